@@ -0,0 +1,143 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "bench_check.h"
+#include "bench_path.h"
+#include "cpu_renderer.h"
+#include "lazy_volume.h"
+#include "thread_pool.h"
+#include "volume_cache.h"
+
+/* =================== LAZY BRICK BENCHMARK =================== */
+// Renders frames along the bench path, at times spread over the bake's
+// loop, from three sources with the default bake settings (or slices):
+//   full bake     VolumeCache::bake up front, then every frame
+//   lazy          LazyVolume with room for every brick
+//   lazy budget   LazyVolume held to a small budget, so bricks are evicted
+// setup is the bake (or nothing), first the first frame including it;
+// hit rate, fills, evictions and stall come from LazyVolumeStats, memory is
+// what the source holds at the end. Exit code is non-zero unless both lazy
+// sources are bit-exact with the bake, the lazy volume touches only part of
+// the grid and the budget is kept.
+//
+// Usage: FlameBrickBench [width] [height] [frames] [budget KiB] [threads] [slices]
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+struct Run {
+    const char* name = "";
+    double setupMs = 0.0, firstMs = 0.0, totalMs = 0.0;
+    std::vector<Image> images;
+};
+
+// Frame i of n: the bench path camera at i of n, time i / n of the loop
+static void renderFrames(Run& run, int width, int height, int frames, float period, ThreadPool& pool,
+                         const RenderOptions& options, Clock::time_point t0) {
+    for (int i = 0; i < frames; i++) {
+        BenchPose pose = benchPose(i, frames);
+        FlameUniforms u;
+        u.camPos = pose.camPos;
+        u.camFront = pose.camFront;
+        u.aspect = (float)width / (float)height;
+        u.time = period * (float)i / (float)frames;
+
+        Image img;
+        img.resize(width, height);
+        renderImage(u, img, pool, options);
+        if (i == 0) run.firstMs = msSince(t0);
+        run.images.push_back(std::move(img));
+    }
+    run.totalMs = msSince(t0);
+}
+
+static bool sameImages(const Run& a, const Run& b) {
+    for (size_t i = 0; i < a.images.size(); i++)
+        if (a.images[i].rgb != b.images[i].rgb) return false;
+    return true;
+}
+
+static void printRun(const Run& run, const LazyVolumeStats* s, size_t bakeBytes) {
+    double mib = (s ? s->memoryBytes : bakeBytes) / (1024.0 * 1024.0);
+    if (!s) {
+        std::printf("%-12s %9.1f %9.1f %9.1f %8s %7s %8s %7s %9s %8.2f\n", run.name, run.setupMs, run.firstMs,
+                    run.totalMs, "-", "-", "-", "-", "-", mib);
+        return;
+    }
+    std::printf("%-12s %9.1f %9.1f %9.1f %7.2f%% %7llu %7.1f%% %7llu %9.1f %8.2f\n", run.name, run.setupMs,
+                run.firstMs, run.totalMs, s->hitRate() * 100.0, (unsigned long long)s->fills,
+                100.0 * s->touchedBricks / s->totalBricks, (unsigned long long)s->evictions, s->stallMs, mib);
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 160;
+    int height = argc > 2 ? std::atoi(argv[2]) : 90;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 8;
+    int budgetKiB = argc > 4 ? std::atoi(argv[4]) : 512;
+    unsigned threads = argc > 5 ? (unsigned)std::atoi(argv[5]) : 0;
+    BakeSettings bake;
+    if (argc > 6) bake.slices = std::atoi(argv[6]);
+    if (width <= 0 || height <= 0 || frames <= 0 || budgetKiB <= 0 || bake.slices <= 0) {
+        std::fprintf(stderr,
+                     "Usage: FlameBrickBench [width] [height] [frames] [budget KiB] [threads] [slices]\n");
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    std::printf("%dx%d, %d frames over a %.0f s loop, %dx%dx%d x %d slices, %u threads\n\n", width, height,
+                frames, bake.period, bake.nx, bake.ny, bake.nz, bake.slices, pool.size());
+
+    Run full;
+    full.name = "full bake";
+    VolumeCache cache;
+    auto t0 = Clock::now();
+    cache.bake(bake, pool);
+    full.setupMs = msSince(t0);
+    RenderOptions baked;
+    baked.baked = &cache;
+    renderFrames(full, width, height, frames, bake.period, pool, baked, t0);
+
+    Run lazy, budget;
+    lazy.name = "lazy";
+    budget.name = "lazy budget";
+    LazyVolumeStats lazyStats, budgetStats;
+    {
+        t0 = Clock::now();
+        LazyVolume volume(bake, (size_t)-1);
+        RenderOptions options;
+        options.lazy = &volume;
+        renderFrames(lazy, width, height, frames, bake.period, pool, options, t0);
+        lazyStats = volume.stats();
+    }
+    {
+        t0 = Clock::now();
+        LazyVolume volume(bake, (size_t)budgetKiB * 1024);
+        RenderOptions options;
+        options.lazy = &volume;
+        renderFrames(budget, width, height, frames, bake.period, pool, options, t0);
+        budgetStats = volume.stats();
+    }
+
+    std::printf("%-12s %9s %9s %9s %8s %7s %8s %7s %9s %8s\n", "source", "setup ms", "first ms", "total ms",
+                "hits", "fills", "touched", "evicted", "stall ms", "MiB");
+    printRun(full, nullptr, cache.memoryBytes());
+    printRun(lazy, &lazyStats, 0);
+    printRun(budget, &budgetStats, 0);
+    std::printf("lazy budget: %zu slots of %zu bricks, %llu coalesced, %llu retries\n\n",
+                budgetStats.capacityBricks, budgetStats.totalBricks, (unsigned long long)budgetStats.coalesced,
+                (unsigned long long)budgetStats.retries);
+
+    bool ok = check("lazy bit-exact with the bake", sameImages(lazy, full));
+    ok &= check("lazy budget bit-exact with the bake", sameImages(budget, full));
+    ok &= check("lazy touches part of the grid", lazyStats.touchedBricks < lazyStats.totalBricks);
+    ok &= check("lazy budget within its slots",
+                budgetStats.residentBricks <= budgetStats.capacityBricks &&
+                    budgetStats.memoryBytes <= budgetStats.budgetBytes);
+    return ok ? 0 : 1;
+}
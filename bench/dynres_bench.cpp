@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_path.h"
+#include "cpu_renderer.h"
+#include "dynamic_resolution.h"
+#include "screen_rect.h"
+#include "thread_pool.h"
+
+/* =================== DYNAMIC RESOLUTION BENCHMARK =================== */
+// First the controller alone against a synthetic flame pass whose times
+// arrive GPU-like, a few frames late, with noise: the camera sits far away,
+// flies into the flame (rect and cost per pixel grow), stays inside, then
+// backs out. Checked per phase: frames over budget after a jump (reaction),
+// scale changes once settled (oscillation), and the scale recovering.
+// Then the CPU renderer along the bench camera path at a fixed full-scale
+// flame and with the controller, budget half the slowest full-scale frame.
+// Exit code is non-zero if a synthetic check fails.
+//
+// Usage: FlameDynResBench [width] [height] [frames] [threads] [-v: print each scale change]
+
+/* =================== SYNTHETIC FLAME PASS =================== */
+
+constexpr int SYNTH_LATENCY = 3;         // frames before a pass time is known
+constexpr int SYNTH_PHASE_FRAMES = 120;
+constexpr int SYNTH_SETTLE_FRAMES = 30;  // after which a phase should hold its scale
+constexpr double SYNTH_BUDGET_MS = 8.0;
+constexpr long long SYNTH_SCREEN = 1280LL * 720LL;
+
+struct SynthPhase {
+    const char* name;
+    double rectFrom, rectTo;     // fraction of the screen, lerped over the phase
+    double nsFrom, nsTo;         // ns per marched pixel
+    int maxOver;                 // frames allowed over budget
+    int maxSettledChanges;
+    bool endAtMax;               // must be back at maxScale by the end
+};
+
+static const SynthPhase SYNTH_PHASES[] = {
+    {"far", 0.05, 0.05, 4.0, 4.0, 0, 0, true},
+    {"fly in", 0.05, 1.0, 4.0, 14.0, SYNTH_LATENCY + 1, 1 << 30, false},
+    {"inside", 1.0, 1.0, 14.0, 14.0, 0, 1, false},
+    {"spike", 1.0, 1.0, 40.0, 40.0, SYNTH_LATENCY + 1, 1, false},
+    {"back out", 0.3, 0.3, 6.0, 6.0, 0, 1 << 30, true},
+};
+
+static bool runSynthetic(bool verbose) {
+    DynamicResolutionSettings settings;
+    settings.budgetMs = SYNTH_BUDGET_MS;
+    DynamicResolution dyn(settings);
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> noise(0.9, 1.1);
+    std::deque<std::pair<double, long long>> inFlight;   // pass times not yet read back
+
+    std::printf("synthetic flame pass: budget %.1f ms, times read back %d frames late, +-10%% noise\n",
+                SYNTH_BUDGET_MS, SYNTH_LATENCY);
+    std::printf("%-10s %10s %10s %10s %8s %8s %10s  %s\n", "phase", "mean ms", "max ms", "mean scale", "over",
+                "changes", "settled", "check");
+    bool ok = true;
+    for (const SynthPhase& ph : SYNTH_PHASES) {
+        double sumMs = 0.0, maxMs = 0.0, sumScale = 0.0;
+        int over = 0, changes = 0, settledChanges = 0;
+        for (int i = 0; i < SYNTH_PHASE_FRAMES; i++) {
+            double t = std::min(1.0, i / (SYNTH_PHASE_FRAMES * 0.5));
+            long long rect = (long long)(SYNTH_SCREEN * (ph.rectFrom + (ph.rectTo - ph.rectFrom) * t));
+            double ns = ph.nsFrom + (ph.nsTo - ph.nsFrom) * t;
+
+            ScaleChange change;
+            if (dyn.update(rect, &change)) {
+                changes++;
+                if (i >= SYNTH_SETTLE_FRAMES) settledChanges++;
+                if (verbose)
+                    std::printf("  %-9s frame %4d: scale %.3f -> %.3f (pass %.2f ms, predicted %.2f ms)\n", ph.name,
+                                change.frame, change.from, change.to, change.sampleMs, change.predictedMs);
+            }
+            float s = dyn.scale();
+            long long pixels = (long long)(rect * (double)s * s);
+            double ms = 0.2 + pixels * ns * 1e-6 * noise(rng);
+            inFlight.push_back({ms, pixels});
+            if ((int)inFlight.size() > SYNTH_LATENCY) {
+                dyn.addSample(inFlight.front().first, inFlight.front().second);
+                inFlight.pop_front();
+            }
+
+            sumMs += ms;
+            maxMs = std::max(maxMs, ms);
+            sumScale += s;
+            if (ms > SYNTH_BUDGET_MS) over++;
+        }
+        bool pass = over <= ph.maxOver && settledChanges <= ph.maxSettledChanges &&
+                    (!ph.endAtMax || dyn.scale() == settings.maxScale);
+        std::printf("%-10s %10.2f %10.2f %10.3f %8d %8d %10d  %s\n", ph.name, sumMs / SYNTH_PHASE_FRAMES, maxMs,
+                    sumScale / SYNTH_PHASE_FRAMES, over, changes, settledChanges, pass ? "ok" : "FAILED");
+        ok = ok && pass;
+    }
+    std::printf("over: frames above budget; settled: changes after the first %d frames of the phase\n\n",
+                SYNTH_SETTLE_FRAMES);
+    return ok;
+}
+
+/* =================== CPU RENDERER =================== */
+
+struct PathFrame {
+    double ms = 0.0;
+    float scale = 1.0f;
+    bool changed = false;
+};
+
+// Frames along the bench path, the flame at a fixed scale 1 (dyn null) or
+// the controller's
+static std::vector<PathFrame> runPath(int width, int height, int frames, ThreadPool& pool, DynamicResolution* dyn,
+                                      bool verbose) {
+    Image img;
+    img.resize(width, height);
+    std::vector<PathFrame> out((size_t)frames);
+    for (int f = 0; f < frames; f++) {
+        BenchPose pose = benchPose(f, frames);
+        FlameUniforms u;
+        u.camPos = pose.camPos;
+        u.camFront = pose.camFront;
+        u.aspect = (float)width / (float)height;
+        u.time = f * BENCH_DEFAULT_DT;
+
+        RenderOptions options;
+        options.screenRect = true;
+        if (dyn) {
+            ScaleChange change;
+            out[f].changed = dyn->update(flameScreenRect(u, width, height).area(), &change);
+            if (out[f].changed && verbose)
+                std::printf("  frame %4d: scale %.3f -> %.3f (frame %.2f ms, predicted %.2f ms)\n", f, change.from,
+                            change.to, change.sampleMs, change.predictedMs);
+            options.flameScale = dyn->scale();
+        }
+        RenderStats stats = renderImage(u, img, pool, options);
+        out[f].ms = stats.seconds * 1000.0;
+        out[f].scale = options.flameScale;
+        if (dyn) dyn->addSample(out[f].ms, (long long)stats.shadedPixels);
+    }
+    return out;
+}
+
+static void printSegments(const char* mode, const std::vector<PathFrame>& frames, double budgetMs) {
+    const int count = (int)frames.size();
+    for (int seg = 0; seg < BENCH_SEGMENT_COUNT; seg++) {
+        double sumMs = 0.0, maxMs = 0.0, sumScale = 0.0;
+        int n = 0, over = 0, changes = 0;
+        for (int f = seg * count / BENCH_SEGMENT_COUNT; f < (seg + 1) * count / BENCH_SEGMENT_COUNT; f++) {
+            sumMs += frames[f].ms;
+            maxMs = std::max(maxMs, frames[f].ms);
+            sumScale += frames[f].scale;
+            over += frames[f].ms > budgetMs;
+            changes += frames[f].changed;
+            n++;
+        }
+        std::printf("%-10s %-10s %10.2f %10.2f %10.3f %7.1f%% %8d\n", mode, benchSegmentName(seg), sumMs / n, maxMs,
+                    sumScale / n, 100.0 * over / n, changes);
+    }
+}
+
+int main(int argc, char** argv) {
+    bool verbose = false;
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-v") verbose = true;
+        else args.push_back(argv[i]);
+    }
+    int width = args.size() > 0 ? std::atoi(args[0]) : 160;
+    int height = args.size() > 1 ? std::atoi(args[1]) : 90;
+    int frames = args.size() > 2 ? std::atoi(args[2]) : 120;
+    unsigned threads = args.size() > 3 ? (unsigned)std::atoi(args[3]) : 0;
+    if (width <= 0 || height <= 0 || frames < BENCH_SEGMENT_COUNT) {
+        std::fprintf(stderr, "Usage: FlameDynResBench [width] [height] [frames] [threads] [-v]\n");
+        return 1;
+    }
+
+    bool ok = runSynthetic(verbose);
+
+    ThreadPool pool(threads);
+    std::vector<PathFrame> fixed = runPath(width, height, frames, pool, nullptr, false);
+    DynamicResolutionSettings settings;
+    settings.budgetMs = 0.0;
+    for (const PathFrame& f : fixed) settings.budgetMs = std::max(settings.budgetMs, 0.5 * f.ms);
+    DynamicResolution dyn(settings);
+    std::vector<PathFrame> dynamic = runPath(width, height, frames, pool, &dyn, verbose);
+
+    std::printf("CPU renderer %dx%d, %d frames on the bench path, %u threads, budget %.2f ms "
+                "(half the slowest full-scale frame)\n", width, height, frames, pool.size(), settings.budgetMs);
+    std::printf("%-10s %-10s %10s %10s %10s %8s %8s\n", "flame", "segment", "mean ms", "max ms", "mean scale",
+                "over", "changes");
+    printSegments("fixed 1.0", fixed, settings.budgetMs);
+    printSegments("dynamic", dynamic, settings.budgetMs);
+    std::printf("\nCPU times are known the same frame; the synthetic run covers read-back latency\n");
+    return ok ? 0 : 1;
+}
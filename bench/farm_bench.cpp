@@ -0,0 +1,190 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu_renderer.h"
+#include "image_io.h"
+#include "render_farm.h"
+#include "thread_pool.h"
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/* =================== RENDER FARM BENCHMARK =================== */
+// Renders a short sequence through a coordinator and 1, 2, 4, ... local
+// worker processes (forked, talking TCP over loopback) and prints the
+// throughput against one worker, then kills a worker mid-frame to check
+// its frame is re-issued. Every frame written is compared byte for byte
+// with a render in this process. Exit code is non-zero if a frame is
+// missing or differs, the lost frame was not re-issued, or a coordinator
+// given a tile size or flame scale no worker can render starts anyway.
+//
+// Workers scale with the cores they get: give each worker threads / cores
+// so the worker counts tried fit the machine.
+//
+// Usage: FlameFarmBench [frames] [width] [height] [max workers] [threads per worker]
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+int main() {
+    std::printf("FlameFarmBench forks its workers and needs a POSIX system; start FlameCpu --worker\n"
+                "processes by hand instead (see README)\n");
+    return 0;
+}
+#else
+
+struct Run {
+    FarmReport report;
+    bool exact = true;
+};
+
+// Frames first..last rendered here, 8-bit, as the farm's PNGs hold them
+static std::vector<std::vector<uint8_t>> renderReference(const SequenceSettings& s, unsigned threads,
+                                                         double& seconds) {
+    ThreadPool pool(threads);
+    std::vector<std::vector<uint8_t>> frames;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int f = s.firstFrame; f <= s.lastFrame; f++) {
+        FlameUniforms u;
+        u.time = (float)f / s.fps;
+        u.aspect = (float)s.width / (float)s.height;
+        Image img;
+        img.resize(s.width, s.height);
+        renderImage(u, img, pool, {});
+        frames.push_back(toRGB8(img));
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return frames;
+}
+
+// Coordinator here, workers forked; killOne SIGKILLs a busy worker when the
+// first frame comes back
+static Run runFarm(SequenceSettings s, const std::string& dir, int workers, unsigned threads, bool killOne,
+                   const std::vector<std::vector<uint8_t>>& reference) {
+    Run run;
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+    s.outPattern = dir + "/frame_%04d";
+
+    FarmCoordinator coordinator;
+    if (!coordinator.listen(0)) {
+        std::fprintf(stderr, "Cannot listen on a loopback port\n");
+        run.exact = false;
+        return run;
+    }
+
+    // Staggered so the coordinator accepts (and numbers) them in fork order
+    std::fflush(stdout);
+    std::vector<pid_t> pids;
+    for (int w = 0; w < workers; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            std::freopen("/dev/null", "w", stdout);
+            _exit(runFarmWorker("127.0.0.1", coordinator.port(), threads, 10.0) ? 0 : 1);
+        }
+        pids.push_back(pid);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    FarmSettings farm;
+    farm.workerTimeout = 60.0;
+    farm.log = false;
+    bool killed = false;
+    if (killOne) {
+        // Every other worker is mid-frame when the first one reports
+        farm.onFrame = [&](int, int worker) {
+            if (killed) return;
+            kill(pids[(worker + 1) % workers], SIGKILL);
+            killed = true;
+        };
+    }
+
+    run.report = coordinator.run(s, FlameUniforms{}, RenderOptions{}, farm);
+    for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+
+    for (int f = s.firstFrame; f <= s.lastFrame; f++) {
+        Image img;
+        bool same = readImage(framePath(s.outPattern, f, ".png"), img) && toRGB8(img) == reference[f - s.firstFrame];
+        if (!same) std::fprintf(stderr, "frame %d: missing or different from the local render\n", f);
+        run.exact = run.exact && same;
+    }
+    fs::remove_all(dir, ec);
+    return run;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 24;
+    int width = argc > 2 ? std::atoi(argv[2]) : 160;
+    int height = argc > 3 ? std::atoi(argv[3]) : 90;
+    int maxWorkers = argc > 4 ? std::atoi(argv[4]) : 4;
+    unsigned threads = argc > 5 ? (unsigned)std::atoi(argv[5]) : 1;
+    if (frames <= 0 || width <= 0 || height <= 0 || maxWorkers <= 0 || threads == 0) {
+        std::fprintf(stderr, "Usage: FlameFarmBench [frames] [width] [height] [max workers] [threads per worker]\n");
+        return 1;
+    }
+
+    SequenceSettings s;
+    s.firstFrame = 0;
+    s.lastFrame = frames - 1;
+    s.width = width;
+    s.height = height;
+    std::string dir = (fs::temp_directory_path() / ("flame_farm_bench_" + std::to_string(getpid()))).string();
+
+    double localSeconds = 0.0;
+    std::vector<std::vector<uint8_t>> reference = renderReference(s, threads, localSeconds);
+    std::printf("%d frames at %dx%d, %u threads per worker, %u hardware threads\n\n", frames, width, height,
+                threads, std::thread::hardware_concurrency());
+    std::printf("%-16s %10s %10s %9s  %-24s %s\n", "workers", "seconds", "frames/s", "speedup", "frames per worker",
+                "exact");
+    std::printf("%-16s %10.2f %10.2f %9s  %-24s %s\n", "local (no farm)", localSeconds, frames / localSeconds, "-",
+                "-", "ref");
+
+    bool ok = true;
+    double oneWorker = 0.0;
+    for (int n = 1; n <= maxWorkers; n *= 2) {
+        Run r = runFarm(s, dir, n, threads, false, reference);
+        if (n == 1) oneWorker = r.report.seconds;
+        std::string split;
+        for (int c : r.report.framesPerWorker) split += (split.empty() ? "" : " ") + std::to_string(c);
+        char label[32], speedup[32];
+        std::snprintf(label, sizeof(label), "%d", n);
+        std::snprintf(speedup, sizeof(speedup), "%.2fx", oneWorker / r.report.seconds);
+        std::printf("%-16s %10.2f %10.2f %9s  %-24s %s\n", label, r.report.seconds, frames / r.report.seconds,
+                    speedup, split.c_str(), r.exact ? "yes" : "NO");
+        ok = ok && r.exact && r.report.failed == 0;
+    }
+
+    // Worker loss: one of the workers is killed mid-frame
+    int n = maxWorkers >= 3 ? 3 : 2;
+    Run r = runFarm(s, dir, n, threads, true, reference);
+    bool recovered = r.exact && r.report.failed == 0 && r.report.workersLost == 1 && r.report.reissued == 1;
+    std::printf("\nkilled 1 of %d workers: %d lost, %d frame re-issued, all frames %s: %s\n", n,
+                r.report.workersLost, r.report.reissued, r.exact ? "exact" : "NOT exact",
+                recovered ? "ok" : "FAILED");
+    ok = ok && recovered;
+
+    // Options every worker would refuse: run() fails every frame at once
+    bool refused = true;
+    for (int k = 0; k < 4; k++) {
+        RenderOptions bad;
+        if (k == 0) bad.tileSize = 0;
+        else bad.flameScale = k == 1 ? 0.0f : k == 2 ? 1.5f : NAN;
+        FarmCoordinator coordinator;
+        FarmReport report = coordinator.listen(0) ? coordinator.run(s, FlameUniforms{}, bad) : FarmReport{};
+        refused = refused && report.failed == frames && report.rendered == 0 && report.workersJoined == 0;
+    }
+    std::printf("tile size 0, flame scale 0 / 1.5 / NaN refused: %s\n", refused ? "ok" : "FAILED");
+    ok = ok && refused;
+    return ok ? 0 : 1;
+}
+#endif
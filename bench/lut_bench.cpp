@@ -0,0 +1,160 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "cpu_renderer.h"
+#include "flame_tables.h"
+#include "thread_pool.h"
+
+/* =================== SHAPE TABLE BENCHMARK =================== */
+// Max absolute difference of each table lookup from the exact function it
+// replaces (dense sweeps over h, temp and the flame's cross-section) against
+// the tolerances in flame_tables.h, throughput of the per-sample shape and
+// colour terms exact and tabled, then a production frame rendered both ways.
+// Exit code is non-zero if a tolerance is exceeded.
+//
+// Usage: FlameLutBench [samples] [width] [height] [repeats] [threads]
+
+/* =================== ACCURACY =================== */
+
+static bool report(const char* name, const char* domain, double maxAbs, double tolerance) {
+    bool ok = maxAbs <= tolerance;
+    std::printf("%-12s %-30s %12.3g %12.3g %6.0f%% %s\n", name, domain, maxAbs, tolerance,
+                maxAbs / tolerance * 100.0, ok ? "ok" : "EXCEEDED");
+    return ok;
+}
+
+static bool checkAccuracy(int samples) {
+    const FlameTables& t = flameTables();
+    std::printf("%-12s %-30s %12s %12s %7s\n", "lookup", "domain", "max abs err", "tolerance", "of tol");
+    bool ok = true;
+
+    double radius = 0.0, heightTemp = 0.0;
+    for (int i = 0; i <= samples; i++) {
+        float h = (float)i / (float)samples;
+        FlameProfileEntry e = t.profileAt(h);
+        radius = std::fmax(radius, std::fabs(e.radius - flameRadius(h)));
+        heightTemp = std::fmax(heightTemp, std::fabs(e.heightTemp - flameHeightTemp(h)));
+    }
+    ok &= report("radius", "h in [0, 1]", radius, FLAME_TABLE_RADIUS_TOLERANCE);
+    ok &= report("heightTemp", "h in [0, 1]", heightTemp, FLAME_TABLE_HEIGHT_TEMP_TOLERANCE);
+
+    // Points anywhere in and just around the flame, any temperature
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f), angle(0.0f, 6.2831853f);
+    double emission = 0.0;
+    for (int i = 0; i < samples; i++) {
+        float h = unit(rng), temp = unit(rng), a = angle(rng);
+        float r = unit(rng) * 1.5f * FLAME_BASE_WIDTH * 1.35f;
+        Vec3 p = {r * cosf(a), h * FLAME_HEIGHT, r * sinf(a)};
+        Vec3 d = flameEmissionTable(p, temp) - flameEmission(p, temp);
+        emission = std::fmax(emission, std::fmax(std::fabs(d.x), std::fmax(std::fabs(d.y), std::fabs(d.z))));
+    }
+    ok &= report("emission", "flame cross-section, temp [0,1]", emission, FLAME_TABLE_EMISSION_TOLERANCE);
+    std::printf("\n");
+    return ok;
+}
+
+/* =================== THROUGHPUT =================== */
+
+template <class Fn>
+static double bestSeconds(int repeats, Fn fn) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+// The shape and colour terms one in-flame march step evaluates: radius,
+// heightTemp and the emission colour
+static void benchThroughput(int samples, int repeats) {
+    std::vector<Vec3> ps(samples);
+    std::vector<float> temps(samples);
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int i = 0; i < samples; i++) {
+        ps[i] = {(unit(rng) - 0.5f) * 0.3f, unit(rng) * FLAME_HEIGHT, (unit(rng) - 0.5f) * 0.3f};
+        temps[i] = unit(rng);
+    }
+    volatile float sink = 0.0f;
+
+    double exactSec = bestSeconds(repeats, [&] {
+        float acc = 0.0f;
+        for (int i = 0; i < samples; i++) {
+            float h = ps[i].y / FLAME_HEIGHT;
+            acc += flameRadius(h) + flameHeightTemp(h) + flameEmission(ps[i], temps[i]).x;
+        }
+        sink = sink + acc;
+    });
+    const FlameTables& t = flameTables();
+    double tableSec = bestSeconds(repeats, [&] {
+        float acc = 0.0f;
+        for (int i = 0; i < samples; i++) {
+            FlameProfileEntry e = t.profileAt(ps[i].y / FLAME_HEIGHT);
+            acc += e.radius + e.heightTemp + flameEmissionTable(ps[i], temps[i]).x;
+        }
+        sink = sink + acc;
+    });
+
+    std::printf("%-26s %14s %9s\n", "shape + colour terms", "Msamples/s", "speedup");
+    std::printf("%-26s %14.2f %9s\n", "exact", samples / exactSec * 1e-6, "1.00x");
+    std::printf("%-26s %14.2f %8.2fx\n\n", "tables", samples / tableSec * 1e-6, exactSec / tableSec);
+}
+
+/* =================== FRAMES =================== */
+
+static void benchFrames(int width, int height, int repeats, unsigned threads) {
+    ThreadPool pool(threads);
+    FlameUniforms u;
+    u.aspect = (float)width / (float)height;
+    u.time = 1.0f;
+
+    Image images[2];
+    double ms[2];
+    for (int v = 0; v < 2; v++) {
+        RenderOptions options;
+        options.tables = v == 1;
+        images[v].resize(width, height);
+        ms[v] = 1e30;
+        for (int r = 0; r < repeats; r++) ms[v] = std::fmin(ms[v], renderImage(u, images[v], pool, options).seconds * 1000.0);
+    }
+
+    double sum = 0.0;
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < images[0].rgb.size(); i++) {
+        float d = images[1].rgb[i] - images[0].rgb[i];
+        sum += (double)d * d;
+        maxDiff = std::fmax(maxDiff, std::fabs(d));
+    }
+    double rmse255 = std::sqrt(sum / (double)images[0].rgb.size()) * 255.0;
+
+    std::printf("production %dx%d, best of %d, %u threads\n", width, height, repeats, pool.size());
+    std::printf("%-10s %10s %9s %10s %10s\n", "shape", "ms", "speedup", "RMSE", "max diff");
+    std::printf("%-10s %10.2f %9s %10s %10s\n", "exact", ms[0], "1.00x", "-", "-");
+    std::printf("%-10s %10.2f %8.2fx %10.3f %10d\n", "tables", ms[1], ms[0] / ms[1], rmse255,
+                (int)(maxDiff * 255.0f + 0.5f));
+    std::printf("\nRMSE and max diff in 8-bit steps against the exact render\n");
+}
+
+int main(int argc, char** argv) {
+    int samples = argc > 1 ? std::atoi(argv[1]) : 1 << 20;
+    int width = argc > 2 ? std::atoi(argv[2]) : 480;
+    int height = argc > 3 ? std::atoi(argv[3]) : 270;
+    int repeats = argc > 4 ? std::atoi(argv[4]) : 3;
+    unsigned threads = argc > 5 ? (unsigned)std::atoi(argv[5]) : 0;
+    if (samples <= 0 || width <= 0 || height <= 0 || repeats <= 0) {
+        std::fprintf(stderr, "Usage: FlameLutBench [samples] [width] [height] [repeats] [threads]\n");
+        return 1;
+    }
+    bool ok = checkAccuracy(samples);
+    benchThroughput(samples, repeats);
+    benchFrames(width, height, repeats, threads);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,303 @@
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "flame_field.h"
+#include "simd_math.h"
+
+/* =================== FAST MATH BENCHMARK =================== */
+// Accuracy of the fast math against double-precision libm over each
+// function's domain (every stride-th float bit pattern, so each binade is
+// covered evenly, plus uniform samples where the range is small), then
+// throughput of the libm calls against every math kernel this CPU supports,
+// with a bit-exactness check of each packet kernel against the scalar one.
+// Exit code is non-zero if an error bound is exceeded or a kernel disagrees.
+//
+// Usage: FlameMathBench [points] [repeats] [sweep stride]
+
+static uint32_t floatBits(float f) {
+    uint32_t b;
+    std::memcpy(&b, &f, sizeof(b));
+    return b;
+}
+
+static float bitsFloat(uint32_t b) {
+    float f;
+    std::memcpy(&f, &b, sizeof(f));
+    return f;
+}
+
+// Every stride-th float from lo to hi, 0 <= lo < hi
+static void sweep(float lo, float hi, uint32_t stride, std::vector<float>& out) {
+    for (uint64_t b = floatBits(lo); b <= floatBits(hi); b += stride) out.push_back(bitsFloat((uint32_t)b));
+}
+
+static void uniform(float lo, float hi, size_t n, std::vector<float>& out) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> d(lo, hi);
+    for (size_t i = 0; i < n; i++) out.push_back(d(rng));
+}
+
+/* =================== ACCURACY =================== */
+
+struct Accuracy {
+    size_t samples = 0;
+    double maxRel = 0.0;
+    double worst = 0.0;   // largest error / bound
+};
+
+static void accumulate(Accuracy& a, double got, double ref, double bound) {
+    double rel = std::fabs(got - ref) / std::fabs(ref);
+    a.samples++;
+    if (rel > a.maxRel) a.maxRel = rel;
+    if (rel / bound > a.worst) a.worst = rel / bound;
+}
+
+static bool report(const char* name, const char* domain, const char* bound, const Accuracy& a) {
+    bool ok = a.worst <= 1.0;
+    std::printf("%-12s %-20s %10zu %12.3g %-22s %6.0f%% %s\n", name, domain, a.samples, a.maxRel, bound,
+                a.worst * 100.0, ok ? "ok" : "EXCEEDED");
+    return ok;
+}
+
+static bool checkAccuracy(uint32_t stride) {
+    std::printf("%-12s %-20s %10s %12s %-22s %7s\n", "function", "domain", "samples", "max rel err",
+                "bound", "of bound");
+    bool ok = true;
+    char bound[64];
+
+    {
+        std::vector<float> xs;
+        sweep(0.0f, FAST_EXP_MAX, stride, xs);
+        size_t positive = xs.size();
+        sweep(0.0f, 87.0f, stride, xs);
+        for (size_t i = positive; i < xs.size(); i++) xs[i] = -xs[i];
+        uniform(-87.0f, FAST_EXP_MAX, xs.size() / 4, xs);
+        Accuracy a;
+        for (float x : xs) accumulate(a, fastExp(x), std::exp((double)x), FAST_EXP_MAX_REL_ERROR);
+        std::snprintf(bound, sizeof(bound), "%.2g", FAST_EXP_MAX_REL_ERROR);
+        ok &= report("exp", "[-87, 88]", bound, a);
+    }
+    {
+        std::vector<float> xs;
+        sweep(FLT_MIN, FLT_MAX, stride, xs);
+        Accuracy a;
+        for (float x : xs)
+            if (x != 1.0f) accumulate(a, fastLog(x), std::log((double)x), FAST_LOG_MAX_REL_ERROR);
+        std::snprintf(bound, sizeof(bound), "%.2g", FAST_LOG_MAX_REL_ERROR);
+        ok &= report("log", "[FLT_MIN, FLT_MAX]", bound, a);
+    }
+    {
+        // x log-uniform over [1e-6, 1e6], y over [-4, 4]: |y ln x| up to ~55
+        std::mt19937 rng(99);
+        std::uniform_real_distribution<float> lx(-13.8f, 13.8f), dy(-4.0f, 4.0f);
+        size_t n = (size_t)((1u << 30) / stride);
+        Accuracy a;
+        for (size_t i = 0; i < n; i++) {
+            float x = std::exp(lx(rng)), y = dy(rng);
+            double t = std::fabs((double)y * std::log((double)x));
+            accumulate(a, fastPow(x, y), std::pow((double)x, (double)y),
+                       FAST_POW_MAX_REL_ERROR + FAST_POW_REL_ERROR_PER_LOG * t);
+        }
+        std::snprintf(bound, sizeof(bound), "%.2g + %.2g|y ln x|", FAST_POW_MAX_REL_ERROR,
+                      FAST_POW_REL_ERROR_PER_LOG);
+        ok &= report("pow", "[1e-6, 1e6]^[-4, 4]", bound, a);
+    }
+    {
+        std::vector<float> xs;
+        sweep(FLT_MIN, FLT_MAX, stride, xs);
+        Accuracy s, r;
+        for (float x : xs) {
+            accumulate(s, fastSqrt(x), std::sqrt((double)x), FAST_SQRT_MAX_REL_ERROR);
+            accumulate(r, fastInverseSqrt(x), 1.0 / std::sqrt((double)x), FAST_INVERSESQRT_MAX_REL_ERROR);
+        }
+        std::snprintf(bound, sizeof(bound), "%.2g", FAST_SQRT_MAX_REL_ERROR);
+        ok &= report("sqrt", "[FLT_MIN, FLT_MAX]", bound, s);
+        std::snprintf(bound, sizeof(bound), "%.2g", FAST_INVERSESQRT_MAX_REL_ERROR);
+        ok &= report("inversesqrt", "[FLT_MIN, FLT_MAX]", bound, r);
+    }
+
+    // normalize() edge cases on every kernel: zero stays zero, and a vector
+    // with a tiny (still normal) squared length comes out unit. Subnormal
+    // squared lengths keep only a few bits, so there the result must just
+    // be finite.
+    {
+        const float cases[][3] = {{0.0f, 0.0f, 0.0f}, {-0.0f, 0.0f, -0.0f}, {1e-18f, -2e-18f, 3e-18f},
+                                  {0.0f, 3e-19f, -4e-19f}, {1e-20f, 0.0f, 0.0f}};
+        constexpr size_t n = sizeof(cases) / sizeof(cases[0]);
+        Accuracy a;
+        bool edgesOk = true;
+        for (SimdIsa isa : {SimdIsa::Scalar, SimdIsa::SSE41, SimdIsa::AVX2, SimdIsa::NEON}) {
+            const MathKernels* k = mathKernelsFor(isa);
+            if (!k) continue;
+            float x[n], y[n], z[n];
+            for (size_t i = 0; i < n; i++) { x[i] = cases[i][0]; y[i] = cases[i][1]; z[i] = cases[i][2]; }
+            k->normalize(x, y, z, n);
+            for (size_t i = 0; i < n; i++) {
+                double cx = cases[i][0], cy = cases[i][1], cz = cases[i][2];
+                double len2 = cx * cx + cy * cy + cz * cz;
+                if (len2 == 0.0) {
+                    edgesOk = edgesOk && x[i] == 0.0f && y[i] == 0.0f && z[i] == 0.0f;
+                } else if (len2 < FLT_MIN) {
+                    edgesOk = edgesOk && std::isfinite(x[i]) && std::isfinite(y[i]) && std::isfinite(z[i]);
+                } else {
+                    // Error of the whole vector, relative to its unit length
+                    double len = std::sqrt(len2);
+                    double dx = x[i] - cx / len, dy = y[i] - cy / len, dz = z[i] - cz / len;
+                    accumulate(a, 1.0 + std::sqrt(dx * dx + dy * dy + dz * dz), 1.0,
+                               2.0 * FAST_INVERSESQRT_MAX_REL_ERROR);
+                }
+            }
+        }
+        if (!edgesOk) a.worst = INFINITY;
+        std::snprintf(bound, sizeof(bound), "%.2g, 0 stays 0", 2.0 * FAST_INVERSESQRT_MAX_REL_ERROR);
+        ok &= report("normalize", "zero / near-zero", bound, a);
+    }
+
+    // The ported shader function, against the libm version it stands in for
+    std::vector<float> hs;
+    uniform(0.0f, 1.0f, 1 << 20, hs);
+    std::vector<float> fast(hs.size());
+    mathKernelsFor(SimdIsa::Scalar)->flameRadius(hs.data(), fast.data(), hs.size());
+    double maxAbs = 0.0;
+    for (size_t i = 0; i < hs.size(); i++) maxAbs = std::fmax(maxAbs, std::fabs(fast[i] - flameRadius(hs[i])));
+    std::printf("\nflameRadius over h in [0, 1]: max abs difference from libm %.3g (%.2g of FLAME_BASE_WIDTH)\n\n",
+                maxAbs, maxAbs / FLAME_BASE_WIDTH);
+    return ok;
+}
+
+/* =================== THROUGHPUT =================== */
+
+template <class Fn>
+static double bestSeconds(int repeats, Fn fn) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+enum class Op { Exp, Log, Pow, Sqrt, Normalize, FlameRadius };
+
+struct Case {
+    const char* name;
+    Op op;
+    float lo, hi;
+};
+
+constexpr float TONE_GAMMA = 1.0f / 2.2f;
+
+static void runKernel(const MathKernels& k, Op op, const std::vector<float>& in,
+                      std::vector<float>& x, std::vector<float>& y, std::vector<float>& z) {
+    size_t n = in.size() / 3;
+    switch (op) {
+    case Op::Exp:  k.exp(in.data(), x.data(), n); break;
+    case Op::Log:  k.log(in.data(), x.data(), n); break;
+    case Op::Pow:  k.pow(in.data(), TONE_GAMMA, x.data(), n); break;
+    case Op::Sqrt: k.sqrt(in.data(), x.data(), n); break;
+    case Op::FlameRadius: k.flameRadius(in.data(), x.data(), n); break;
+    case Op::Normalize:
+        std::memcpy(x.data(), in.data(), n * sizeof(float));
+        std::memcpy(y.data(), in.data() + n, n * sizeof(float));
+        std::memcpy(z.data(), in.data() + 2 * n, n * sizeof(float));
+        k.normalize(x.data(), y.data(), z.data(), n);
+        break;
+    }
+}
+
+static void runLibm(Op op, const std::vector<float>& in, std::vector<float>& x, std::vector<float>& y,
+                    std::vector<float>& z) {
+    size_t n = in.size() / 3;
+    for (size_t i = 0; i < n; i++) {
+        float v = in[i];
+        switch (op) {
+        case Op::Exp:  x[i] = expf(v); break;
+        case Op::Log:  x[i] = logf(v); break;
+        case Op::Pow:  x[i] = powf(v, TONE_GAMMA); break;
+        case Op::Sqrt: x[i] = sqrtf(v); break;
+        case Op::FlameRadius: x[i] = flameRadius(v); break;
+        case Op::Normalize: {
+            Vec3 r = normalize(Vec3{v, in[n + i], in[2 * n + i]});
+            x[i] = r.x; y[i] = r.y; z[i] = r.z;
+            break;
+        }
+        }
+    }
+}
+
+static bool benchThroughput(size_t n, int repeats) {
+    const Case cases[] = {
+        {"exp", Op::Exp, -10.0f, 10.0f},
+        {"log", Op::Log, 1e-3f, 1e3f},
+        {"pow(x,1/2.2)", Op::Pow, 0.0f, 4.0f},
+        {"sqrt", Op::Sqrt, 0.0f, 1e4f},
+        {"normalize", Op::Normalize, -1.0f, 1.0f},
+        {"flameRadius", Op::FlameRadius, 0.0f, 1.0f},
+    };
+    const MathKernels& scalar = *mathKernelsFor(SimdIsa::Scalar);
+    std::vector<float> x(n), y(n), z(n), rx(n), ry(n), rz(n);
+    volatile float sink = 0.0f;
+
+    std::printf("points: %zu, repeats: %d, auto-selected kernels: %s\n\n", n, repeats, mathKernels().name);
+    std::printf("%-10s %-14s %14s %10s %s\n", "kernel", "function", "Msamples/s", "vs libm", "exact");
+
+    bool allExact = true;
+    for (const Case& c : cases) {
+        std::vector<float> in;
+        uniform(c.lo, c.hi, 3 * n, in);   // x | y | z
+
+        double libmSec = bestSeconds(repeats, [&] {
+            runLibm(c.op, in, x, y, z);
+            sink = sink + x[n / 2];
+        });
+        std::printf("%-10s %-14s %14.2f %10s %s\n", "libm", c.name, n / libmSec * 1e-6, "1.00x", "-");
+
+        runKernel(scalar, c.op, in, rx, ry, rz);
+        for (SimdIsa isa : {SimdIsa::Scalar, SimdIsa::SSE41, SimdIsa::AVX2, SimdIsa::NEON}) {
+            const MathKernels* k = mathKernelsFor(isa);
+            if (!k) continue;
+            double sec = bestSeconds(repeats, [&] {
+                runKernel(*k, c.op, in, x, y, z);
+                sink = sink + x[n / 2];
+            });
+            size_t mismatches = 0;
+            for (size_t i = 0; i < n; i++) {
+                bool same = std::memcmp(&x[i], &rx[i], sizeof(float)) == 0;
+                if (c.op == Op::Normalize)
+                    same = same && std::memcmp(&y[i], &ry[i], sizeof(float)) == 0
+                                && std::memcmp(&z[i], &rz[i], sizeof(float)) == 0;
+                if (!same) mismatches++;
+            }
+            allExact = allExact && mismatches == 0;
+
+            char speedup[32];
+            std::snprintf(speedup, sizeof(speedup), "%.2fx", libmSec / sec);
+            std::printf("%-10s %-14s %14.2f %10s %s", k->name, c.name, n / sec * 1e-6, speedup,
+                        isa == SimdIsa::Scalar ? "ref" : mismatches ? "NO" : "yes");
+            if (mismatches) std::printf(" (%zu mismatches)", mismatches);
+            std::printf("\n");
+        }
+    }
+    return allExact;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? (size_t)std::atoll(argv[1]) : 1 << 18;
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+    long stride = argc > 3 ? std::atol(argv[3]) : 97;
+    if (n == 0 || repeats <= 0 || stride <= 0) {
+        std::fprintf(stderr, "Usage: FlameMathBench [points] [repeats] [sweep stride]\n");
+        return 1;
+    }
+    bool accurate = checkAccuracy((uint32_t)stride);
+    bool exact = benchThroughput(n, repeats);
+    return accurate && exact ? 0 : 1;
+}
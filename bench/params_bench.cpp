@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_check.h"
+#include "file_watcher.h"
+#include "flame_march.h"
+#include "flame_params.h"
+#include "flame_tables.h"
+#include "lazy_volume.h"
+#include "occupancy_grid.h"
+#include "thread_pool.h"
+#include "volume_cache.h"
+
+/* =================== FLAME PARAMETER BENCHMARK =================== */
+// The hot-reload path of Sandbox --params without the GPU: tables built
+// from the default block against the compiled ones, a save / load round
+// trip, rejected files, the caches each parameter group invalidates, the
+// CPU field, bake, lazy bricks and occupancy grid on a block, then a
+// series of edits to a watched file, each saved either in place or by
+// renaming a new file over it, timed from the save until the watcher
+// reports it and until the block is parsed and its tables rebuilt.
+// Exit code is non-zero if a check fails or an edit takes a second or more.
+//
+// Usage: FlameParamsBench [edits] [dir]
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+/* =================== DEFAULTS =================== */
+
+static bool checkDefaults() {
+    FlameParams params;
+    FlameTables built;
+    buildFlameProfileTable(built, params);
+    buildFlameRampTable(built, params);
+    const FlameTables& compiled = flameTables();
+
+    bool profileExact = true;
+    for (int i = 0; i < FLAME_PROFILE_TABLE_SIZE; i++) {
+        const FlameProfileEntry& a = built.profile[i];
+        const FlameProfileEntry& b = compiled.profile[i];
+        profileExact &= a.radius == b.radius && a.heightTemp == b.heightTemp && a.blueHeight == b.blueHeight;
+    }
+    double ramp = 0.0;
+    for (int i = 0; i < FLAME_RAMP_TABLE_SIZE; i++) {
+        Vec3 d = built.ramp[i].color - compiled.ramp[i].color;
+        ramp = std::max(ramp, (double)std::max(std::fabs(d.x), std::max(std::fabs(d.y), std::fabs(d.z))));
+    }
+    std::printf("default ramp table vs compiled: max abs diff %.3g\n", ramp);
+
+    bool ok = check("default profile table bit-exact with compiled", profileExact);
+    ok &= check("default ramp table within 1e-6 of compiled", ramp <= 1e-6);
+    ok &= check("default bounding sphere is FLAME_SPHERE_*",
+                params.sphereRadius() == FLAME_SPHERE_RADIUS && params.sphereCenter().y == FLAME_SPHERE_CENTER.y);
+    return ok;
+}
+
+/* =================== FILES =================== */
+
+static bool rejects(const char* text) {
+    FlameParams p;
+    p.height = 3.0f;
+    std::string error;
+    bool rejected = !parseFlameParams(text, p, error) && p.height == 3.0f && !error.empty();
+    if (rejected) std::printf("  rejected: %s\n", error.c_str());
+    return rejected;
+}
+
+static bool checkFiles(const fs::path& dir) {
+    std::string path = (dir / "roundtrip.params").string();
+    FlameParams edited;
+    edited.height = 1.7f;
+    edited.swayZ = 0.02f;
+    edited.stops[4].color = {0.3f, 0.6f, 1.0f};
+    FlameParams loaded;
+    bool ok = check("save / load round trip", saveFlameParams(path, edited) && loadFlameParams(path, loaded) &&
+                                                  flameParamsChanged(edited, loaded) == 0);
+
+    FlameParams partial;
+    std::string error;
+    ok &= check("keys left out keep their default",
+                parseFlameParams("# only the height\nheight = 1.5  # shorter\n", partial, error) &&
+                    partial.height == 1.5f && flameParamsChanged(partial, FlameParams{}) == PARAMS_HEIGHT);
+
+    bool rejected = rejects("height = 2.0\nturbulance = 0.1\n") && rejects("flicker = 0.04 0.05\n") &&
+                    rejects("sway = 0.01\n") && rejects("height\n") && rejects("base_width = -0.1\n") &&
+                    rejects("stop.golden = 0.3  1 1 1\n") && rejects("stop.smoke = 0.05  0 0 0\n") &&
+                    rejects("stop.teal = 0.5  0 1 1\n");
+    ok &= check("bad files rejected, previous block kept", rejected);
+    return ok;
+}
+
+/* =================== DEPENDENCIES =================== */
+
+static bool checkDependencies() {
+    const FlameParams base;
+    struct Edit {
+        const char* name;
+        void (*apply)(FlameParams&);
+        unsigned groups, caches;
+    };
+    const unsigned always = CACHE_UNIFORMS | CACHE_HISTORY;
+    const unsigned cpu = CACHE_BAKED | CACHE_LAZY | CACHE_OCCUPANCY;
+    const Edit edits[] = {
+        {"height", [](FlameParams& p) { p.height = 2.0f; }, PARAMS_HEIGHT, always | CACHE_BOUNDS | cpu},
+        {"base_width", [](FlameParams& p) { p.baseWidth = 0.1f; }, PARAMS_WIDTH,
+         always | CACHE_PROFILE_TABLE | cpu},
+        {"flicker", [](FlameParams& p) { p.flicker = 0.0f; }, PARAMS_TURBULENCE, always | cpu},
+        {"stop.golden", [](FlameParams& p) { p.stops[4].temp = 0.6f; }, PARAMS_COLOR, always | CACHE_RAMP_TABLE},
+        {"nothing", [](FlameParams&) {}, 0, 0},
+    };
+    bool ok = true;
+    std::printf("%-14s %-14s %s\n", "edit", "groups", "rebuilds");
+    for (const Edit& e : edits) {
+        FlameParams p = base;
+        e.apply(p);
+        unsigned groups = flameParamsChanged(base, p);
+        unsigned caches = flameCachesFor(groups);
+        std::printf("%-14s %-14s %s\n", e.name, flameParamGroupNames(groups).c_str(),
+                    flameParamCacheNames(caches).c_str());
+        ok &= groups == e.groups && caches == e.caches;
+    }
+    return check("each group invalidates only its caches", ok);
+}
+
+/* =================== CPU STRUCTURES =================== */
+
+// Random points in the block's bounding sphere
+static std::vector<Vec3> spherePoints(const FlameParams& params, int count) {
+    std::vector<Vec3> points;
+    unsigned state = 12345;
+    auto unit = [&] { state = state * 1664525u + 1013904223u; return (float)(state >> 8) / (float)(1u << 24); };
+    while ((int)points.size() < count) {
+        Vec3 d = {unit() * 2.0f - 1.0f, unit() * 2.0f - 1.0f, unit() * 2.0f - 1.0f};
+        if (dot(d, d) <= 1.0f) points.push_back(params.sphereCenter() + d * params.sphereRadius());
+    }
+    return points;
+}
+
+// Lazy bricks sample the bake of the same block, before and after a reset
+static bool sameAsBake(const LazyVolume& lazy, const VolumeCache& cache, const std::vector<Vec3>& points) {
+    for (const Vec3& p : points) {
+        for (float t : {0.1f, 1.3f, 2.9f}) {
+            if (lazy.density(p, t, 1.0f) != cache.density(p, t, 1.0f) ||
+                lazy.temperatureFactor(p, t) != cache.temperatureFactor(p, t))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Every point with density lies in an occupied cell
+static bool occupancyCovers(const OccupancyGrid& grid, const FlameParams& params, const std::vector<Vec3>& points) {
+    ParamsField<QualityFinal> field{&params, 0.0f, 1.0f};
+    const float r = params.sphereRadius();
+    const Vec3 min = params.sphereCenter() - Vec3{r, r, r};
+    const int n = grid.cellsPerAxis();
+    const float cell = 2.0f * r / n;
+    auto index = [&](float v) { return std::clamp((int)(v / cell), 0, n - 1); };
+    for (const Vec3& p : points) {
+        for (float t : {0.0f, 0.7f, 1.9f, 3.4f}) {
+            field.time = t;
+            if (field.density(p, 0.0f) > 0.0f &&
+                !grid.cellOccupied(index(p.x - min.x), index(p.y - min.y), index(p.z - min.z)))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool checkCpu() {
+    const FlameParams defaults;
+    const std::vector<Vec3> points = spherePoints(defaults, 4000);
+    bool exact = true;
+    ParamsField<QualityProduction> field{&defaults, 0.0f, 1.0f};
+    for (const Vec3& p : points) {
+        for (float t : {0.0f, 1.7f}) {
+            field.time = t;
+            float d = field.density(p, 0.0f);
+            exact &= d == flameDensity(p, t, 1.0f) && field.temperature(p, d, 0.0f) == getTemperature(p, d, t);
+        }
+    }
+    bool ok = check("default block field bit-exact with the compiled one", exact);
+
+    OccupancyGrid compiled, fromBlock;
+    compiled.build(32);
+    fromBlock.build(32, defaults);
+    bool sameGrid = true;
+    for (int z = 0; z < 32; z++)
+        for (int y = 0; y < 32; y++)
+            for (int x = 0; x < 32; x++) sameGrid &= compiled.cellOccupied(x, y, z) == fromBlock.cellOccupied(x, y, z);
+    ok &= check("default block occupancy grid equals the compiled one", sameGrid);
+
+    // A squat, wide flame that spills out of the compiled occupancy grid,
+    // and a taller one after a reload
+    FlameParams squat, tall;
+    squat.height = 1.6f;
+    squat.baseWidth = 0.35f;
+    squat.turbulence = 0.15f;
+    squat.flicker = 0.07f;
+    tall.height = 2.8f;
+    tall.turbulenceTip = 0.24f;
+    tall.swayX = 0.03f;
+
+    ThreadPool pool(2);
+    BakeSettings bake;
+    bake.nx = 17;
+    bake.ny = 33;
+    bake.nz = 17;
+    bake.slices = 4;
+    VolumeCache cache;
+    cache.bake(bake, pool, squat);
+    LazyVolume lazy(bake, (size_t)-1, 2, squat);
+    const std::vector<Vec3> squatPoints = spherePoints(squat, 1000), tallPoints = spherePoints(tall, 1000);
+    ok &= check("lazy bricks of a block equal its bake", sameAsBake(lazy, cache, squatPoints));
+
+    lazy.reset(tall);
+    cache.bake(bake, pool, tall);
+    LazyVolumeStats stats = lazy.stats();
+    ok &= check("reset drops every brick", stats.dropped > 0 && stats.residentBricks == 0);
+    ok &= check("lazy bricks after a reset equal the new bake", sameAsBake(lazy, cache, tallPoints));
+
+    std::string path = (fs::temp_directory_path() / "flame_params_bench.cache").string();
+    VolumeCache loaded;
+    ok &= check("a bake only loads for its own block", cache.save(path) && !loaded.load(path, bake, squat) &&
+                                                            loaded.load(path, bake, tall));
+    fs::remove(path);
+
+    OccupancyGrid squatGrid, tallGrid;
+    squatGrid.build(32, squat);
+    tallGrid.build(32, tall);
+    ok &= check("occupancy grid of the squat block covers its flame",
+                occupancyCovers(squatGrid, squat, spherePoints(squat, 20000)));
+    ok &= check("occupancy grid of the tall block covers its flame",
+                occupancyCovers(tallGrid, tall, spherePoints(tall, 20000)));
+    return ok;
+}
+
+/* =================== RELOAD =================== */
+
+static void writeText(const std::string& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+static bool runReload(const fs::path& dir, int edits) {
+    const std::string path = (dir / "flame.params").string();
+    writeText(path, "height = 2.2\n");
+    FileWatcher watcher(path);
+    FlameParams current;
+    FlameTables tables;
+    buildFlameProfileTable(tables, current);
+    buildFlameRampTable(tables, current);
+
+    std::printf("\n%d edits of %s, watched by %s\n", edits, path.c_str(),
+                watcher.native() ? "inotify" : "polling");
+    double sumSeen = 0.0, maxSeen = 0.0, sumTotal = 0.0, maxTotal = 0.0;
+    int missed = 0, wrong = 0;
+    for (int i = 0; i < edits; i++) {
+        // Alternate the group edited and the way the editor saves
+        char text[128];
+        float v = 0.15f + 0.01f * (float)i;   // never a default
+        if (i % 2 == 0) std::snprintf(text, sizeof(text), "base_width = %g\n", v);
+        else std::snprintf(text, sizeof(text), "stop.golden = 0.62  %g 0.72 0.18\n", v);
+
+        auto t0 = Clock::now();
+        if (i % 4 < 2) {
+            writeText(path, text);
+        } else {
+            std::string tmp = path + ".tmp";
+            writeText(tmp, text);
+            fs::rename(tmp, path);
+        }
+        while (!watcher.changed() && Clock::now() - t0 < std::chrono::seconds(2))
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        auto seen = Clock::now();
+        if (seen - t0 >= std::chrono::seconds(2)) {
+            missed++;
+            continue;
+        }
+
+        FlameParams next;
+        if (!loadFlameParams(path, next)) {
+            wrong++;
+            continue;
+        }
+        unsigned caches = flameCachesFor(flameParamsChanged(current, next));
+        if (caches & CACHE_PROFILE_TABLE) buildFlameProfileTable(tables, next);
+        if (caches & CACHE_RAMP_TABLE) buildFlameRampTable(tables, next);
+        current = next;
+        auto done = Clock::now();
+        const unsigned cpu = CACHE_BAKED | CACHE_LAZY | CACHE_OCCUPANCY;
+        unsigned expected = CACHE_UNIFORMS | CACHE_HISTORY | CACHE_PROFILE_TABLE | CACHE_RAMP_TABLE | cpu;
+        if (i == 0) expected = CACHE_UNIFORMS | CACHE_HISTORY | CACHE_PROFILE_TABLE | cpu;   // colour still default
+        if (caches != expected) wrong++;
+
+        double seenMs = std::chrono::duration<double, std::milli>(seen - t0).count();
+        double totalMs = std::chrono::duration<double, std::milli>(done - t0).count();
+        sumSeen += seenMs;
+        maxSeen = std::max(maxSeen, seenMs);
+        sumTotal += totalMs;
+        maxTotal = std::max(maxTotal, totalMs);
+    }
+    fs::remove(path);
+
+    int n = std::max(edits - missed, 1);
+    std::printf("%-30s %10s %10s\n", "save to", "mean ms", "max ms");
+    std::printf("%-30s %10.3f %10.3f\n", "watcher reports it", sumSeen / n, maxSeen);
+    std::printf("%-30s %10.3f %10.3f\n", "parsed, tables rebuilt", sumTotal / n, maxTotal);
+    if (missed || wrong) std::printf("%d saves missed, %d reloads wrong\n", missed, wrong);
+    bool ok = check("every save seen, right tables rebuilt", missed == 0 && wrong == 0);
+    ok &= check("every reload under a second", maxTotal < 1000.0);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int edits = argc > 1 ? std::atoi(argv[1]) : 20;
+    fs::path dir = argc > 2 ? fs::path(argv[2]) : fs::temp_directory_path() / "flame_params_bench";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (edits <= 0 || !fs::is_directory(dir)) {
+        std::fprintf(stderr, "Usage: FlameParamsBench [edits] [dir]\n");
+        return 1;
+    }
+
+    bool ok = checkDefaults();
+    ok &= checkFiles(dir);
+    ok &= checkDependencies();
+    ok &= checkCpu();
+    ok &= runReload(dir, edits);
+    return ok ? 0 : 1;
+}
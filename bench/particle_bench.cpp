@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "noise_simd.h"
+#include "particle_system.h"
+#include "thread_pool.h"
+
+/* =================== PARTICLE BENCHMARK =================== */
+// Steps a prewarmed particle pool at 60 Hz with 1, 2, 4, ... threads up to
+// the hardware count and reports particle updates per second and scaling.
+// Each run starts from the same seed; the final pool state must match
+// across thread counts (exit code is non-zero if it does not).
+//
+// Usage: FlameParticleBench [particles] [steps] [maxThreads]
+
+// Order-dependent hash of every live particle's position bits
+static uint64_t poolChecksum(const ParticleSystem& ps) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < ps.capacity(); i++) {
+        if (!ps.alive(i)) continue;
+        Vec3 p = ps.position(i);
+        uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        for (uint32_t b : bits) h = (h ^ b) * 1099511628211ull;
+    }
+    return h;
+}
+
+int main(int argc, char** argv) {
+    size_t particles = argc > 1 ? (size_t)std::atoll(argv[1]) : 1 << 20;
+    int steps = argc > 2 ? std::atoi(argv[2]) : 30;
+    unsigned maxThreads = argc > 3 ? (unsigned)std::atoi(argv[3]) : std::thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 1;
+    const float dt = 1.0f / 60.0f;
+
+    std::printf("particles: %zu, steps: %d, noise kernels: %s\n\n", particles, steps, noiseKernels().name);
+    std::printf("%8s %12s %16s %10s %10s\n", "threads", "ms/step", "Mparticles/s", "speedup", "alive");
+
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    double baseSec = 0.0;
+    uint64_t refSum = 0;
+    bool consistent = true;
+    for (unsigned threads : counts) {
+        ParticleSettings settings;
+        settings.capacity = particles;
+        ParticleSystem ps(settings);
+        ps.prewarm();
+        ThreadPool pool(threads);
+
+        size_t updated = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; s++) {
+            updated += ps.aliveCount();
+            ps.step(dt, pool);
+        }
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (threads == counts.front()) baseSec = sec;
+
+        uint64_t sum = poolChecksum(ps);
+        if (threads == counts.front()) refSum = sum;
+        bool same = sum == refSum;
+        consistent = consistent && same;
+
+        char speedup[32];
+        std::snprintf(speedup, sizeof(speedup), "%.2fx", baseSec / sec);
+        std::printf("%8u %12.2f %16.2f %10s %10zu%s\n", threads, sec * 1e3 / steps,
+                    updated / sec * 1e-6, speedup, ps.aliveCount(), same ? "" : "  (state differs!)");
+    }
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "cpu_renderer.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+/* =================== PROFILER OVERHEAD BENCHMARK =================== */
+// Cost of a PROFILE_SCOPE around a tiny body with the profiler off and on,
+// against the bare body, then a production frame rendered with the
+// profiler off and on (one marker per tile plus one per frame).
+//
+// Usage: FlameProfilerBench [iterations] [width] [height] [threads]
+
+template <class Body>
+static double nsPerIteration(int iterations, Body&& body) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) body();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 10000000;
+    int width = argc > 2 ? std::atoi(argv[2]) : 320;
+    int height = argc > 3 ? std::atoi(argv[3]) : 180;
+    unsigned threads = argc > 4 ? (unsigned)std::atoi(argv[4]) : 0;
+    if (iterations <= 0 || width <= 0 || height <= 0) {
+        std::fprintf(stderr, "Usage: FlameProfilerBench [iterations] [width] [height] [threads]\n");
+        return 1;
+    }
+#if !FLAME_PROFILER
+    std::printf("Built with FLAME_PROFILER=OFF: markers compile to nothing\n\n");
+#endif
+
+    volatile unsigned sink = 0;
+    nsPerIteration(iterations, [&] { sink = sink + 1; });   // warm up
+    double bare = nsPerIteration(iterations, [&] { sink = sink + 1; });
+    double off = nsPerIteration(iterations, [&] {
+        PROFILE_SCOPE("bench");
+        sink = sink + 1;
+    });
+    profilerEnable(true);
+    double on = nsPerIteration(iterations, [&] {
+        PROFILE_SCOPE("bench");
+        sink = sink + 1;
+    });
+    profilerEnable(false);
+    profilerReset();
+
+    std::printf("%d iterations\n", iterations);
+    std::printf("%-22s %8.2f ns\n", "bare body", bare);
+    std::printf("%-22s %8.2f ns  (%+.2f ns per marker)\n", "marker, profiler off", off, off - bare);
+    std::printf("%-22s %8.2f ns  (%+.2f ns per marker)\n\n", "marker, profiler on", on, on - bare);
+
+    ThreadPool pool(threads);
+    FlameUniforms u;
+    u.aspect = (float)width / (float)height;
+    Image img;
+    img.resize(width, height);
+    auto frameMs = [&] {
+        double best = 1e30;
+        for (int i = 0; i < 3; i++) best = std::min(best, renderImage(u, img, pool).seconds * 1000.0);
+        return best;
+    };
+    double frameOff = frameMs();
+    profilerEnable(true);
+    double frameOn = frameMs();
+    profilerEnable(false);
+    std::printf("%dx%d production frame, best of 3, %u threads\n", width, height, pool.size());
+    std::printf("%-22s %8.2f ms\n", "profiler off", frameOff);
+    std::printf("%-22s %8.2f ms  (%+.2f%%)\n", "profiler on", frameOn, (frameOn / frameOff - 1.0) * 100.0);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bench_path.h"
+#include "cpu_renderer.h"
+#include "thread_pool.h"
+
+/* =================== QUALITY TIER BENCHMARK =================== */
+// Renders one pose from each bench path segment, plus a distant view, with
+// every quality tier with and without footprint LOD, and reports throughput
+// and the error against the final tier: RMSE in 8-bit steps and PSNR.
+//
+// Usage: FlameQualityBench [width] [height] [repeats] [threads]
+
+struct ImageError {
+    double rmse255 = 0.0;
+    int max255 = 0;
+    double psnr = 0.0;
+};
+
+static ImageError compare(const Image& a, const Image& ref) {
+    ImageError e;
+    double sum = 0.0;
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < a.rgb.size(); i++) {
+        float d = a.rgb[i] - ref.rgb[i];
+        sum += (double)d * d;
+        maxDiff = fmaxf(maxDiff, fabsf(d));
+    }
+    double mse = sum / (double)a.rgb.size();
+    e.rmse255 = std::sqrt(mse) * 255.0;
+    e.max255 = (int)(maxDiff * 255.0f + 0.5f);
+    e.psnr = mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : INFINITY;
+    return e;
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 480;
+    int height = argc > 2 ? std::atoi(argv[2]) : 270;
+    int repeats = argc > 3 ? std::atoi(argv[3]) : 3;
+    unsigned threads = argc > 4 ? (unsigned)std::atoi(argv[4]) : 0;
+    if (width <= 0 || height <= 0 || repeats <= 0) {
+        std::fprintf(stderr, "Usage: FlameQualityBench [width] [height] [repeats] [threads]\n");
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    std::printf("%dx%d, best of %d, %u threads; error against the final tier\n\n",
+                width, height, repeats, pool.size());
+    std::printf("%-9s %-15s %10s %9s %9s %10s %8s %8s\n", "segment", "tier", "ms", "Mpix/s",
+                "speedup", "smp/ray", "RMSE", "PSNR");
+
+    struct View { const char* name; Vec3 camPos, camFront; };
+    std::vector<View> views;
+    const int pathFrames = 4 * BENCH_SEGMENT_COUNT;
+    for (int seg = 0; seg < BENCH_SEGMENT_COUNT; seg++) {
+        // Middle of each segment of a short path
+        BenchPose pose = benchPose(seg * 4 + 2, pathFrames);
+        views.push_back({pose.segment, pose.camPos, pose.camFront});
+    }
+    views.push_back({"distant", {0.0f, 1.0f, 25.0f}, {0.0f, 0.0f, -1.0f}});
+
+    // Every tier without and with LOD; the last plain final render is the reference
+    constexpr int VARIANTS = 2 * QUALITY_TIER_COUNT;
+    for (const View& view : views) {
+        FlameUniforms u;
+        u.camPos = view.camPos;
+        u.camFront = view.camFront;
+        u.aspect = (float)width / (float)height;
+        u.time = 1.0f;
+
+        Image images[VARIANTS];
+        double ms[VARIANTS];
+        double perRay[VARIANTS];
+        for (int v = 0; v < VARIANTS; v++) {
+            RenderOptions options;
+            options.quality = (QualityTier)(v / 2);
+            options.lod = (v & 1) != 0;
+            images[v].resize(width, height);
+            ms[v] = 1e30;
+            for (int r = 0; r < repeats; r++) {
+                RenderStats s = renderImage(u, images[v], pool, options);
+                ms[v] = std::fmin(ms[v], s.seconds * 1000.0);
+                perRay[v] = s.raysMarched ? (double)s.densitySamples / s.raysMarched : 0.0;
+            }
+        }
+
+        const int production = 2 * (int)QualityTier::Production;
+        const Image& reference = images[2 * (int)QualityTier::Final];
+        for (int v = 0; v < VARIANTS; v++) {
+            ImageError e = compare(images[v], reference);
+            char tier[32], speedup[32];
+            std::snprintf(tier, sizeof(tier), "%s%s", qualityTierName((QualityTier)(v / 2)), v & 1 ? "+lod" : "");
+            std::snprintf(speedup, sizeof(speedup), "%.2fx", ms[production] / ms[v]);
+            std::printf("%-9s %-15s %10.2f %9.2f %9s %10.1f %8.2f %8.1f\n", view.name, tier, ms[v],
+                        width * height / (ms[v] * 1e3), speedup, perRay[v], e.rmse255, e.psnr);
+        }
+    }
+    std::printf("\nspeedup is relative to production; RMSE in 8-bit steps, PSNR in dB\n");
+    return 0;
+}
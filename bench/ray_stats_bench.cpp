@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bench_check.h"
+#include "bench_path.h"
+#include "cpu_renderer.h"
+#include "flame_march.h"
+#include "flame_scene.h"
+#include "ray_stats.h"
+#include "thread_pool.h"
+
+/* =================== RAY STATISTICS BENCHMARK =================== */
+// Where the march spends its steps, per quality tier along the bench path
+// and for a candle scene seen from above (as FlameSceneBench), summed over
+// the frames:
+//   steps/ray   mean loop iterations of marched rays
+//   p95         the highest per-frame p95 of those
+//   empty       fraction of the steps that found no density
+//   left / opaque / budget   how marched rays ended (opaque is the
+//                            accAlpha > 0.97 early-out)
+// Exit code is non-zero unless every ray cost map agrees with the frame's
+// RenderStats, the screen rect at scale 1 gives the full march's map, the
+// flameFS packing round-trips, the histograms cover every pixel and a ray
+// that turns opaque on its last step counts as opaque, not out of steps.
+//
+// Usage: FlameRayStatsBench [width] [height] [frames] [candles] [threads]
+
+struct Source {
+    const char* name;
+    RenderOptions options;
+    int maxSteps;
+    RayStatsFrame sum;   // counters summed over the frames (frames stacked in height), no bins
+    int p95 = 0;
+};
+
+// Dense everywhere: every step is in-flame at the 0.2 opacity cap, so the
+// ray passes the production alphaCutoff (0.97) on its 16th step
+struct SolidField {
+    float density(Vec3) const { return 1.0f; }
+    float temperature(Vec3, float) const { return 1.0f; }
+};
+
+template <int Steps>
+struct StepLimit : QualityProduction {
+    static constexpr int maxSteps = Steps;
+};
+
+template <int Steps>
+static RayExit solidExit() {
+    FlameSample out;
+    float t = 0.0f;
+    marchInterval<StepLimit<Steps>>(SolidField{}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, t, 1e3f, 0.1f, out);
+    return out.exit;
+}
+
+static bool sameMaps(const RayCostMap& a, const RayCostMap& b) {
+    return a.steps == b.steps && a.emptySteps == b.emptySteps && a.exit == b.exit;
+}
+
+static bool coversPixels(const RayStatsFrame& f) {
+    uint64_t pixels = 0, empty = 0, inFlame = 0;
+    for (const RayStatsBin& b : f.bins) {
+        pixels += b.pixels;
+        empty += b.empty;
+        inFlame += b.inFlame;
+    }
+    uint64_t all = (uint64_t)f.width * f.height;
+    return pixels == all && empty == all && inFlame == all;
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 160;
+    int height = argc > 2 ? std::atoi(argv[2]) : 90;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 8;
+    int candles = argc > 4 ? std::atoi(argv[4]) : 100;
+    unsigned threads = argc > 5 ? (unsigned)std::atoi(argv[5]) : 0;
+    if (width <= 0 || height <= 0 || frames <= 0 || candles <= 0) {
+        std::fprintf(stderr, "Usage: FlameRayStatsBench [width] [height] [frames] [candles] [threads]\n");
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    FlameScene scene = makeCandleField(candles);
+    std::vector<Source> sources;
+    for (int i = 0; i < QUALITY_TIER_COUNT; i++) {
+        Source s{qualityTierName((QualityTier)i), {}, qualityTierMaxSteps((QualityTier)i), {}};
+        s.options.quality = (QualityTier)i;
+        sources.push_back(s);
+    }
+    Source sceneSource{"candles", {}, QualityProduction::maxSteps, {}};
+    sceneSource.options.scene = &scene;
+    sources.push_back(sceneSource);
+
+    std::printf("%dx%d, %d frames along the bench path, %d candles, %u threads\n\n", width, height, frames,
+                candles, pool.size());
+
+    bool statsMatch = true, rectMatches = true, packRoundTrips = true, histogramsCover = true;
+    for (Source& s : sources) {
+        for (int i = 0; i < frames; i++) {
+            BenchPose pose = benchPose(i, frames);
+            FlameUniforms u;
+            u.camPos = s.options.scene ? Vec3{0.0f, 5.0f, 7.0f} : pose.camPos;
+            u.camFront = s.options.scene ? normalize(Vec3{0.0f, -0.6f, -0.8f}) : pose.camFront;
+            u.aspect = (float)width / (float)height;
+            u.time = (float)i * BENCH_DEFAULT_DT * 10.0f;
+
+            Image img;
+            img.resize(width, height);
+            RayCostMap map;
+            RenderOptions options = s.options;
+            options.rayCost = &map;
+            RenderStats rs = renderImage(u, img, pool, options);
+
+            RayStatsFrame f = summarizeRayCost(map, s.maxSteps, i);
+            statsMatch &= f.steps == rs.densitySamples && f.emptySteps == rs.emptySamples &&
+                          f.marched() == rs.raysMarched;
+            histogramsCover &= coversPixels(f);
+            s.sum.width = f.width;
+            s.sum.height += f.height;
+            s.sum.steps += f.steps;
+            s.sum.emptySteps += f.emptySteps;
+            for (int e = 0; e < RAY_EXIT_COUNT; e++) s.sum.exits[e] += f.exits[e];
+            s.p95 = std::max(s.p95, f.p95);
+
+            // GL order (rows bottom first), as flameFS writes it
+            std::vector<uint32_t> packed(map.steps.size());
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++) {
+                    size_t k = (size_t)y * width + x;
+                    packed[(size_t)(height - 1 - y) * width + x] =
+                        packRayCost(map.steps[k], map.emptySteps[k], map.exit[k]);
+                }
+            RayCostMap unpacked;
+            unpackRayCost(packed.data(), width, height, unpacked);
+            packRoundTrips &= sameMaps(unpacked, map);
+
+            if (!s.options.scene) {
+                RayCostMap rectMap;
+                options.screenRect = true;
+                options.rayCost = &rectMap;
+                renderImage(u, img, pool, options);
+                rectMatches &= sameMaps(rectMap, map);
+            }
+        }
+    }
+
+    std::printf("%-12s %10s %6s %8s %8s %8s %8s\n", "source", "steps/ray", "p95", "empty", "left", "opaque",
+                "budget");
+    for (const Source& s : sources) {
+        const RayStatsFrame& f = s.sum;
+        uint64_t marched = f.marched();
+        auto pct = [&](RayExit e) { return marched ? 100.0 * f.exits[(int)e] / marched : 0.0; };
+        std::printf("%-12s %10.1f %6d %7.1f%% %7.1f%% %7.1f%% %7.1f%%\n", s.name, f.meanSteps(), s.p95,
+                    f.emptyFraction() * 100.0, pct(RayExit::Left), pct(RayExit::Opaque), pct(RayExit::Budget));
+    }
+    std::printf("\n");
+
+    bool ok = check("ray cost maps match RenderStats", statsMatch);
+    ok &= check("screen rect at scale 1 gives the same map", rectMatches);
+    ok &= check("flameFS packing round-trips", packRoundTrips);
+    ok &= check("histograms cover every pixel", histogramsCover);
+    ok &= check("opaque on the last step counts as opaque",
+                solidExit<15>() == RayExit::Budget && solidExit<16>() == RayExit::Opaque &&
+                    solidExit<17>() == RayExit::Opaque);
+    return ok ? 0 : 1;
+}
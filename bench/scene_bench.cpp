@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+#include "cpu_renderer.h"
+#include "flame_scene.h"
+#include "thread_pool.h"
+
+/* =================== FLAME SCENE BENCHMARK =================== */
+// Renders candle fields of 1 to 10,000 flames from the same camera, above
+// the middle of the field and looking 35 degrees down, so the flames on
+// screen stay about the same while the scene grows around them. Per size:
+//   build         BVH build time
+//   frame         full production render
+//   smp/ray       density samples per marched ray
+//   nodes/ray     BVH nodes visited per camera ray
+//   tests/ray     instance bounds tested in the leaves
+//   glow/ray      instance bounds crossed (glow summed)
+//   flames/ray    bounding spheres entered (marched)
+//   bvh / brute   gathering the crossed instances of every camera ray with
+//                 the BVH, and by testing every instance (single thread)
+//
+// Then a degenerate scene file, instances spaced 4x further out each time
+// and alternating between the x and z axes, on which binned SAH splits off
+// one instance per level: its BVH must stop at FlameScene::MAX_DEPTH and
+// still find what brute force finds. Exit code is non-zero if the BVH and
+// brute force disagree anywhere or the degenerate BVH is too deep.
+//
+// Usage: FlameSceneBench [width] [height] [max flames] [threads]
+
+// Crossings of every camera ray of u at width x height: the BVH's, and by
+// testing every instance
+static void countCrossings(const FlameScene& scene, const FlameUniforms& u, int width, int height,
+                           uint64_t& bvh, uint64_t& brute) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            Vec3 ro, rd;
+            cameraRay(u, 2.0f * (x + 0.5f) / width - 1.0f, 1.0f - 2.0f * (y + 0.5f) / height, ro, rd);
+            scene.traverse(ro, rd, [&](int) { bvh++; });
+            for (const FlameInstance& inst : scene.instances()) {
+                Vec3 c = inst.position + FLAME_GLOW_CENTER * inst.scale;
+                if (intersectSphere(ro, rd, c, FLAME_GLOW_RADIUS * inst.scale).y >= 0.0f) brute++;
+            }
+        }
+    }
+}
+
+static int depth(const FlameScene& scene, int node = 0) {
+    const FlameScene::Node& n = scene.nodes()[node];
+    return n.count ? 0 : 1 + std::max(depth(scene, n.first), depth(scene, n.first + 1));
+}
+
+static double msSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 320;
+    int height = argc > 2 ? std::atoi(argv[2]) : 180;
+    int maxFlames = argc > 3 ? std::atoi(argv[3]) : 10000;
+    unsigned threads = argc > 4 ? (unsigned)std::atoi(argv[4]) : 0;
+    if (width <= 0 || height <= 0 || maxFlames <= 0) {
+        std::fprintf(stderr, "Usage: FlameSceneBench [width] [height] [max flames] [threads]\n");
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    FlameUniforms u;
+    u.camPos = {0.0f, 5.0f, 7.0f};
+    u.camFront = {0.0f, -sinf(0.61f), -cosf(0.61f)};
+    u.aspect = (float)width / (float)height;
+    u.time = 1.0f;
+
+    std::printf("%dx%d, candle fields 1.5 apart, %u threads\n\n", width, height, pool.size());
+    std::printf("%7s %7s %9s %10s %8s %10s %10s %9s %11s %10s %10s\n", "flames", "nodes", "build ms",
+                "frame ms", "smp/ray", "nodes/ray", "tests/ray", "glow/ray", "flames/ray", "bvh ms", "brute ms");
+
+    for (int count = 1; count <= maxFlames; count *= 10) {
+        auto t0 = std::chrono::steady_clock::now();
+        FlameScene scene = makeCandleField(count);
+        double buildMs = msSince(t0);
+
+        Image img;
+        img.resize(width, height);
+        RenderOptions options;
+        options.scene = &scene;
+        RenderStats rs = renderImage(u, img, pool, options);
+
+        // Gather only: the instances each camera ray crosses and enters
+        SceneRayStats stats;
+        uint64_t crossed = 0, entered = 0;
+        t0 = std::chrono::steady_clock::now();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                Vec3 ro, rd;
+                cameraRay(u, 2.0f * (x + 0.5f) / width - 1.0f, 1.0f - 2.0f * (y + 0.5f) / height, ro, rd);
+                scene.traverse(ro, rd, [&](int i) {
+                    crossed++;
+                    Vec3 lro = scene.toLocal(i, ro), lrd = scene.dirToLocal(i, rd);
+                    if (intersectSphere(lro, lrd, FLAME_SPHERE_CENTER, FLAME_SPHERE_RADIUS).y >= 0.0f) entered++;
+                }, &stats);
+            }
+        }
+        double bvhMs = msSince(t0);
+
+        uint64_t bruteCrossed = 0;
+        t0 = std::chrono::steady_clock::now();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                Vec3 ro, rd;
+                cameraRay(u, 2.0f * (x + 0.5f) / width - 1.0f, 1.0f - 2.0f * (y + 0.5f) / height, ro, rd);
+                for (const FlameInstance& inst : scene.instances()) {
+                    Vec3 c = inst.position + FLAME_GLOW_CENTER * inst.scale;
+                    if (intersectSphere(ro, rd, c, FLAME_GLOW_RADIUS * inst.scale).y >= 0.0f) bruteCrossed++;
+                }
+            }
+        }
+        double bruteMs = msSince(t0);
+        if (bruteCrossed != crossed) {
+            std::fprintf(stderr, "BVH found %llu crossings, brute force %llu\n", (unsigned long long)crossed,
+                         (unsigned long long)bruteCrossed);
+            return 1;
+        }
+
+        double rays = (double)width * height;
+        std::printf("%7zu %7zu %9.2f %10.2f %8.1f %10.1f %10.1f %9.2f %11.2f %10.2f %10.2f\n", scene.size(),
+                    scene.nodes().size(), buildMs, rs.seconds * 1000.0,
+                    rs.raysMarched ? (double)rs.densitySamples / rs.raysMarched : 0.0,
+                    stats.nodesVisited / rays, stats.boundsTested / rays, crossed / rays, entered / rays,
+                    bvhMs, bruteMs);
+    }
+
+    // Degenerate scene file: 1e-30 out to 1e14, 4x apart, on x and z in turn
+    FlameScene spread;
+    int k = 0;
+    for (float a = 1e-30f; a < 1e14f; a *= 4.0f, k++) {
+        FlameInstance inst;
+        inst.position = k % 2 ? Vec3{0.0f, 0.0f, a} : Vec3{a, 0.0f, 0.0f};
+        spread.add(inst);
+    }
+    std::string path = (std::filesystem::temp_directory_path() / "flame_scene_bench_degenerate.scene").string();
+    FlameScene degenerate;
+    if (!spread.save(path) || !degenerate.load(path)) return 1;
+    std::filesystem::remove(path);
+
+    FlameUniforms close;
+    close.aspect = (float)width / (float)height;
+    uint64_t crossed = 0, bruteCrossed = 0;
+    countCrossings(degenerate, close, width, height, crossed, bruteCrossed);
+    int levels = depth(degenerate);
+    bool ok = levels <= FlameScene::MAX_DEPTH && crossed == bruteCrossed;
+    std::printf("\ndegenerate scene, %zu flames 4x apart: BVH depth %d (max %d), %llu crossings, brute force "
+                "%llu: %s\n", degenerate.size(), levels, FlameScene::MAX_DEPTH, (unsigned long long)crossed,
+                (unsigned long long)bruteCrossed, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "sim_thread.h"
+
+/* =================== SIMULATION THREAD BENCHMARK =================== */
+// A stand-in render loop at ~60 fps (sleeps instead of drawing) that hitches
+// for 100 ms every second, reading the simulation three ways:
+//   clamped dt     the old render-thread update, dt capped at 0.05 s
+//   sim thread     SimThread at the fixed rate, interpolated
+//   heavy steps    SimThread with each step also costing --step-ms
+// Per variant: simulated time lost against the wall clock at the end, the
+// frame-to-frame error of simulated against wall time deltas outside the
+// hitches (smoothness), p99 of the other frames' intervals (render pacing)
+// and steps dropped.
+//
+// Usage: FlameSimBench [seconds] [sim hz] [step ms]
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Result {
+    double lostMs = 0.0, jitterMs = 0.0, p99FrameMs = 0.0;
+    uint64_t dropped = 0;
+};
+
+// sample(frame dt) returns the simulated time
+template <class Sample>
+static Result renderLoop(double seconds, Sample&& sample) {
+    const int64_t start = nowNs();
+    std::vector<double> frames, errors;
+    double lastWall = 0.0, lastSim = 0.0;
+    int frame = 0;
+    for (;;) {
+        bool hitch = frame > 0 && frame % 60 == 0;
+        std::this_thread::sleep_for(std::chrono::microseconds(hitch ? 100000 : 16667));
+        double wall = (nowNs() - start) * 1e-9;
+        double sim = sample((float)(wall - lastWall));
+        if (!hitch && frame > 0) {
+            frames.push_back((wall - lastWall) * 1000.0);
+            errors.push_back(std::fabs((sim - lastSim) - (wall - lastWall)) * 1000.0);
+        }
+        lastWall = wall;
+        lastSim = sim;
+        frame++;
+        if (wall >= seconds) break;
+    }
+
+    Result r;
+    r.lostMs = (lastWall - lastSim) * 1000.0;
+    for (double e : errors) r.jitterMs += e;
+    r.jitterMs /= std::max<size_t>(errors.size(), 1);
+    std::sort(frames.begin(), frames.end());
+    r.p99FrameMs = frames[std::min(frames.size() - 1, (size_t)(frames.size() * 0.99))];
+    return r;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 5.0;
+    int hz = argc > 2 ? std::atoi(argv[2]) : DEFAULT_SIM_HZ;
+    double stepMs = argc > 3 ? std::atof(argv[3]) : 4.0;
+    if (seconds <= 0.0 || hz <= 0 || stepMs < 0.0) {
+        std::fprintf(stderr, "Usage: FlameSimBench [seconds] [sim hz] [step ms]\n");
+        return 1;
+    }
+    std::printf("%.1f s at ~60 fps with a 100 ms hitch every 60 frames, sim at %d Hz\n\n", seconds, hz);
+    std::printf("%-14s %10s %12s %14s %9s\n", "variant", "lost ms", "jitter ms", "p99 frame ms", "dropped");
+    auto row = [](const char* name, const Result& r) {
+        std::printf("%-14s %10.1f %12.3f %14.2f %9llu\n", name, r.lostMs, r.jitterMs, r.p99FrameMs,
+                    (unsigned long long)r.dropped);
+    };
+
+    double simTime = 0.0;
+    row("clamped dt", renderLoop(seconds, [&](float dt) { return simTime += fminf(dt, 0.05f); }));
+
+    for (int heavy = 0; heavy < 2; heavy++) {
+        SimThread sim(hz);
+        if (heavy) sim.setExtraStepCost(stepMs);
+        sim.start();
+        // The sim starts with the loop; its time runs one tick behind
+        Result r = renderLoop(seconds, [&](float) { return sim.sample().time + 1.0 / hz; });
+        sim.stop();
+        r.dropped = sim.droppedSteps();
+        row(heavy ? "heavy steps" : "sim thread", r);
+    }
+    std::printf("\nlost: wall-clock time the simulation fell behind; jitter: mean |sim - wall| per frame\n");
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bench_path.h"
+#include "blue_noise.h"
+#include "cpu_renderer.h"
+#include "temporal_accumulator.h"
+#include "thread_pool.h"
+
+/* =================== TEMPORAL ACCUMULATION BENCHMARK =================== */
+// Plays a short run of consecutive 60 Hz frames from the middle of each
+// bench path segment, plus a paused run (close-up camera and time frozen),
+// and compares the last frames of each run against a final-tier render of
+// the same frame:
+//   production        the shader march, 96 steps
+//   temporal          a quarter of the steps, fixed start (bands)
+//   temporal+jitter   a quarter of the steps, blue-noise start (noise)
+//   temporal+accum    the jittered frames accumulated with reprojection
+// Error is RMSE in 8-bit steps and PSNR; ms and samples/ray are per frame.
+//
+// Usage: FlameTemporalBench [width] [height] [frames] [measured] [threads]
+
+constexpr int SEGMENT_FRAMES = 240;   // 4 s per segment at 60 Hz
+
+static double mse(const Image& a, const Image& ref) {
+    double sum = 0.0;
+    for (size_t i = 0; i < a.rgb.size(); i++) {
+        double d = a.rgb[i] - ref.rgb[i];
+        sum += d * d;
+    }
+    return sum / (double)a.rgb.size();
+}
+
+struct Variant {
+    const char* name;
+    double ms = 0.0, samplesPerRay = 0.0, mse = 0.0;
+    int count = 0;
+
+    void add(const RenderStats& s, double extraMs, double err) {
+        ms += s.seconds * 1000.0 + extraMs;
+        samplesPerRay += s.raysMarched ? (double)s.densitySamples / s.raysMarched : 0.0;
+        mse += err;
+        count++;
+    }
+};
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 320;
+    int height = argc > 2 ? std::atoi(argv[2]) : 180;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 24;
+    int measured = argc > 4 ? std::atoi(argv[4]) : 4;
+    unsigned threads = argc > 5 ? (unsigned)std::atoi(argv[5]) : 0;
+    if (width <= 0 || height <= 0 || frames <= 0 || measured <= 0 || measured > frames) {
+        std::fprintf(stderr, "Usage: FlameTemporalBench [width] [height] [frames] [measured] [threads]\n");
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    BlueNoise noise = makeBlueNoise();
+    std::printf("%dx%d, %d frames per segment at 60 Hz, error over the last %d against the final tier, "
+                "%u threads\n\n", width, height, frames, measured, pool.size());
+    std::printf("%-9s %-16s %9s %10s %8s %8s %9s\n", "segment", "variant", "ms", "smp/ray", "RMSE",
+                "PSNR", "rejected");
+
+    // The bench segments, then the paused run
+    for (int seg = 0; seg <= BENCH_SEGMENT_COUNT; seg++) {
+        const bool paused = seg == BENCH_SEGMENT_COUNT;
+        const char* name = paused ? "paused" : benchSegmentName(seg);
+        Variant variants[4] = {{"production"}, {"temporal"}, {"temporal+jitter"}, {"temporal+accum"}};
+        TemporalAccumulator accumulator;
+        double rejected = 0.0;
+
+        Image img, reference;
+        std::vector<float> depth;
+        img.resize(width, height);
+        reference.resize(width, height);
+
+        const int first = (paused ? 0 : seg) * SEGMENT_FRAMES + SEGMENT_FRAMES / 2;
+        for (int i = 0; i < frames; i++) {
+            int frame = first + i;
+            int shown = paused ? first : frame;
+            BenchPose pose = benchPose(shown, SEGMENT_FRAMES * BENCH_SEGMENT_COUNT);
+            FlameUniforms u;
+            u.camPos = pose.camPos;
+            u.camFront = pose.camFront;
+            u.aspect = (float)width / (float)height;
+            u.time = shown * BENCH_DEFAULT_DT;
+            bool measure = i >= frames - measured;
+
+            RenderOptions jittered;
+            jittered.quality = QualityTier::Temporal;
+            jittered.jitter = &noise;
+            jittered.frameIndex = frame;
+            jittered.depth = &depth;
+            RenderStats js = renderImage(u, img, pool, jittered);
+            if (measure) {
+                RenderOptions ref;
+                ref.quality = QualityTier::Final;
+                renderImage(u, reference, pool, ref);
+                variants[2].add(js, 0.0, mse(img, reference));
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+            const Image& acc = accumulator.accumulate(img, depth, u, pool);
+            double accMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            if (!measure) continue;
+            variants[3].add(js, accMs, mse(acc, reference));
+            rejected += accumulator.rejectedFraction();
+
+            Image other;
+            other.resize(width, height);
+            RenderOptions production;
+            RenderStats ps = renderImage(u, other, pool, production);
+            variants[0].add(ps, 0.0, mse(other, reference));
+
+            RenderOptions fixed;
+            fixed.quality = QualityTier::Temporal;
+            RenderStats fs = renderImage(u, other, pool, fixed);
+            variants[1].add(fs, 0.0, mse(other, reference));
+        }
+
+        for (int v = 0; v < 4; v++) {
+            const Variant& r = variants[v];
+            double m = r.mse / r.count;
+            char rej[16] = "";
+            if (v == 3) std::snprintf(rej, sizeof(rej), "%.1f%%", rejected / measured * 100.0);
+            std::printf("%-9s %-16s %9.2f %10.1f %8.2f %8.1f %9s\n", name, r.name,
+                        r.ms / r.count, r.samplesPerRay / r.count, std::sqrt(m) * 255.0,
+                        m > 0.0 ? 10.0 * std::log10(1.0 / m) : INFINITY, rej);
+        }
+    }
+    std::printf("\nrejected: pixels whose history was dropped (off screen or disoccluded)\n");
+    return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdio>
+
+/* =================== BENCH CHECKS =================== */
+// Pass / fail lines of the benches' exactness checks, one per check:
+//   default profile table bit-exact with compiled        ok
+
+// Print the check's line; returns ok so results can be and-ed together
+inline bool check(const char* name, bool ok) {
+    std::printf("%-52s %s\n", name, ok ? "ok" : "FAILED");
+    return ok;
+}
@@ -0,0 +1,50 @@
+#include "bench_path.h"
+
+#include <algorithm>
+
+static const char* SEGMENT_NAMES[BENCH_SEGMENT_COUNT] = {"close-up", "far", "inside", "grazing"};
+
+const char* benchSegmentName(int segment) {
+    return SEGMENT_NAMES[std::clamp(segment, 0, BENCH_SEGMENT_COUNT - 1)];
+}
+
+static Vec3 lerp(Vec3 a, Vec3 b, float t) { return a + (b - a) * t; }
+
+BenchPose benchPose(int frame, int frameCount) {
+    frameCount = std::max(frameCount, 1);
+    // Position along the whole path, then within the current segment
+    float s = (float)frame / (float)frameCount * BENCH_SEGMENT_COUNT;
+    int seg = std::min((int)s, BENCH_SEGMENT_COUNT - 1);
+    float k = s - (float)seg;
+
+    const Vec3 flameMid = {0.0f, 0.8f, 0.0f};
+    BenchPose pose;
+    pose.segment = SEGMENT_NAMES[seg];
+
+    switch (seg) {
+    case 0: {
+        // Quarter orbit around the flame at close range
+        float a = 1.5707963f * k;
+        pose.camPos = {0.6f * sinf(a), 0.8f, 0.6f * cosf(a)};
+        pose.camFront = normalize(flameMid - pose.camPos);
+        break;
+    }
+    case 1: {
+        pose.camPos = lerp({0.0f, 1.0f, 3.0f}, {0.0f, 1.5f, 8.0f}, k);
+        pose.camFront = normalize(flameMid - pose.camPos);
+        break;
+    }
+    case 2: {
+        // On the axis, rising from the blue base to the tip, looking ahead
+        pose.camPos = lerp({0.0f, 0.15f, 0.02f}, {0.0f, 1.8f, 0.02f}, k);
+        pose.camFront = normalize(Vec3{0.0f, 0.35f, -1.0f});
+        break;
+    }
+    default: {
+        pose.camPos = lerp({-2.0f, 0.9f, 0.25f}, {2.0f, 0.9f, 0.25f}, k);
+        pose.camFront = {1.0f, 0.0f, 0.0f};
+        break;
+    }
+    }
+    return pose;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "math_utils.h"
+
+/* =================== BENCHMARK CAMERA PATH =================== */
+// Scripted camera for --bench runs. The path is split evenly into segments
+// that stress different costs of the raymarch:
+//   close-up  orbit at 0.6 from the axis: flame fills much of the frame
+//   far       dolly out to 8 units: flame covers a few pixels
+//   inside    rise along the axis through the flame
+//   grazing   tangential pass 0.25 from the axis: long in-flame chords
+// Poses depend only on the frame index, so runs are repeatable.
+
+struct BenchPose {
+    Vec3 camPos;
+    Vec3 camFront;
+    const char* segment;
+};
+
+constexpr int BENCH_SEGMENT_COUNT = 4;
+constexpr float BENCH_DEFAULT_DT = 1.0f / 60.0f;   // simTime step per frame
+
+// Segment names in path order
+const char* benchSegmentName(int segment);
+
+// Pose for frame in [0, frameCount)
+BenchPose benchPose(int frame, int frameCount);
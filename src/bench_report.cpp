@@ -0,0 +1,118 @@
+#include "bench_report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "bench_path.h"
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::clamp(rank, (size_t)1, sorted.size()) - 1];
+}
+
+BenchStats benchStats(const BenchRun& run, const char* segment) {
+    std::vector<double> ms;
+    double sum = 0.0, spr = 0.0, shaded = 0.0, skipped = 0.0;
+    int sprCount = 0, rectCount = 0;
+    double pixels = (double)run.width * run.height;
+    for (const BenchFrame& f : run.frames) {
+        if (segment && std::strcmp(f.segment, segment) != 0) continue;
+        ms.push_back(f.ms);
+        sum += f.ms;
+        if (f.samplesPerRay >= 0.0) { spr += f.samplesPerRay; sprCount++; }
+        if (f.shadedPixels >= 0 && pixels > 0.0) {
+            shaded += (double)f.shadedPixels / pixels;
+            skipped += (double)f.skippedPixels / pixels;
+            rectCount++;
+        }
+    }
+
+    BenchStats s;
+    if (ms.empty()) return s;
+    std::sort(ms.begin(), ms.end());
+    s.mean = sum / ms.size();
+    s.min = ms.front();
+    s.max = ms.back();
+    s.p50 = percentile(ms, 50.0);
+    s.p95 = percentile(ms, 95.0);
+    s.p99 = percentile(ms, 99.0);
+    s.samplesPerRay = sprCount ? spr / sprCount : -1.0;
+    if (rectCount) {
+        s.shaded = shaded / rectCount;
+        s.skipped = skipped / rectCount;
+    }
+    return s;
+}
+
+void printBenchSummary(const BenchRun& run) {
+    // Screen-rect columns only for runs that counted pixels
+    const bool rect = benchStats(run).shaded >= 0.0;
+    std::printf("%-10s %9s %9s %9s %9s %12s", "segment", "mean ms", "p50 ms", "p95 ms", "p99 ms", "samples/ray");
+    if (rect) std::printf(" %9s %9s", "shaded", "skipped");
+    std::printf("\n");
+    auto row = [rect](const char* name, const BenchStats& s) {
+        std::printf("%-10s %9.3f %9.3f %9.3f %9.3f ", name, s.mean, s.p50, s.p95, s.p99);
+        if (s.samplesPerRay >= 0.0) std::printf("%12.2f", s.samplesPerRay);
+        else std::printf("%12s", "n/a");
+        if (rect) std::printf(" %8.1f%% %8.1f%%", s.shaded * 100.0, s.skipped * 100.0);
+        std::printf("\n");
+    };
+    for (int i = 0; i < BENCH_SEGMENT_COUNT; i++)
+        row(benchSegmentName(i), benchStats(run, benchSegmentName(i)));
+    row("all", benchStats(run));
+}
+
+static void writeStats(FILE* f, const BenchStats& s) {
+    std::fprintf(f, "{\"mean_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, "
+                    "\"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"samples_per_ray\": ",
+                 s.mean, s.min, s.max, s.p50, s.p95, s.p99);
+    if (s.samplesPerRay >= 0.0) std::fprintf(f, "%.4f", s.samplesPerRay);
+    else std::fprintf(f, "null");
+    if (s.shaded >= 0.0) std::fprintf(f, ", \"shaded_fraction\": %.4f, \"skipped_fraction\": %.4f", s.shaded, s.skipped);
+    std::fprintf(f, "}");
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c >= 0x20) out += c;
+    }
+    return out;
+}
+
+bool writeBenchJson(const std::string& path, const BenchRun& run) {
+    std::unique_ptr<FILE, int (*)(FILE*)> f(std::fopen(path.c_str(), "w"), &std::fclose);
+    if (!f) return false;
+    FILE* o = f.get();
+
+    std::fprintf(o, "{\n  \"mode\": \"%s\",\n  \"renderer\": \"%s\",\n", jsonEscape(run.mode).c_str(),
+                 jsonEscape(run.renderer).c_str());
+    std::fprintf(o, "  \"width\": %d,\n  \"height\": %d,\n  \"threads\": %d,\n  \"dt\": %.6f,\n",
+                 run.width, run.height, run.threads, run.dt);
+    std::fprintf(o, "  \"frame_count\": %zu,\n  \"summary\": ", run.frames.size());
+    writeStats(o, benchStats(run));
+    std::fprintf(o, ",\n  \"segments\": {\n");
+    for (int i = 0; i < BENCH_SEGMENT_COUNT; i++) {
+        std::fprintf(o, "    \"%s\": ", benchSegmentName(i));
+        writeStats(o, benchStats(run, benchSegmentName(i)));
+        std::fprintf(o, i + 1 < BENCH_SEGMENT_COUNT ? ",\n" : "\n");
+    }
+    std::fprintf(o, "  },\n  \"frames\": [\n");
+    for (size_t i = 0; i < run.frames.size(); i++) {
+        const BenchFrame& fr = run.frames[i];
+        std::fprintf(o, "    {\"frame\": %d, \"segment\": \"%s\", \"time\": %.6f, \"ms\": %.4f, \"samples_per_ray\": ",
+                     fr.frame, fr.segment, fr.simTime, fr.ms);
+        if (fr.samplesPerRay >= 0.0) std::fprintf(o, "%.4f", fr.samplesPerRay);
+        else std::fprintf(o, "null");
+        if (fr.shadedPixels >= 0)
+            std::fprintf(o, ", \"shaded_pixels\": %lld, \"skipped_pixels\": %lld", fr.shadedPixels, fr.skippedPixels);
+        std::fprintf(o, "}");
+        std::fprintf(o, i + 1 < run.frames.size() ? ",\n" : "\n");
+    }
+    std::fprintf(o, "  ]\n}\n");
+    return std::ferror(o) == 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/* =================== BENCHMARK REPORT =================== */
+// Per-frame timings from a --bench run and their JSON export.
+
+struct BenchFrame {
+    int frame = 0;
+    const char* segment = "";
+    float simTime = 0.0f;
+    double ms = 0.0;
+    double samplesPerRay = -1.0;   // < 0 when the renderer cannot count them
+    long long shadedPixels = -1;   // flame rays (screen rect at flame scale); < 0 without a rect
+    long long skippedPixels = -1;  // pixels outside the screen rect
+};
+
+struct BenchRun {
+    std::string mode;        // "cpu" or "gpu"
+    std::string renderer;    // GL_RENDERER string or CPU kernel description
+    int width = 0, height = 0;
+    int threads = 0;         // CPU renderer threads, 0 for GPU
+    float dt = 0.0f;
+    std::vector<BenchFrame> frames;
+};
+
+struct BenchStats {
+    double mean = 0, min = 0, max = 0, p50 = 0, p95 = 0, p99 = 0;
+    double samplesPerRay = -1.0;
+    double shaded = -1.0, skipped = -1.0;   // mean fractions of the frame's pixels
+};
+
+// Nearest-rank percentiles over frames whose segment matches (nullptr = all)
+BenchStats benchStats(const BenchRun& run, const char* segment = nullptr);
+
+// Print overall and per-segment statistics
+void printBenchSummary(const BenchRun& run);
+
+bool writeBenchJson(const std::string& path, const BenchRun& run);
+
+// s with quotes and backslashes escaped and control characters dropped,
+// for the other JSON reports
+std::string jsonEscape(const std::string& s);
@@ -0,0 +1,98 @@
+#include "blue_noise.h"
+
+#include <cmath>
+#include <random>
+
+// Void-and-cluster (Ulichney 1993) on a torus. "Energy" is the sum of a
+// Gaussian splatted at every set pixel: the set pixel with the most energy
+// sits in the tightest cluster, the empty pixel with the least in the
+// largest void.
+BlueNoise makeBlueNoise(int size, uint32_t seed) {
+    const int n = size * size;
+    const int mask = size - 1;
+    const float sigma = 1.5f;
+
+    std::vector<float> kernel(n);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int dx = x < size - x ? x : size - x;
+            int dy = y < size - y ? y : size - y;
+            kernel[y * size + x] = expf(-(float)(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+        }
+    }
+
+    std::vector<uint8_t> bits(n, 0);
+    std::vector<float> energy(n, 0.0f);
+    auto set = [&](std::vector<uint8_t>& b, std::vector<float>& e, int i, bool on) {
+        b[i] = on;
+        int px = i % size, py = i / size;
+        float sign = on ? 1.0f : -1.0f;
+        for (int y = 0; y < size; y++) {
+            const float* k = &kernel[((y - py) & mask) * size];
+            float* row = &e[y * size];
+            for (int x = 0; x < size; x++) row[x] += sign * k[(x - px) & mask];
+        }
+    };
+    auto tightestCluster = [&](const std::vector<uint8_t>& b, const std::vector<float>& e) {
+        int best = 0;
+        float most = -1.0f;
+        for (int i = 0; i < n; i++)
+            if (b[i] && e[i] > most) { most = e[i]; best = i; }
+        return best;
+    };
+    auto largestVoid = [&](const std::vector<uint8_t>& b, const std::vector<float>& e) {
+        int best = 0;
+        float least = 3.0e38f;
+        for (int i = 0; i < n; i++)
+            if (!b[i] && e[i] < least) { least = e[i]; best = i; }
+        return best;
+    };
+
+    // Initial binary pattern: 10% random pixels, relaxed by moving the
+    // tightest cluster into the largest void until that is a no-op
+    std::mt19937 rng(seed);
+    const int ones = n / 10 > 0 ? n / 10 : 1;
+    for (int count = 0; count < ones;) {
+        int i = (int)(rng() % (uint32_t)n);
+        if (!bits[i]) { set(bits, energy, i, true); count++; }
+    }
+    for (;;) {
+        int c = tightestCluster(bits, energy);
+        set(bits, energy, c, false);
+        int v = largestVoid(bits, energy);
+        set(bits, energy, v, true);
+        if (v == c) break;
+    }
+
+    std::vector<int> rank(n, 0);
+
+    // Phase 1: rank the initial pattern by removing its tightest clusters
+    std::vector<uint8_t> b1 = bits;
+    std::vector<float> e1 = energy;
+    for (int r = ones - 1; r >= 0; r--) {
+        int c = tightestCluster(b1, e1);
+        rank[c] = r;
+        set(b1, e1, c, false);
+    }
+
+    // Phases 2 and 3: fill the largest voids until every pixel is ranked
+    for (int r = ones; r < n; r++) {
+        int v = largestVoid(bits, energy);
+        rank[v] = r;
+        set(bits, energy, v, true);
+    }
+
+    BlueNoise noise;
+    noise.size = size;
+    noise.values.resize(n);
+    for (int i = 0; i < n; i++) noise.values[i] = ((float)rank[i] + 0.5f) / (float)n;
+    return noise;
+}
+
+float blueNoiseOffset(int frame) {
+    // Fractional part of frame * golden ratio, in double so it stays exact
+    // for long runs
+    double v = (double)frame * 0.6180339887498949;
+    float f = (float)(v - std::floor(v));
+    return f < 1.0f ? f : 0.0f;
+}
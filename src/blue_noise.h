@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* =================== BLUE NOISE =================== */
+// Tileable blue-noise threshold map for per-pixel ray start offsets. The
+// values are ranks from the void-and-cluster method: every value in [0, 1)
+// appears once, and neighbouring pixels get values far apart, so the
+// banding of a coarse fixed-step march turns into fine, high-frequency
+// noise that a temporal filter averages away.
+//
+// Each frame the whole map is rotated by the golden ratio (mod 1). A pixel
+// then walks a low-discrepancy sequence over time while the frame keeps its
+// blue-noise spectrum. The shader uploads the same map as a texture and
+// gets the rotation as a uniform, so both renderers jitter identically.
+
+constexpr int BLUE_NOISE_SIZE = 64;
+
+struct BlueNoise {
+    int size = 0;
+    std::vector<float> values;   // [y][x], (rank + 0.5) / size^2
+
+    float at(int x, int y) const {
+        return values[(size_t)(y & (size - 1)) * size + (x & (size - 1))];
+    }
+};
+
+// size must be a power of two; the result depends only on size and seed
+BlueNoise makeBlueNoise(int size = BLUE_NOISE_SIZE, uint32_t seed = 1);
+
+// Per-frame rotation of the map, in [0, 1)
+float blueNoiseOffset(int frame);
+
+// March start offset in [0, 1) for a pixel of a frame
+inline float blueNoiseJitter(const BlueNoise& noise, int x, int y, int frame) {
+    float v = noise.at(x, y) + blueNoiseOffset(frame);
+    return v >= 1.0f ? v - 1.0f : v;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+/* =================== BOUNDED QUEUE =================== */
+// Blocking multi-producer / multi-consumer FIFO with a fixed capacity.
+// Producers wait while it is full, which is what keeps a render pipeline's
+// memory bounded when the consumer (disk, network) is the bottleneck.
+
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    // Blocks while full; returns false if the queue was closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(m_);
+        notFull_.wait(lock, [&] { return closed_ || items_.size() < capacity_; });
+        if (closed_) return false;
+        items_.push_back(std::move(item));
+        if (items_.size() > peak_) peak_ = items_.size();
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    // Blocks until an item arrives; empty once closed and drained
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(m_);
+        notEmpty_.wait(lock, [&] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return std::nullopt;
+        T item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return item;
+    }
+
+    // No more pushes; consumers drain what is left
+    void close() {
+        std::lock_guard<std::mutex> lock(m_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    size_t capacity() const { return capacity_; }
+    size_t peak() const {
+        std::lock_guard<std::mutex> lock(m_);
+        return peak_;
+    }
+
+private:
+    const size_t capacity_;
+    mutable std::mutex m_;
+    std::condition_variable notEmpty_, notFull_;
+    std::deque<T> items_;
+    size_t peak_ = 0;
+    bool closed_ = false;
+};
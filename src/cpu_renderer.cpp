@@ -0,0 +1,396 @@
+#include "cpu_renderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include "blue_noise.h"
+#include "flame_field.h"
+#include "flame_scene.h"
+#include "fluid_solver.h"
+#include "lazy_volume.h"
+#include "occupancy_grid.h"
+#include "profiler.h"
+#include "ray_stats.h"
+#include "screen_rect.h"
+#include "thread_pool.h"
+#include "volume_cache.h"
+#include "volume_sequence.h"
+
+/* =================== PER-PIXEL SHADING =================== */
+
+void cameraRay(const FlameUniforms& u, float uvx, float uvy, Vec3& ro, Vec3& rd) {
+    Vec3 forward = normalize(u.camFront);
+    Vec3 right = normalize(cross(forward, u.camUp));
+    Vec3 up = cross(right, forward);
+
+    rd = normalize(forward + right * (uvx * u.aspect * 0.5f) + up * (uvy * 0.5f));
+    ro = u.camPos;
+}
+
+Vec3 warmGlow(Vec3 ro, Vec3 rd, float formation, float flameHeight) {
+    Vec3 flameCenter = {0.0f, flameHeight * 0.35f, 0.0f};
+    Vec3 toC = flameCenter - ro;
+    float tProj = fmaxf(dot(toC, rd), 0.0f);
+    Vec3 closest = ro + rd * tProj;
+    float dAxis = length2D(closest.x, closest.z);
+    float dCenter = length(closest - flameCenter);
+
+    float glowAmt = expf(-dCenter * dCenter * 1.2f) * 0.035f
+                  + expf(-dAxis * dAxis * 10.0f) * 0.015f;
+    glowAmt *= formation;
+    return Vec3{1.0f, 0.5f, 0.12f} * glowAmt;
+}
+
+Vec3 compositePixel(const FlameSample& flame, Vec3 glow) {
+    const Vec3 bgColor = {0.003f, 0.003f, 0.006f};
+    Vec3 c = bgColor * (1.0f - flame.alpha) + flame.color + glow;
+
+    // Filmic tone mapping, then gamma
+    auto tone = [](float v) {
+        v = v / (v + 0.8f) * 1.1f;
+        return powf(fmaxf(v, 0.0f), 1.0f / 2.2f);
+    };
+    return {tone(c.x), tone(c.y), tone(c.z)};
+}
+
+Vec3 compositeMiss(Vec3 glow) {
+    // Background + glow with plain Reinhard, as in the shader
+    Vec3 c = Vec3{0.003f, 0.003f, 0.006f} + glow;
+    auto tone = [](float v) { return powf(v / (v + 1.0f), 1.0f / 2.2f); };
+    return {tone(c.x), tone(c.y), tone(c.z)};
+}
+
+/* =================== SCREEN RECT =================== */
+
+// Flame buffer sample at continuous buffer coordinates (texel centres at
+// integers). Bilinear over premultiplied colour, alpha and depthSum, so
+// flame edges fade without fringes; taps whose flame lies at a different
+// depth than the most visible tap are left out, keeping depth edges sharp.
+static FlameSample upsampleFlame(const std::vector<FlameSample>& buf, int bw, int bh, float px, float py) {
+    int x0 = (int)std::floor(px), y0 = (int)std::floor(py);
+    float fx = px - (float)x0, fy = py - (float)y0;
+    const FlameSample* taps[4];
+    float bilinear[4];
+    int front = 0;
+    for (int k = 0; k < 4; k++) {
+        int tx = std::clamp(x0 + (k & 1), 0, bw - 1);
+        int ty = std::clamp(y0 + (k >> 1), 0, bh - 1);
+        taps[k] = &buf[(size_t)ty * bw + tx];
+        bilinear[k] = ((k & 1) ? fx : 1.0f - fx) * ((k >> 1) ? fy : 1.0f - fy);
+        if (bilinear[k] * taps[k]->alpha > bilinear[front] * taps[front]->alpha) front = k;
+    }
+
+    float ref = taps[front]->depth();
+    FlameSample out;
+    out.hit = true;
+    float weight = 0.0f;
+    for (int k = 0; k < 4; k++) {
+        const FlameSample& t = *taps[k];
+        if (t.alpha > 0.0f && ref > 0.0f && fabsf(t.depth() - ref) > UPSAMPLE_DEPTH_TOLERANCE * ref) continue;
+        out.color += t.color * bilinear[k];
+        out.alpha += t.alpha * bilinear[k];
+        out.depthSum += t.depthSum * bilinear[k];
+        weight += bilinear[k];
+    }
+    if (weight > 0.0f) {
+        out.color = out.color * (1.0f / weight);
+        out.alpha /= weight;
+        out.depthSum /= weight;
+    }
+    return out;
+}
+
+// Two passes: march the screen rect into a flame buffer at options.flameScale,
+// then composite every pixel, with the glow alone outside the rect. At
+// scale 1 the buffer maps 1:1 to pixels and the image equals the full march.
+// A ray cost map gives pixels in the rect their nearest texel's cost.
+template <class March>
+static RenderStats renderRect(const March& march, const FlameUniforms& u, Image& img,
+                              ThreadPool& pool, const RenderOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+
+    const int tileSize = options.tileSize;
+    const BlueNoise* noise = options.jitter;
+    const int frame = options.frameIndex;
+    const FlameParams& params = options.params ? *options.params : FlameParams{};
+    const Vec3 sphereCenter = params.sphereCenter();
+    const float sphereRadius = params.sphereRadius();
+    const ScreenRect rect = flameScreenRect(u, img.width, img.height, sphereCenter, sphereRadius);
+    int bw, bh;
+    flameBufferSize(rect, std::clamp(options.flameScale, 0.01f, 1.0f), bw, bh);
+    const bool exact = bw == rect.width() && bh == rect.height();
+    const float sx = bw ? (float)rect.width() / (float)bw : 1.0f;
+    const float sy = bh ? (float)rect.height() / (float)bh : 1.0f;
+    float* depth = nullptr;
+    if (options.depth) {
+        options.depth->assign((size_t)img.width * img.height, 0.0f);
+        depth = options.depth->data();
+    }
+    RayCostMap* cost = options.rayCost;
+    if (cost) cost->resize(img.width, img.height);
+
+    // Pass 1: the flame buffer; texel centres map to (x0 + (i + 0.5) * sx, ...)
+    std::vector<FlameSample> buffer((size_t)bw * bh);
+    std::atomic<uint64_t> rays{0}, samples{0}, empty{0};
+    int tilesX = (bw + tileSize - 1) / tileSize;
+    int tilesY = (bh + tileSize - 1) / tileSize;
+    pool.parallelFor((size_t)tilesX * tilesY, [&](size_t tile) {
+        PROFILE_SCOPE("flame tile");
+        int i0 = (int)(tile % tilesX) * tileSize;
+        int j0 = (int)(tile / tilesX) * tileSize;
+        int i1 = std::min(i0 + tileSize, bw);
+        int j1 = std::min(j0 + tileSize, bh);
+
+        uint64_t tileRays = 0, tileSamples = 0, tileEmpty = 0;
+        for (int j = j0; j < j1; j++) {
+            float uvy = 1.0f - 2.0f * ((float)rect.y0 + ((float)j + 0.5f) * sy) / (float)img.height;
+            for (int i = i0; i < i1; i++) {
+                float uvx = 2.0f * ((float)rect.x0 + ((float)i + 0.5f) * sx) / (float)img.width - 1.0f;
+                float jitter = noise ? blueNoiseJitter(*noise, i, j, frame) : 0.0f;
+                Vec3 ro, rd;
+                cameraRay(u, uvx, uvy, ro, rd);
+                FlameSample& s = buffer[(size_t)j * bw + i];
+                s = march(ro, rd, jitter);
+                if (s.hit) tileRays++;
+                tileSamples += (uint64_t)s.steps;
+                tileEmpty += (uint64_t)s.emptySteps;
+            }
+        }
+        rays.fetch_add(tileRays, std::memory_order_relaxed);
+        samples.fetch_add(tileSamples, std::memory_order_relaxed);
+        empty.fetch_add(tileEmpty, std::memory_order_relaxed);
+    });
+
+    // Pass 2: composite at full resolution. Upsampled pixels take the
+    // bounding-sphere test at their own position, so the flame / miss tone
+    // curves split exactly where the full march splits them.
+    tilesX = (img.width + tileSize - 1) / tileSize;
+    tilesY = (img.height + tileSize - 1) / tileSize;
+    pool.parallelFor((size_t)tilesX * tilesY, [&](size_t tile) {
+        PROFILE_SCOPE("composite tile");
+        int x0 = (int)(tile % tilesX) * tileSize;
+        int y0 = (int)(tile / tilesX) * tileSize;
+        int x1 = std::min(x0 + tileSize, img.width);
+        int y1 = std::min(y0 + tileSize, img.height);
+
+        for (int y = y0; y < y1; y++) {
+            float uvy = 1.0f - 2.0f * ((float)y + 0.5f) / (float)img.height;
+            bool rowInside = y >= rect.y0 && y < rect.y1;
+            for (int x = x0; x < x1; x++) {
+                float uvx = 2.0f * ((float)x + 0.5f) / (float)img.width - 1.0f;
+                Vec3 ro, rd;
+                cameraRay(u, uvx, uvy, ro, rd);
+                Vec3 glow = warmGlow(ro, rd, u.formation, params.height);
+
+                FlameSample s;
+                if (rowInside && x >= rect.x0 && x < rect.x1) {
+                    if (exact) {
+                        s = buffer[(size_t)(y - rect.y0) * bw + (x - rect.x0)];
+                    } else if (intersectSphere(ro, rd, sphereCenter, sphereRadius).y >= 0.0f) {
+                        s = upsampleFlame(buffer, bw, bh, ((float)(x - rect.x0) + 0.5f) / sx - 0.5f,
+                                          ((float)(y - rect.y0) + 0.5f) / sy - 0.5f);
+                    }
+                }
+                Vec3 c = s.hit ? compositePixel(s, glow) : compositeMiss(glow);
+                float* px = img.pixel(x, y);
+                px[0] = c.x; px[1] = c.y; px[2] = c.z;
+                if (depth) depth[(size_t)y * img.width + x] = s.depth();
+                if (cost && rowInside && x >= rect.x0 && x < rect.x1) {
+                    // The texel this pixel was marched in, or nearest to it
+                    int i = std::min((int)(((float)(x - rect.x0) + 0.5f) / sx), bw - 1);
+                    int j = std::min((int)(((float)(y - rect.y0) + 0.5f) / sy), bh - 1);
+                    const FlameSample& t = buffer[(size_t)j * bw + i];
+                    cost->set((size_t)y * img.width + x, t.steps, t.emptySteps, t.exit);
+                }
+            }
+        }
+    });
+
+    RenderStats stats;
+    stats.pixels = (uint64_t)img.width * img.height;
+    stats.raysMarched = rays.load();
+    stats.densitySamples = samples.load();
+    stats.emptySamples = empty.load();
+    stats.shadedPixels = (uint64_t)bw * bh;
+    stats.skippedPixels = stats.pixels - (uint64_t)rect.area();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+/* =================== TILED FRAME =================== */
+
+// march(ro, rd, jitter) marches one ray. A scene march takes a fourth
+// argument, Vec3& glow, and returns its instances' glow there in place of
+// the single flame's.
+template <class March>
+static RenderStats renderTiles(const March& march, const FlameUniforms& u, Image& img,
+                               ThreadPool& pool, const RenderOptions& options) {
+    constexpr bool sceneMarch = requires(Vec3 v, Vec3& glow) { march(v, v, 0.0f, glow); };
+    if constexpr (!sceneMarch) {
+        if (options.screenRect || options.flameScale < 1.0f) return renderRect(march, u, img, pool, options);
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    const int tileSize = options.tileSize;
+    const BlueNoise* noise = options.jitter;
+    const int frame = options.frameIndex;
+    const float flameHeight = options.params ? options.params->height : FLAME_HEIGHT;
+    float* depth = nullptr;
+    if (options.depth) {
+        options.depth->assign((size_t)img.width * img.height, 0.0f);
+        depth = options.depth->data();
+    }
+    RayCostMap* cost = options.rayCost;
+    if (cost) cost->resize(img.width, img.height);
+
+    int tilesX = (img.width + tileSize - 1) / tileSize;
+    int tilesY = (img.height + tileSize - 1) / tileSize;
+
+    std::atomic<uint64_t> rays{0}, samples{0}, empty{0};
+
+    pool.parallelFor((size_t)tilesX * tilesY, [&](size_t tile) {
+        PROFILE_SCOPE("tile");
+        int x0 = (int)(tile % tilesX) * tileSize;
+        int y0 = (int)(tile / tilesX) * tileSize;
+        int x1 = std::min(x0 + tileSize, img.width);
+        int y1 = std::min(y0 + tileSize, img.height);
+
+        uint64_t tileRays = 0, tileSamples = 0, tileEmpty = 0;
+        for (int y = y0; y < y1; y++) {
+            // Row 0 is the top of the image; uv.y = +1 at the top like GL
+            float uvy = 1.0f - 2.0f * ((float)y + 0.5f) / (float)img.height;
+            for (int x = x0; x < x1; x++) {
+                float uvx = 2.0f * ((float)x + 0.5f) / (float)img.width - 1.0f;
+                float jitter = noise ? blueNoiseJitter(*noise, x, y, frame) : 0.0f;
+                FlameSample s;
+                Vec3 c;
+                if constexpr (sceneMarch) {
+                    Vec3 ro, rd, glow;
+                    cameraRay(u, uvx, uvy, ro, rd);
+                    s = march(ro, rd, jitter, glow);
+                    c = s.hit ? compositePixel(s, glow) : compositeMiss(glow);
+                } else {
+                    c = shadePixel([&](Vec3 ro, Vec3 rd) { return march(ro, rd, jitter); }, u, uvx, uvy, &s,
+                                   flameHeight);
+                }
+                float* px = img.pixel(x, y);
+                px[0] = c.x; px[1] = c.y; px[2] = c.z;
+                if (depth) depth[(size_t)y * img.width + x] = s.depth();
+                if (cost) cost->set((size_t)y * img.width + x, s.steps, s.emptySteps, s.exit);
+                if (s.hit) tileRays++;
+                tileSamples += (uint64_t)s.steps;
+                tileEmpty += (uint64_t)s.emptySteps;
+            }
+        }
+        rays.fetch_add(tileRays, std::memory_order_relaxed);
+        samples.fetch_add(tileSamples, std::memory_order_relaxed);
+        empty.fetch_add(tileEmpty, std::memory_order_relaxed);
+    });
+
+    RenderStats stats;
+    stats.pixels = (uint64_t)img.width * img.height;
+    stats.raysMarched = rays.load();
+    stats.densitySamples = samples.load();
+    stats.emptySamples = empty.load();
+    stats.shadedPixels = stats.pixels;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+// Pixel footprint per unit distance: cameraRay spans 1 unit vertically and
+// 'aspect' units horizontally on the plane one unit ahead
+static float pixelSpread(const FlameUniforms& u, const Image& img) {
+    return fmaxf(1.0f / (float)img.height, u.aspect / (float)img.width);
+}
+
+template <class Q, class Field>
+static RenderStats renderField(const Field& field, const FlameUniforms& u, Image& img,
+                               ThreadPool& pool, const RenderOptions& options) {
+    const float spread = options.lod ? pixelSpread(u, img) : 0.0f;
+    if (options.occupancy) {
+        const OccupancyGrid& grid = *options.occupancy;
+        return renderTiles([&](Vec3 ro, Vec3 rd, float jitter) {
+            return marchFlameSkipping<Q>(field, grid, ro, rd, spread, jitter);
+        }, u, img, pool, options);
+    }
+    return renderTiles([&](Vec3 ro, Vec3 rd, float jitter) { return marchFlame<Q>(field, ro, rd, spread, jitter); },
+                       u, img, pool, options);
+}
+
+// Every instance gets the tier's field at its own time and formation
+template <class Q, class MakeField>
+static RenderStats renderScene(const FlameScene& scene, const MakeField& makeField, const FlameUniforms& u,
+                               Image& img, ThreadPool& pool, const RenderOptions& options) {
+    const float spread = options.lod ? pixelSpread(u, img) : 0.0f;
+    return renderTiles([&](Vec3 ro, Vec3 rd, float jitter, Vec3& glow) {
+        return marchScene<Q>(scene, makeField, ro, rd, u.formation, glow, spread, jitter);
+    }, u, img, pool, options);
+}
+
+// One full renderer per quality tier and table setting; sources that are not
+// procedural only take the tier's march limits (and the LOD step growth), and
+// the shape tables only replace the procedural flame's shape and colour
+template <class Q, bool Tables>
+static RenderStats renderTier(const FlameUniforms& u, Image& img, ThreadPool& pool,
+                              const RenderOptions& options) {
+    // The occupancy grid bounds the procedural flame at the origin, not
+    // simulated or recorded gas or a scene
+    RenderOptions dense = options;
+    dense.occupancy = nullptr;
+    if (options.fluid)
+        return renderField<Q>(FluidField{options.fluid, u.formation}, u, img, pool, dense);
+    if (options.volume) {
+        VolumeFrame frame = options.volume->frame(options.volume->frameAt(u.time));
+        return renderField<Q>(VolumeFrameField{&frame, u.formation}, u, img, pool, dense);
+    }
+    if (options.scene) {
+        if (options.lod) {
+            return renderScene<Q>(*options.scene, [&](const FlameInstance& i) {
+                return LodField<Q, Tables>{u.time + i.timeOffset, u.formation * i.formation};
+            }, u, img, pool, dense);
+        }
+        return renderScene<Q>(*options.scene, [&](const FlameInstance& i) {
+            return TieredField<Q, Tables>{u.time + i.timeOffset, u.formation * i.formation};
+        }, u, img, pool, dense);
+    }
+    if (const FlameParams* params = options.params) {
+        if (options.baked)
+            return renderField<Q>(WithParams<BakedField>{{options.baked, u.time, u.formation}, params}, u, img,
+                                  pool, options);
+        if (options.lazy)
+            return renderField<Q>(WithParams<LazyField>{{options.lazy, u.time, u.formation}, params}, u, img,
+                                  pool, options);
+        return renderField<Q>(ParamsField<Q>{params, u.time, u.formation}, u, img, pool, options);
+    }
+    if (options.baked)
+        return renderField<Q>(BakedField{options.baked, u.time, u.formation}, u, img, pool, options);
+    if (options.lazy)
+        return renderField<Q>(LazyField{options.lazy, u.time, u.formation}, u, img, pool, options);
+    if (options.lod)
+        return renderField<Q>(LodField<Q, Tables>{u.time, u.formation}, u, img, pool, options);
+    return renderField<Q>(TieredField<Q, Tables>{u.time, u.formation}, u, img, pool, options);
+}
+
+using TierRenderer = RenderStats (*)(const FlameUniforms&, Image&, ThreadPool&, const RenderOptions&);
+
+// Indexed by [tables][QualityTier]
+static const TierRenderer TIER_RENDERERS[2][QUALITY_TIER_COUNT] = {
+    {
+        &renderTier<QualityPreview, false>,
+        &renderTier<QualityProduction, false>,
+        &renderTier<QualityFinal, false>,
+        &renderTier<QualityTemporal, false>,
+    },
+    {
+        &renderTier<QualityPreview, true>,
+        &renderTier<QualityProduction, true>,
+        &renderTier<QualityFinal, true>,
+        &renderTier<QualityTemporal, true>,
+    },
+};
+
+RenderStats renderImage(const FlameUniforms& u, Image& img, ThreadPool& pool,
+                        const RenderOptions& options) {
+    PROFILE_SCOPE("render frame");
+    return TIER_RENDERERS[options.tables ? 1 : 0][(int)options.quality](u, img, pool, options);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "flame_march.h"
+#include "math_utils.h"
+
+struct BlueNoise;
+class FlameScene;
+class FluidSolver;
+class LazyVolume;
+class OccupancyGrid;
+struct RayCostMap;
+class ThreadPool;
+class VolumeCache;
+class VolumeSequence;
+
+/* =================== CPU RENDERER =================== */
+// Tile-based CPU reference renderer for the flameFS raymarcher. Takes the
+// same inputs as the shader uniforms and produces the same tone-mapped,
+// gamma-corrected image, so it can run on nodes without a GPU or display.
+
+// Shader uniforms (iTime, iCamPos, iCamFront, iCamUp, iAspect, iFormation)
+struct FlameUniforms {
+    float time = 0.0f;
+    Vec3  camPos = {0.0f, 0.8f, 3.0f};
+    Vec3  camFront = {0.0f, 0.0f, -1.0f};
+    Vec3  camUp = {0.0f, 1.0f, 0.0f};
+    float aspect = 16.0f / 9.0f;
+    float formation = 1.0f;
+};
+
+// RGB float image, rows stored top to bottom
+struct Image {
+    int width = 0, height = 0;
+    std::vector<float> rgb;
+
+    void resize(int w, int h) { width = w; height = h; rgb.assign((size_t)w * h * 3, 0.0f); }
+    float* pixel(int x, int y) { return &rgb[((size_t)y * width + x) * 3]; }
+    const float* pixel(int x, int y) const { return &rgb[((size_t)y * width + x) * 3]; }
+};
+
+// Per-frame counters
+struct RenderStats {
+    uint64_t pixels = 0;
+    uint64_t raysMarched = 0;   // rays that hit the bounding sphere
+    uint64_t densitySamples = 0;
+    uint64_t emptySamples = 0;  // density samples that found nothing
+    uint64_t shadedPixels = 0;  // rays marched for the flame (at the flame buffer size)
+    uint64_t skippedPixels = 0; // pixels outside the screen rect: glow only
+    double   seconds = 0.0;
+};
+
+// ---- Per-pixel pieces of flameFS main() ----
+
+// Camera ray for a fullscreen-triangle uv in [-1, 1]^2
+void cameraRay(const FlameUniforms& u, float uvx, float uvy, Vec3& ro, Vec3& rd);
+
+// Ambient warm light cast by the flame, evaluated for every pixel; centred
+// on a flame of the given height
+Vec3 warmGlow(Vec3 ro, Vec3 rd, float formation, float flameHeight = FLAME_HEIGHT);
+
+// Background + flame + glow, filmic tone map and gamma
+Vec3 compositePixel(const FlameSample& flame, Vec3 glow);
+
+// Miss path: background + glow only
+Vec3 compositeMiss(Vec3 glow);
+
+// Full flameFS for one pixel; march(ro, rd) returns the FlameSample, e.g.
+// marchFlame() over any Field (see flame_march.h)
+template <class March>
+Vec3 shadePixel(const March& march, const FlameUniforms& u, float uvx, float uvy,
+                FlameSample* sampleOut = nullptr, float flameHeight = FLAME_HEIGHT) {
+    Vec3 ro, rd;
+    cameraRay(u, uvx, uvy, ro, rd);
+    Vec3 glow = warmGlow(ro, rd, u.formation, flameHeight);
+    FlameSample flame = march(ro, rd);
+    if (sampleOut) *sampleOut = flame;
+    return flame.hit ? compositePixel(flame, glow) : compositeMiss(glow);
+}
+
+// ---- Frame rendering ----
+
+constexpr int DEFAULT_TILE_SIZE = 32;
+
+struct RenderOptions {
+    int tileSize = DEFAULT_TILE_SIZE;
+    QualityTier quality = QualityTier::Production;  // compile-time kernel set to run
+    bool lod = false;   // fade sub-pixel octaves and grow steps with the ray footprint
+    bool tables = false;  // procedural shape and colour from the lookup tables (flame_tables.h)
+    bool screenRect = false;  // march only the flame's screen rect (screen_rect.h)
+    float flameScale = 1.0f;  // march the rect at this resolution and upsample; < 1 implies screenRect
+    const BlueNoise* jitter = nullptr;  // per-pixel march start offsets, rotated by frameIndex
+    int frameIndex = 0;
+    std::vector<float>* depth = nullptr;  // if set, receives FlameSample::depth() per pixel
+    RayCostMap* rayCost = nullptr;        // if set, receives each pixel's march cost (ray_stats.h)
+    const VolumeCache* baked = nullptr;       // sample this instead of the noise
+    const LazyVolume* lazy = nullptr;         // or this, bricks computed on demand (lazy_volume.h)
+    const OccupancyGrid* occupancy = nullptr; // skip empty space with this grid
+    const FluidSolver* fluid = nullptr;       // simulated gas; occupancy does not apply
+    const VolumeSequence* volume = nullptr;   // play back a recorded sequence at u.time
+    const FlameScene* scene = nullptr;        // many procedural flames (flame_scene.h); no rect or occupancy
+    // Shape, colour and bounds of the procedural flame, or of the baked or
+    // lazy one (which must have been built from the same block); null is
+    // the compiled flame. Not with tables, fluid, volume or scene
+    const FlameParams* params = nullptr;
+};
+
+// Render the whole image (img must be sized) as tiles spread over the pool
+RenderStats renderImage(const FlameUniforms& u, Image& img, ThreadPool& pool,
+                        const RenderOptions& options = {});
@@ -0,0 +1,62 @@
+#include "dynamic_resolution.h"
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings)
+    : settings_(settings), scale_(settings.maxScale) {
+    settings_.costWindow = std::max(settings_.costWindow, 1);
+    cost_.assign((size_t)settings_.costWindow, 0.0);
+}
+
+void DynamicResolution::reset() {
+    scale_ = settings_.maxScale;
+    costCount_ = costNext_ = 0;
+    lastMs_ = 0.0;
+    underFrames_ = 0;
+}
+
+void DynamicResolution::addSample(double ms, long long pixels) {
+    if (pixels <= 0 || !(ms >= 0.0)) return;
+    cost_[(size_t)costNext_] = ms / (double)pixels;
+    costNext_ = (costNext_ + 1) % settings_.costWindow;
+    costCount_ = std::min(costCount_ + 1, settings_.costWindow);
+    lastMs_ = ms;
+}
+
+// Rounded down, so a change never overshoots its aim
+float DynamicResolution::quantize(float s) const {
+    float q = settings_.quantum > 0.0f ? std::floor(s / settings_.quantum) * settings_.quantum : s;
+    return std::clamp(q, settings_.minScale, settings_.maxScale);
+}
+
+bool DynamicResolution::update(long long rectPixels, ScaleChange* change) {
+    frame_++;
+    if (costCount_ == 0 || rectPixels <= 0) return false;
+
+    double cost = *std::max_element(cost_.begin(), cost_.begin() + costCount_);
+    double fullMs = cost * (double)rectPixels;   // the rect at scale 1
+    double predicted = fullMs * scale_ * scale_;
+    float ideal = fullMs > 0.0 ? (float)std::sqrt(settings_.aim * settings_.budgetMs / fullMs) : settings_.maxScale;
+
+    float next = scale_;
+    if (predicted > settings_.budgetMs) {
+        underFrames_ = 0;
+        next = quantize(ideal);
+    } else if (predicted < settings_.growBelow * settings_.budgetMs && scale_ < settings_.maxScale) {
+        if (++underFrames_ >= settings_.growFrames) next = quantize(std::min(ideal, scale_ * settings_.maxGrowth));
+    } else {
+        underFrames_ = 0;
+    }
+    if (next == scale_) return false;
+
+    if (change) {
+        change->frame = frame_;
+        change->from = scale_;
+        change->to = next;
+        change->sampleMs = lastMs_;
+        change->predictedMs = predicted;
+    }
+    scale_ = next;
+    underFrames_ = 0;
+    return true;
+}
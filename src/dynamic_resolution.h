@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+
+/* =================== DYNAMIC RESOLUTION =================== */
+// Picks the flame scale (the resolution the screen rect is marched at, see
+// screen_rect.h) that keeps the flame pass under a time budget. Frame times
+// are turned into a cost per marched pixel, so a measurement stays valid
+// while the rect grows or shrinks and can arrive a few frames late (GPU
+// timer queries); the scale for the next frame is then
+//
+//   scale = sqrt(aim * budget / (cost per pixel * rect pixels at full res))
+//
+// The cost is the largest of the last few samples: a spike (camera moving
+// into the flame) shrinks the scale on the frame its time arrives, while a
+// drop has to persist for growFrames frames before the scale grows, by at
+// most maxGrowth per change. Changes aim below the budget and the scale only
+// grows while the prediction is under growBelow of it, so a frame time
+// settling between the two leaves the scale alone: no oscillation.
+
+struct DynamicResolutionSettings {
+    double budgetMs = 8.0;     // flame pass time to stay under
+    float minScale = 0.25f;
+    float maxScale = 1.0f;
+    double aim = 0.85;         // a change targets this fraction of the budget
+    double growBelow = 0.7;    // grow only while predicted under this fraction...
+    int growFrames = 8;        // ...for this many consecutive frames
+    float maxGrowth = 1.25f;   // largest step up per change
+    int costWindow = 4;        // samples the cost per pixel is the maximum of
+    float quantum = 1.0f / 64.0f;   // scales are multiples of this
+};
+
+// One scale decision, for logging and tuning
+struct ScaleChange {
+    int frame = 0;             // update() calls so far
+    float from = 1.0f, to = 1.0f;
+    double sampleMs = 0.0;     // newest flame pass time
+    double predictedMs = 0.0;  // at the old scale, for this frame's rect
+};
+
+class DynamicResolution {
+public:
+    explicit DynamicResolution(const DynamicResolutionSettings& settings = {});
+
+    // A finished flame pass: its time and the pixels it marched (any frame
+    // of the last few; results may lag). Passes with no pixels are ignored
+    void addSample(double ms, long long pixels);
+
+    // Scale for a frame whose rect covers rectPixels at full resolution.
+    // True if it changed, with the decision in *change if given
+    bool update(long long rectPixels, ScaleChange* change = nullptr);
+
+    float scale() const { return scale_; }
+    const DynamicResolutionSettings& settings() const { return settings_; }
+
+    // Back to maxScale with no cost history
+    void reset();
+
+private:
+    float quantize(float s) const;
+
+    DynamicResolutionSettings settings_;
+    float scale_;
+    std::vector<double> cost_;   // ms per marched pixel, ring of costWindow
+    int costCount_ = 0, costNext_ = 0;
+    double lastMs_ = 0.0;
+    int underFrames_ = 0;
+    int frame_ = 0;
+};
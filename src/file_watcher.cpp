@@ -0,0 +1,71 @@
+#include "file_watcher.h"
+
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace fs = std::filesystem;
+
+FileWatcher::FileWatcher(const std::string& path) : path_(path) {
+    fs::path p(path);
+    name_ = p.filename().string();
+    pollStat();   // baseline for the fallback
+
+#ifdef __linux__
+    std::string dir = p.has_parent_path() ? p.parent_path().string() : ".";
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ >= 0 && inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "[Watch] Cannot watch " << dir << " (" << std::strerror(errno) << "), polling instead"
+                  << std::endl;
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (fd_ >= 0) close(fd_);
+#endif
+}
+
+bool FileWatcher::changed() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+        bool hit = false;
+        alignas(inotify_event) char buf[4096];
+        for (;;) {
+            ssize_t n = read(fd_, buf, sizeof(buf));
+            if (n <= 0) break;   // EAGAIN: nothing more queued
+            for (char* e = buf; e < buf + n;) {
+                const inotify_event* ev = (const inotify_event*)e;
+                if (ev->len > 0 && name_ == ev->name) hit = true;
+                e += sizeof(inotify_event) + ev->len;
+            }
+        }
+        return hit;
+    }
+#endif
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextPoll_) return false;
+    nextPoll_ = now + POLL_INTERVAL;
+    return pollStat();
+}
+
+bool FileWatcher::pollStat() {
+    std::error_code ec;
+    long long mtime = (long long)fs::last_write_time(path_, ec).time_since_epoch().count();
+    long long size = ec ? -1 : (long long)fs::file_size(path_, ec);
+    if (ec) mtime = 0, size = -1;   // missing for now: changes when it appears
+    bool changed = mtime != mtime_ || size != size_;
+    mtime_ = mtime;
+    size_ = size;
+    return changed;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <chrono>
+#include <string>
+
+/* =================== FILE WATCHER =================== */
+// Tells a render loop that a file was saved, without blocking it. On Linux
+// an inotify watch on the file's directory reports writes that finished
+// (IN_CLOSE_WRITE) and files renamed over it (IN_MOVED_TO, how most editors
+// save); the directory rather than the file, since a rename replaces the
+// file's inode and a watch on it would go quiet. Elsewhere, or if inotify
+// is unavailable, the modification time and size are polled at most every
+// POLL_INTERVAL.
+
+class FileWatcher {
+public:
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{100};
+
+    explicit FileWatcher(const std::string& path);
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // True if the file was saved since the last call (several saves in
+    // between count once). Never blocks
+    bool changed();
+
+    // inotify rather than polling
+    bool native() const { return fd_ >= 0; }
+    const std::string& path() const { return path_; }
+
+private:
+    bool pollStat();
+
+    std::string path_;
+    std::string name_;   // file name within the watched directory
+    int fd_ = -1;        // inotify instance
+    long long mtime_ = 0, size_ = -1;
+    std::chrono::steady_clock::time_point nextPoll_{};
+};
@@ -0,0 +1,815 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "bench_path.h"
+#include "bench_report.h"
+#include "blue_noise.h"
+#include "cpu_renderer.h"
+#include "file_watcher.h"
+#include "flame_field.h"
+#include "flame_params.h"
+#include "flame_scene.h"
+#include "fluid_solver.h"
+#include "image_io.h"
+#include "lazy_volume.h"
+#include "occupancy_grid.h"
+#include "profiler.h"
+#include "ray_stats.h"
+#include "render_farm.h"
+#include "sequence_renderer.h"
+#include "temporal_accumulator.h"
+#include "thread_pool.h"
+#include "volume_cache.h"
+#include "volume_sequence.h"
+
+/* =================== FLAME CPU =================== */
+// Headless renderer: draws one frame of the flame on the CPU and writes it
+// to disk. Inputs mirror the flameFS uniforms.
+
+static void usage() {
+    std::cout <<
+        "Usage: FlameCpu [options]\n"
+        "  --out <file>          Output image (.png/.bmp/.tga/.jpg), default flame.png\n"
+        "  --width <px>          Image width, default 1280\n"
+        "  --height <px>         Image height, default 720\n"
+        "  --time <s>            iTime, default 0\n"
+        "  --cam-pos <x,y,z>     iCamPos, default 0,0.8,3\n"
+        "  --cam-front <x,y,z>   iCamFront, default 0,0,-1\n"
+        "  --cam-up <x,y,z>      iCamUp, default 0,1,0\n"
+        "  --aspect <a>          iAspect, default width/height\n"
+        "  --formation <f>       iFormation in [0,1], default 1\n"
+        "  --threads <n>         Worker threads, default all cores\n"
+        "  --tile <px>           Tile size, default 32\n"
+        "  --quality <tier>      preview, production (= shader), final or temporal, default production\n"
+        "  --lod                 Footprint LOD: fade sub-pixel noise octaves, grow far steps\n"
+        "  --lut                 Flame shape and colour from lookup tables instead of the exact\n"
+        "                        functions (tolerances in flame_tables.h)\n"
+        "  --screen-rect         March only the flame's projected bounding rect; glow elsewhere\n"
+        "  --flame-scale <s>     March the rect at s x resolution (0..1] and upsample; implies\n"
+        "                        --screen-rect\n"
+        "  --profile <file>      Record timing markers; write a Chrome trace to file and print\n"
+        "                        a summary at exit\n"
+        "  --ray-stats <prefix>  Record steps per pixel: write prefix_heatmap.png and step\n"
+        "                        histograms to prefix.csv / prefix.json (per frame with --bench)\n"
+        "  --params <file>       Flame shape and colour from a parameter file (written with the\n"
+        "                        defaults if missing); with --bench it is reloaded between\n"
+        "                        frames when saved, rebuilding what the edit reaches\n"
+        "\nFlame scenes (many instanced flames, BVH over their bounds):\n"
+        "  --scene <file>        Render the flames listed in a scene file (see README)\n"
+        "  --candles <n>         Render a generated field of n small candle flames\n"
+        "  --candle-spacing <s>  Grid spacing of the candle field, default 1.5\n"
+        "  --scene-save <file>   Write the scene (e.g. a generated field) to a file\n"
+        "\nBaked volume cache:\n"
+        "  --baked <file>        Render from a baked density/temperature cache; the\n"
+        "                        file is loaded if it matches, else baked and saved\n"
+        "  --lazy-bricks <MiB>   Render from the same grid computed brick by brick as rays\n"
+        "                        reach it, in an LRU cache of MiB; prints hit rate and stalls\n"
+        "  --bake-res <x,y,z>    Grid nodes per axis, default 48,96,48\n"
+        "  --bake-slices <n>     Time slices per loop, default 24\n"
+        "  --bake-period <s>     Loop length in seconds, default 4\n"
+        "\nEmpty-space skipping:\n"
+        "  --occupancy           March only occupied cells of the occupancy grid\n"
+        "  --occupancy-res <n>   Grid cells per axis, default 64\n"
+        "  --occupancy-compare   Render with and without skipping, print sample stats\n"
+        "\nFluid simulation (single frame only):\n"
+        "  --fluid               Simulate the gas from t=0 to --time at 60 Hz and render it\n"
+        "  --fluid-res <n>       Solver cells per axis, default 64\n"
+        "\nVolume sequences (memory-mapped playback):\n"
+        "  --volume <file>       Render from a recorded sequence, frame chosen by --time\n"
+        "  --volume-write <file> Record a sequence and exit; with --fluid records the simulation\n"
+        "  --volume-frames <n>   Frames to record, default 96\n"
+        "  --volume-fps <f>      Recorded frame rate, default 24\n"
+        "  --volume-res <n>      Cells per axis of procedural recordings, default 64\n"
+        "  --volume-bits <b>     Quantization, 8 or 16, default 8\n"
+        "\nBenchmark (scripted camera path, fixed time step):\n"
+        "  --bench               Render the bench path instead of a single frame\n"
+        "  --frames <n>          Recorded frames, default 240\n"
+        "  --warmup <n>          Unrecorded frames first, default 2\n"
+        "  --dt <s>              simTime step per frame, default 1/60\n"
+        "  --bench-out <file>    JSON report, default bench_cpu.json\n"
+        "  --temporal            Blue-noise jittered march accumulated over frames with\n"
+        "                        reprojection; implies --quality temporal unless given\n"
+        "\nOffline sequence (frames rendered in parallel, encoded asynchronously):\n"
+        "  --sequence <a>:<b>    Render frames a..b inclusive, iTime = frame / fps\n"
+        "  --fps <n>             Frame rate, default 24\n"
+        "  --out-pattern <p>     printf pattern for outputs, default flame_%04d\n"
+        "  --float-dump          Also write a 32-bit float .pfm per frame\n"
+        "  --no-png              Skip the .png output\n"
+        "  --render-workers <n>  Frames rendered concurrently, default all cores\n"
+        "  --encoders <n>        Encoder threads, default 1\n"
+        "  --queue <n>           Finished frames waiting for encoders, default 2/encoder\n"
+        "  --resume              Skip frames whose outputs already exist\n"
+        "\nDistributed sequence (procedural flame only):\n"
+        "  --coordinator <port>  Hand the --sequence frames out to workers over TCP instead of\n"
+        "                        rendering them here; outputs are written here\n"
+        "  --worker-timeout <s>  Re-issue a frame a worker has not returned in s seconds,\n"
+        "                        default 120\n"
+        "  --worker <host:port>  Render frames for a coordinator until it is done (uses\n"
+        "                        --threads; other options come from the coordinator)\n";
+}
+
+static void printStats(const char* label, const RenderStats& s) {
+    double perRay = s.raysMarched ? (double)s.densitySamples / s.raysMarched : 0.0;
+    std::printf("%-10s %9.2f ms %12llu samples %12llu empty %8.2f samples/ray\n", label,
+                s.seconds * 1000.0, (unsigned long long)s.densitySamples,
+                (unsigned long long)s.emptySamples, perRay);
+}
+
+static void printBrickStats(const LazyVolume& volume) {
+    LazyVolumeStats s = volume.stats();
+    std::printf("Bricks: %.2f%% hit rate over %llu lookups, %llu misses, %llu coalesced, %llu retries; "
+                "stalled %.2f ms\n", s.hitRate() * 100.0, (unsigned long long)s.lookups,
+                (unsigned long long)s.misses, (unsigned long long)s.coalesced, (unsigned long long)s.retries,
+                s.stallMs);
+    std::printf("Bricks: %llu filled in %.2f ms, %llu evicted, %llu dropped by reloads; %zu of %zu touched "
+                "(%.1f%%), %zu of %zu slots resident\n", (unsigned long long)s.fills, s.fillMs,
+                (unsigned long long)s.evictions, (unsigned long long)s.dropped, s.touchedBricks, s.totalBricks,
+                100.0 * s.touchedBricks / s.totalBricks, s.residentBricks, s.capacityBricks);
+    std::printf("Brick memory: %.2f MiB of a %.2f MiB budget (full bake %.2f MiB)\n",
+                s.memoryBytes / (1024.0 * 1024.0), s.budgetBytes / (1024.0 * 1024.0),
+                s.fullBakeBytes / (1024.0 * 1024.0));
+}
+
+static int maxPixelDifference(const Image& a, const Image& b) {
+    float d = 0.0f;
+    for (size_t i = 0; i < a.rgb.size(); i++) d = fmaxf(d, fabsf(a.rgb[i] - b.rgb[i]));
+    return (int)(d * 255.0f + 0.5f);
+}
+
+// Record frames 0..frames-1 of the procedural flame or the fluid simulation
+static int writeVolume(const std::string& path, bool fluid, const FluidSettings& fluidSettings, int frames,
+                       float fps, int res, int bits, ThreadPool& pool) {
+    FluidSolver solver(fluidSettings);
+    VolumeLayout layout = fluid ? VolumeLayout{solver.cellsPerAxis(), solver.gridMin(), solver.cellSize()}
+                                : flameVolumeLayout(res);
+    VolumeSequenceWriter writer;
+    if (!writer.open(path, layout, bits, fps)) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return 1;
+    }
+
+    const int n = layout.cellsPerAxis, nb = n / VOLUME_BRICK;
+    const float cs = layout.cellSize;
+    const int substeps = std::max(1, (int)std::lround(60.0f / fps));
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (int f = 0; f < frames; f++) {
+        float time = f / fps;
+        bool ok;
+        if (fluid) {
+            for (int s = 0; s < substeps; s++) solver.step(1.0f / (fps * substeps), pool);
+            ok = writer.addFrame([&](int id, float* d, float* t) { return solver.exportBrick(id, d, t); }, pool);
+        } else {
+            ok = writer.addFrame([&](int id, float* d, float* t) {
+                int bx = id % nb, by = id / nb % nb, bz = id / (nb * nb);
+                Vec3 lo = layout.min + Vec3{(float)bx, (float)by, (float)bz} * (cs * VOLUME_BRICK);
+                Vec3 hi = lo + Vec3{1.0f, 1.0f, 1.0f} * (cs * VOLUME_BRICK);
+
+                // Same conservative support test as the occupancy grid
+                float h0 = lo.y / FLAME_HEIGHT, h1 = hi.y / FLAME_HEIGHT;
+                auto gap = [](float a, float b) { return a > 0.0f ? a : (b < 0.0f ? -b : 0.0f); };
+                if (h1 <= 0.0f || h0 >= 1.0f || length2D(gap(lo.x, hi.x), gap(lo.z, hi.z)) >= flameSupportRadius(h0, h1))
+                    return false;
+
+                int i = 0;
+                for (int z = 0; z < VOLUME_BRICK; z++)
+                    for (int y = 0; y < VOLUME_BRICK; y++)
+                        for (int x = 0; x < VOLUME_BRICK; x++, i++) {
+                            Vec3 p = lo + Vec3{x + 0.5f, y + 0.5f, z + 0.5f} * cs;
+                            d[i] = flameDensity(p, time, 1.0f);
+                            t[i] = getTemperature(p, d[i], time);
+                        }
+                return true;
+            }, pool);
+        }
+        if (!ok) {
+            std::cerr << "Failed writing frame " << f << " to " << path << std::endl;
+            return 1;
+        }
+    }
+    if (!writer.finish()) {
+        std::cerr << "Failed to finish " << path << std::endl;
+        return 1;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double raw = (double)frames * n * n * n * 2 * sizeof(float);
+    std::printf("Recorded %d %s frames (%d^3, %d-bit) in %.2f s: %.1f MiB, %.1f KiB/frame, "
+                "%.1fx smaller than dense float\n", frames, fluid ? "fluid" : "procedural", n, bits, sec,
+                writer.bytesWritten() / (1024.0 * 1024.0), writer.bytesWritten() / 1024.0 / frames,
+                raw / writer.bytesWritten());
+    return 0;
+}
+
+// e.g. "FlameCpu baked + occupancy @ production", for the reports
+static std::string rendererName(const RenderOptions& options, bool temporal) {
+    const bool rect = options.screenRect || options.flameScale < 1.0f;
+    char scale[32];
+    std::snprintf(scale, sizeof(scale), " + rect x%.2f", options.flameScale);
+    std::string source = options.baked ? "baked" : options.lazy ? "lazy bricks" : "procedural";
+    if (options.scene) source = "scene x" + std::to_string(options.scene->size());
+    return "FlameCpu " + source +
+           (options.occupancy ? " + occupancy" : "") +
+           (options.lod ? " + lod" : "") + (options.tables ? " + lut" : "") +
+           (options.params ? " + params" : "") +
+           (temporal ? " + temporal" : "") +
+           (rect ? scale : "") + " @ " +
+           qualityTierName(options.quality);
+}
+
+// Summarize frame's ray cost map and write its heatmap
+static RayStatsFrame recordRayStats(const RayCostMap& map, QualityTier quality, int frame,
+                                    const std::string& prefix, bool sequence) {
+    const int maxSteps = qualityTierMaxSteps(quality);
+    Image heatmap;
+    rayCostHeatmap(map, maxSteps, heatmap);
+    std::string path = rayHeatmapPath(prefix, frame, sequence);
+    if (!writeImage(path, heatmap)) std::cerr << "Failed to write " << path << std::endl;
+    return summarizeRayCost(map, maxSteps, frame);
+}
+
+// --params: the block FlameCpu renders with and what was built from it.
+// poll() reloads a saved file and rebuilds only the structures the changed
+// groups reach (flameCachesFor): the baked volume is rebaked in memory, the
+// lazy volume drops its bricks and the occupancy grid is rebuilt.
+struct ParamsReload {
+    std::string path;
+    FlameParams params;
+    std::unique_ptr<FileWatcher> watcher;
+    VolumeCache* baked = nullptr;
+    BakeSettings bake;
+    LazyVolume* lazy = nullptr;
+    OccupancyGrid* grid = nullptr;
+    int occupancyRes = 64;
+
+    // Invalidated caches, 0 if the file is unchanged or does not parse
+    unsigned poll(ThreadPool& pool) {
+        if (!watcher || !watcher->changed()) return 0;
+        auto t0 = std::chrono::steady_clock::now();
+        FlameParams next;
+        if (!loadFlameParams(path, next)) {
+            std::cerr << "[Params] Keeping the previous parameters" << std::endl;
+            return 0;
+        }
+        unsigned groups = flameParamsChanged(params, next);
+        unsigned caches = flameCachesFor(groups);
+        params = next;
+        // The caller clears temporal history; the GPU-side bits have nothing here
+        unsigned rebuilt = caches & CACHE_HISTORY;
+        if (baked && (caches & CACHE_BAKED)) {
+            baked->bake(bake, pool, params);
+            rebuilt |= CACHE_BAKED;
+        }
+        if (lazy && (caches & CACHE_LAZY)) {
+            lazy->reset(params);
+            rebuilt |= CACHE_LAZY;
+        }
+        if (grid && (caches & CACHE_OCCUPANCY)) {
+            grid->build(occupancyRes, params);
+            rebuilt |= CACHE_OCCUPANCY;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if (groups)
+            std::printf("[Params] %s: %s changed, rebuilt %s in %.2f ms\n", path.c_str(),
+                        flameParamGroupNames(groups).c_str(), flameParamCacheNames(rebuilt).c_str(), ms);
+        else
+            std::printf("[Params] %s: no changes\n", path.c_str());
+        std::fflush(stdout);
+        return caches;
+    }
+};
+
+// Render the scripted path and write per-frame timings; the uniforms'
+// camera and time are replaced by the path. With temporal set, frames are
+// jittered and accumulated, and the accumulation is part of the frame time.
+// With a rayStats prefix, every recorded frame's march cost is written too
+// (outside the timing), and with a reload the parameter file is polled
+// before each frame (also outside it).
+static int runBench(FlameUniforms u, Image& img, ThreadPool& pool, RenderOptions options,
+                    int frames, int warmup, float dt, bool temporal, const std::string& outPath,
+                    const std::string& rayStats, ParamsReload* reload) {
+    const bool rect = options.screenRect || options.flameScale < 1.0f;
+    BenchRun run;
+    run.mode = "cpu";
+    run.renderer = rendererName(options, temporal);
+    run.width = img.width;
+    run.height = img.height;
+    run.threads = (int)pool.size();
+    run.dt = dt;
+
+    BlueNoise noise;
+    std::vector<float> depth;
+    TemporalAccumulator accumulator;
+    RayCostMap cost;
+    std::vector<RayStatsFrame> rayFrames;
+    if (!rayStats.empty()) options.rayCost = &cost;
+    if (temporal) {
+        noise = makeBlueNoise();
+        options.jitter = &noise;
+        options.depth = &depth;
+    }
+
+    for (int i = -warmup; i < frames; i++) {
+        int frame = i < 0 ? 0 : i;
+        BenchPose pose = benchPose(frame, frames);
+        u.camPos = pose.camPos;
+        u.camFront = pose.camFront;
+        u.time = frame * dt;
+        options.frameIndex = i + warmup;
+        if (reload && (reload->poll(pool) & CACHE_HISTORY)) accumulator.reset();
+
+        auto t0 = std::chrono::steady_clock::now();
+        RenderStats stats = renderImage(u, img, pool, options);
+        if (temporal) accumulator.accumulate(img, depth, u, pool);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if (i < 0) continue;
+
+        BenchFrame f;
+        f.frame = frame;
+        f.segment = pose.segment;
+        f.simTime = u.time;
+        f.ms = ms;
+        f.samplesPerRay = stats.raysMarched ? (double)stats.densitySamples / stats.raysMarched : 0.0;
+        if (rect) {
+            f.shadedPixels = (long long)stats.shadedPixels;
+            f.skippedPixels = (long long)stats.skippedPixels;
+        }
+        run.frames.push_back(f);
+        if (!rayStats.empty()) rayFrames.push_back(recordRayStats(cost, options.quality, frame, rayStats, true));
+    }
+
+    printBenchSummary(run);
+    if (!rayStats.empty() && !writeRayStats(rayStats, run.renderer, rayFrames)) return 1;
+    if (!writeBenchJson(outPath, run)) {
+        std::cerr << "Failed to write " << outPath << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << outPath << std::endl;
+    return 0;
+}
+
+// With a path, records timing markers from construction and exports them
+// when main returns (after the thread pool, declared later, has joined)
+struct ProfileOutput {
+    std::string path;
+
+    explicit ProfileOutput(std::string p) : path(std::move(p)) {
+        if (path.empty()) return;
+        profilerSetThreadName("main");
+        profilerEnable(true);
+    }
+    ~ProfileOutput() {
+        if (path.empty()) return;
+        profilerEnable(false);
+        std::printf("\nProfile:\n");
+        profilerPrintSummary();
+        if (profilerWriteChromeTrace(path)) std::cout << "Wrote " << path << std::endl;
+        else std::cerr << "Failed to write " << path << std::endl;
+    }
+};
+
+static bool parseVec3(const char* s, Vec3& v) {
+    return std::sscanf(s, "%f,%f,%f", &v.x, &v.y, &v.z) == 3;
+}
+
+int main(int argc, char** argv) {
+    FlameUniforms u;
+    std::string outPath = "flame.png";
+    int width = 1280, height = 720;
+    int tile = DEFAULT_TILE_SIZE;
+    QualityTier quality = QualityTier::Production;
+    bool qualitySet = false;
+    bool lod = false;
+    bool tables = false;
+    bool temporal = false;
+    bool screenRect = false;
+    float flameScale = 1.0f;
+    unsigned threads = 0;
+    float aspect = -1.0f;
+    std::string bakedPath;
+    double lazyMiB = 0.0;
+    BakeSettings bake;
+    bool occupancy = false, occupancyCompare = false;
+    int occupancyRes = 64;
+    bool fluid = false;
+    FluidSettings fluidSettings;
+    bool bench = false;
+    int benchFrames = 240, benchWarmup = 2;
+    float benchDt = BENCH_DEFAULT_DT;
+    std::string benchOut = "bench_cpu.json";
+    bool sequence = false;
+    SequenceSettings seq;
+    int coordinatorPort = -1;
+    FarmSettings farm;
+    std::string workerAddress;
+    std::string volumePath, volumeWritePath;
+    int volumeFrames = 96, volumeRes = 64, volumeBits = 8;
+    float volumeFps = 24.0f;
+    std::string scenePath, sceneSavePath;
+    std::string profilePath;
+    std::string rayStatsPrefix;
+    std::string paramsPath;
+    int candles = 0;
+    float candleSpacing = 1.5f;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << a << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        auto vec = [&](Vec3& v) {
+            const char* s = next();
+            if (!parseVec3(s, v)) {
+                std::cerr << "Expected x,y,z for " << a << ", got '" << s << "'" << std::endl;
+                std::exit(1);
+            }
+        };
+
+        if (a == "--out") outPath = next();
+        else if (a == "--width") width = std::atoi(next());
+        else if (a == "--height") height = std::atoi(next());
+        else if (a == "--time") u.time = (float)std::atof(next());
+        else if (a == "--cam-pos") vec(u.camPos);
+        else if (a == "--cam-front") vec(u.camFront);
+        else if (a == "--cam-up") vec(u.camUp);
+        else if (a == "--aspect") aspect = (float)std::atof(next());
+        else if (a == "--formation") u.formation = (float)std::atof(next());
+        else if (a == "--threads") threads = (unsigned)std::atoi(next());
+        else if (a == "--tile") tile = std::atoi(next());
+        else if (a == "--lod") lod = true;
+        else if (a == "--lut") tables = true;
+        else if (a == "--screen-rect") screenRect = true;
+        else if (a == "--flame-scale") flameScale = (float)std::atof(next());
+        else if (a == "--quality") {
+            const char* v = next();
+            if (!parseQualityTier(v, quality)) {
+                std::cerr << "Unknown quality tier '" << v << "' (preview, production, final, temporal)"
+                          << std::endl;
+                return 1;
+            }
+            qualitySet = true;
+        }
+        else if (a == "--temporal") temporal = true;
+        else if (a == "--profile") profilePath = next();
+        else if (a == "--ray-stats") rayStatsPrefix = next();
+        else if (a == "--params") paramsPath = next();
+        else if (a == "--scene") scenePath = next();
+        else if (a == "--candles") candles = std::atoi(next());
+        else if (a == "--candle-spacing") candleSpacing = (float)std::atof(next());
+        else if (a == "--scene-save") sceneSavePath = next();
+        else if (a == "--baked") bakedPath = next();
+        else if (a == "--lazy-bricks") lazyMiB = std::atof(next());
+        else if (a == "--bake-res") {
+            const char* v = next();
+            if (std::sscanf(v, "%d,%d,%d", &bake.nx, &bake.ny, &bake.nz) != 3) {
+                std::cerr << "Expected x,y,z for --bake-res, got '" << v << "'" << std::endl;
+                return 1;
+            }
+        }
+        else if (a == "--bake-slices") bake.slices = std::atoi(next());
+        else if (a == "--bake-period") bake.period = (float)std::atof(next());
+        else if (a == "--occupancy") occupancy = true;
+        else if (a == "--occupancy-res") occupancyRes = std::atoi(next());
+        else if (a == "--occupancy-compare") occupancy = occupancyCompare = true;
+        else if (a == "--fluid") fluid = true;
+        else if (a == "--fluid-res") fluidSettings.cellsPerAxis = std::atoi(next());
+        else if (a == "--volume") volumePath = next();
+        else if (a == "--volume-write") volumeWritePath = next();
+        else if (a == "--volume-frames") volumeFrames = std::atoi(next());
+        else if (a == "--volume-fps") volumeFps = (float)std::atof(next());
+        else if (a == "--volume-res") volumeRes = std::atoi(next());
+        else if (a == "--volume-bits") volumeBits = std::atoi(next());
+        else if (a == "--bench") bench = true;
+        else if (a == "--frames") benchFrames = std::atoi(next());
+        else if (a == "--warmup") benchWarmup = std::atoi(next());
+        else if (a == "--dt") benchDt = (float)std::atof(next());
+        else if (a == "--bench-out") benchOut = next();
+        else if (a == "--sequence") {
+            const char* v = next();
+            if (std::sscanf(v, "%d:%d", &seq.firstFrame, &seq.lastFrame) != 2) {
+                std::cerr << "Expected first:last for --sequence, got '" << v << "'" << std::endl;
+                return 1;
+            }
+            sequence = true;
+        }
+        else if (a == "--fps") seq.fps = (float)std::atof(next());
+        else if (a == "--out-pattern") seq.outPattern = next();
+        else if (a == "--float-dump") seq.writeFloat = true;
+        else if (a == "--no-png") seq.writePng = false;
+        else if (a == "--render-workers") seq.renderWorkers = std::atoi(next());
+        else if (a == "--encoders") seq.encoders = std::atoi(next());
+        else if (a == "--queue") seq.queueCapacity = std::atoi(next());
+        else if (a == "--resume") seq.resume = true;
+        else if (a == "--coordinator") coordinatorPort = std::atoi(next());
+        else if (a == "--worker-timeout") farm.workerTimeout = std::atof(next());
+        else if (a == "--worker") workerAddress = next();
+        else if (a == "--help" || a == "-h") { usage(); return 0; }
+        else {
+            std::cerr << "Unknown option: " << a << std::endl;
+            usage();
+            return 1;
+        }
+    }
+
+    // Everything but the thread count comes from the coordinator
+    if (!workerAddress.empty()) {
+        size_t colon = workerAddress.rfind(':');
+        int port = colon == std::string::npos ? 0 : std::atoi(workerAddress.c_str() + colon + 1);
+        if (port <= 0 || port > 65535) {
+            std::cerr << "Expected host:port for --worker, got '" << workerAddress << "'" << std::endl;
+            return 1;
+        }
+        return runFarmWorker(workerAddress.substr(0, colon), port, threads) ? 0 : 1;
+    }
+
+    if (width <= 0 || height <= 0 || tile <= 0) {
+        std::cerr << "Width, height and tile size must be positive" << std::endl;
+        return 1;
+    }
+    if (!(flameScale > 0.0f && flameScale <= 1.0f)) {
+        std::cerr << "--flame-scale must be in (0, 1]" << std::endl;
+        return 1;
+    }
+    u.aspect = aspect > 0.0f ? aspect : (float)width / (float)height;
+
+    ProfileOutput profile(profilePath);
+    ThreadPool pool(threads);
+    Image img;
+    img.resize(width, height);
+
+    if (coordinatorPort >= 0 && !sequence) {
+        std::cerr << "--coordinator hands out the frames of a --sequence" << std::endl;
+        return 1;
+    }
+    if (temporal && (!bench || sequence)) {
+        std::cerr << "--temporal accumulates consecutive frames; it needs --bench" << std::endl;
+        return 1;
+    }
+    if (temporal && !qualitySet) quality = QualityTier::Temporal;
+    if (!rayStatsPrefix.empty() && (sequence || fluid)) {
+        std::cerr << "--ray-stats records single frames or a --bench run; it cannot be combined with "
+                     "--sequence or --fluid" << std::endl;
+        return 1;
+    }
+
+    ParamsReload reload;
+    if (!paramsPath.empty()) {
+        if (tables || !scenePath.empty() || candles > 0 || fluid || !volumePath.empty() ||
+            !volumeWritePath.empty() || coordinatorPort >= 0) {
+            std::cerr << "--params drives the procedural, baked and lazy flame; it cannot be combined with "
+                         "--lut, --scene, --candles, --fluid, --volume, --volume-write or --coordinator" << std::endl;
+            return 1;
+        }
+        if (!std::filesystem::exists(paramsPath)) {
+            if (!saveFlameParams(paramsPath, reload.params)) {
+                std::cerr << "Cannot write " << paramsPath << std::endl;
+                return 1;
+            }
+            std::cout << "[Params] Wrote the defaults to " << paramsPath << std::endl;
+        } else if (!loadFlameParams(paramsPath, reload.params)) {
+            return 1;
+        }
+        reload.path = paramsPath;
+        if (bench) reload.watcher = std::make_unique<FileWatcher>(paramsPath);
+    }
+
+    RenderOptions options;
+    options.tileSize = tile;
+    options.quality = quality;
+    options.lod = lod;
+    options.tables = tables;
+    options.screenRect = screenRect;
+    options.flameScale = flameScale;
+    if (!paramsPath.empty()) options.params = &reload.params;
+
+    FlameScene scene;
+    if (!scenePath.empty() || candles > 0) {
+        if (!scenePath.empty() && candles > 0) {
+            std::cerr << "--scene and --candles both choose the scene; give one" << std::endl;
+            return 1;
+        }
+        if (!bakedPath.empty() || lazyMiB > 0.0 || !volumePath.empty() || !volumeWritePath.empty() || fluid || occupancy ||
+            screenRect || flameScale < 1.0f) {
+            std::cerr << "Scenes render the procedural flame; they cannot be combined with --baked, --lazy-bricks, "
+                         "--volume, --volume-write, --fluid, --occupancy, --screen-rect or --flame-scale" << std::endl;
+            return 1;
+        }
+        if (!(candleSpacing > 0.0f)) {
+            std::cerr << "--candle-spacing must be positive" << std::endl;
+            return 1;
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        if (candles > 0) scene = makeCandleField(candles, candleSpacing);
+        else if (!scene.load(scenePath)) return 1;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::printf("Scene: %zu flames, %zu BVH nodes, built in %.2f ms\n", scene.size(), scene.nodes().size(), ms);
+        if (!sceneSavePath.empty()) {
+            if (!scene.save(sceneSavePath)) return 1;
+            std::cout << "Wrote " << sceneSavePath << std::endl;
+        }
+        options.scene = &scene;
+    } else if (!sceneSavePath.empty()) {
+        std::cerr << "--scene-save needs --scene or --candles" << std::endl;
+        return 1;
+    }
+
+    VolumeCache cache;
+    if (!bakedPath.empty()) {
+        if (bake.nx < 2 || bake.ny < 2 || bake.nz < 2 || bake.slices < 1 || bake.period <= 0.0f) {
+            std::cerr << "Invalid bake settings" << std::endl;
+            return 1;
+        }
+        if (cache.load(bakedPath, bake, reload.params)) {
+            std::cout << "Loaded baked volume " << bakedPath << std::endl;
+        } else {
+            auto t0 = std::chrono::steady_clock::now();
+            cache.bake(bake, pool, reload.params);
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            std::cout << "Baked " << bake.slices << " slices of " << bake.nx << "x" << bake.ny << "x"
+                      << bake.nz << " in " << sec << " s" << std::endl;
+            if (!cache.save(bakedPath))
+                std::cerr << "Warning: could not write cache " << bakedPath << std::endl;
+        }
+        std::cout << "Cache memory: " << cache.memoryBytes() / (1024.0 * 1024.0) << " MiB" << std::endl;
+        options.baked = &cache;
+        reload.baked = &cache;
+        reload.bake = bake;
+    }
+
+    std::unique_ptr<LazyVolume> lazy;
+    if (lazyMiB > 0.0) {
+        if (!bakedPath.empty() || fluid || !volumePath.empty() || !volumeWritePath.empty() ||
+            coordinatorPort >= 0) {
+            std::cerr << "--lazy-bricks renders the baked grid on demand; it cannot be combined with "
+                         "--baked, --fluid, --volume, --volume-write or --coordinator" << std::endl;
+            return 1;
+        }
+        if (bake.nx < 2 || bake.ny < 2 || bake.nz < 2 || bake.slices < 1 || bake.period <= 0.0f) {
+            std::cerr << "Invalid bake settings" << std::endl;
+            return 1;
+        }
+        lazy = std::make_unique<LazyVolume>(bake, (size_t)(lazyMiB * 1024.0 * 1024.0), 0, reload.params);
+        options.lazy = lazy.get();
+        reload.lazy = lazy.get();
+    }
+
+    if (!volumeWritePath.empty()) {
+        if (volumeFrames <= 0 || volumeFps <= 0.0f || volumeRes <= 0 || (volumeBits != 8 && volumeBits != 16)) {
+            std::cerr << "Invalid volume recording settings" << std::endl;
+            return 1;
+        }
+        return writeVolume(volumeWritePath, fluid, fluidSettings, volumeFrames, volumeFps, volumeRes,
+                           volumeBits, pool);
+    }
+    VolumeSequence volume;
+    if (!volumePath.empty()) {
+        if (fluid || !bakedPath.empty()) {
+            std::cerr << "--volume cannot be combined with --fluid or --baked" << std::endl;
+            return 1;
+        }
+        if (!volume.open(volumePath)) {
+            std::cerr << "Cannot open volume sequence " << volumePath << std::endl;
+            return 1;
+        }
+        std::printf("Volume sequence: %d frames at %.1f fps, %d-bit, %.1f MiB mapped\n", volume.frameCount(),
+                    volume.fps(), volume.bits(), volume.fileBytes() / (1024.0 * 1024.0));
+        options.volume = &volume;
+    }
+
+    if (fluid && (sequence || bench || !bakedPath.empty() || occupancy)) {
+        std::cerr << "--fluid renders one simulated frame; it cannot be combined with "
+                     "--sequence, --bench, --baked or --occupancy" << std::endl;
+        return 1;
+    }
+    FluidSolver solver(fluidSettings);
+    if (fluid) {
+        const float dt = 1.0f / 60.0f;
+        int steps = std::max(1, (int)std::lround(u.time / dt));
+        double simSeconds = 0.0;
+        int pcgIterations = 0;
+        for (int s = 0; s < steps; s++) {
+            solver.step(dt, pool);
+            simSeconds += solver.lastStep().seconds;
+            pcgIterations += solver.lastStep().pressureIterations;
+        }
+        std::printf("Fluid: %d steps on %d^3 cells, %zu of %zu bricks active, %.1f MiB, "
+                    "%.2f ms/step, %.1f CG iterations/step (last residual %.1e)\n",
+                    steps, solver.cellsPerAxis(), solver.activeBricks(), solver.totalBricks(),
+                    solver.memoryBytes() / (1024.0 * 1024.0), simSeconds * 1000.0 / steps,
+                    (double)pcgIterations / steps, solver.lastStep().pressureResidual);
+        options.fluid = &solver;
+    }
+
+    OccupancyGrid grid;
+    RenderStats before;
+    if (occupancy) {
+        grid.build(occupancyRes, reload.params);
+        reload.grid = &grid;
+        reload.occupancyRes = occupancyRes;
+        std::printf("Occupancy grid: %d^3 cells, %.1f%% of cells / %.1f%% of bricks occupied\n",
+                    grid.cellsPerAxis(), grid.occupiedCellFraction() * 100.0f,
+                    grid.occupiedBrickFraction() * 100.0f);
+        if (occupancyCompare) before = renderImage(u, img, pool, options);
+        options.occupancy = &grid;
+    }
+    if (sequence) {
+        if (seq.lastFrame < seq.firstFrame || !(seq.fps > 0.0f) || !validFramePattern(seq.outPattern) ||
+            (!seq.writePng && !seq.writeFloat)) {
+            std::cerr << "Invalid sequence settings (range, fps, output pattern or outputs)" << std::endl;
+            return 1;
+        }
+        seq.width = width;
+        seq.height = height;
+        if (coordinatorPort >= 0) {
+            if (options.baked || options.occupancy || options.scene || !volumePath.empty()) {
+                std::cerr << "--coordinator distributes the procedural flame only; drop --baked, "
+                             "--occupancy, --scene / --candles and --volume" << std::endl;
+                return 1;
+            }
+            FarmCoordinator coordinator;
+            if (coordinatorPort > 65535 || !coordinator.listen(coordinatorPort)) {
+                std::cerr << "Cannot listen on port " << coordinatorPort << std::endl;
+                return 1;
+            }
+            std::printf("Coordinator listening on port %d; start workers with --worker <host>:%d\n",
+                        coordinator.port(), coordinator.port());
+            FarmReport r = coordinator.run(seq, u, options, farm);
+            int total = seq.lastFrame - seq.firstFrame + 1;
+            std::printf("Sequence: %d rendered, %d skipped, %d failed of %d in %.2f s (%.2f frames/s); "
+                        "%d workers joined, %d lost, %d frames re-issued\n", r.rendered, r.skipped, r.failed,
+                        total, r.seconds, r.rendered / r.seconds, r.workersJoined, r.workersLost, r.reissued);
+            return r.failed ? 1 : 0;
+        }
+        SequenceReport r = renderSequence(seq, u, options);
+        int total = seq.lastFrame - seq.firstFrame + 1;
+        std::printf("Sequence: %d rendered, %d skipped, %d failed of %d in %.2f s (%.2f frames/s), "
+                    "peak queue %zu\n", r.rendered, r.skipped, r.failed, total, r.seconds,
+                    r.rendered / r.seconds, r.peakQueued);
+        if (lazy) printBrickStats(*lazy);
+        return r.failed ? 1 : 0;
+    }
+
+    if (bench) {
+        if (benchFrames <= 0) {
+            std::cerr << "--frames must be positive" << std::endl;
+            return 1;
+        }
+        int rc = runBench(u, img, pool, options, benchFrames, std::max(benchWarmup, 0), benchDt, temporal,
+                          benchOut, rayStatsPrefix, &reload);
+        if (lazy) printBrickStats(*lazy);
+        return rc;
+    }
+
+    Image reference;
+    if (occupancyCompare) reference = img;
+
+    RayCostMap cost;
+    if (!rayStatsPrefix.empty()) options.rayCost = &cost;
+    RenderStats stats = renderImage(u, img, pool, options);
+
+    double mpix = (double)stats.pixels / stats.seconds * 1e-6;
+    std::cout << "Rendered " << width << "x" << height << " in " << stats.seconds * 1000.0
+              << " ms (" << mpix << " Mpix/s, " << pool.size() << " threads)" << std::endl;
+    std::cout << "Rays marched: " << stats.raysMarched
+              << ", density samples: " << stats.densitySamples << std::endl;
+    if (lazy) printBrickStats(*lazy);
+    if (screenRect || flameScale < 1.0f) {
+        std::printf("Screen rect: %llu flame rays (%.1f%% of pixels), %llu pixels skipped (%.1f%%)\n",
+                    (unsigned long long)stats.shadedPixels, 100.0 * stats.shadedPixels / stats.pixels,
+                    (unsigned long long)stats.skippedPixels, 100.0 * stats.skippedPixels / stats.pixels);
+    }
+
+    if (!rayStatsPrefix.empty()) {
+        RayStatsFrame frame = recordRayStats(cost, quality, 0, rayStatsPrefix, false);
+        printRayStats(frame);
+        if (!writeRayStats(rayStatsPrefix, rendererName(options, false), {frame})) return 1;
+    }
+
+    if (occupancyCompare) {
+        std::printf("\n");
+        printStats("full", before);
+        printStats("skipping", stats);
+        double kept = before.densitySamples ? 100.0 * stats.densitySamples / (double)before.densitySamples : 100.0;
+        std::printf("samples: %.1f%% of full, %.2fx faster, max pixel difference %d/255\n",
+                    kept, before.seconds / stats.seconds, maxPixelDifference(reference, img));
+    }
+
+    if (!writeImage(outPath, img)) {
+        std::cerr << "Failed to write " << outPath << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << outPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include "flame_field.h"
+
+#include <cstring>
+#include "flame_quality.h"
+
+/* =================== NOISE =================== */
+
+// Fast integer hash (same constants and wrap-around as the GLSL uvec3 math)
+Vec3 hash33(Vec3 p) {
+    const uint32_t kx = 1597334673u, ky = 3812015801u, kz = 2798796415u;
+    uint32_t qx = (uint32_t)(int32_t)p.x * kx;
+    uint32_t qy = (uint32_t)(int32_t)p.y * ky;
+    uint32_t qz = (uint32_t)(int32_t)p.z * kz;
+    uint32_t q = qx ^ qy ^ qz;
+    const float inv = 1.0f / 4294967296.0f;  // 1.0 / float(0xffffffffu)
+    return {
+        -1.0f + 2.0f * (float)(q * kx) * inv,
+        -1.0f + 2.0f * (float)(q * ky) * inv,
+        -1.0f + 2.0f * (float)(q * kz) * inv
+    };
+}
+
+float noise3D(Vec3 p) {
+    Vec3 i = {floorf(p.x), floorf(p.y), floorf(p.z)};
+    Vec3 f = p - i;
+    // Quintic Hermite for smoother interpolation (less grid artifacts)
+    Vec3 u = f * f * f * ((f * (f * 6.0f - Vec3{15.0f, 15.0f, 15.0f})) + Vec3{10.0f, 10.0f, 10.0f});
+
+    auto corner = [&](float x, float y, float z) {
+        Vec3 c = {x, y, z};
+        return dot(hash33(i + c), f - c);
+    };
+
+    return mixf(mixf(mixf(corner(0,0,0), corner(1,0,0), u.x),
+                     mixf(corner(0,1,0), corner(1,1,0), u.x), u.y),
+                mixf(mixf(corner(0,0,1), corner(1,0,1), u.x),
+                     mixf(corner(0,1,1), corner(1,1,1), u.x), u.y), u.z);
+}
+
+// FBM with rotation between octaves to break grid alignment
+float fbm(Vec3 p, int octaves) {
+    float value = 0.0f;
+    float amp = 0.5f;
+    for (int i = 0; i < octaves; i++) {
+        value += amp * noise3D(p);
+        p = fbmNextOctave(p);
+        amp *= 0.5f;
+    }
+    return value;
+}
+
+/* =================== SHAPE =================== */
+
+float flameRadius(float h) {
+    // Fast rise from narrow nozzle point
+    float rise = 1.0f - expf(-h * 15.0f);
+
+    // Smooth taper toward tip
+    float taper = powf(fmaxf(1.0f - h, 0.0f), 1.2f);
+
+    // Bell-shaped combustion zone bulge, peaking at h=0.35
+    float bulge = 1.0f + 0.35f * expf(-powf((h - 0.35f) / 0.18f, 2.0f));
+
+    return FLAME_BASE_WIDTH * rise * taper * bulge;
+}
+
+float flameSDF(Vec3 p) {
+    return flameSDF(p, FlameShape{});
+}
+
+/* =================== DENSITY =================== */
+// Bodies live in flame_quality.h as tier templates
+
+float flameDensity(Vec3 p, float time, float formation) {
+    return flameDensityT<QualityProduction>(p, time, formation);
+}
+
+/* =================== TEMPERATURE =================== */
+
+float getTemperature(Vec3 p, float density, float time) {
+    return clampf(temperatureFactor(p, time) * density, 0.0f, 1.0f);
+}
+
+float temperatureFactor(Vec3 p, float time) {
+    return temperatureFactorT<QualityProduction>(p, time);
+}
+
+/* =================== BOUNDS =================== */
+
+// fbm amplitudes sum to 1 - 2^-octaves < 1, so this holds for every tier
+constexpr float FBM_BOUND = NOISE3D_BOUND;
+
+float flameMaxDisplacement(float h) {
+    // Same amplitude terms as flameDensity, every noise at its bound
+    float turbHeight = smoothstepf(0.05f, 0.6f, h);
+    float turbAmp = 0.08f + turbHeight * 0.18f;
+    float fineAmp = turbHeight * 0.04f;
+    float dx = 0.015f * NOISE3D_BOUND + turbAmp * FBM_BOUND + fineAmp * FBM_BOUND;
+    float dz = 0.012f * NOISE3D_BOUND + turbAmp * 0.8f * FBM_BOUND + fineAmp * 0.7f * FBM_BOUND;
+    return sqrtf(dx * dx + dz * dz);
+}
+
+float flameRadiusMax(float h0, float h1) {
+    h0 = clampf(h0, 0.0f, 1.0f);
+    h1 = clampf(h1, 0.0f, 1.0f);
+    const int N = 64;
+    float r = 0.0f;
+    for (int i = 0; i <= N; i++)
+        r = fmaxf(r, flameRadius(mixf(h0, h1, (float)i / N)));
+    // |flameRadius'| < 2.0, so the true maximum is within one half step
+    return r + 2.0f * 0.5f * (h1 - h0) / N;
+}
+
+float flameSupportRadius(float h0, float h1) {
+    // Displacement grows with height, so the top of the range bounds it.
+    // 0.035 is where flameDensity's smoothstep on the SDF reaches zero.
+    return flameRadiusMax(h0, h1) + 0.035f + flameMaxDisplacement(h1);
+}
+
+/* =================== COLOR =================== */
+
+float radialFactor(float radial, float h) {
+    float maxR = flameRadius(h) + 0.01f;
+    return 1.0f - smoothstepf(0.0f, maxR, radial);
+}
+
+Vec3 flameColorRamp(float temp) {
+    const Vec3 whiteHot     = {1.0f, 0.96f, 0.88f};
+    const Vec3 brightYellow = {1.0f, 0.9f, 0.5f};
+    const Vec3 golden       = {1.0f, 0.72f, 0.18f};
+    const Vec3 deepOrange   = {1.0f, 0.48f, 0.02f};
+    const Vec3 darkOrange   = {0.88f, 0.28f, 0.0f};
+    const Vec3 darkRed      = {0.55f, 0.1f, 0.0f};
+    const Vec3 dimSmoke     = {0.18f, 0.04f, 0.0f};
+
+    if (temp > 0.82f) return mix(brightYellow, whiteHot, (temp - 0.82f) / 0.18f);
+    if (temp > 0.62f) return mix(golden, brightYellow, (temp - 0.62f) / 0.2f);
+    if (temp > 0.42f) return mix(deepOrange, golden, (temp - 0.42f) / 0.2f);
+    if (temp > 0.24f) return mix(darkOrange, deepOrange, (temp - 0.24f) / 0.18f);
+    if (temp > 0.1f) return mix(darkRed, darkOrange, (temp - 0.1f) / 0.14f);
+    return mix(dimSmoke, darkRed, temp / 0.1f);
+}
+
+Vec3 flameColor(float temp, float h, float radial) {
+    Vec3 color = flameColorRamp(temp);
+
+    // Blue base zone (CH chemiluminescence, independent of temperature)
+    float blueHeight = flameBlueHeight(h);
+    float blueRadial = 1.0f - smoothstepf(0.0f, flameRadius(h) * 1.2f, radial);
+    float blueStrength = blueHeight * blueRadial;
+
+    const Vec3 innerBlue = {0.25f, 0.45f, 1.0f};
+    const Vec3 outerBlue = {0.08f, 0.2f, 0.7f};
+    float rFac = radialFactor(radial, h);
+    Vec3 blueCol = mix(outerBlue, innerBlue, rFac);
+
+    return mix(color, blueCol, blueStrength * 0.75f);
+}
+
+/* =================== RAY INTERSECTION =================== */
+
+Vec2 intersectSphere(Vec3 ro, Vec3 rd, Vec3 center, float radius) {
+    Vec3 oc = ro - center;
+    float b = dot(oc, rd);
+    float c = dot(oc, oc) - radius * radius;
+    float disc = b * b - c;
+    if (disc < 0.0f) return {-1.0f, -1.0f};
+    float s = sqrtf(disc);
+    return {-b - s, -b + s};
+}
+
+/* =================== QUALITY TIERS =================== */
+
+const char* qualityTierName(QualityTier tier) {
+    switch (tier) {
+        case QualityTier::Preview: return QualityPreview::name;
+        case QualityTier::Production: return QualityProduction::name;
+        case QualityTier::Final: return QualityFinal::name;
+        case QualityTier::Temporal: return QualityTemporal::name;
+    }
+    return "?";
+}
+
+int qualityTierMaxSteps(QualityTier tier) {
+    switch (tier) {
+        case QualityTier::Preview: return QualityPreview::maxSteps;
+        case QualityTier::Production: return QualityProduction::maxSteps;
+        case QualityTier::Final: return QualityFinal::maxSteps;
+        case QualityTier::Temporal: return QualityTemporal::maxSteps;
+    }
+    return 0;
+}
+
+bool parseQualityTier(const char* s, QualityTier& out) {
+    for (int i = 0; i < QUALITY_TIER_COUNT; i++) {
+        if (std::strcmp(s, qualityTierName((QualityTier)i)) == 0) {
+            out = (QualityTier)i;
+            return true;
+        }
+    }
+    return false;
+}
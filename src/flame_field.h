@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include "math_utils.h"
+
+/* =================== FLAME FIELD (CPU) =================== */
+// C++ port of the noise, shape, density, temperature and color functions
+// from the flameFS shader in sandbox_main.cpp. Each function mirrors its
+// GLSL namesake line by line so the CPU renderer draws the same flame.
+// Keep the two in sync when tweaking constants. flameFS takes the shape,
+// turbulence and colour constants from a parameter block instead
+// (flame_params.h), whose defaults are the values here.
+
+constexpr float FLAME_HEIGHT = 2.2f;
+constexpr float FLAME_BASE_WIDTH = 0.12f;
+
+// Bounding sphere that contains the whole flame (same as flameFS main())
+constexpr Vec3  FLAME_SPHERE_CENTER = {0.0f, FLAME_HEIGHT * 0.45f, 0.0f};
+constexpr float FLAME_SPHERE_RADIUS = FLAME_HEIGHT * 0.65f;
+
+// The compiled shape and motion constants, named as the FlameParams members
+// (flame_params.h) so the field templates of flame_quality.h take either
+struct FlameShape {
+    static constexpr float height = FLAME_HEIGHT;
+    static constexpr float baseWidth = FLAME_BASE_WIDTH;
+    static constexpr float turbulence = 0.08f;
+    static constexpr float turbulenceTip = 0.18f;
+    static constexpr float flicker = 0.04f;
+    static constexpr float swayX = 0.015f, swayZ = 0.012f;
+};
+
+// ---- Noise ----
+
+// Integer hash of a lattice point, returns a gradient in [-1, 1]^3
+Vec3 hash33(Vec3 p);
+
+// Gradient noise with quintic fade
+float noise3D(Vec3 p);
+
+// Fractal sum of noise3D with a rotation between octaves
+float fbm(Vec3 p, int octaves);
+
+// Rotate and rescale an fbm sample point for the next octave
+// (rot * p * 2 + offset with the column-major GLSL mat3)
+inline Vec3 fbmNextOctave(Vec3 p) {
+    Vec3 r = {
+         0.00f * p.x - 0.80f * p.y - 0.60f * p.z,
+         0.80f * p.x + 0.36f * p.y - 0.48f * p.z,
+         0.60f * p.x - 0.48f * p.y + 0.64f * p.z
+    };
+    return r * 2.0f + Vec3{1.7f, 9.2f, 3.1f};
+}
+
+// ---- Shape ----
+
+// Teardrop radius profile, h in [0..1] (0 = base, 1 = tip)
+float flameRadius(float h);
+
+inline float flameRadius(float h, const FlameShape&) { return flameRadius(h); }
+
+// Signed distance to the undisturbed flame surface
+float flameSDF(Vec3 p);
+
+// flameSDF of a shape (FlameShape or a FlameParams block)
+template <class Shape>
+inline float flameSDF(Vec3 p, const Shape& shape) {
+    float h = p.y / shape.height;
+
+    if (h < -0.01f || h > 1.01f) {
+        return length2D(p.x, p.z) + fabsf(p.y) * 0.3f + 0.1f;
+    }
+
+    float hc = clampf(h, 0.0f, 1.0f);
+    float radius = flameRadius(hc, shape);
+    float radialDist = length2D(p.x, p.z);
+
+    return radialDist - radius;
+}
+
+// ---- Fields ----
+
+// Flame density at p; formation scales the whole flame in (iFormation).
+// Production-tier instantiation of flameDensityT (flame_quality.h).
+float flameDensity(Vec3 p, float time, float formation);
+
+// Normalized temperature in [0, 1] for a sample with the given density
+float getTemperature(Vec3 p, float density, float time);
+
+// getTemperature before the density weighting and clamp:
+// getTemperature(p, d, t) == clamp(temperatureFactor(p, t) * d, 0, 1)
+float temperatureFactor(Vec3 p, float time);
+
+// Convective cooling with height, before the radial and noise terms
+inline float flameHeightTemp(float h) {
+    return expf(-h * 1.8f) * 0.7f + (1.0f - h) * 0.3f;
+}
+
+// Radial factor: 1 on the flame axis, 0 at the flame edge
+float radialFactor(float radial, float h);
+
+// Emission color for a temperature at height h and distance from axis
+Vec3 flameColor(float temp, float h, float radial);
+
+// flameColor's temperature bands alone, before the blue base zone
+Vec3 flameColorRamp(float temp);
+
+// Weight of the blue base zone by height (strong at the base, gone by 0.22)
+inline float flameBlueHeight(float h) {
+    return smoothstepf(0.22f, 0.02f, h);
+}
+
+// ---- Bounds ----
+// Conservative, time-independent limits of where flameDensity can be
+// non-zero at any quality tier. |noise3D| <= 1.5 (each axis contributes at
+// most 0.5 through the quintic weights), so an fbm of any octave count is
+// within 1.5 too, which bounds every displacement.
+
+constexpr float NOISE3D_BOUND = 1.5f;
+
+// Largest x/z offset the sway + turbulence terms can apply at height h
+float flameMaxDisplacement(float h);
+
+// Largest flameRadius over [h0, h1] (scanned, padded for the scan step)
+float flameRadiusMax(float h0, float h1);
+
+// Distance from the axis beyond which density is zero for heights in [h0, h1]
+float flameSupportRadius(float h0, float h1);
+
+// ---- Ray helpers ----
+
+// Ray/sphere intersection, returns (tNear, tFar) or (-1, -1) on a miss
+Vec2 intersectSphere(Vec3 ro, Vec3 rd, Vec3 center, float radius);
@@ -0,0 +1,232 @@
+#pragma once
+#include "flame_field.h"
+#include "flame_params.h"
+#include "flame_quality.h"
+
+/* =================== RAYMARCH KERNEL =================== */
+// The adaptive-step march from flameFS main(), templated on where density
+// and temperature come from. A Field provides:
+//
+//   float density(Vec3 p) const;                  // flameDensity
+//   float temperature(Vec3 p, float density) const; // getTemperature
+//   Vec3 emission(Vec3 p, float temp) const;        // optional, else flameEmission
+//   Vec3 sphereCenter() const; float sphereRadius() const;  // optional bounds
+//
+// so the procedural port, the baked volume and later sources share one loop.
+// The step budget, step divisor and opacity cutoff come from a quality tier
+// (flame_quality.h), QualityProduction by default.
+
+// How the march of a ray ended (ray_stats.h)
+enum class RayExit : uint8_t {
+    Miss,     // never entered the bounding sphere
+    Left,     // marched out of the far side of the sphere
+    Opaque,   // early-out: accumulated alpha passed the tier's cutoff (0.97)
+    Budget,   // ran out of steps first
+};
+
+// Result of marching one ray through the flame volume (premultiplied)
+struct FlameSample {
+    Vec3  color = {0.0f, 0.0f, 0.0f};
+    float alpha = 0.0f;
+    int   steps = 0;        // loop iterations == density evaluations
+    int   emptySteps = 0;   // of those, samples with no density
+    bool  hit = false;      // ray entered the bounding sphere
+    RayExit exit = RayExit::Miss;
+    float depthSum = 0.0f;  // sum of t * opacity added at t
+
+    // Opacity-weighted mean distance of the flame along the ray; 0 if none
+    float depth() const { return alpha > 0.0f ? depthSum / alpha : 0.0f; }
+};
+
+constexpr int   MARCH_MAX_STEPS = QualityProduction::maxSteps;
+constexpr float MARCH_ALPHA_CUTOFF = QualityProduction::alphaCutoff;
+
+// Evaluates the flameFS functions directly
+struct ProceduralField {
+    float time;
+    float formation;
+
+    float density(Vec3 p) const { return flameDensity(p, time, formation); }
+    float temperature(Vec3 p, float density) const { return getTemperature(p, density, time); }
+};
+
+// Emitted colour of an in-flame sample at p (flame space)
+inline Vec3 flameEmission(Vec3 p, float temp) {
+    float h = clampf(p.y / FLAME_HEIGHT, 0.0f, 1.0f);
+    float radial = length2D(p.x, p.z);
+    Vec3 col = flameColor(temp, h, radial);
+
+    // Emission: pow curve makes core dramatically brighter
+    float emission = powf(temp, 1.6f) * 3.5f;
+    return col * emission;
+}
+
+// flameEmission with a parameter block's height, width and colour stops
+inline Vec3 flameEmission(Vec3 p, float temp, const FlameParams& params) {
+    float h = clampf(p.y / params.height, 0.0f, 1.0f);
+    float radial = length2D(p.x, p.z);
+    Vec3 col = flameColor(temp, h, radial, params);
+    float emission = powf(temp, 1.6f) * 3.5f;
+    return col * emission;
+}
+
+// A field's own emission(p, temp) if it has one (the shape-table fields),
+// else flameEmission
+template <class Field>
+inline Vec3 fieldEmission(const Field& field, Vec3 p, float temp) {
+    if constexpr (requires { field.emission(p, temp); }) return field.emission(p, temp);
+    else return flameEmission(p, temp);
+}
+
+// A field's own bounding sphere if it has one (a parameter block's), else
+// FLAME_SPHERE_CENTER / RADIUS
+template <class Field>
+inline void fieldSphere(const Field& field, Vec3& center, float& radius) {
+    if constexpr (requires { field.sphereRadius(); }) {
+        center = field.sphereCenter();
+        radius = field.sphereRadius();
+    } else {
+        center = FLAME_SPHERE_CENTER;
+        radius = FLAME_SPHERE_RADIUS;
+    }
+}
+
+// Procedural field on a parameter block (flame_params.h) at a tier: the
+// block's shape and motion, colour stops and bounding sphere. The footprint
+// is 0 without LOD, where the LOD instantiation equals the plain one.
+template <class Q>
+struct ParamsField {
+    const FlameParams* params;
+    float time;
+    float formation;
+
+    float density(Vec3 p, float footprint) const {
+        return flameDensityT<Q, true>(p, time, formation, footprint, *params);
+    }
+    float temperature(Vec3 p, float density, float footprint) const {
+        return clampf(temperatureFactorT<Q, true>(p, time, footprint, *params) * density, 0.0f, 1.0f);
+    }
+    Vec3 emission(Vec3 p, float temp) const { return flameEmission(p, temp, *params); }
+    Vec3 sphereCenter() const { return params->sphereCenter(); }
+    float sphereRadius() const { return params->sphereRadius(); }
+};
+
+// A baked or lazy field (whose volume was built from the same block) with
+// the block's colour stops and bounding sphere
+template <class Field>
+struct WithParams : Field {
+    const FlameParams* params;
+
+    Vec3 emission(Vec3 p, float temp) const { return flameEmission(p, temp, *params); }
+    Vec3 sphereCenter() const { return params->sphereCenter(); }
+    float sphereRadius() const { return params->sphereRadius(); }
+};
+
+// Opacity of a step through density (Beer-Lambert, capped per step).
+// substeps > 1 composites the step as that many equal, uniform steps.
+inline float stepOpacity(float density, float stepLen, int substeps = 1) {
+    if (substeps > 1) {
+        float sub = fminf(density * (stepLen / (float)substeps) * 18.0f, 0.2f);
+        return 1.0f - powf(1.0f - sub, (float)substeps);
+    }
+    return fminf(density * stepLen * 18.0f, 0.2f);
+}
+
+// Emission col and the opacity of one in-flame step, accumulated front to back
+inline void accumulateStep(Vec3 col, float density, float stepLen,
+                           Vec3& accColor, float& accAlpha, int substeps = 1) {
+    float alpha = stepOpacity(density, stepLen, substeps);
+    accColor += col * (alpha * (1.0f - accAlpha));
+    accAlpha += alpha * (1.0f - accAlpha);
+}
+
+// Bounding-sphere interval and base step for a ray; false on a miss
+template <class Q = QualityProduction>
+bool marchRange(Vec3 ro, Vec3 rd, Vec2& tRange, float& baseStep, Vec3 center = FLAME_SPHERE_CENTER,
+                float radius = FLAME_SPHERE_RADIUS) {
+    tRange = intersectSphere(ro, rd, center, radius);
+    if (tRange.y < 0.0f) return false;  // camera inside the sphere still marches
+    tRange.x = fmaxf(tRange.x, 0.0f);
+
+    // Fewer steps in empty regions, more steps inside the flame
+    float totalDist = tRange.y - tRange.x;
+    baseStep = fmaxf(totalDist / Q::stepDivisor, 0.01f);
+    return true;
+}
+
+// Step length per pixel footprint once the footprint outgrows baseStep
+constexpr float LOD_STEP_PER_FOOTPRINT = 1.0f;
+
+// March [t, tEnd] with the flameFS stepping rule, continuing 'out' and 't'.
+// Returns false once the ray is finished (opaque or out of steps).
+//
+// pixelSpread > 0 enables footprint LOD: the pixel footprint at distance t
+// is t * pixelSpread, the base step grows to LOD_STEP_PER_FOOTPRINT
+// footprints when that is larger, and fields whose density(p, footprint) /
+// temperature(p, density, footprint) take it get the footprint too.
+//
+// jitter in [0, 1) (blue_noise.h) shortens the first step to 1 - jitter of
+// its length, and weighs the first sample by that. Every later sample moves
+// by up to one stride while nothing before it is skipped, so the banding of
+// a coarse march becomes noise around the same mean. 0 is the shader march.
+template <class Q = QualityProduction, class Field>
+bool marchInterval(const Field& field, Vec3 ro, Vec3 rd, float& t, float tEnd,
+                   float baseStep, FlameSample& out, float pixelSpread = 0.0f,
+                   float jitter = 0.0f) {
+    constexpr bool footprintField = requires(const Field& f, Vec3 p) { f.density(p, 0.0f); };
+
+    float stepScale = 1.0f - jitter;
+    for (; out.steps < Q::maxSteps; out.steps++) {
+        if (out.alpha > Q::alphaCutoff) {
+            out.exit = RayExit::Opaque;
+            return false;
+        }
+        if (t > tEnd) return true;
+
+        Vec3 p = ro + rd * t;
+        float footprint = t * pixelSpread;
+        float step = pixelSpread > 0.0f ? fmaxf(baseStep, footprint * LOD_STEP_PER_FOOTPRINT) : baseStep;
+        step *= stepScale;
+        stepScale = 1.0f;
+
+        float density;
+        if constexpr (footprintField) density = field.density(p, footprint);
+        else density = field.density(p);
+
+        if (density > 0.001f) {
+            float stepLen = step * 0.6f;  // finer steps inside flame
+            float temp;
+            if constexpr (footprintField) temp = field.temperature(p, density, footprint);
+            else temp = field.temperature(p, density);
+            float before = out.alpha;
+            accumulateStep(fieldEmission(field, p, temp), density, stepLen, out.color, out.alpha,
+                           Q::opacitySubsteps);
+            out.depthSum += (out.alpha - before) * t;
+            t += stepLen;
+        } else {
+            // Empty space: take a larger step
+            out.emptySteps++;
+            t += step * 1.4f;
+        }
+    }
+    // Out of steps, unless the last one made the ray opaque
+    out.exit = out.alpha > Q::alphaCutoff ? RayExit::Opaque : RayExit::Budget;
+    return false;
+}
+
+template <class Q = QualityProduction, class Field>
+FlameSample marchFlame(const Field& field, Vec3 ro, Vec3 rd, float pixelSpread = 0.0f,
+                       float jitter = 0.0f) {
+    FlameSample out;
+    Vec2 tRange;
+    float baseStep, radius;
+    Vec3 center;
+    fieldSphere(field, center, radius);
+    if (!marchRange<Q>(ro, rd, tRange, baseStep, center, radius)) return out;
+    out.hit = true;
+    out.exit = RayExit::Left;
+
+    float t = tRange.x;
+    marchInterval<Q>(field, ro, rd, t, tRange.y, baseStep, out, pixelSpread, jitter);
+    return out;
+}
@@ -0,0 +1,260 @@
+#include "flame_params.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const char* const STOP_NAMES[FLAME_COLOR_STOPS] = {
+    "smoke", "dark_red", "dark_orange", "deep_orange", "golden", "bright_yellow", "white_hot",
+};
+
+const char* flameColorStopName(int stop) {
+    return stop >= 0 && stop < FLAME_COLOR_STOPS ? STOP_NAMES[stop] : "?";
+}
+
+/* =================== DEPENDENCIES =================== */
+
+static bool sameVec(Vec3 a, Vec3 b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+unsigned flameParamsChanged(const FlameParams& a, const FlameParams& b) {
+    unsigned groups = 0;
+    if (a.height != b.height) groups |= PARAMS_HEIGHT;
+    if (a.baseWidth != b.baseWidth) groups |= PARAMS_WIDTH;
+    if (a.turbulence != b.turbulence || a.turbulenceTip != b.turbulenceTip || a.flicker != b.flicker ||
+        a.swayX != b.swayX || a.swayZ != b.swayZ)
+        groups |= PARAMS_TURBULENCE;
+    for (int i = 0; i < FLAME_COLOR_STOPS; i++)
+        if (a.stops[i].temp != b.stops[i].temp || !sameVec(a.stops[i].color, b.stops[i].color))
+            groups |= PARAMS_COLOR;
+    return groups;
+}
+
+// The profile table is over normalised height, so the flame height does
+// not reach it; the blue zone and heightTemp columns depend on h alone
+unsigned flameCachesFor(unsigned groups) {
+    if (!groups) return 0;
+    unsigned caches = CACHE_UNIFORMS | CACHE_HISTORY;
+    if (groups & PARAMS_WIDTH) caches |= CACHE_PROFILE_TABLE;
+    if (groups & PARAMS_COLOR) caches |= CACHE_RAMP_TABLE;
+    if (groups & PARAMS_HEIGHT) caches |= CACHE_BOUNDS;
+    if (groups & (PARAMS_HEIGHT | PARAMS_WIDTH | PARAMS_TURBULENCE))
+        caches |= CACHE_BAKED | CACHE_LAZY | CACHE_OCCUPANCY;
+    return caches;
+}
+
+static std::string joinNames(unsigned bits, const char* const* names, int count) {
+    std::string out;
+    for (int i = 0; i < count; i++) {
+        if (!(bits & (1u << i))) continue;
+        if (!out.empty()) out += ", ";
+        out += names[i];
+    }
+    return out.empty() ? "none" : out;
+}
+
+std::string flameParamGroupNames(unsigned groups) {
+    static const char* const names[] = {"height", "width", "turbulence", "colour"};
+    return joinNames(groups, names, 4);
+}
+
+std::string flameParamCacheNames(unsigned caches) {
+    static const char* const names[] = {"uniforms", "profile table", "ramp table", "bounds", "history",
+                                        "baked volume", "lazy bricks", "occupancy grid"};
+    return joinNames(caches, names, 8);
+}
+
+/* =================== PARAMETERISED FUNCTIONS =================== */
+
+float flameRadius(float h, const FlameParams& params) {
+    float rise = 1.0f - expf(-h * 15.0f);
+    float taper = powf(fmaxf(1.0f - h, 0.0f), 1.2f);
+    float bulge = 1.0f + 0.35f * expf(-powf((h - 0.35f) / 0.18f, 2.0f));
+    return params.baseWidth * rise * taper * bulge;
+}
+
+// The band of the highest stop below temp, as flameColorRamp's if-chain
+Vec3 flameColorRamp(float temp, const FlameParams& params) {
+    int i = 0;
+    for (int k = 1; k < FLAME_COLOR_STOPS - 1; k++)
+        if (temp > params.stops[k].temp) i = k;
+    const FlameColorStop& a = params.stops[i];
+    const FlameColorStop& b = params.stops[i + 1];
+    return mix(a.color, b.color, (temp - a.temp) / (b.temp - a.temp));
+}
+
+Vec3 flameColor(float temp, float h, float radial, const FlameParams& params) {
+    Vec3 color = flameColorRamp(temp, params);
+
+    float radius = flameRadius(h, params);
+    float blueStrength = flameBlueHeight(h) * (1.0f - smoothstepf(0.0f, radius * 1.2f, radial));
+    float rFac = 1.0f - smoothstepf(0.0f, radius + 0.01f, radial);
+    Vec3 blueCol = mix(Vec3{0.08f, 0.2f, 0.7f}, Vec3{0.25f, 0.45f, 1.0f}, rFac);
+    return mix(color, blueCol, blueStrength * 0.75f);
+}
+
+// The bounds of flame_field.cpp with the block's amplitudes and width
+
+float flameMaxDisplacement(float h, const FlameParams& params) {
+    float turbHeight = smoothstepf(0.05f, 0.6f, h);
+    float turbAmp = params.turbulence + turbHeight * params.turbulenceTip;
+    float fineAmp = turbHeight * params.flicker;
+    float dx = params.swayX * NOISE3D_BOUND + turbAmp * NOISE3D_BOUND + fineAmp * NOISE3D_BOUND;
+    float dz = params.swayZ * NOISE3D_BOUND + turbAmp * 0.8f * NOISE3D_BOUND + fineAmp * 0.7f * NOISE3D_BOUND;
+    return sqrtf(dx * dx + dz * dz);
+}
+
+float flameRadiusMax(float h0, float h1, const FlameParams& params) {
+    h0 = clampf(h0, 0.0f, 1.0f);
+    h1 = clampf(h1, 0.0f, 1.0f);
+    const int N = 64;
+    float r = 0.0f;
+    for (int i = 0; i <= N; i++)
+        r = fmaxf(r, flameRadius(mixf(h0, h1, (float)i / N), params));
+    // The slope bound of the default profile, scaled with the width
+    float slope = 2.0f * (params.baseWidth / FLAME_BASE_WIDTH);
+    return r + slope * 0.5f * (h1 - h0) / N;
+}
+
+float flameSupportRadius(float h0, float h1, const FlameParams& params) {
+    return flameRadiusMax(h0, h1, params) + 0.035f + flameMaxDisplacement(h1, params);
+}
+
+/* =================== FILES =================== */
+
+// Exactly count floats separated by whitespace
+static bool parseFloats(const std::string& s, float* out, int count) {
+    const char* p = s.c_str();
+    for (int i = 0; i < count; i++) {
+        char* end = nullptr;
+        out[i] = std::strtof(p, &end);
+        if (end == p || !std::isfinite(out[i])) return false;
+        p = end;
+    }
+    while (*p == ' ' || *p == '\t') p++;
+    return *p == '\0';
+}
+
+static std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+static bool validate(const FlameParams& p, std::string& error) {
+    if (!(p.height > 0.0f)) { error = "height must be positive"; return false; }
+    if (!(p.baseWidth > 0.0f)) { error = "base_width must be positive"; return false; }
+    if (p.stops[0].temp != 0.0f || p.stops[FLAME_COLOR_STOPS - 1].temp != 1.0f) {
+        error = "stop.smoke must start at temperature 0 and stop.white_hot at 1";
+        return false;
+    }
+    for (int i = 1; i < FLAME_COLOR_STOPS; i++) {
+        if (!(p.stops[i].temp > p.stops[i - 1].temp)) {
+            error = std::string("stop.") + STOP_NAMES[i] + " must be at a higher temperature than stop." +
+                    STOP_NAMES[i - 1];
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseFlameParams(const std::string& text, FlameParams& out, std::string& error) {
+    FlameParams p;
+    std::istringstream in(text);
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            error = "line " + std::to_string(n) + ": expected key = value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, eq)), value = trim(line.substr(eq + 1));
+
+        float v[4];
+        bool ok = false, known = true;
+        if (key == "height") ok = parseFloats(value, &p.height, 1);
+        else if (key == "base_width") ok = parseFloats(value, &p.baseWidth, 1);
+        else if (key == "turbulence") ok = parseFloats(value, &p.turbulence, 1);
+        else if (key == "turbulence_tip") ok = parseFloats(value, &p.turbulenceTip, 1);
+        else if (key == "flicker") ok = parseFloats(value, &p.flicker, 1);
+        else if (key == "sway") {
+            ok = parseFloats(value, v, 2);
+            if (ok) { p.swayX = v[0]; p.swayZ = v[1]; }
+        } else if (key.compare(0, 5, "stop.") == 0) {
+            int stop = -1;
+            for (int i = 0; i < FLAME_COLOR_STOPS; i++)
+                if (key.compare(5, std::string::npos, STOP_NAMES[i]) == 0) stop = i;
+            known = stop >= 0;
+            ok = known && parseFloats(value, v, 4);
+            if (ok) p.stops[stop] = {v[0], {v[1], v[2], v[3]}};
+        } else {
+            known = false;
+        }
+
+        if (!known) {
+            error = "line " + std::to_string(n) + ": unknown key '" + key + "'";
+            return false;
+        }
+        if (!ok) {
+            error = "line " + std::to_string(n) + ": bad value for " + key +
+                    (key.compare(0, 5, "stop.") == 0 ? " (temperature r g b)" : key == "sway" ? " (x z)" : "");
+            return false;
+        }
+    }
+    if (!validate(p, error)) return false;
+    out = p;
+    return true;
+}
+
+bool loadFlameParams(const std::string& path, FlameParams& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        std::cerr << "Cannot read " << path << std::endl;
+        return false;
+    }
+    std::ostringstream text;
+    text << f.rdbuf();
+    std::string error;
+    if (!parseFlameParams(text.str(), out, error)) {
+        std::cerr << path << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Shortest text that reads back as the same float
+static std::string num(float v) {
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    return std::string(buf, r.ptr);
+}
+
+bool saveFlameParams(const std::string& path, const FlameParams& p) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    f << "# Flame look (flame_params.h). Saving this file while Sandbox --params runs\n"
+         "# reloads it; keys left out keep their default.\n\n"
+      << "height = " << num(p.height) << "\n"
+      << "base_width = " << num(p.baseWidth) << "\n"
+      << "\n# Tongue displacement: turbulence at the base, + turbulence_tip toward the tip\n"
+      << "turbulence = " << num(p.turbulence) << "\n"
+      << "turbulence_tip = " << num(p.turbulenceTip) << "\n"
+      << "flicker = " << num(p.flicker) << "\n"
+      << "sway = " << num(p.swayX) << " " << num(p.swayZ) << "\n"
+      << "\n# Colour ramp: temperature the band starts at, then r g b\n";
+    for (int i = 0; i < FLAME_COLOR_STOPS; i++) {
+        const FlameColorStop& s = p.stops[i];
+        f << "stop." << STOP_NAMES[i] << " = " << num(s.temp) << "  " << num(s.color.x) << " " << num(s.color.y)
+          << " " << num(s.color.z) << "\n";
+    }
+    f.close();
+    return !f.fail();
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <string>
+#include "flame_field.h"
+
+/* =================== FLAME PARAMETERS =================== */
+// The look of the flame as data instead of shader constants: shape,
+// turbulence amplitudes and the colour ramp. Sandbox loads a block from a
+// text file (--params), hands it to flameFS as a uniform buffer and reloads
+// it when the file changes, so a tweak is a save in the editor instead of a
+// rebuild and shader relink. Only the data derived from the groups that
+// changed is rebuilt (flameCachesFor).
+//
+// The defaults are the constants of flame_field.h / flame_quality.h
+// (FlameShape and the colour ramp). The CPU renderer keeps those compiled
+// in unless it is given a block (RenderOptions::params, FlameCpu --params),
+// so production output stays bit-exact; with a block it renders, bakes and
+// bounds the flame from it.
+//
+// File format: one "key = value" per line, # starts a comment, keys not
+// given keep their default.
+//
+//   height = 2.2                 flame height, world units
+//   base_width = 0.12            radius scale of the teardrop profile
+//   turbulence = 0.08            tongue displacement at the base...
+//   turbulence_tip = 0.18        ...plus this much toward the tip
+//   flicker = 0.04               fine tip flicker
+//   sway = 0.015 0.012           whole-flame sway along x and z
+//   stop.golden = 0.62  1.0 0.72 0.18    band start temperature, then colour
+//
+// The colour stops are named as in flameColorRamp (flameColorStopName);
+// their temperatures must rise from 0 (smoke) to 1 (white_hot).
+
+constexpr int FLAME_COLOR_STOPS = 7;
+
+struct FlameColorStop {
+    float temp;    // the band towards the next stop starts here
+    Vec3  color;
+};
+
+struct FlameParams {
+    float height = FlameShape::height;
+    float baseWidth = FlameShape::baseWidth;
+    float turbulence = FlameShape::turbulence;
+    float turbulenceTip = FlameShape::turbulenceTip;
+    float flicker = FlameShape::flicker;
+    float swayX = FlameShape::swayX, swayZ = FlameShape::swayZ;
+    FlameColorStop stops[FLAME_COLOR_STOPS] = {
+        {0.0f,  {0.18f, 0.04f, 0.0f}},
+        {0.1f,  {0.55f, 0.1f, 0.0f}},
+        {0.24f, {0.88f, 0.28f, 0.0f}},
+        {0.42f, {1.0f, 0.48f, 0.02f}},
+        {0.62f, {1.0f, 0.72f, 0.18f}},
+        {0.82f, {1.0f, 0.9f, 0.5f}},
+        {1.0f,  {1.0f, 0.96f, 0.88f}},
+    };
+
+    // Bounding sphere, as FLAME_SPHERE_CENTER / RADIUS for the default height
+    Vec3 sphereCenter() const { return {0.0f, height * 0.45f, 0.0f}; }
+    float sphereRadius() const { return height * 0.65f; }
+};
+
+// "smoke", "dark_red", ... "white_hot"
+const char* flameColorStopName(int stop);
+
+// ---- Dependencies ----
+
+// Parameter groups, as a bit mask of what differs between two blocks
+enum FlameParamGroup : unsigned {
+    PARAMS_HEIGHT = 1u << 0,
+    PARAMS_WIDTH = 1u << 1,
+    PARAMS_TURBULENCE = 1u << 2,   // turbulence, flicker, sway
+    PARAMS_COLOR = 1u << 3,
+};
+
+// Data derived from the parameters, as a bit mask of what a change
+// invalidates. The first five are Sandbox's; the CPU structures hold the
+// density field itself, so every shape group reaches them and colour does
+// not (it is applied when a sample is shaded).
+enum FlameParamCache : unsigned {
+    CACHE_UNIFORMS = 1u << 0,        // the block flameFS reads: every group
+    CACHE_PROFILE_TABLE = 1u << 1,   // radius column of the profile table: width
+    CACHE_RAMP_TABLE = 1u << 2,      // colour ramp table: colour
+    CACHE_BOUNDS = 1u << 3,          // bounding sphere and screen rect: height
+    CACHE_HISTORY = 1u << 4,         // temporal history: every group
+    CACHE_BAKED = 1u << 5,           // VolumeCache bake: height, width, turbulence
+    CACHE_LAZY = 1u << 6,            // LazyVolume bricks: height, width, turbulence
+    CACHE_OCCUPANCY = 1u << 7,       // OccupancyGrid cells: height, width, turbulence
+};
+
+unsigned flameParamsChanged(const FlameParams& a, const FlameParams& b);
+unsigned flameCachesFor(unsigned groups);
+
+// Comma-separated names of the bits, for logs ("height, colour")
+std::string flameParamGroupNames(unsigned groups);
+std::string flameParamCacheNames(unsigned caches);
+
+// ---- Parameterised functions ----
+// The flame_field.h functions on a block, as flameFS evaluates them. With
+// the defaults flameRadius and the bounds are bit-exact; the ramp divides
+// by the difference of two stop temperatures instead of the literal band
+// width, which can be an ulp off. flameSDF(p, params), flameDensityT and
+// temperatureFactorT (flame_quality.h) take a block as their shape.
+
+float flameRadius(float h, const FlameParams& params);
+Vec3 flameColorRamp(float temp, const FlameParams& params);
+Vec3 flameColor(float temp, float h, float radial, const FlameParams& params);
+
+float flameMaxDisplacement(float h, const FlameParams& params);
+float flameRadiusMax(float h0, float h1, const FlameParams& params);
+float flameSupportRadius(float h0, float h1, const FlameParams& params);
+
+// ---- Files ----
+
+// Parses text over the defaults; on failure out is untouched and error says
+// which line and why
+bool parseFlameParams(const std::string& text, FlameParams& out, std::string& error);
+
+// parseFlameParams on a file, errors to stderr
+bool loadFlameParams(const std::string& path, FlameParams& out);
+
+// Every key, with the format notes above, for a starting point to edit
+bool saveFlameParams(const std::string& path, const FlameParams& params);
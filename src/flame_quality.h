@@ -0,0 +1,248 @@
+#pragma once
+#include <utility>
+#include "flame_field.h"
+#include "flame_tables.h"
+
+/* =================== QUALITY TIERS =================== */
+// The flameFS quality knobs as compile-time parameters. A tier is a type
+// with static constants; the density, temperature and march templates are
+// instantiated once per tier, so octave loops unroll to straight-line code
+// and a tier without fine flicker does not contain it at all.
+//
+// QualityProduction is the shader: flameDensity() and temperatureFactor()
+// are its instantiations and MARCH_MAX_STEPS / MARCH_ALPHA_CUTOFF its
+// march limits.
+
+struct QualityPreview {
+    static constexpr const char* name = "preview";
+    static constexpr int   maxSteps = 48;
+    static constexpr float stepDivisor = 32.0f;   // baseStep = chord / divisor
+    static constexpr float alphaCutoff = 0.95f;
+    static constexpr int   turbOctaves = 2;       // flame tongue fbm
+    static constexpr int   fineOctaves = 0;       // tip flicker fbm (0 = off)
+    static constexpr int   detailOctaves = 1;     // internal density and temperature fbm
+    static constexpr int   opacitySubsteps = 1;   // see QualityTemporal
+};
+
+struct QualityProduction {
+    static constexpr const char* name = "production";
+    static constexpr int   maxSteps = 96;
+    static constexpr float stepDivisor = 64.0f;
+    static constexpr float alphaCutoff = 0.97f;
+    static constexpr int   turbOctaves = 3;
+    static constexpr int   fineOctaves = 2;
+    static constexpr int   detailOctaves = 2;
+    static constexpr int   opacitySubsteps = 1;
+};
+
+struct QualityFinal {
+    static constexpr const char* name = "final";
+    static constexpr int   maxSteps = 256;
+    static constexpr float stepDivisor = 160.0f;
+    static constexpr float alphaCutoff = 0.995f;
+    static constexpr int   turbOctaves = 4;
+    static constexpr int   fineOctaves = 3;
+    static constexpr int   detailOctaves = 3;
+    static constexpr int   opacitySubsteps = 1;
+};
+
+// Production detail with a quarter of the step budget and steps twice as
+// long. Alone it bands; with blue-noise start offsets (RenderOptions::jitter)
+// and temporal accumulation (temporal_accumulator.h) the bands turn into
+// noise that averages out over frames. The per-step opacity is capped, so a
+// long step is composited as opacitySubsteps production-length steps rather
+// than one, or the flame would turn transparent.
+struct QualityTemporal {
+    static constexpr const char* name = "temporal";
+    static constexpr int   maxSteps = 24;
+    static constexpr float stepDivisor = 32.0f;
+    static constexpr float alphaCutoff = 0.97f;
+    static constexpr int   turbOctaves = 3;
+    static constexpr int   fineOctaves = 2;
+    static constexpr int   detailOctaves = 2;
+    static constexpr int   opacitySubsteps = 2;
+};
+
+// Runtime tier selector (index into the renderer's dispatch table)
+enum class QualityTier { Preview, Production, Final, Temporal };
+constexpr int QUALITY_TIER_COUNT = 4;
+
+const char* qualityTierName(QualityTier tier);
+int qualityTierMaxSteps(QualityTier tier);   // the tier's march budget per ray
+
+// Parses "preview" / "production" / "final" / "temporal"; false if unknown
+bool parseQualityTier(const char* s, QualityTier& out);
+
+// ---- Tiered field functions ----
+
+// fbm() with the octave loop unrolled at compile time
+template <int Octaves>
+inline float fbmT(Vec3 p) {
+    float value = 0.0f;
+    float amp = 0.5f;
+    [&]<int... I>(std::integer_sequence<int, I...>) {
+        ((value += amp * noise3D(p), p = fbmNextOctave(p), amp *= 0.5f, (void)I), ...);
+    }(std::make_integer_sequence<int, Octaves>{});
+    return value;
+}
+
+// ---- Footprint LOD ----
+// With Lod set, each fbm octave is weighted by how well a pixel resolves
+// it. cyclesPerPixel is the octave's noise frequency times the world-space
+// width of the pixel footprint at the sample: octaves are kept up to four
+// pixels per cycle and fade out smoothly by Nyquist (two pixels per cycle),
+// after which the remaining, finer octaves are skipped.
+
+inline float lodOctaveWeight(float cyclesPerPixel) {
+    return 1.0f - smoothstepf(0.25f, 0.5f, cyclesPerPixel);
+}
+
+template <int Octaves, bool Lod>
+inline float fbmLodT(Vec3 p, float cyclesPerPixel) {
+    if constexpr (!Lod) {
+        return fbmT<Octaves>(p);
+    } else {
+        // Every octave resolved: the unrolled path
+        if (cyclesPerPixel * (float)(1 << (Octaves - 1)) <= 0.25f) return fbmT<Octaves>(p);
+
+        float value = 0.0f;
+        float amp = 0.5f;
+        for (int i = 0; i < Octaves; i++) {
+            float w = lodOctaveWeight(cyclesPerPixel);
+            if (w <= 0.0f) break;
+            value += amp * w * noise3D(p);
+            p = fbmNextOctave(p);
+            amp *= 0.5f;
+            cyclesPerPixel *= 2.0f;
+        }
+        return value;
+    }
+}
+
+// footprint: pixel width in world units at p (only read when Lod is set).
+// Tables takes the radius from the shape tables (flame_tables.h). shape is
+// the compiled FlameShape or a FlameParams block (flame_params.h).
+template <class Q, bool Lod = false, bool Tables = false, class Shape = FlameShape>
+float flameDensityT(Vec3 p, float time, float formation, float footprint = 0.0f, const Shape& shape = {}) {
+    float h = p.y / shape.height;
+
+    // Quick reject
+    if (h < -0.01f || h > 1.05f) return 0.0f;
+
+    // Upward-scrolling noise coordinates
+    Vec3 noisePos = p;
+    noisePos.y -= time * 2.0f;
+
+    // Turbulence strongest at tip, weakest at base
+    float turbHeight = smoothstepf(0.05f, 0.6f, h);
+    float turbAmp = shape.turbulence + turbHeight * shape.turbulenceTip;
+
+    // Gentle whole-flame sway (very low frequency)
+    float swayX = noise3D({time * 0.3f, 0.0f, 0.0f}) * shape.swayX;
+    float swayZ = noise3D({0.0f, 0.0f, time * 0.25f}) * shape.swayZ;
+
+    // Medium turbulence (flame tongue motion)
+    float turbX = fbmLodT<Q::turbOctaves, Lod>(noisePos * 3.5f, footprint * 3.5f) * turbAmp;
+    float turbZ = fbmLodT<Q::turbOctaves, Lod>(noisePos * 3.5f + Vec3{43.0f, 17.0f, 31.0f}, footprint * 3.5f)
+                * turbAmp * 0.8f;
+
+    float offX = swayX + turbX;
+    float offZ = swayZ + turbZ;
+
+    // Fine flickering at tip
+    if constexpr (Q::fineOctaves > 0) {
+        if (!Lod || lodOctaveWeight(footprint * 9.0f) > 0.0f) {
+            float fineAmp = turbHeight * shape.flicker;
+            offX += fbmLodT<Q::fineOctaves, Lod>(noisePos * 9.0f + Vec3{0.0f, time * 1.2f, 0.0f},
+                                                 footprint * 9.0f) * fineAmp;
+            offZ += fbmLodT<Q::fineOctaves, Lod>(noisePos * 9.0f + Vec3{67.0f, time * 1.2f, 41.0f},
+                                                 footprint * 9.0f) * fineAmp * 0.7f;
+        }
+    }
+
+    // Displaced sample point
+    Vec3 dp = p;
+    dp.x += offX;
+    dp.z += offZ;
+
+    float sdf;
+    if constexpr (Tables) sdf = flameSDFTable(dp);
+    else sdf = flameSDF(dp, shape);
+
+    // SDF -> density with smooth, wide falloff for soft edges
+    float density = 1.0f - smoothstepf(-0.05f, 0.035f, sdf);
+
+    // Internal density variation (flame isn't solid)
+    float intNoise = fbmLodT<Q::detailOctaves, Lod>(noisePos * 5.0f + Vec3{0.0f, time * 2.0f, 0.0f},
+                                                    footprint * 5.0f);
+    density *= 0.65f + 0.35f * (0.5f + 0.5f * intNoise);
+
+    // Base fade and tip dissolve
+    density *= smoothstepf(0.0f, 0.05f, h);
+    density *= 1.0f - smoothstepf(0.75f, 1.0f, h);
+
+    // Formation scale
+    density *= formation;
+
+    return fmaxf(density, 0.0f);
+}
+
+template <class Q, bool Lod = false, bool Tables = false, class Shape = FlameShape>
+float temperatureFactorT(Vec3 p, float time, float footprint = 0.0f, const Shape& shape = {}) {
+    float h = clampf(p.y / shape.height, 0.0f, 1.0f);
+    float radial = length2D(p.x, p.z);
+
+    // Convective cooling with height
+    float maxR, heightTemp;
+    if constexpr (Tables) {
+        FlameProfileEntry e = flameTables().profileAt(h);
+        maxR = e.radius + 0.01f;
+        heightTemp = e.heightTemp;
+    } else {
+        maxR = flameRadius(h, shape) + 0.01f;
+        heightTemp = flameHeightTemp(h);
+    }
+
+    // Radial: hottest on center axis, coolest at edges
+    float radial01 = 1.0f - smoothstepf(0.0f, maxR * 0.85f, radial);
+
+    float temp = heightTemp * mixf(0.3f, 1.0f, radial01);
+
+    // Slight noise flicker in temperature
+    Vec3 nP = p;
+    nP.y -= time * 1.6f;
+    temp += fbmLodT<Q::detailOctaves, Lod>(nP * 4.0f, footprint * 4.0f) * 0.1f;
+
+    return temp;
+}
+
+// Procedural field at a given tier (ProceduralField == TieredField<QualityProduction>)
+// Tables: shape and colour from the tables; the march then uses the
+// field's emission() (see fieldEmission in flame_march.h)
+template <class Q, bool Tables = false>
+struct TieredField {
+    float time;
+    float formation;
+
+    float density(Vec3 p) const { return flameDensityT<Q, false, Tables>(p, time, formation); }
+    float temperature(Vec3 p, float density) const {
+        return clampf(temperatureFactorT<Q, false, Tables>(p, time) * density, 0.0f, 1.0f);
+    }
+    Vec3 emission(Vec3 p, float temp) const requires Tables { return flameEmissionTable(p, temp); }
+};
+
+// Procedural field with footprint LOD; marchInterval() passes the footprint
+// to fields whose density takes one
+template <class Q, bool Tables = false>
+struct LodField {
+    float time;
+    float formation;
+
+    float density(Vec3 p, float footprint) const {
+        return flameDensityT<Q, true, Tables>(p, time, formation, footprint);
+    }
+    float temperature(Vec3 p, float density, float footprint) const {
+        return clampf(temperatureFactorT<Q, true, Tables>(p, time, footprint) * density, 0.0f, 1.0f);
+    }
+    Vec3 emission(Vec3 p, float temp) const requires Tables { return flameEmissionTable(p, temp); }
+};
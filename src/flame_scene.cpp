@@ -0,0 +1,226 @@
+#include "flame_scene.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+
+namespace {
+
+constexpr int SAH_BINS = 12;
+constexpr int MAX_LEAF = 4;
+constexpr float PI = 3.14159265358979f;
+
+struct Box {
+    Vec3 min = {1e30f, 1e30f, 1e30f};
+    Vec3 max = {-1e30f, -1e30f, -1e30f};
+
+    void grow(Vec3 p) {
+        min = {fminf(min.x, p.x), fminf(min.y, p.y), fminf(min.z, p.z)};
+        max = {fmaxf(max.x, p.x), fmaxf(max.y, p.y), fmaxf(max.z, p.z)};
+    }
+    void grow(const Box& b) {
+        if (!b.empty()) { grow(b.min); grow(b.max); }
+    }
+    bool empty() const { return max.x < min.x; }
+    float area() const {
+        if (empty()) return 0.0f;
+        Vec3 e = max - min;
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+};
+
+float axis(Vec3 v, int a) { return a == 0 ? v.x : (a == 1 ? v.y : v.z); }
+
+} // namespace
+
+void FlameScene::clear() {
+    instances_.clear();
+    xforms_.clear();
+    nodes_.clear();
+    order_.clear();
+}
+
+void FlameScene::build() {
+    xforms_.resize(instances_.size());
+    for (size_t i = 0; i < instances_.size(); i++) {
+        const FlameInstance& inst = instances_[i];
+        Xform& x = xforms_[i];
+        x.c = cosf(inst.yaw);
+        x.s = sinf(inst.yaw);
+        x.invScale = 1.0f / inst.scale;
+        // The glow centre is on the flame axis, so yaw does not move it
+        x.boundsCenter = inst.position + FLAME_GLOW_CENTER * inst.scale;
+        x.boundsRadius = FLAME_GLOW_RADIUS * inst.scale;
+    }
+
+    nodes_.clear();
+    order_.resize(instances_.size());
+    for (size_t i = 0; i < order_.size(); i++) order_[i] = (int)i;
+    if (instances_.empty()) return;
+    nodes_.reserve(2 * instances_.size());
+    nodes_.push_back({});
+    buildNode(0, 0, (int)instances_.size(), 0);
+}
+
+// Fills nodes_[self] (and appends its subtree) for order_[first .. first + count)
+void FlameScene::buildNode(int self, int first, int count, int depth) {
+    auto bounds = [&](int i) {
+        const Xform& x = xforms_[i];
+        Vec3 r = {x.boundsRadius, x.boundsRadius, x.boundsRadius};
+        Box b;
+        b.grow(x.boundsCenter - r);
+        b.grow(x.boundsCenter + r);
+        return b;
+    };
+
+    Box box, centroids;
+    for (int k = first; k < first + count; k++) {
+        box.grow(bounds(order_[k]));
+        centroids.grow(xforms_[order_[k]].boundsCenter);
+    }
+    auto makeLeaf = [&] { nodes_[self] = {box.min, first, box.max, count}; };
+    // Past MAX_DEPTH (e.g. exponentially spaced instances, split off one per
+    // level) the rest share a leaf
+    if (count <= 1 || depth >= MAX_DEPTH) return makeLeaf();
+
+    // Binned SAH along the centroids' longest axis
+    Vec3 extent = centroids.max - centroids.min;
+    int a = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    float lo = axis(centroids.min, a), span = axis(extent, a);
+    if (span <= 0.0f) return makeLeaf();   // coincident instances
+
+    Box binBox[SAH_BINS];
+    int binCount[SAH_BINS] = {};
+    auto binOf = [&](int i) {
+        int b = (int)((axis(xforms_[i].boundsCenter, a) - lo) / span * SAH_BINS);
+        return std::min(b, SAH_BINS - 1);
+    };
+    for (int k = first; k < first + count; k++) {
+        int b = binOf(order_[k]);
+        binBox[b].grow(bounds(order_[k]));
+        binCount[b]++;
+    }
+
+    // Cost of splitting after bin s: areas and counts of both sides
+    float leftArea[SAH_BINS - 1];
+    int leftCount[SAH_BINS - 1];
+    Box acc;
+    int n = 0;
+    for (int s = 0; s < SAH_BINS - 1; s++) {
+        acc.grow(binBox[s]);
+        n += binCount[s];
+        leftArea[s] = acc.area();
+        leftCount[s] = n;
+    }
+    float bestCost = 1e30f;
+    int bestSplit = -1;
+    acc = Box{};
+    n = 0;
+    for (int s = SAH_BINS - 2; s >= 0; s--) {
+        acc.grow(binBox[s + 1]);
+        n += binCount[s + 1];
+        if (leftCount[s] == 0 || n == 0) continue;
+        float cost = leftArea[s] * (float)leftCount[s] + acc.area() * (float)n;
+        if (cost < bestCost) { bestCost = cost; bestSplit = s; }
+    }
+
+    // Traversal ~ one box test, an instance ~ one sphere test
+    float leafCost = box.area() * (float)count;
+    if (bestSplit < 0 || (count <= MAX_LEAF && leafCost <= box.area() + bestCost)) return makeLeaf();
+
+    int* mid = std::partition(&order_[first], &order_[first] + count,
+                              [&](int i) { return binOf(i) <= bestSplit; });
+    int leftN = (int)(mid - &order_[first]);
+
+    int left = (int)nodes_.size();
+    nodes_[self] = {box.min, left, box.max, 0};
+    nodes_.push_back({});
+    nodes_.push_back({});
+    buildNode(left, first, leftN, depth + 1);
+    buildNode(left + 1, first + leftN, count - leftN, depth + 1);
+}
+
+bool FlameScene::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open scene " << path << std::endl;
+        return false;
+    }
+    clear();
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); lineNo++) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind)) continue;
+        if (kind != "flame") {
+            std::cerr << path << ":" << lineNo << ": unknown entry '" << kind << "'" << std::endl;
+            return false;
+        }
+
+        // x y z, then up to four optional values
+        float v[7] = {0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f};
+        int n = 0;
+        while (n < 7 && fields >> v[n]) n++;
+        std::string rest;
+        fields.clear();
+        if (n < 3 || fields >> rest) {
+            std::cerr << path << ":" << lineNo << ": expected flame <x> <y> <z> [yaw] [scale] [time offset] "
+                         "[formation]" << std::endl;
+            return false;
+        }
+        if (!(v[4] > 0.0f)) {
+            std::cerr << path << ":" << lineNo << ": scale must be positive" << std::endl;
+            return false;
+        }
+
+        FlameInstance inst;
+        inst.position = {v[0], v[1], v[2]};
+        inst.yaw = v[3] * PI / 180.0f;
+        inst.scale = v[4];
+        inst.timeOffset = v[5];
+        inst.formation = v[6];
+        add(inst);
+    }
+    build();
+    return true;
+}
+
+bool FlameScene::save(const std::string& path) const {
+    std::unique_ptr<FILE, int (*)(FILE*)> f(std::fopen(path.c_str(), "w"), &std::fclose);
+    if (!f) {
+        std::cerr << "Cannot write scene " << path << std::endl;
+        return false;
+    }
+    std::fprintf(f.get(), "# flame <x> <y> <z> [yaw degrees] [scale] [time offset] [formation]\n");
+    for (const FlameInstance& i : instances_) {
+        std::fprintf(f.get(), "flame %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", i.position.x, i.position.y, i.position.z,
+                     i.yaw * 180.0f / PI, i.scale, i.timeOffset, i.formation);
+    }
+    return std::ferror(f.get()) == 0;
+}
+
+FlameScene makeCandleField(int count, float spacing, uint32_t seed) {
+    FlameScene scene;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    int side = std::max(1, (int)std::ceil(std::sqrt((double)count)));
+    float origin = -0.5f * (float)(side - 1) * spacing;
+
+    for (int k = 0; k < count; k++) {
+        FlameInstance inst;
+        float jx = (unit(rng) - 0.5f) * 0.3f * spacing, jz = (unit(rng) - 0.5f) * 0.3f * spacing;
+        inst.position = {origin + (float)(k % side) * spacing + jx, 0.0f, origin + (float)(k / side) * spacing + jz};
+        inst.yaw = unit(rng) * 2.0f * PI;
+        inst.scale = 0.25f + 0.15f * unit(rng);
+        inst.timeOffset = unit(rng) * 10.0f;
+        scene.add(inst);
+    }
+    scene.build();
+    return scene;
+}
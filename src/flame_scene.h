@@ -0,0 +1,294 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cpu_renderer.h"
+#include "flame_march.h"
+
+/* =================== FLAME SCENES =================== */
+// Many flames instead of the one at the origin. Each instance is the
+// procedural flame moved, turned about +y, uniformly scaled, shifted in time
+// and with its own formation. A BVH over the instances' bounds finds the
+// flames near a ray in O(log n), so a ray pays only for what it passes:
+//
+//   - the glow of every instance whose bounds it crosses (the bounds hold
+//     the glow out to where it falls below an 8-bit step)
+//   - the march of every instance whose bounding sphere it enters
+//
+// Hits are sorted by distance and walked front to back. A flame whose
+// interval overlaps no other is marched in its own space with the normal
+// march, so a lone instance at the origin renders exactly like the single
+// flame. Overlapping intervals are merged and marched together in world
+// space, summing the flames' extinction at every sample, so interpenetrating
+// flames composite in depth order.
+
+struct FlameInstance {
+    Vec3  position = {0.0f, 0.0f, 0.0f};
+    float yaw = 0.0f;          // radians about +y
+    float scale = 1.0f;
+    float timeOffset = 0.0f;   // added to the scene time
+    float formation = 1.0f;    // multiplies the global formation
+};
+
+// Instance bounds in flame space: around the glow centre, holding the
+// bounding sphere and the glow
+constexpr Vec3  FLAME_GLOW_CENTER = {0.0f, FLAME_HEIGHT * 0.35f, 0.0f};
+constexpr float FLAME_GLOW_RADIUS = 2.5f;
+
+// Traversal counters, summed over rays
+struct SceneRayStats {
+    uint64_t nodesVisited = 0;
+    uint64_t boundsTested = 0;    // instance bounds tested in leaves
+    uint64_t flamesEntered = 0;   // bounding spheres the rays entered
+};
+
+class FlameScene {
+public:
+    // BVH node: interior nodes have count 0 and children first, first + 1;
+    // leaves hold order[first .. first + count)
+    struct Node {
+        Vec3 min;
+        int  first;
+        Vec3 max;
+        int  count;
+    };
+
+    // Deepest level of the BVH (the root is level 0); build() makes a leaf of
+    // whatever reaches it, which bounds traverse()'s stack
+    static constexpr int MAX_DEPTH = 60;
+
+    void clear();
+    void add(const FlameInstance& instance) { instances_.push_back(instance); }
+
+    // Build the BVH (binned SAH) over the current instances
+    void build();
+
+    // Text format, one instance per line, '#' starts a comment:
+    //   flame <x> <y> <z> [yaw degrees] [scale] [time offset] [formation]
+    // load() builds the BVH; both report errors on std::cerr
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    size_t size() const { return instances_.size(); }
+    const std::vector<FlameInstance>& instances() const { return instances_; }
+    const std::vector<Node>& nodes() const { return nodes_; }
+    const std::vector<int>& order() const { return order_; }
+
+    // World to flame space of instance i (directions keep unit length)
+    Vec3 toLocal(int i, Vec3 p) const {
+        const Xform& x = xforms_[i];
+        Vec3 d = p - instances_[i].position;
+        return Vec3{x.c * d.x - x.s * d.z, d.y, x.s * d.x + x.c * d.z} * x.invScale;
+    }
+    Vec3 dirToLocal(int i, Vec3 d) const {
+        const Xform& x = xforms_[i];
+        return {x.c * d.x - x.s * d.z, d.y, x.s * d.x + x.c * d.z};
+    }
+
+    // Calls visit(instance) for every instance whose bounds the ray crosses
+    template <class Visit>
+    void traverse(Vec3 ro, Vec3 rd, Visit&& visit, SceneRayStats* stats = nullptr) const;
+
+private:
+    struct Xform {
+        float c, s, invScale;   // cos / sin of yaw, 1 / scale
+        Vec3 boundsCenter;
+        float boundsRadius;
+    };
+
+    void buildNode(int self, int first, int count, int depth);
+
+    std::vector<FlameInstance> instances_;
+    std::vector<Xform> xforms_;
+    std::vector<Node> nodes_;
+    std::vector<int> order_;
+};
+
+// Candle field: count small flames on a jittered square grid centred on the
+// origin, spacing apart, with random yaw, size and phase
+FlameScene makeCandleField(int count, float spacing = 1.5f, uint32_t seed = 1);
+
+/* ---- Template implementation ---- */
+
+template <class Visit>
+void FlameScene::traverse(Vec3 ro, Vec3 rd, Visit&& visit, SceneRayStats* stats) const {
+    if (nodes_.empty()) return;
+    const Vec3 inv = {1.0f / rd.x, 1.0f / rd.y, 1.0f / rd.z};
+    uint64_t visited = 0, tested = 0;
+
+    // One pending sibling per level, plus both children of the deepest
+    // interior node
+    int stack[MAX_DEPTH + 1];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& n = nodes_[stack[--top]];
+        visited++;
+
+        // Slab test against [0, inf)
+        float tx0 = (n.min.x - ro.x) * inv.x, tx1 = (n.max.x - ro.x) * inv.x;
+        float ty0 = (n.min.y - ro.y) * inv.y, ty1 = (n.max.y - ro.y) * inv.y;
+        float tz0 = (n.min.z - ro.z) * inv.z, tz1 = (n.max.z - ro.z) * inv.z;
+        float tNear = fmaxf(fmaxf(fminf(tx0, tx1), fminf(ty0, ty1)), fmaxf(fminf(tz0, tz1), 0.0f));
+        float tFar = fminf(fminf(fmaxf(tx0, tx1), fmaxf(ty0, ty1)), fmaxf(tz0, tz1));
+        if (tNear > tFar) continue;
+
+        if (n.count == 0) {
+            assert(top + 2 <= MAX_DEPTH + 1);
+            stack[top++] = n.first + 1;
+            stack[top++] = n.first;
+            continue;
+        }
+        for (int k = 0; k < n.count; k++) {
+            int i = order_[n.first + k];
+            const Xform& x = xforms_[i];
+            tested++;
+            if (intersectSphere(ro, rd, x.boundsCenter, x.boundsRadius).y >= 0.0f) visit(i);
+        }
+    }
+    if (stats) {
+        stats->nodesVisited += visited;
+        stats->boundsTested += tested;
+    }
+}
+
+/* =================== SCENE MARCH =================== */
+
+// One flame a ray enters: its bounding-sphere interval in world distance
+struct SceneHit {
+    int   instance;
+    float t0, t1;
+};
+
+// Marches the instances in [i, j) of hits, whose intervals overlap, together
+// in world space. The base step is the finest of theirs and the budget is
+// theirs combined; each sample sums the instances whose interval holds it.
+// With pixelSpread > 0 the step grows with the footprint as in marchInterval.
+template <class Q, class MakeField>
+void marchOverlapping(const FlameScene& scene, const MakeField& makeField, const SceneHit* hits, int count,
+                      Vec3 ro, Vec3 rd, float pixelSpread, float jitter, FlameSample& out) {
+    using Field = decltype(makeField(scene.instances()[0]));
+    constexpr bool footprintField = requires(const Field& f, Vec3 p) { f.density(p, 0.0f); };
+
+    float t = hits[0].t0, tEnd = hits[0].t1, baseStep = 1e30f;
+    for (int k = 0; k < count; k++) {
+        const FlameInstance& inst = scene.instances()[hits[k].instance];
+        float local = fmaxf((hits[k].t1 - hits[k].t0) / inst.scale / Q::stepDivisor, 0.01f);
+        baseStep = fminf(baseStep, local * inst.scale);
+        tEnd = fmaxf(tEnd, hits[k].t1);
+    }
+
+    float stepScale = 1.0f - jitter;
+    for (int n = 0; n < Q::maxSteps * count; n++) {
+        if (out.alpha > Q::alphaCutoff || t > tEnd) return;
+
+        Vec3 p = ro + rd * t;
+        float step = pixelSpread > 0.0f ? fmaxf(baseStep, t * pixelSpread * LOD_STEP_PER_FOOTPRINT) : baseStep;
+        step *= stepScale;
+        stepScale = 1.0f;
+
+        // Extinction in world units (flame-space density / scale) and the
+        // extinction-weighted emission of the flames at p
+        float sigma = 0.0f;
+        Vec3 emission = {0.0f, 0.0f, 0.0f};
+        for (int k = 0; k < count; k++) {
+            if (t < hits[k].t0 || t > hits[k].t1) continue;
+            int i = hits[k].instance;
+            const FlameInstance& inst = scene.instances()[i];
+            Field field = makeField(inst);
+            Vec3 lp = scene.toLocal(i, p);
+            float footprint = t * pixelSpread / inst.scale;
+
+            float density;
+            if constexpr (footprintField) density = field.density(lp, footprint);
+            else density = field.density(lp);
+            out.steps++;
+            if (density <= 0.001f) { out.emptySteps++; continue; }
+
+            float temp;
+            if constexpr (footprintField) temp = field.temperature(lp, density, footprint);
+            else temp = field.temperature(lp, density);
+            float s = density / inst.scale;
+            sigma += s;
+            emission += fieldEmission(field, lp, temp) * s;
+        }
+
+        if (sigma > 0.0f) {
+            float stepLen = step * 0.6f;  // finer steps inside flame
+            float alpha = stepOpacity(sigma, stepLen, Q::opacitySubsteps);
+            float before = out.alpha;
+            out.color += emission * (alpha * (1.0f - out.alpha) / sigma);
+            out.alpha += alpha * (1.0f - out.alpha);
+            out.depthSum += (out.alpha - before) * t;
+            t += stepLen;
+        } else {
+            t += step * 1.4f;
+        }
+    }
+    out.exit = out.alpha > Q::alphaCutoff ? RayExit::Opaque : RayExit::Budget;
+}
+
+// The flames and glow along one ray. makeField(instance) returns the field of
+// an instance in its own space (e.g. TieredField<Q> at its time); glow
+// receives the summed warm glow, formation scaling each instance's.
+template <class Q, class MakeField>
+FlameSample marchScene(const FlameScene& scene, const MakeField& makeField, Vec3 ro, Vec3 rd,
+                       float formation, Vec3& glow, float pixelSpread = 0.0f, float jitter = 0.0f,
+                       SceneRayStats* stats = nullptr) {
+    thread_local std::vector<SceneHit> hits;
+    hits.clear();
+    glow = {0.0f, 0.0f, 0.0f};
+
+    scene.traverse(ro, rd, [&](int i) {
+        const FlameInstance& inst = scene.instances()[i];
+        Vec3 lro = scene.toLocal(i, ro), lrd = scene.dirToLocal(i, rd);
+        glow += warmGlow(lro, lrd, formation * inst.formation);
+        Vec2 tRange = intersectSphere(lro, lrd, FLAME_SPHERE_CENTER, FLAME_SPHERE_RADIUS);
+        if (tRange.y >= 0.0f) hits.push_back({i, fmaxf(tRange.x, 0.0f) * inst.scale, tRange.y * inst.scale});
+    }, stats);
+    if (stats) stats->flamesEntered += hits.size();
+
+    FlameSample out;
+    if (hits.empty()) return out;
+    out.hit = true;
+    out.exit = RayExit::Left;
+    std::sort(hits.begin(), hits.end(), [](const SceneHit& a, const SceneHit& b) {
+        return a.t0 < b.t0 || (a.t0 == b.t0 && a.instance < b.instance);
+    });
+
+    const int n = (int)hits.size();
+    for (int i = 0, j; i < n && out.alpha <= Q::alphaCutoff; i = j) {
+        // Extend the run while the next interval starts inside it
+        float end = hits[i].t1;
+        for (j = i + 1; j < n && hits[j].t0 < end; j++) end = fmaxf(end, hits[j].t1);
+
+        if (j - i > 1) {
+            marchOverlapping<Q>(scene, makeField, &hits[i], j - i, ro, rd, pixelSpread, jitter, out);
+            continue;
+        }
+
+        // A lone flame: the normal march in its own space, then composited
+        // behind what the ray has gathered so far
+        int id = hits[i].instance;
+        const FlameInstance& inst = scene.instances()[id];
+        Vec3 lro = scene.toLocal(id, ro), lrd = scene.dirToLocal(id, rd);
+        Vec2 tRange;
+        float baseStep = 0.0f;
+        if (!marchRange<Q>(lro, lrd, tRange, baseStep)) continue;   // behind the camera
+        FlameSample flame;
+        float t = tRange.x;
+        marchInterval<Q>(makeField(inst), lro, lrd, t, tRange.y, baseStep, flame, pixelSpread, jitter);
+
+        float transmit = 1.0f - out.alpha;
+        out.color += flame.color * transmit;
+        out.depthSum += flame.depthSum * inst.scale * transmit;
+        out.alpha += flame.alpha * transmit;
+        out.steps += flame.steps;
+        out.emptySteps += flame.emptySteps;
+        if (flame.exit == RayExit::Budget) out.exit = RayExit::Budget;
+    }
+    if (out.alpha > Q::alphaCutoff) out.exit = RayExit::Opaque;
+    return out;
+}
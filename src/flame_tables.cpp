@@ -0,0 +1,43 @@
+#include "flame_tables.h"
+
+#include <cmath>
+#include "flame_params.h"
+
+void buildFlameTables(FlameTables& tables) {
+    tables.profile.resize(FLAME_PROFILE_TABLE_SIZE);
+    for (int i = 0; i < FLAME_PROFILE_TABLE_SIZE; i++) {
+        float h = (float)i / (float)(FLAME_PROFILE_TABLE_SIZE - 1);
+        tables.profile[i] = {flameRadius(h), flameHeightTemp(h), flameBlueHeight(h), 0.0f};
+    }
+
+    tables.ramp.resize(FLAME_RAMP_TABLE_SIZE);
+    for (int i = 0; i < FLAME_RAMP_TABLE_SIZE; i++) {
+        float temp = (float)i / (float)(FLAME_RAMP_TABLE_SIZE - 1);
+        tables.ramp[i] = {flameColorRamp(temp), powf(temp, 1.6f) * 3.5f};
+    }
+}
+
+void buildFlameProfileTable(FlameTables& tables, const FlameParams& params) {
+    tables.profile.resize(FLAME_PROFILE_TABLE_SIZE);
+    for (int i = 0; i < FLAME_PROFILE_TABLE_SIZE; i++) {
+        float h = (float)i / (float)(FLAME_PROFILE_TABLE_SIZE - 1);
+        tables.profile[i] = {flameRadius(h, params), flameHeightTemp(h), flameBlueHeight(h), 0.0f};
+    }
+}
+
+void buildFlameRampTable(FlameTables& tables, const FlameParams& params) {
+    tables.ramp.resize(FLAME_RAMP_TABLE_SIZE);
+    for (int i = 0; i < FLAME_RAMP_TABLE_SIZE; i++) {
+        float temp = (float)i / (float)(FLAME_RAMP_TABLE_SIZE - 1);
+        tables.ramp[i] = {flameColorRamp(temp, params), powf(temp, 1.6f) * 3.5f};
+    }
+}
+
+const FlameTables& flameTables() {
+    static const FlameTables tables = [] {
+        FlameTables t;
+        buildFlameTables(t);
+        return t;
+    }();
+    return tables;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <vector>
+#include "flame_field.h"
+
+/* =================== SHAPE AND COLOR TABLES =================== */
+// Precomputed 1D tables for the per-sample shape and colour terms, built
+// once at startup from the exact functions in flame_field.cpp:
+//
+//   profile, over h in [0, 1]:    flameRadius, the convective heightTemp
+//                                 curve and the blue-zone height weight
+//   ramp, over temp in [0, 1]:    flameColor's six-band colour ramp and the
+//                                 pow(temp, 1.6) * 3.5 emission
+//
+// Lookups interpolate linearly between entries, entry i sitting at
+// x = i / (size - 1). The ramp's band edges (0.1, 0.24, ... 0.82) fall on
+// entries, so the piecewise-linear ramp itself is reproduced exactly. The
+// blue zone also depends on the distance from the axis, so it stays two
+// smoothsteps on the tabled radius rather than a third table axis.
+//
+// The CPU fields take them with the Tables template flag (flame_quality.h);
+// Sandbox uploads the same arrays as 1D textures and interpolates them the
+// same way (tableLookup in flameFS). Results differ from the exact functions
+// by at most the tolerances below, checked by FlameLutBench.
+
+constexpr int FLAME_PROFILE_TABLE_SIZE = 1025;
+constexpr int FLAME_RAMP_TABLE_SIZE = 501;   // 1/500 steps put the band edges on entries
+
+// Max absolute differences from the exact functions. The emission error
+// peaks in the bottom 1% of the flame, where the radius rises from zero and
+// the blue zone's smoothstep over it is steepest; above that it is < 3e-4
+constexpr float FLAME_TABLE_RADIUS_TOLERANCE = 5e-6f;      // world units (radius up to ~0.15)
+constexpr float FLAME_TABLE_HEIGHT_TEMP_TOLERANCE = 5e-7f;
+constexpr float FLAME_TABLE_EMISSION_TOLERANCE = 6e-3f;    // flameEmission, per channel (up to 3.5)
+
+// One profile entry, 16 bytes so the array uploads as an RGBA32F texture
+struct FlameProfileEntry {
+    float radius;       // flameRadius(h)
+    float heightTemp;   // expf(-h * 1.8) * 0.7 + (1 - h) * 0.3
+    float blueHeight;   // smoothstep(0.22, 0.02, h)
+    float unused;
+};
+
+struct FlameRampEntry {
+    Vec3  color;        // flameColor's band ramp, before the blue zone
+    float emission;     // powf(temp, 1.6) * 3.5
+};
+
+struct FlameTables {
+    std::vector<FlameProfileEntry> profile;
+    std::vector<FlameRampEntry> ramp;
+
+    FlameProfileEntry profileAt(float h) const;
+    FlameRampEntry rampAt(float temp) const;
+};
+
+// Built on first use
+const FlameTables& flameTables();
+
+// Fills the tables from the exact functions
+void buildFlameTables(FlameTables& tables);
+
+// One table from a parameter block (flame_params.h) instead of the compiled
+// constants, so a reload rebuilds only the table its changes reach
+struct FlameParams;
+void buildFlameProfileTable(FlameTables& tables, const FlameParams& params);
+void buildFlameRampTable(FlameTables& tables, const FlameParams& params);
+
+// ---- Lookups used by the Tables instantiations ----
+
+// Entry index and blend weight for x in [0, 1] (clamped) in a table of size n
+inline int tableIndex(float x, int n, float& frac) {
+    float f = clampf(x, 0.0f, 1.0f) * (float)(n - 1);
+    int i = (int)f;
+    if (i > n - 2) i = n - 2;
+    frac = f - (float)i;
+    return i;
+}
+
+inline FlameProfileEntry FlameTables::profileAt(float h) const {
+    float w;
+    int i = tableIndex(h, FLAME_PROFILE_TABLE_SIZE, w);
+    const FlameProfileEntry& a = profile[i];
+    const FlameProfileEntry& b = profile[i + 1];
+    return {mixf(a.radius, b.radius, w), mixf(a.heightTemp, b.heightTemp, w),
+            mixf(a.blueHeight, b.blueHeight, w), 0.0f};
+}
+
+inline FlameRampEntry FlameTables::rampAt(float temp) const {
+    float w;
+    int i = tableIndex(temp, FLAME_RAMP_TABLE_SIZE, w);
+    const FlameRampEntry& a = ramp[i];
+    const FlameRampEntry& b = ramp[i + 1];
+    return {mix(a.color, b.color, w), mixf(a.emission, b.emission, w)};
+}
+
+// flameRadius from the profile table
+inline float flameRadiusTable(float h) {
+    return flameTables().profileAt(h).radius;
+}
+
+// flameSDF on the tabled radius
+inline float flameSDFTable(Vec3 p) {
+    float h = p.y / FLAME_HEIGHT;
+    if (h < -0.01f || h > 1.01f) return length2D(p.x, p.z) + fabsf(p.y) * 0.3f + 0.1f;
+    return length2D(p.x, p.z) - flameRadiusTable(clampf(h, 0.0f, 1.0f));
+}
+
+// flameEmission (flame_march.h) from the tables: ramp colour and emission
+// by temperature, blue zone by height and the tabled radius
+inline Vec3 flameEmissionTable(Vec3 p, float temp) {
+    const FlameTables& t = flameTables();
+    float h = clampf(p.y / FLAME_HEIGHT, 0.0f, 1.0f);
+    float radial = length2D(p.x, p.z);
+    FlameProfileEntry s = t.profileAt(h);
+    FlameRampEntry c = t.rampAt(temp);
+
+    const Vec3 innerBlue = {0.25f, 0.45f, 1.0f};
+    const Vec3 outerBlue = {0.08f, 0.2f, 0.7f};
+    float blueRadial = 1.0f - smoothstepf(0.0f, s.radius * 1.2f, radial);
+    float rFac = 1.0f - smoothstepf(0.0f, s.radius + 0.01f, radial);
+    Vec3 blueCol = mix(outerBlue, innerBlue, rFac);
+    return mix(c.color, blueCol, s.blueHeight * blueRadial * 0.75f) * c.emission;
+}
@@ -0,0 +1,388 @@
+#include "fluid_solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include "flame_field.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+FluidSolver::FluidSolver(const FluidSettings& settings) : settings_(settings) {
+    nb_ = std::max(1, (settings_.cellsPerAxis + BRICK - 1) / BRICK);
+    n_ = nb_ * BRICK;
+
+    // Same cube as the occupancy grid: everything the renderer marches
+    min_ = FLAME_SPHERE_CENTER - Vec3{FLAME_SPHERE_RADIUS, FLAME_SPHERE_RADIUS, FLAME_SPHERE_RADIUS};
+    dx_ = 2.0f * FLAME_SPHERE_RADIUS / n_;
+
+    brickSlot_.assign((size_t)nb_ * nb_ * nb_, -1);
+}
+
+size_t FluidSolver::memoryBytes() const {
+    size_t bytes = 0;
+    for (const std::vector<float>& c : ch_) bytes += c.size() * sizeof(float);
+    return bytes + brickSlot_.size() * sizeof(int32_t);
+}
+
+bool FluidSolver::exportBrick(int brickId, float* density, float* temperature) const {
+    int slot = brickSlot_[brickId];
+    if (slot < 0) return false;
+    std::copy_n(ch_[DENS].begin() + (size_t)slot * BRICK_CELLS, BRICK_CELLS, density);
+    std::copy_n(ch_[TEMP].begin() + (size_t)slot * BRICK_CELLS, BRICK_CELLS, temperature);
+    return true;
+}
+
+/* =================== BRICK ACCESS =================== */
+
+template <class Fn>
+void FluidSolver::forEachCell(ThreadPool& pool, Fn&& fn) {
+    pool.parallelFor(active_.size(), [&](size_t i) {
+        int id = active_[i];
+        int slot = brickSlot_[id];
+        int x0 = id % nb_ * BRICK, y0 = id / nb_ % nb_ * BRICK, z0 = id / (nb_ * nb_) * BRICK;
+        for (int z = z0; z < z0 + BRICK; z++)
+            for (int y = y0; y < y0 + BRICK; y++)
+                for (int x = x0; x < x0 + BRICK; x++) fn(slot, x, y, z);
+    });
+}
+
+// Sum of fn(slot, x, y, z) over every active cell; per-brick partials are
+// added in brick order so the result does not depend on the thread count
+template <class Fn>
+double FluidSolver::reduce(ThreadPool& pool, Fn&& fn) {
+    partial_.assign(active_.size(), 0.0);
+    pool.parallelFor(active_.size(), [&](size_t i) {
+        int id = active_[i];
+        int slot = brickSlot_[id];
+        int x0 = id % nb_ * BRICK, y0 = id / nb_ % nb_ * BRICK, z0 = id / (nb_ * nb_) * BRICK;
+        double sum = 0.0;
+        for (int z = z0; z < z0 + BRICK; z++)
+            for (int y = y0; y < y0 + BRICK; y++)
+                for (int x = x0; x < x0 + BRICK; x++) sum += fn(slot, x, y, z);
+        partial_[i] = sum;
+    });
+    double total = 0.0;
+    for (double s : partial_) total += s;
+    return total;
+}
+
+float FluidSolver::at(int ch, int x, int y, int z) const {
+    if ((unsigned)x >= (unsigned)n_ || (unsigned)y >= (unsigned)n_ || (unsigned)z >= (unsigned)n_) return 0.0f;
+    int slot = brickSlot_[brickId(x / BRICK, y / BRICK, z / BRICK)];
+    return slot < 0 ? 0.0f : ch_[ch][(size_t)slot * BRICK_CELLS + local(x, y, z)];
+}
+
+// Sum of the six face neighbours; stays inside the brick when it can
+float FluidSolver::neighborSum(int ch, int slot, int x, int y, int z) const {
+    int lx = x & (BRICK - 1), ly = y & (BRICK - 1), lz = z & (BRICK - 1);
+    if (lx > 0 && lx < BRICK - 1 && ly > 0 && ly < BRICK - 1 && lz > 0 && lz < BRICK - 1) {
+        const float* c = &ch_[ch][(size_t)slot * BRICK_CELLS + local(x, y, z)];
+        return c[-1] + c[1] + c[-BRICK] + c[BRICK] + c[-BRICK * BRICK] + c[BRICK * BRICK];
+    }
+    return at(ch, x - 1, y, z) + at(ch, x + 1, y, z) + at(ch, x, y - 1, z) +
+           at(ch, x, y + 1, z) + at(ch, x, y, z - 1) + at(ch, x, y, z + 1);
+}
+
+// Trilinear in grid space, cell centres at integer coordinates
+float FluidSolver::sampleGrid(int ch, float gx, float gy, float gz) const {
+    float fx = floorf(gx), fy = floorf(gy), fz = floorf(gz);
+    int x = (int)fx, y = (int)fy, z = (int)fz;
+    float tx = gx - fx, ty = gy - fy, tz = gz - fz;
+
+    float c[8];
+    constexpr int M = BRICK - 1;
+    bool sameBrick = (x & M) != M && (y & M) != M && (z & M) != M &&
+                     x >= 0 && y >= 0 && z >= 0 && x < n_ && y < n_ && z < n_;
+    if (sameBrick) {
+        int slot = brickSlot_[brickId(x / BRICK, y / BRICK, z / BRICK)];
+        if (slot < 0) return 0.0f;
+        const float* b = &ch_[ch][(size_t)slot * BRICK_CELLS + local(x, y, z)];
+        const int sy = BRICK, sz = BRICK * BRICK;
+        c[0] = b[0];       c[1] = b[1];
+        c[2] = b[sy];      c[3] = b[sy + 1];
+        c[4] = b[sz];      c[5] = b[sz + 1];
+        c[6] = b[sz + sy]; c[7] = b[sz + sy + 1];
+    } else {
+        for (int i = 0; i < 8; i++) c[i] = at(ch, x + (i & 1), y + (i >> 1 & 1), z + (i >> 2));
+    }
+    float x00 = mixf(c[0], c[1], tx), x10 = mixf(c[2], c[3], tx);
+    float x01 = mixf(c[4], c[5], tx), x11 = mixf(c[6], c[7], tx);
+    return mixf(mixf(x00, x10, ty), mixf(x01, x11, ty), tz);
+}
+
+float FluidSolver::sampleWorld(int ch, Vec3 p) const {
+    float inv = 1.0f / dx_;
+    return sampleGrid(ch, (p.x - min_.x) * inv - 0.5f, (p.y - min_.y) * inv - 0.5f, (p.z - min_.z) * inv - 0.5f);
+}
+
+/* =================== SPARSE ALLOCATION =================== */
+
+int FluidSolver::allocateBrick(int id) {
+    int slot;
+    if (!freeSlots_.empty()) {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+    } else {
+        slot = (int)(ch_[0].size() / BRICK_CELLS);
+        for (std::vector<float>& c : ch_) c.resize(c.size() + BRICK_CELLS);
+    }
+    for (std::vector<float>& c : ch_)
+        std::fill_n(c.begin() + (size_t)slot * BRICK_CELLS, BRICK_CELLS, 0.0f);
+    brickSlot_[id] = slot;
+    return slot;
+}
+
+void FluidSolver::activate(ThreadPool& pool) {
+    // Largest density/temperature in each allocated brick
+    std::vector<float> content(active_.size(), 0.0f);
+    pool.parallelFor(active_.size(), [&](size_t i) {
+        size_t base = (size_t)brickSlot_[active_[i]] * BRICK_CELLS;
+        float m = 0.0f;
+        for (int c = 0; c < BRICK_CELLS; c++) m = fmaxf(m, fmaxf(ch_[DENS][base + c], ch_[TEMP][base + c]));
+        content[i] = m;
+    });
+
+    std::vector<uint8_t> wanted(brickSlot_.size(), 0);
+    auto markAround = [&](int bx0, int by0, int bz0, int bx1, int by1, int bz1) {
+        for (int z = std::max(bz0, 0); z <= std::min(bz1, nb_ - 1); z++)
+            for (int y = std::max(by0, 0); y <= std::min(by1, nb_ - 1); y++)
+                for (int x = std::max(bx0, 0); x <= std::min(bx1, nb_ - 1); x++) wanted[brickId(x, y, z)] = 1;
+    };
+
+    // One-brick ring: gas moves less than a brick per step
+    for (size_t i = 0; i < active_.size(); i++) {
+        if (content[i] <= settings_.activeThreshold) continue;
+        int id = active_[i];
+        int bx = id % nb_, by = id / nb_ % nb_, bz = id / (nb_ * nb_);
+        markAround(bx - 1, by - 1, bz - 1, bx + 1, by + 1, bz + 1);
+    }
+
+    // Source bricks and their ring
+    float brickSize = dx_ * BRICK;
+    float r = settings_.sourceRadius;
+    markAround((int)floorf((-r - min_.x) / brickSize) - 1, (int)floorf((0.0f - min_.y) / brickSize) - 1,
+               (int)floorf((-r - min_.z) / brickSize) - 1, (int)floorf((r - min_.x) / brickSize) + 1,
+               (int)floorf((settings_.sourceHeight - min_.y) / brickSize) + 1, (int)floorf((r - min_.z) / brickSize) + 1);
+
+    active_.clear();
+    for (int id = 0; id < (int)brickSlot_.size(); id++) {
+        if (wanted[id]) {
+            if (brickSlot_[id] < 0) allocateBrick(id);
+            active_.push_back(id);
+        } else if (brickSlot_[id] >= 0) {
+            freeSlots_.push_back(brickSlot_[id]);
+            brickSlot_[id] = -1;
+        }
+    }
+}
+
+/* =================== SIMULATION STEP =================== */
+
+void FluidSolver::addSources() {
+    const FluidSettings& s = settings_;
+    int x0 = std::max(0, (int)floorf((-s.sourceRadius - min_.x) / dx_));
+    int x1 = std::min(n_ - 1, (int)floorf((s.sourceRadius - min_.x) / dx_));
+    int y0 = std::max(0, (int)floorf((0.0f - min_.y) / dx_));
+    int y1 = std::min(n_ - 1, (int)floorf((s.sourceHeight - min_.y) / dx_));
+    int z0 = std::max(0, (int)floorf((-s.sourceRadius - min_.z) / dx_));
+    int z1 = std::min(n_ - 1, (int)floorf((s.sourceRadius - min_.z) / dx_));
+
+    for (int z = z0; z <= z1; z++) {
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                Vec3 p = min_ + Vec3{x + 0.5f, y + 0.5f, z + 0.5f} * dx_;
+                float r = length2D(p.x, p.z);
+                if (r >= s.sourceRadius) continue;
+
+                // Soft-edged disc that flickers with the shader's noise
+                float falloff = smoothstepf(s.sourceRadius, s.sourceRadius * 0.5f, r);
+                float flicker = clampf(0.8f + 0.4f * noise3D({p.x * 6.0f, p.y * 6.0f - time_ * 4.0f, p.z * 6.0f + time_}),
+                                       0.0f, 1.0f);
+                float amount = falloff * flicker;
+
+                int slot = brickSlot_[brickId(x / BRICK, y / BRICK, z / BRICK)];
+                cell(TEMP, slot, x, y, z) = fmaxf(cell(TEMP, slot, x, y, z), amount);
+                cell(DENS, slot, x, y, z) = fmaxf(cell(DENS, slot, x, y, z), amount);
+                cell(V, slot, x, y, z) = fmaxf(cell(V, slot, x, y, z), s.sourceSpeed * falloff);
+            }
+        }
+    }
+}
+
+void FluidSolver::advect(float dt, ThreadPool& pool) {
+    const float k = dt / dx_;   // world velocity -> grid cells per step
+    const float cool = expf(-settings_.cooling * dt);
+    const float decay = expf(-settings_.densityDecay * dt);
+
+    forEachCell(pool, [&](int slot, int x, int y, int z) {
+        float u = cell(U, slot, x, y, z), v = cell(V, slot, x, y, z), w = cell(W, slot, x, y, z);
+
+        // Midpoint backtrace
+        float mx = x - 0.5f * k * u, my = y - 0.5f * k * v, mz = z - 0.5f * k * w;
+        float um = sampleGrid(U, mx, my, mz), vm = sampleGrid(V, mx, my, mz), wm = sampleGrid(W, mx, my, mz);
+        float bx = x - k * um, by = y - k * vm, bz = z - k * wm;
+
+        cell(U_NEXT, slot, x, y, z) = sampleGrid(U, bx, by, bz);
+        cell(V_NEXT, slot, x, y, z) = sampleGrid(V, bx, by, bz);
+        cell(W_NEXT, slot, x, y, z) = sampleGrid(W, bx, by, bz);
+        cell(DENS_NEXT, slot, x, y, z) = sampleGrid(DENS, bx, by, bz) * decay;
+        cell(TEMP_NEXT, slot, x, y, z) = sampleGrid(TEMP, bx, by, bz) * cool;
+    });
+
+    std::swap(ch_[U], ch_[U_NEXT]);
+    std::swap(ch_[V], ch_[V_NEXT]);
+    std::swap(ch_[W], ch_[W_NEXT]);
+    std::swap(ch_[DENS], ch_[DENS_NEXT]);
+    std::swap(ch_[TEMP], ch_[TEMP_NEXT]);
+}
+
+void FluidSolver::applyForces(float dt, ThreadPool& pool) {
+    const float h = 0.5f / dx_;   // central difference
+
+    // Vorticity omega = curl u
+    forEachCell(pool, [&](int slot, int x, int y, int z) {
+        float dw_dy = (at(W, x, y + 1, z) - at(W, x, y - 1, z)) * h;
+        float dv_dz = (at(V, x, y, z + 1) - at(V, x, y, z - 1)) * h;
+        float du_dz = (at(U, x, y, z + 1) - at(U, x, y, z - 1)) * h;
+        float dw_dx = (at(W, x + 1, y, z) - at(W, x - 1, y, z)) * h;
+        float dv_dx = (at(V, x + 1, y, z) - at(V, x - 1, y, z)) * h;
+        float du_dy = (at(U, x, y + 1, z) - at(U, x, y - 1, z)) * h;
+        Vec3 omega = {dw_dy - dv_dz, du_dz - dw_dx, dv_dx - du_dy};
+        cell(OMEGA_X, slot, x, y, z) = omega.x;
+        cell(OMEGA_Y, slot, x, y, z) = omega.y;
+        cell(OMEGA_Z, slot, x, y, z) = omega.z;
+        cell(OMEGA_LEN, slot, x, y, z) = length(omega);
+    });
+
+    // Confinement f = eps dx (N x omega), N = grad|omega| / |grad|omega||,
+    // plus Boussinesq buoyancy along +y
+    const float eps = settings_.vorticity * dx_;
+    forEachCell(pool, [&](int slot, int x, int y, int z) {
+        Vec3 g = {at(OMEGA_LEN, x + 1, y, z) - at(OMEGA_LEN, x - 1, y, z),
+                  at(OMEGA_LEN, x, y + 1, z) - at(OMEGA_LEN, x, y - 1, z),
+                  at(OMEGA_LEN, x, y, z + 1) - at(OMEGA_LEN, x, y, z - 1)};
+        Vec3 f = {0.0f, 0.0f, 0.0f};
+        float gl = length(g);
+        if (gl > 1e-6f) {
+            Vec3 omega = {cell(OMEGA_X, slot, x, y, z), cell(OMEGA_Y, slot, x, y, z), cell(OMEGA_Z, slot, x, y, z)};
+            f = cross(g * (1.0f / gl), omega) * eps;
+        }
+        f.y += settings_.buoyancy * cell(TEMP, slot, x, y, z) - settings_.weight * cell(DENS, slot, x, y, z);
+
+        cell(U, slot, x, y, z) += f.x * dt;
+        cell(V, slot, x, y, z) += f.y * dt;
+        cell(W, slot, x, y, z) += f.z * dt;
+    });
+}
+
+// dst = A src, A = 6 I - (face neighbours) = -dx^2 Lap with p = 0 outside
+void FluidSolver::applyA(int src, int dst, ThreadPool& pool) {
+    forEachCell(pool, [&](int slot, int x, int y, int z) {
+        cell(dst, slot, x, y, z) = 6.0f * cell(src, slot, x, y, z) - neighborSum(src, slot, x, y, z);
+    });
+}
+
+// PRE = M^-1 RES for the symmetric Gauss-Seidel preconditioner in red-black
+// order from zero: red, black, red (the backward black sweep is a no-op).
+// Each sweep only reads the other colour, so bricks update in parallel.
+void FluidSolver::precondition(ThreadPool& pool) {
+    auto sweep = [&](int parity, bool first) {
+        forEachCell(pool, [&](int slot, int x, int y, int z) {
+            if (((x + y + z) & 1) != parity) return;
+            float nb = first ? 0.0f : neighborSum(PRE, slot, x, y, z);
+            cell(PRE, slot, x, y, z) = (cell(RES, slot, x, y, z) + nb) * (1.0f / 6.0f);
+        });
+    };
+    sweep(0, true);
+    sweep(1, false);
+    sweep(0, false);
+}
+
+void FluidSolver::project(ThreadPool& pool) {
+    const float h = 0.5f / dx_;
+
+    // b = -dx^2 div(u), so A p = b solves Lap(p) = div(u)
+    double bb = reduce(pool, [&](int slot, int x, int y, int z) {
+        float div = (at(U, x + 1, y, z) - at(U, x - 1, y, z) + at(V, x, y + 1, z) - at(V, x, y - 1, z) +
+                     at(W, x, y, z + 1) - at(W, x, y, z - 1)) * h;
+        float b = -div * dx_ * dx_;
+        cell(RHS, slot, x, y, z) = b;
+        return (double)b * b;
+    });
+
+    stats_.pressureIterations = 0;
+    stats_.pressureResidual = 0.0f;
+    if (bb > 1e-30) {
+        // Warm start from last step's pressure: r = b - A x
+        applyA(PRESS, AD, pool);
+        double rr = reduce(pool, [&](int slot, int x, int y, int z) {
+            float r = cell(RHS, slot, x, y, z) - cell(AD, slot, x, y, z);
+            cell(RES, slot, x, y, z) = r;
+            return (double)r * r;
+        });
+        precondition(pool);
+        double rz = reduce(pool, [&](int slot, int x, int y, int z) {
+            cell(DIR, slot, x, y, z) = cell(PRE, slot, x, y, z);
+            return (double)cell(RES, slot, x, y, z) * cell(PRE, slot, x, y, z);
+        });
+
+        const double tol2 = (double)settings_.pressureTolerance * settings_.pressureTolerance * bb;
+        int it = 0;
+        for (; it < settings_.pressureIterations && rr > tol2; it++) {
+            applyA(DIR, AD, pool);
+            double dAd = reduce(pool, [&](int slot, int x, int y, int z) {
+                return (double)cell(DIR, slot, x, y, z) * cell(AD, slot, x, y, z);
+            });
+            if (dAd <= 0.0) break;
+            float alpha = (float)(rz / dAd);
+            rr = reduce(pool, [&](int slot, int x, int y, int z) {
+                cell(PRESS, slot, x, y, z) += alpha * cell(DIR, slot, x, y, z);
+                float r = cell(RES, slot, x, y, z) -= alpha * cell(AD, slot, x, y, z);
+                return (double)r * r;
+            });
+            if (rr <= tol2) { it++; break; }
+
+            precondition(pool);
+            double rzNew = reduce(pool, [&](int slot, int x, int y, int z) {
+                return (double)cell(RES, slot, x, y, z) * cell(PRE, slot, x, y, z);
+            });
+            float beta = (float)(rzNew / rz);
+            rz = rzNew;
+            forEachCell(pool, [&](int slot, int x, int y, int z) {
+                cell(DIR, slot, x, y, z) = cell(PRE, slot, x, y, z) + beta * cell(DIR, slot, x, y, z);
+            });
+        }
+        stats_.pressureIterations = it;
+        stats_.pressureResidual = (float)std::sqrt(rr / bb);
+    }
+
+    // u -= grad p; reads only PRESS, so velocity updates in place
+    forEachCell(pool, [&](int slot, int x, int y, int z) {
+        cell(U, slot, x, y, z) -= (at(PRESS, x + 1, y, z) - at(PRESS, x - 1, y, z)) * h;
+        cell(V, slot, x, y, z) -= (at(PRESS, x, y + 1, z) - at(PRESS, x, y - 1, z)) * h;
+        cell(W, slot, x, y, z) -= (at(PRESS, x, y, z + 1) - at(PRESS, x, y, z - 1)) * h;
+    });
+}
+
+void FluidSolver::step(float dt, ThreadPool& pool) {
+    PROFILE_SCOPE("fluid step");
+    auto start = std::chrono::steady_clock::now();
+
+    activate(pool);
+    addSources();
+    {
+        PROFILE_SCOPE("fluid advect");
+        advect(dt, pool);
+    }
+    {
+        PROFILE_SCOPE("fluid forces");
+        applyForces(dt, pool);
+    }
+    {
+        PROFILE_SCOPE("fluid project");
+        project(pool);
+    }
+
+    time_ += dt;
+    stats_.activeBricks = active_.size();
+    stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
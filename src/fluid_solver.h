@@ -0,0 +1,140 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "math_utils.h"
+
+class ThreadPool;
+
+/* =================== SPARSE-BRICK FLUID SOLVER =================== */
+// Eulerian Boussinesq smoke/fire solver (Stam-style stable fluids) over the
+// bounding sphere's cube, stored in BRICK^3 bricks that are only allocated
+// where the flame is:
+//
+//   1. activate  keep bricks holding density/temperature, plus a one-brick
+//                ring around them and the source, free everything else
+//   2. sources   inject hot gas in a flickering disc at the flame base
+//   3. advect    semi-Lagrangian (midpoint backtrace, trilinear) for
+//                velocity, density and temperature; cooling and decay
+//   4. forces    Boussinesq buoyancy (beta T - alpha d) and vorticity
+//                confinement
+//   5. project   solve Lap(p) = div(u) with preconditioned CG (red-black
+//                symmetric Gauss-Seidel), then u -= grad(p)
+//
+// All fields are cell-centred. Unallocated bricks and the domain edge read
+// as zero: ambient, still air with an open (p = 0) boundary. Every pass
+// runs in parallel over the active bricks.
+//
+// Units: positions in flame_field coordinates, temperature normalized so
+// the source is 1 (ambient 0), density in [0, 1].
+
+struct FluidSettings {
+    int   cellsPerAxis = 64;        // over the bounding-sphere cube, rounded up to BRICK
+    float buoyancy = 6.0f;          // beta: upward acceleration per unit temperature
+    float weight = 0.5f;            // alpha: downward acceleration per unit density
+    float vorticity = 2.0f;         // confinement strength (epsilon)
+    float cooling = 1.2f;           // T *= exp(-cooling dt)
+    float densityDecay = 0.7f;      // d *= exp(-decay dt)
+    float sourceRadius = 0.12f;     // FLAME_BASE_WIDTH
+    float sourceHeight = 0.12f;
+    float sourceSpeed = 1.0f;       // upward velocity of injected gas
+    int   pressureIterations = 40;  // PCG iteration cap
+    float pressureTolerance = 1e-4f;// relative residual to stop at
+    float activeThreshold = 2e-3f;  // density/temperature that keeps a brick
+};
+
+// Counters for the last step()
+struct FluidStepStats {
+    size_t activeBricks = 0;
+    int    pressureIterations = 0;
+    float  pressureResidual = 0.0f;  // relative, at exit
+    double seconds = 0.0;
+};
+
+class FluidSolver {
+public:
+    static constexpr int BRICK = 8;
+
+    explicit FluidSolver(const FluidSettings& settings = {});
+
+    void step(float dt, ThreadPool& pool);
+
+    const FluidSettings& settings() const { return settings_; }
+    const FluidStepStats& lastStep() const { return stats_; }
+    float time() const { return time_; }
+    int cellsPerAxis() const { return n_; }
+    size_t activeBricks() const { return active_.size(); }
+    size_t totalBricks() const { return brickSlot_.size(); }
+    size_t memoryBytes() const;
+    Vec3 gridMin() const { return min_; }
+    float cellSize() const { return dx_; }
+
+    // Copy one brick's density and temperature ([z][y][x] within the brick,
+    // brick id (bz * nb + by) * nb + bx); false if it is not allocated
+    bool exportBrick(int brickId, float* density, float* temperature) const;
+
+    // Trilinear samples at a world position, 0 outside the active bricks
+    float density(Vec3 p) const { return sampleWorld(DENS, p); }
+    float temperature(Vec3 p) const { return sampleWorld(TEMP, p); }
+
+private:
+    // Channels per brick. The pressure solve and vorticity confinement never
+    // overlap, so the vorticity pass borrows the CG vectors.
+    enum Channel {
+        U, V, W, DENS, TEMP,                              // state
+        U_NEXT, V_NEXT, W_NEXT, DENS_NEXT, TEMP_NEXT,     // advection targets
+        PRESS, RHS, RES, PRE, DIR, AD,                    // CG: x, b, r, z, d, A*d
+        CHANNEL_COUNT,
+        OMEGA_X = RES, OMEGA_Y = PRE, OMEGA_Z = DIR, OMEGA_LEN = AD,
+    };
+    static constexpr int BRICK_CELLS = BRICK * BRICK * BRICK;
+
+    template <class Fn> void forEachCell(ThreadPool& pool, Fn&& fn);
+    template <class Fn> double reduce(ThreadPool& pool, Fn&& fn);
+
+    void activate(ThreadPool& pool);
+    void addSources();
+    void advect(float dt, ThreadPool& pool);
+    void applyForces(float dt, ThreadPool& pool);
+    void project(ThreadPool& pool);
+    void applyA(int src, int dst, ThreadPool& pool);
+    void precondition(ThreadPool& pool);
+
+    int  brickId(int bx, int by, int bz) const { return (bz * nb_ + by) * nb_ + bx; }
+    int  allocateBrick(int id);
+    float at(int ch, int x, int y, int z) const;
+    float neighborSum(int ch, int slot, int x, int y, int z) const;
+    float sampleGrid(int ch, float gx, float gy, float gz) const;
+    float sampleWorld(int ch, Vec3 p) const;
+    // Index inside a brick for global cell coordinates
+    static int local(int x, int y, int z) {
+        constexpr int M = BRICK - 1;
+        return ((z & M) * BRICK + (y & M)) * BRICK + (x & M);
+    }
+    float& cell(int ch, int slot, int x, int y, int z) {
+        return ch_[ch][(size_t)slot * BRICK_CELLS + local(x, y, z)];
+    }
+
+    FluidSettings settings_;
+    FluidStepStats stats_;
+    float time_ = 0.0f;
+
+    int n_ = 0, nb_ = 0;          // cells / bricks per axis
+    Vec3 min_ = {0, 0, 0};
+    float dx_ = 0.0f;
+
+    std::vector<int32_t> brickSlot_;     // brick id -> storage slot, -1 = unallocated
+    std::vector<int32_t> active_;        // allocated brick ids, ascending
+    std::vector<int32_t> freeSlots_;
+    std::vector<float> ch_[CHANNEL_COUNT];
+    std::vector<double> partial_;        // per-brick reduction results
+};
+
+// Field policy for marchFlame() that reads the solver's current state
+struct FluidField {
+    const FluidSolver* solver;
+    float formation;
+
+    float density(Vec3 p) const { return solver->density(p) * formation; }
+    float temperature(Vec3 p, float) const { return clampf(solver->temperature(p), 0.0f, 1.0f); }
+};
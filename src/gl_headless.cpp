@@ -0,0 +1,152 @@
+#include "gl_headless.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifdef FLAME_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/* =================== EGL CONTEXT =================== */
+
+#ifdef FLAME_HAVE_EGL
+static bool hasExtension(const char* list, const char* name) {
+    if (!list) return false;
+    size_t n = std::strlen(name);
+    for (const char* p = std::strstr(list, name); p; p = std::strstr(p + n, name))
+        if ((p == list || p[-1] == ' ') && (p[n] == ' ' || p[n] == '\0')) return true;
+    return false;
+}
+
+bool createEglContext(EglContext& ctx, int major, int minor) {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint eglMajor = 0, eglMinor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor)) {
+        std::cerr << "[EGL] No display" << std::endl;
+        return false;
+    }
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!hasExtension(extensions, "EGL_KHR_surfaceless_context") || !eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "[EGL] Display cannot make a surfaceless desktop GL context" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    EGLConfig config = nullptr;   // EGL_NO_CONFIG_KHR
+    if (!hasExtension(extensions, "EGL_KHR_no_config_context")) {
+        const EGLint want[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLint count = 0;
+        if (!eglChooseConfig(display, want, &config, 1, &count) || count == 0) {
+            std::cerr << "[EGL] No desktop GL config" << std::endl;
+            eglTerminate(display);
+            return false;
+        }
+    }
+    const EGLint attribs[] = {EGL_CONTEXT_MAJOR_VERSION, major, EGL_CONTEXT_MINOR_VERSION, minor,
+                              EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, attribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cerr << "[EGL] Cannot create an OpenGL " << major << "." << minor << " core context" << std::endl;
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cerr << "[EGL] Failed to load GL functions" << std::endl;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+    ctx.display = display;
+    ctx.context = context;
+    return true;
+}
+
+void destroyEglContext(EglContext& ctx) {
+    if (!ctx.display) return;
+    eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(ctx.display, ctx.context);
+    eglTerminate(ctx.display);
+    ctx = EglContext{};
+}
+#endif
+
+/* =================== PIXEL BUFFER READBACK =================== */
+
+FrameReadback::FrameReadback(int width, int height, int depth) : width_(width), height_(height) {
+    const GLsizeiptr bytes = (GLsizeiptr)width * height * 4;
+    slots_.resize(depth > 0 ? (size_t)depth : 0);
+    for (Slot& s : slots_) {
+        glGenBuffers(1, &s.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (slots_.empty()) pixels_.resize((size_t)bytes);
+}
+
+FrameReadback::~FrameReadback() {
+    for (Slot& s : slots_) {
+        if (s.fence) glDeleteSync(s.fence);
+        glDeleteBuffers(1, &s.buffer);
+    }
+}
+
+void FrameReadback::read(GLuint fbo, int frame, const Deliver& deliver) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    if (slots_.empty()) {
+        auto t0 = std::chrono::steady_clock::now();
+        glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels_.data());
+        waitMs_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        deliver(frame, pixels_.data());
+        return;
+    }
+
+    if (pending_ == depth()) deliverOldest(deliver);
+    Slot& s = slots_[(size_t)next_];
+    auto t0 = std::chrono::steady_clock::now();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);   // into the buffer, no wait
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.frame = frame;
+    glFlush();   // the fence must reach the GPU before anyone waits on it
+    waitMs_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    next_ = (next_ + 1) % depth();
+    pending_++;
+}
+
+void FrameReadback::finish(const Deliver& deliver) {
+    while (pending_ > 0) deliverOldest(deliver);
+}
+
+void FrameReadback::deliverOldest(const Deliver& deliver) {
+    Slot& s = slots_[(size_t)((next_ - pending_ + depth()) % depth())];
+    auto t0 = std::chrono::steady_clock::now();
+    while (glClientWaitSync(s.fence, 0, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(s.fence);
+    s.fence = nullptr;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+    const void* px = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width_ * height_ * 4, GL_MAP_READ_BIT);
+    waitMs_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (px) {
+        deliver(s.frame, (const uint8_t*)px);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        std::cerr << "[Readback] Cannot map the buffer of frame " << s.frame << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pending_--;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/* =================== HEADLESS GL =================== */
+// Sandbox without a window: a GL context with no surface (EGL, when built
+// with it) renders into framebuffer objects, and frames come back through
+// a ring of pixel pack buffers. Each frame's glReadPixels goes into the
+// next buffer with a fence behind it and returns at once; the buffer is
+// mapped depth - 1 frames later, by when the GPU has finished it, so
+// reading frame N overlaps rendering the frames after it instead of
+// stalling the pipeline the way a plain glReadPixels does.
+
+#ifdef FLAME_HAVE_EGL
+struct EglContext {
+    void* display = nullptr;   // EGLDisplay
+    void* context = nullptr;   // EGLContext
+};
+
+// A surfaceless core-profile context (EGL_MESA_platform_surfaceless, else
+// the default display with EGL_KHR_surfaceless_context), made current and
+// loaded through glad. Works with no display server, e.g. Mesa llvmpipe
+bool createEglContext(EglContext& ctx, int major, int minor);
+void destroyEglContext(EglContext& ctx);
+#endif
+
+// Readback of RGBA8 frames, bottom row first (GL order)
+class FrameReadback {
+public:
+    using Deliver = std::function<void(int frame, const uint8_t* rgba)>;
+
+    // depth pixel buffers in flight; 0 reads synchronously with glReadPixels.
+    // Needs a current context
+    FrameReadback(int width, int height, int depth);
+    ~FrameReadback();
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    // Start reading colour attachment 0 of fbo as frame. If the ring is full
+    // the oldest frame is finished first and passed to deliver
+    void read(GLuint fbo, int frame, const Deliver& deliver);
+
+    // Deliver every frame still in flight, oldest first
+    void finish(const Deliver& deliver);
+
+    int depth() const { return (int)slots_.size(); }
+    double waitMs() const { return waitMs_; }   // spent in readback calls: reads, flushes, fences, mapping
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        int frame = -1;
+    };
+    void deliverOldest(const Deliver& deliver);
+
+    int width_, height_;
+    std::vector<Slot> slots_;
+    int next_ = 0, pending_ = 0;
+    std::vector<uint8_t> pixels_;   // synchronous reads
+    double waitMs_ = 0.0;
+};
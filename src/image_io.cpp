@@ -0,0 +1,66 @@
+#include "image_io.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <memory>
+#include "cpu_renderer.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_HDR
+#include <stb_image.h>
+
+std::vector<uint8_t> toRGB8(const Image& img) {
+    std::vector<uint8_t> out(img.rgb.size());
+    for (size_t i = 0; i < img.rgb.size(); i++) {
+        float v = std::clamp(img.rgb[i], 0.0f, 1.0f);
+        out[i] = (uint8_t)(v * 255.0f + 0.5f);
+    }
+    return out;
+}
+
+static bool endsWith(const std::string& s, const char* suffix) {
+    std::string suf(suffix);
+    if (s.size() < suf.size()) return false;
+    return std::equal(suf.rbegin(), suf.rend(), s.rbegin(),
+                      [](char a, char b) { return a == std::tolower((unsigned char)b); });
+}
+
+bool writeImage(const std::string& path, const Image& img) {
+    std::vector<uint8_t> px = toRGB8(img);
+    const char* p = path.c_str();
+    int w = img.width, h = img.height;
+
+    if (endsWith(path, ".bmp")) return stbi_write_bmp(p, w, h, 3, px.data()) != 0;
+    if (endsWith(path, ".tga")) return stbi_write_tga(p, w, h, 3, px.data()) != 0;
+    if (endsWith(path, ".jpg") || endsWith(path, ".jpeg"))
+        return stbi_write_jpg(p, w, h, 3, px.data(), 95) != 0;
+    return stbi_write_png(p, w, h, 3, px.data(), w * 3) != 0;
+}
+
+bool readImage(const std::string& path, Image& img) {
+    int w, h, channels;
+    std::unique_ptr<stbi_uc, void (*)(void*)> px(stbi_load(path.c_str(), &w, &h, &channels, 3), &stbi_image_free);
+    if (!px) return false;
+    img.resize(w, h);
+    for (size_t i = 0; i < img.rgb.size(); i++) img.rgb[i] = px.get()[i] / 255.0f;
+    return true;
+}
+
+bool writePFM(const std::string& path, const Image& img) {
+    std::unique_ptr<FILE, int (*)(FILE*)> f(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if (!f) return false;
+
+    // Negative scale marks little-endian data
+    const uint16_t probe = 1;
+    bool little = *(const uint8_t*)&probe == 1;
+    std::fprintf(f.get(), "PF\n%d %d\n%s\n", img.width, img.height, little ? "-1.0" : "1.0");
+
+    size_t rowFloats = (size_t)img.width * 3;
+    for (int y = img.height - 1; y >= 0; y--) {
+        if (std::fwrite(img.pixel(0, y), sizeof(float), rowFloats, f.get()) != rowFloats) return false;
+    }
+    return true;
+}
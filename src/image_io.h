@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Image;
+
+/* =================== IMAGE OUTPUT =================== */
+// Writes CPU renderer output through the vendored stb_image_write, and
+// reads 8-bit images back (golden images) through stb_image.
+
+// Quantize [0, 1] RGB floats to 8-bit RGB
+std::vector<uint8_t> toRGB8(const Image& img);
+
+// Format is chosen by extension: .png (default), .bmp, .tga, .jpg
+bool writeImage(const std::string& path, const Image& img);
+
+// Portable Float Map (PFM): 32-bit float RGB, bottom row first, no quantization
+bool writePFM(const std::string& path, const Image& img);
+
+// 8-bit PNG / BMP / TGA / JPG into [0, 1] RGB floats (alpha dropped)
+bool readImage(const std::string& path, Image& img);
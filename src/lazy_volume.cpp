@@ -0,0 +1,300 @@
+#include "lazy_volume.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "profiler.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Bricks along an axis of n nodes (n - 1 cells)
+static int bricksAlong(int nodes) {
+    return (nodes - 1 + LazyVolume::BRICK - 1) / LazyVolume::BRICK;
+}
+
+// As VolumeCache::bake
+static BakeSettings clampedSettings(BakeSettings s) {
+    s.nx = std::max(s.nx, 2);
+    s.ny = std::max(s.ny, 2);
+    s.nz = std::max(s.nz, 2);
+    s.slices = std::max(s.slices, 1);
+    return s;
+}
+
+LazyVolume::LazyVolume(const BakeSettings& settings, size_t memoryBytes, int workers, const FlameParams& params)
+    : settings_(clampedSettings(settings)),
+      params_(params),
+      grid_(bakeGrid(settings_, params_)),
+      bricksX_(bricksAlong(settings_.nx)),
+      bricksY_(bricksAlong(settings_.ny)),
+      bricksZ_(bricksAlong(settings_.nz)),
+      totalBricks_((size_t)bricksX_ * bricksY_ * bricksZ_ * settings_.slices),
+      capacity_(std::min(std::max(memoryBytes / BRICK_BYTES, MIN_BRICKS), totalBricks_)),
+      queue_(totalBricks_) {
+    table_ = std::make_unique<std::atomic<int32_t>[]>(totalBricks_);
+    for (size_t i = 0; i < totalBricks_; i++) table_[i].store(EMPTY, std::memory_order_relaxed);
+    slots_ = std::make_unique<Slot[]>(capacity_);
+    data_ = std::make_unique_for_overwrite<uint16_t[]>(capacity_ * 2 * BRICK_NODES);
+    counters_ = std::make_unique<Counters[]>(COUNTER_SHARDS);
+    touched_.assign(totalBricks_, 0);
+
+    if (workers <= 0) workers = (int)std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < workers; i++) workers_.emplace_back([this] { workerLoop(); });
+}
+
+LazyVolume::~LazyVolume() {
+    queue_.close();
+    for (std::thread& t : workers_) t.join();
+}
+
+LazyVolumeStats LazyVolume::stats() const {
+    LazyVolumeStats s;
+    for (int i = 0; i < COUNTER_SHARDS; i++) {
+        const Counters& c = counters_[i];
+        s.lookups += c.lookups.load(std::memory_order_relaxed);
+        s.hits += c.hits.load(std::memory_order_relaxed);
+        s.misses += c.misses.load(std::memory_order_relaxed);
+        s.coalesced += c.coalesced.load(std::memory_order_relaxed);
+        s.retries += c.retries.load(std::memory_order_relaxed);
+        s.stallMs += c.stallNs.load(std::memory_order_relaxed) * 1e-6;
+    }
+    s.fills = fills_.load();
+    s.evictions = evictions_.load();
+    s.dropped = dropped_.load();
+    s.fillMs = fillNs_.load() * 1e-6;
+    s.touchedBricks = touchedCount_.load();
+    s.residentBricks = (size_t)(s.fills - s.evictions - s.dropped);
+    s.capacityBricks = capacity_;
+    s.totalBricks = totalBricks_;
+    s.memoryBytes = s.residentBricks * BRICK_BYTES + totalBricks_ * sizeof(int32_t);
+    s.budgetBytes = capacity_ * BRICK_BYTES + totalBricks_ * sizeof(int32_t);
+    s.fullBakeBytes = (size_t)settings_.nx * settings_.ny * settings_.nz * settings_.slices * 2 * sizeof(uint16_t);
+    return s;
+}
+
+void LazyVolume::reset(const FlameParams& params) {
+    std::lock_guard<std::mutex> lock(slotMutex_);
+    params_ = params;
+    grid_ = bakeGrid(settings_, params_);
+    for (size_t i = 0; i < totalBricks_; i++) table_[i].store(EMPTY, std::memory_order_relaxed);
+    for (size_t i = 0; i < used_; i++) {
+        slots_[i].brick.store(-1, std::memory_order_relaxed);
+        slots_[i].referenced.store(0, std::memory_order_relaxed);
+    }
+    dropped_.fetch_add(fills_.load() - evictions_.load() - dropped_.load(), std::memory_order_relaxed);
+    used_ = hand_ = 0;
+}
+
+/* =================== SAMPLING =================== */
+
+LazyVolume::Counters& LazyVolume::counters() const {
+    static std::atomic<unsigned> nextShard{0};
+    thread_local unsigned shard = nextShard.fetch_add(1, std::memory_order_relaxed) % COUNTER_SHARDS;
+    return counters_[shard];
+}
+
+// The brick's slot if resident; otherwise queues it unless another sample
+// already has, and returns -1
+int32_t LazyVolume::request(uint32_t brick, Counters& c) const {
+    c.lookups.fetch_add(1, std::memory_order_relaxed);
+    int32_t s = table_[brick].load(std::memory_order_acquire);
+    if (s == EMPTY) {
+        if (table_[brick].compare_exchange_strong(s, PENDING, std::memory_order_acq_rel)) {
+            c.misses.fetch_add(1, std::memory_order_relaxed);
+            queue_.push(brick);
+            return -1;
+        }
+        // Lost the race: s is now whoever won's PENDING (or the filled slot)
+    }
+    if (s >= 0) {
+        c.hits.fetch_add(1, std::memory_order_relaxed);
+        return s;
+    }
+    c.coalesced.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+}
+
+int32_t LazyVolume::wait(uint32_t brick, Counters& c) const {
+    auto t0 = Clock::now();
+    int32_t s;
+    for (;;) {
+        s = table_[brick].load(std::memory_order_acquire);
+        if (s >= 0) break;
+        if (s == EMPTY) {
+            // Filled and already evicted again: queue it anew
+            s = request(brick, c);
+            if (s >= 0) break;
+            continue;
+        }
+        table_[brick].wait(PENDING, std::memory_order_acquire);
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+    c.stallNs.fetch_add((uint64_t)ns, std::memory_order_relaxed);
+    return s;
+}
+
+// The eight corners of the cell at node of the slot's channel, in
+// VolumeCache::sampleChannel's order; false if the slot no longer holds
+// brick or was rewritten during the reads
+bool LazyVolume::read(int32_t slot, uint32_t brick, int channel, int node, uint16_t out[8]) const {
+    constexpr int SX = 1, SY = BRICK + 1, SZ = (BRICK + 1) * (BRICK + 1);
+    Slot& s = slots_[slot];
+    uint32_t seq = s.sequence.load(std::memory_order_acquire);
+    if ((seq & 1) || s.brick.load(std::memory_order_relaxed) != (int64_t)brick) return false;
+
+    uint16_t* c = &data_[((size_t)slot * 2 + channel) * BRICK_NODES + node];
+    auto load = [&](int i) { return std::atomic_ref<uint16_t>(c[i]).load(std::memory_order_relaxed); };
+    out[0] = load(0);
+    out[1] = load(SX);
+    out[2] = load(SY);
+    out[3] = load(SY + SX);
+    out[4] = load(SZ);
+    out[5] = load(SZ + SX);
+    out[6] = load(SZ + SY);
+    out[7] = load(SZ + SY + SX);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.sequence.load(std::memory_order_relaxed) != seq) return false;
+
+    // Only write the bit when it changes, so hits stay read-only
+    if (!s.referenced.load(std::memory_order_relaxed)) s.referenced.store(1, std::memory_order_relaxed);
+    return true;
+}
+
+// VolumeCache::locate and sampleChannel on bricks; channel 0 is density
+float LazyVolume::sample(int channel, Vec3 p, float time) const {
+    const int nx = settings_.nx, ny = settings_.ny, nz = settings_.nz;
+    float gx = (p.x - grid_.boundsMin.x) * grid_.invCell.x;
+    float gy = (p.y - grid_.boundsMin.y) * grid_.invCell.y;
+    float gz = (p.z - grid_.boundsMin.z) * grid_.invCell.z;
+    if (!(gx >= 0.0f && gy >= 0.0f && gz >= 0.0f && gx <= nx - 1 && gy <= ny - 1 && gz <= nz - 1))
+        return -1.0f;  // outside the support
+
+    int ix = std::min((int)gx, nx - 2), iy = std::min((int)gy, ny - 2), iz = std::min((int)gz, nz - 2);
+    float fx = gx - ix, fy = gy - iy, fz = gz - iz;
+
+    float tm = fmodf(time, settings_.period);
+    if (tm < 0.0f) tm += settings_.period;
+    float ts = tm / settings_.period * settings_.slices;
+    int s0 = std::min((int)ts, settings_.slices - 1);
+    int s1 = (s0 + 1) % settings_.slices;
+    float ft = ts - (float)s0;
+
+    int bx = ix / BRICK, by = iy / BRICK, bz = iz / BRICK;
+    int node = ((iz - bz * BRICK) * (BRICK + 1) + (iy - by * BRICK)) * (BRICK + 1) + (ix - bx * BRICK);
+    uint32_t perSlice = (uint32_t)bricksX_ * bricksY_ * bricksZ_;
+    uint32_t spatial = ((uint32_t)bz * bricksY_ + by) * bricksX_ + bx;
+    uint32_t id0 = s0 * perSlice + spatial, id1 = s1 * perSlice + spatial;
+
+    // Queue both slices' bricks before waiting on either
+    Counters& c = counters();
+    uint16_t v0[8], v1[8];
+    for (;;) {
+        int32_t a = request(id0, c);
+        int32_t b = id1 == id0 ? a : request(id1, c);
+        if (a < 0) a = wait(id0, c);
+        if (b < 0) b = wait(id1, c);
+        if (read(a, id0, channel, node, v0) && read(b, id1, channel, node, v1)) break;
+        c.retries.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto trilinear = [&](const uint16_t* v) {
+        float x00 = mixf(v[0], v[1], fx);
+        float x10 = mixf(v[2], v[3], fx);
+        float x01 = mixf(v[4], v[5], fx);
+        float x11 = mixf(v[6], v[7], fx);
+        return mixf(mixf(x00, x10, fy), mixf(x01, x11, fy), fz);
+    };
+    return mixf(trilinear(v0), trilinear(v1), ft);
+}
+
+float LazyVolume::density(Vec3 p, float time, float formation) const {
+    float q = sample(0, p, time);
+    if (q < 0.0f) return 0.0f;
+    return bakedDensity(q) * formation;
+}
+
+float LazyVolume::temperatureFactor(Vec3 p, float time) const {
+    float q = sample(1, p, time);
+    if (q < 0.0f) return 0.0f;
+    return bakedTemperatureFactor(q);
+}
+
+/* =================== WORKERS =================== */
+
+void LazyVolume::workerLoop() {
+    profilerSetThreadName("brick worker");
+    std::vector<uint16_t> nodes(2 * BRICK_NODES);
+    while (std::optional<uint32_t> brick = queue_.pop()) {
+        auto t0 = Clock::now();
+        fill(*brick, nodes.data());
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        fillNs_.fetch_add((uint64_t)ns, std::memory_order_relaxed);
+        publish(*brick, nodes.data());
+    }
+}
+
+// The brick's nodes through bakeNode; nodes past the grid's far faces (in
+// the last brick along an axis) are never read and left zero
+void LazyVolume::fill(uint32_t brick, uint16_t* nodes) const {
+    PROFILE_SCOPE("brick fill");
+    uint32_t perSlice = (uint32_t)bricksX_ * bricksY_ * bricksZ_;
+    int slice = (int)(brick / perSlice);
+    uint32_t rest = brick % perSlice;
+    int x0 = (int)(rest % bricksX_) * BRICK;
+    int y0 = (int)(rest / bricksX_ % bricksY_) * BRICK;
+    int z0 = (int)(rest / ((uint32_t)bricksX_ * bricksY_)) * BRICK;
+
+    int i = 0;
+    for (int z = z0; z <= z0 + BRICK; z++)
+        for (int y = y0; y <= y0 + BRICK; y++)
+            for (int x = x0; x <= x0 + BRICK; x++, i++) {
+                if (x < settings_.nx && y < settings_.ny && z < settings_.nz) {
+                    bakeNode(settings_, grid_, x, y, z, slice, nodes[i], nodes[BRICK_NODES + i], params_);
+                } else {
+                    nodes[i] = nodes[BRICK_NODES + i] = 0;
+                }
+            }
+}
+
+void LazyVolume::publish(uint32_t brick, const uint16_t* nodes) {
+    std::lock_guard<std::mutex> lock(slotMutex_);
+
+    // A free slot while there are any, then CLOCK: the hand clears set
+    // referenced bits and takes the first slot whose bit was already clear
+    size_t slot;
+    if (used_ < capacity_) {
+        slot = used_++;
+    } else {
+        for (;;) {
+            slot = hand_;
+            hand_ = (hand_ + 1) % capacity_;
+            if (!slots_[slot].referenced.exchange(0, std::memory_order_relaxed)) break;
+        }
+    }
+
+    Slot& s = slots_[slot];
+    int64_t old = s.brick.load(std::memory_order_relaxed);
+    if (old >= 0) {
+        table_[old].store(EMPTY, std::memory_order_release);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t seq = s.sequence.load(std::memory_order_relaxed);
+    s.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    uint16_t* d = &data_[slot * 2 * BRICK_NODES];
+    for (int i = 0; i < 2 * BRICK_NODES; i++)
+        std::atomic_ref<uint16_t>(d[i]).store(nodes[i], std::memory_order_relaxed);
+    s.brick.store(brick, std::memory_order_relaxed);
+    s.sequence.store(seq + 2, std::memory_order_release);
+    s.referenced.store(1, std::memory_order_relaxed);   // a second chance before its first hit
+
+    table_[brick].store((int32_t)slot, std::memory_order_release);
+    table_[brick].notify_all();
+
+    fills_.fetch_add(1, std::memory_order_relaxed);
+    if (!touched_[brick]) {
+        touched_[brick] = 1;
+        touchedCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+#include "volume_cache.h"
+
+/* =================== LAZY VOLUME =================== */
+// The baked volume of volume_cache.h, computed on demand. The grid of every
+// time slice is split into bricks of BRICK^3 cells; a brick's nodes are
+// evaluated the first time a sample lands in it and kept in a fixed number
+// of slots, so memory is bounded by the budget instead of the bake size and
+// regions no ray reaches (most of the support box outside the tongues, the
+// slices a short render never visits) are never computed. Nodes are the
+// bake's nodes through bakeNode(), so samples are bit-exact with a
+// VolumeCache baked with the same settings.
+//
+// Lookup is lock-free: a table indexed by brick id holds the brick's slot,
+// EMPTY or PENDING, and each slot carries a sequence counter that a reader
+// checks around its reads (a seqlock), so a slot reused under it is noticed
+// and the lookup retried. The first sample to find a brick EMPTY marks it
+// PENDING and queues it; samples arriving while it is PENDING wait on the
+// table entry instead of queueing it again (coalescing). Background workers
+// evaluate queued bricks and publish them, evicting with CLOCK (one
+// referenced bit per slot, set on hits), an approximation of LRU that keeps
+// hits free of shared writes.
+//
+// Bricks share their boundary nodes with their neighbours ((BRICK + 1)^3
+// nodes each) so a cell's eight corners are always in one brick; a fully
+// resident volume takes about 1.4x the bake's memory.
+//
+// reset() switches to another parameter block (flame_params.h) by dropping
+// every brick; the next samples fill them from the new block.
+
+struct LazyVolumeStats {
+    uint64_t lookups = 0;     // by samples, one per time slice read
+    uint64_t hits = 0;        // brick was resident
+    uint64_t misses = 0;      // sample queued the brick
+    uint64_t coalesced = 0;   // brick was already queued by another sample
+    uint64_t retries = 0;     // slot reused while being read
+    double stallMs = 0.0;     // time samples spent waiting for bricks, summed over threads
+    uint64_t fills = 0;       // bricks evaluated by the workers
+    uint64_t evictions = 0;
+    uint64_t dropped = 0;     // resident bricks dropped by reset()
+    double fillMs = 0.0;      // worker time evaluating bricks, summed
+    size_t touchedBricks = 0; // distinct bricks ever filled
+    size_t residentBricks = 0, capacityBricks = 0, totalBricks = 0;
+    size_t memoryBytes = 0;   // resident bricks and the lookup table
+    size_t budgetBytes = 0;   // every slot resident
+    size_t fullBakeBytes = 0; // a VolumeCache with the same settings
+
+    double hitRate() const { return lookups ? (double)hits / (double)lookups : 0.0; }
+};
+
+class LazyVolume {
+public:
+    static constexpr int BRICK = 8;   // cells per brick edge
+    static constexpr int BRICK_NODES = (BRICK + 1) * (BRICK + 1) * (BRICK + 1);
+    static constexpr size_t BRICK_BYTES = 2 * BRICK_NODES * sizeof(uint16_t);
+    // Enough that the few bricks a sample holds are not evicted under it by
+    // every other thread's fills
+    static constexpr size_t MIN_BRICKS = 64;
+
+    // Slots for memoryBytes of bricks (at least MIN_BRICKS, at most every
+    // brick); workers = 0 starts one per core. Bricks are bakeNode()s of
+    // params, the compiled flame by default
+    LazyVolume(const BakeSettings& settings, size_t memoryBytes, int workers = 0, const FlameParams& params = {});
+    ~LazyVolume();
+    LazyVolume(const LazyVolume&) = delete;
+    LazyVolume& operator=(const LazyVolume&) = delete;
+
+    const BakeSettings& settings() const { return settings_; }
+    const FlameParams& params() const { return params_; }
+    LazyVolumeStats stats() const;
+
+    // Drop every brick and fill later ones from params. Not while samples
+    // run: between frames, every brick a sample queued has been published
+    void reset(const FlameParams& params);
+
+    // As VolumeCache; blocks while the bricks are filled. Thread-safe
+    float density(Vec3 p, float time, float formation) const;
+    float temperatureFactor(Vec3 p, float time) const;
+
+private:
+    static constexpr int32_t EMPTY = -1;
+    static constexpr int32_t PENDING = -2;
+
+    struct Slot {
+        std::atomic<uint32_t> sequence{0};   // odd while being written
+        std::atomic<int64_t> brick{-1};
+        std::atomic<uint8_t> referenced{0};
+    };
+
+    // Per-thread sample counters, sharded so hits do not share a cache line
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> lookups{0}, hits{0}, misses{0}, coalesced{0}, retries{0}, stallNs{0};
+    };
+    static constexpr int COUNTER_SHARDS = 64;
+
+    float sample(int channel, Vec3 p, float time) const;
+    int32_t request(uint32_t brick, Counters& c) const;
+    int32_t wait(uint32_t brick, Counters& c) const;
+    bool read(int32_t slot, uint32_t brick, int channel, int node, uint16_t out[8]) const;
+    Counters& counters() const;
+
+    void workerLoop();
+    void fill(uint32_t brick, uint16_t* nodes) const;
+    void publish(uint32_t brick, const uint16_t* nodes);
+
+    BakeSettings settings_;
+    FlameParams params_;
+    BakeGrid grid_;
+    int bricksX_, bricksY_, bricksZ_;
+    size_t totalBricks_, capacity_;
+
+    std::unique_ptr<std::atomic<int32_t>[]> table_;     // brick id -> slot, EMPTY or PENDING
+    std::unique_ptr<Slot[]> slots_;
+    // [slot][channel][node], read and written through std::atomic_ref; left
+    // uninitialized so pages of slots never used are never committed
+    std::unique_ptr<uint16_t[]> data_;
+    std::unique_ptr<Counters[]> counters_;
+
+    mutable BoundedQueue<uint32_t> queue_;   // PENDING bricks, each at most once
+    std::vector<std::thread> workers_;
+
+    // Slot allocation and eviction; workers only
+    std::mutex slotMutex_;
+    size_t used_ = 0, hand_ = 0;
+    std::vector<uint8_t> touched_;
+    std::atomic<uint64_t> fills_{0}, evictions_{0}, dropped_{0}, fillNs_{0};
+    std::atomic<size_t> touchedCount_{0};
+};
+
+// Field policy for marchFlame() that reads the lazy volume
+struct LazyField {
+    const LazyVolume* volume;
+    float time;
+    float formation;
+
+    float density(Vec3 p) const { return volume->density(p, time, formation); }
+    float temperature(Vec3 p, float density) const {
+        return clampf(volume->temperatureFactor(p, time) * density, 0.0f, 1.0f);
+    }
+};
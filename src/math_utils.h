@@ -4,6 +4,9 @@
 // Simple 3D Vector structure used throughout the simulation
 struct Vec3 { float x,y,z; };
 
+// 2D pair, used for ray intervals (GLSL vec2 returned by intersectSphere)
+struct Vec2 { float x,y; };
+
 // ---- Vector Arithmetic Operators ----
 
 // Vector addition: a + b
@@ -15,8 +18,20 @@ inline Vec3 operator-(Vec3 a,Vec3 b){ return {a.x-b.x,a.y-b.y,a.z-b.z}; }
 // Scalar multiplication: a * s
 inline Vec3 operator*(Vec3 a,float s){ return {a.x*s,a.y*s,a.z*s}; }
 
+// Component-wise multiplication: a * b (GLSL vec3 * vec3)
+inline Vec3 operator*(Vec3 a,Vec3 b){ return {a.x*b.x,a.y*b.y,a.z*b.z}; }
+
+// In-place accumulation: a += b
+inline Vec3& operator+=(Vec3& a,Vec3 b){ a.x+=b.x; a.y+=b.y; a.z+=b.z; return a; }
+
 // ---- Vector Math Utilities ----
 
+// Dot product of two vectors
+inline float dot(Vec3 a,Vec3 b){ return a.x*b.x+a.y*b.y+a.z*b.z; }
+
+// Euclidean length of a vector
+inline float length(Vec3 v){ return sqrtf(dot(v,v)); }
+
 // Normalize a vector to unit length (length = 1.0)
 inline Vec3 normalize(Vec3 v){
     float l = sqrt(v.x*v.x+v.y*v.y+v.z*v.z);
@@ -38,3 +53,27 @@ inline Vec3 cross(Vec3 a,Vec3 b){
 inline float length2D(float x, float z){
     return sqrtf(x*x + z*z);
 }
+
+// ---- GLSL-equivalent scalar helpers ----
+// Used by the CPU port of the flame shader; formulas follow the GLSL spec
+// so CPU and GPU evaluate the same expressions.
+
+// Clamp x into [lo, hi]
+inline float clampf(float x, float lo, float hi){
+    return fminf(fmaxf(x, lo), hi);
+}
+
+// Linear blend: x*(1-a) + y*a
+inline float mixf(float x, float y, float a){
+    return x * (1.0f - a) + y * a;
+}
+
+inline Vec3 mix(Vec3 x, Vec3 y, float a){
+    return {mixf(x.x,y.x,a), mixf(x.y,y.y,a), mixf(x.z,y.z,a)};
+}
+
+// Hermite smoothstep; also valid for e0 > e1 (reversed ramp)
+inline float smoothstepf(float e0, float e1, float x){
+    float t = clampf((x - e0) / (e1 - e0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
@@ -0,0 +1,117 @@
+#include "noise_simd.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "flame_field.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Defined in the per-ISA translation units that CMake adds for this target
+#if defined(FLAME_SIMD_X86)
+const NoiseKernels* noiseKernelsSSE41();
+const NoiseKernels* noiseKernelsAVX2();
+#endif
+#if defined(FLAME_SIMD_NEON)
+const NoiseKernels* noiseKernelsNEON();
+#endif
+
+/* =================== SCALAR FALLBACK =================== */
+
+static void hash33Scalar(const float* x, const float* y, const float* z,
+                         float* ox, float* oy, float* oz, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        Vec3 h = hash33({x[i], y[i], z[i]});
+        ox[i] = h.x; oy[i] = h.y; oz[i] = h.z;
+    }
+}
+
+static void noise3DScalar(const float* x, const float* y, const float* z, float* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = noise3D({x[i], y[i], z[i]});
+}
+
+static void fbmScalar(const float* x, const float* y, const float* z, int octaves, float* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = fbm({x[i], y[i], z[i]}, octaves);
+}
+
+static const NoiseKernels scalarKernels = {
+    SimdIsa::Scalar, "scalar", 1, &hash33Scalar, &noise3DScalar, &fbmScalar
+};
+
+/* =================== CPU FEATURE DISPATCH =================== */
+
+#if defined(FLAME_SIMD_X86)
+static bool cpuHasSSE41() {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 1);
+    return (r[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+static bool cpuHasAVX2() {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 1);
+    bool osxsave = (r[2] & (1 << 27)) != 0, avx = (r[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+bool simdIsaSupported(SimdIsa isa) {
+    switch (isa) {
+    case SimdIsa::Scalar: return true;
+#if defined(FLAME_SIMD_X86)
+    case SimdIsa::SSE41: return cpuHasSSE41();
+    case SimdIsa::AVX2:  return cpuHasAVX2();
+#endif
+#if defined(FLAME_SIMD_NEON)
+    case SimdIsa::NEON:  return true;
+#endif
+    default: return false;
+    }
+}
+
+const NoiseKernels* noiseKernelsFor(SimdIsa isa) {
+    if (!simdIsaSupported(isa)) return nullptr;
+    switch (isa) {
+    case SimdIsa::Scalar: return &scalarKernels;
+#if defined(FLAME_SIMD_X86)
+    case SimdIsa::SSE41: return noiseKernelsSSE41();
+    case SimdIsa::AVX2:  return noiseKernelsAVX2();
+#endif
+#if defined(FLAME_SIMD_NEON)
+    case SimdIsa::NEON:  return noiseKernelsNEON();
+#endif
+    default: return nullptr;
+    }
+}
+
+static const NoiseKernels& selectKernels() {
+    const SimdIsa preference[] = {SimdIsa::AVX2, SimdIsa::SSE41, SimdIsa::NEON, SimdIsa::Scalar};
+
+    if (const char* forced = std::getenv("FLAME_SIMD")) {
+        for (SimdIsa isa : preference) {
+            const NoiseKernels* k = noiseKernelsFor(isa);
+            if (k && std::strcmp(k->name, forced) == 0) return *k;
+        }
+        std::cerr << "[noise] FLAME_SIMD=" << forced << " not available, auto-selecting" << std::endl;
+    }
+    for (SimdIsa isa : preference)
+        if (const NoiseKernels* k = noiseKernelsFor(isa)) return *k;
+    return scalarKernels;
+}
+
+const NoiseKernels& noiseKernels() {
+    static const NoiseKernels& k = selectKernels();
+    return k;
+}
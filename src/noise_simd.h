@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+
+/* =================== PACKET NOISE =================== */
+// Vectorized hash33 / noise3D / fbm for the CPU path. Points are passed in
+// structure-of-arrays form (separate x, y, z arrays) and evaluated 8 at a
+// time with AVX2 or 4 at a time with SSE4.1 / NEON. Results are bit-exact
+// with the scalar functions in flame_field.cpp: same integer hash, same
+// quintic fade and the same order of float operations.
+//
+// The instruction set is picked at runtime from the CPU features. Set the
+// FLAME_SIMD environment variable (scalar, sse4.1, avx2, neon) to force one.
+
+enum class SimdIsa { Scalar, SSE41, AVX2, NEON };
+
+// Whether isa is compiled in and this CPU can run it
+bool simdIsaSupported(SimdIsa isa);
+
+// Function table for one instruction set; n may be any count (tails are padded)
+struct NoiseKernels {
+    SimdIsa isa;
+    const char* name;
+    int width;   // lanes per packet
+
+    void (*hash33)(const float* x, const float* y, const float* z,
+                   float* outX, float* outY, float* outZ, size_t n);
+    void (*noise3D)(const float* x, const float* y, const float* z, float* out, size_t n);
+    void (*fbm)(const float* x, const float* y, const float* z, int octaves, float* out, size_t n);
+};
+
+// Best kernels for this CPU (chosen once, honours FLAME_SIMD)
+const NoiseKernels& noiseKernels();
+
+// Kernels for a specific ISA, or nullptr if not compiled in / not supported
+const NoiseKernels* noiseKernelsFor(SimdIsa isa);
+
+// ---- Convenience wrappers over noiseKernels() ----
+
+inline void noise3DPacket(const float* x, const float* y, const float* z, float* out, size_t n) {
+    noiseKernels().noise3D(x, y, z, out, n);
+}
+
+inline void fbmPacket(const float* x, const float* y, const float* z, int octaves, float* out, size_t n) {
+    noiseKernels().fbm(x, y, z, octaves, out, n);
+}
@@ -0,0 +1,8 @@
+// Compiled with -mavx2 (see CMakeLists.txt); only called after a CPU check.
+#include "simd_lanes.h"
+#include "noise_simd_impl.h"
+
+const NoiseKernels* noiseKernelsAVX2() {
+    static const NoiseKernels k = NoisePacket<LanesAVX2>::kernels(SimdIsa::AVX2, "avx2");
+    return &k;
+}
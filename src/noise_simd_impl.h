@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "noise_simd.h"
+
+/* =================== PACKET NOISE KERNELS =================== */
+// Shared kernel bodies, instantiated once per instruction set. L is one of
+// the lane wrappers in simd_lanes.h. Only include this from the per-ISA
+// translation units.
+//
+// Every expression matches flame_field.cpp operation for operation; do not
+// reassociate or the results stop being bit-exact.
+
+template <class L>
+struct NoisePacket {
+    using F = typename L::F;
+    using I = typename L::I;
+
+    static inline void hash33(F px, F py, F pz, F& hx, F& hy, F& hz) {
+        const I kx = L::set1u(1597334673u), ky = L::set1u(3812015801u), kz = L::set1u(2798796415u);
+        I q = L::bxor(L::bxor(L::mullo(L::toInt(px), kx), L::mullo(L::toInt(py), ky)),
+                      L::mullo(L::toInt(pz), kz));
+        const F one = L::set1(-1.0f), two = L::set1(2.0f), inv = L::set1(1.0f / 4294967296.0f);
+        hx = L::add(one, L::mul(L::mul(two, L::u32ToFloat(L::mullo(q, kx))), inv));
+        hy = L::add(one, L::mul(L::mul(two, L::u32ToFloat(L::mullo(q, ky))), inv));
+        hz = L::add(one, L::mul(L::mul(two, L::u32ToFloat(L::mullo(q, kz))), inv));
+    }
+
+    // dot(hash33(i + c), f - c) for a corner c in {0,1}^3
+    static inline F corner(F ix, F iy, F iz, F fx, F fy, F fz, int cx, int cy, int cz) {
+        const F one = L::set1(1.0f);
+        F px = cx ? L::add(ix, one) : ix, dx = cx ? L::sub(fx, one) : fx;
+        F py = cy ? L::add(iy, one) : iy, dy = cy ? L::sub(fy, one) : fy;
+        F pz = cz ? L::add(iz, one) : iz, dz = cz ? L::sub(fz, one) : fz;
+        F hx, hy, hz;
+        hash33(px, py, pz, hx, hy, hz);
+        return L::add(L::add(L::mul(hx, dx), L::mul(hy, dy)), L::mul(hz, dz));
+    }
+
+    static inline F mix(F x, F y, F a) {
+        return L::add(L::mul(x, L::sub(L::set1(1.0f), a)), L::mul(y, a));
+    }
+
+    // f * f * f * ((f * (f * 6 - 15)) + 10)
+    static inline F fade(F f) {
+        F inner = L::add(L::mul(f, L::sub(L::mul(f, L::set1(6.0f)), L::set1(15.0f))), L::set1(10.0f));
+        return L::mul(L::mul(L::mul(f, f), f), inner);
+    }
+
+    static inline F noise3D(F x, F y, F z) {
+        F ix = L::floor(x), iy = L::floor(y), iz = L::floor(z);
+        F fx = L::sub(x, ix), fy = L::sub(y, iy), fz = L::sub(z, iz);
+        F ux = fade(fx), uy = fade(fy), uz = fade(fz);
+
+        auto c = [&](int cx, int cy, int cz) { return corner(ix, iy, iz, fx, fy, fz, cx, cy, cz); };
+
+        return mix(mix(mix(c(0,0,0), c(1,0,0), ux),
+                       mix(c(0,1,0), c(1,1,0), ux), uy),
+                   mix(mix(c(0,0,1), c(1,0,1), ux),
+                       mix(c(0,1,1), c(1,1,1), ux), uy), uz);
+    }
+
+    static inline F fbm(F x, F y, F z, int octaves) {
+        F value = L::set1(0.0f);
+        float amp = 0.5f;
+        for (int i = 0; i < octaves; i++) {
+            value = L::add(value, L::mul(L::set1(amp), noise3D(x, y, z)));
+            F rx = L::sub(L::sub(L::mul(L::set1(0.00f), x), L::mul(L::set1(0.80f), y)), L::mul(L::set1(0.60f), z));
+            F ry = L::sub(L::add(L::mul(L::set1(0.80f), x), L::mul(L::set1(0.36f), y)), L::mul(L::set1(0.48f), z));
+            F rz = L::add(L::sub(L::mul(L::set1(0.60f), x), L::mul(L::set1(0.48f), y)), L::mul(L::set1(0.64f), z));
+            x = L::add(L::mul(rx, L::set1(2.0f)), L::set1(1.7f));
+            y = L::add(L::mul(ry, L::set1(2.0f)), L::set1(9.2f));
+            z = L::add(L::mul(rz, L::set1(2.0f)), L::set1(3.1f));
+            amp *= 0.5f;
+        }
+        return value;
+    }
+
+    // ---- Array drivers: full packets, then one zero-padded tail packet ----
+
+    template <class Fn>
+    static inline void forEachPacket(const float* x, const float* y, const float* z, size_t n, Fn fn) {
+        size_t i = 0;
+        for (; i + L::W <= n; i += L::W)
+            fn(L::load(x + i), L::load(y + i), L::load(z + i), i, (size_t)L::W);
+        if (i < n) {
+            alignas(32) float tx[L::W] = {}, ty[L::W] = {}, tz[L::W] = {};
+            size_t rest = n - i;
+            std::memcpy(tx, x + i, rest * sizeof(float));
+            std::memcpy(ty, y + i, rest * sizeof(float));
+            std::memcpy(tz, z + i, rest * sizeof(float));
+            fn(L::load(tx), L::load(ty), L::load(tz), i, rest);
+        }
+    }
+
+    static inline void storeN(float* dst, F v, size_t count) {
+        if (count == (size_t)L::W) { L::store(dst, v); return; }
+        alignas(32) float tmp[L::W];
+        L::store(tmp, v);
+        std::memcpy(dst, tmp, count * sizeof(float));
+    }
+
+    static void hash33N(const float* x, const float* y, const float* z,
+                        float* ox, float* oy, float* oz, size_t n) {
+        forEachPacket(x, y, z, n, [&](F px, F py, F pz, size_t i, size_t count) {
+            F hx, hy, hz;
+            hash33(px, py, pz, hx, hy, hz);
+            storeN(ox + i, hx, count);
+            storeN(oy + i, hy, count);
+            storeN(oz + i, hz, count);
+        });
+    }
+
+    static void noise3DN(const float* x, const float* y, const float* z, float* out, size_t n) {
+        forEachPacket(x, y, z, n, [&](F px, F py, F pz, size_t i, size_t count) {
+            storeN(out + i, noise3D(px, py, pz), count);
+        });
+    }
+
+    static void fbmN(const float* x, const float* y, const float* z, int octaves, float* out, size_t n) {
+        forEachPacket(x, y, z, n, [&](F px, F py, F pz, size_t i, size_t count) {
+            storeN(out + i, fbm(px, py, pz, octaves), count);
+        });
+    }
+
+    static NoiseKernels kernels(SimdIsa isa, const char* name) {
+        return {isa, name, L::W, &hash33N, &noise3DN, &fbmN};
+    }
+};
@@ -0,0 +1,8 @@
+// AArch64 only: NEON is part of the base ISA, so no runtime check is needed.
+#include "simd_lanes.h"
+#include "noise_simd_impl.h"
+
+const NoiseKernels* noiseKernelsNEON() {
+    static const NoiseKernels k = NoisePacket<LanesNEON>::kernels(SimdIsa::NEON, "neon");
+    return &k;
+}
@@ -0,0 +1,8 @@
+// Compiled with -msse4.1 (see CMakeLists.txt); only called after a CPU check.
+#include "simd_lanes.h"
+#include "noise_simd_impl.h"
+
+const NoiseKernels* noiseKernelsSSE41() {
+    static const NoiseKernels k = NoisePacket<LanesSSE41>::kernels(SimdIsa::SSE41, "sse4.1");
+    return &k;
+}
@@ -0,0 +1,54 @@
+#include "occupancy_grid.h"
+
+#include <algorithm>
+#include "flame_params.h"
+
+void OccupancyGrid::build(int cellsPerAxis, const FlameParams& params) {
+    nb_ = std::max(1, (cellsPerAxis + BRICK - 1) / BRICK);
+    n_ = nb_ * BRICK;
+
+    // Cube around the bounding sphere, so every marched ray is inside
+    const float radius = params.sphereRadius();
+    float side = 2.0f * radius;
+    min_ = params.sphereCenter() - Vec3{radius, radius, radius};
+    cellSize_ = side / n_;
+
+    cells_.assign((size_t)n_ * n_ * n_, 0);
+    bricks_.assign((size_t)nb_ * nb_ * nb_, 0);
+
+    // Support radius only depends on the height band of a cell row
+    std::vector<float> support(n_, -1.0f);
+    for (int y = 0; y < n_; y++) {
+        float h0 = (min_.y + y * cellSize_) / params.height;
+        float h1 = (min_.y + (y + 1) * cellSize_) / params.height;
+        // Base fade and tip dissolve zero the density outside 0 < h < 1
+        if (h1 > 0.0f && h0 < 1.0f) support[y] = flameSupportRadius(h0, h1, params);
+    }
+
+    // Distance from 0 to the interval [lo, hi]
+    auto axisGap = [](float lo, float hi) { return lo > 0.0f ? lo : (hi < 0.0f ? -hi : 0.0f); };
+
+    for (int z = 0; z < n_; z++) {
+        float gz = axisGap(min_.z + z * cellSize_, min_.z + (z + 1) * cellSize_);
+        for (int y = 0; y < n_; y++) {
+            if (support[y] < 0.0f) continue;
+            for (int x = 0; x < n_; x++) {
+                float gx = axisGap(min_.x + x * cellSize_, min_.x + (x + 1) * cellSize_);
+                if (length2D(gx, gz) < support[y]) {
+                    cells_[((size_t)z * n_ + y) * n_ + x] = 1;
+                    bricks_[((size_t)(z / BRICK) * nb_ + y / BRICK) * nb_ + x / BRICK] = 1;
+                }
+            }
+        }
+    }
+}
+
+float OccupancyGrid::occupiedCellFraction() const {
+    if (cells_.empty()) return 0.0f;
+    return (float)std::count(cells_.begin(), cells_.end(), 1) / (float)cells_.size();
+}
+
+float OccupancyGrid::occupiedBrickFraction() const {
+    if (bricks_.empty()) return 0.0f;
+    return (float)std::count(bricks_.begin(), bricks_.end(), 1) / (float)bricks_.size();
+}
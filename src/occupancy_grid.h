@@ -0,0 +1,148 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "flame_march.h"
+
+/* =================== OCCUPANCY GRID =================== */
+// Two-level empty-space skipping structure over the bounding sphere's box.
+// A fine cell is marked occupied when the flame can reach it at any time:
+// the cell comes within flameSupportRadius() of the axis (flameRadius plus
+// the SDF falloff plus the largest possible turbulence displacement) over
+// the cell's height range. A brick of BRICK^3 cells is occupied when any of
+// its cells is. Being a bound on every frame, the grid is built once per
+// flame shape; a parameter block (flame_params.h) whose height, width or
+// turbulence changes needs a new build (CACHE_OCCUPANCY).
+//
+// Rays walk the bricks with a 3D DDA, descend into occupied bricks with a
+// second DDA over cells, and only run the density march inside the merged
+// occupied spans.
+
+class OccupancyGrid {
+public:
+    static constexpr int BRICK = 8;   // cells per brick edge
+
+    // cellsPerAxis is rounded up to a multiple of BRICK; the default block
+    // is the compiled flame
+    void build(int cellsPerAxis = 64, const FlameParams& params = {});
+
+    bool empty() const { return cells_.empty(); }
+    int cellsPerAxis() const { return n_; }
+    float occupiedCellFraction() const;
+    float occupiedBrickFraction() const;
+
+    bool cellOccupied(int x, int y, int z) const { return cells_[((size_t)z * n_ + y) * n_ + x] != 0; }
+    bool brickOccupied(int x, int y, int z) const { return bricks_[((size_t)z * nb_ + y) * nb_ + x] != 0; }
+
+    // Calls fn(t0, t1) for each maximal occupied span of [tMin, tMax] in
+    // ray order; fn returns false to stop early
+    template <class Fn>
+    void forEachOccupiedSpan(Vec3 ro, Vec3 rd, float tMin, float tMax, Fn&& fn) const;
+
+private:
+    // Visits grid cells of size 'size' (n per axis, from min_) crossed by the
+    // ray on [t0, t1] as visit(ix, iy, iz, tEnter, tExit) -> keep going?
+    template <class Visit>
+    void dda(Vec3 ro, Vec3 rd, float t0, float t1, float size, int n, Visit&& visit) const;
+
+    Vec3 min_ = {0, 0, 0};
+    float cellSize_ = 0.0f;
+    int n_ = 0, nb_ = 0;
+    std::vector<uint8_t> cells_;    // [z][y][x], 1 = density possible
+    std::vector<uint8_t> bricks_;   // OR of the cells in each brick
+};
+
+/* ---- Template implementation ---- */
+
+template <class Visit>
+void OccupancyGrid::dda(Vec3 ro, Vec3 rd, float t0, float t1, float size, int n, Visit&& visit) const {
+    const float inf = 1e30f;
+    float o[3] = {ro.x - min_.x, ro.y - min_.y, ro.z - min_.z};
+    float d[3] = {rd.x, rd.y, rd.z};
+
+    int idx[3], step[3];
+    float tNext[3], tDelta[3];
+    for (int a = 0; a < 3; a++) {
+        float p = o[a] + d[a] * t0;
+        idx[a] = (int)floorf(p / size);
+        idx[a] = idx[a] < 0 ? 0 : (idx[a] >= n ? n - 1 : idx[a]);
+        if (d[a] > 0.0f) {
+            step[a] = 1;
+            tDelta[a] = size / d[a];
+            tNext[a] = ((idx[a] + 1) * size - o[a]) / d[a];
+        } else if (d[a] < 0.0f) {
+            step[a] = -1;
+            tDelta[a] = -size / d[a];
+            tNext[a] = (idx[a] * size - o[a]) / d[a];
+        } else {
+            step[a] = 0;
+            tDelta[a] = inf;
+            tNext[a] = inf;
+        }
+    }
+
+    float t = t0;
+    for (;;) {
+        int a = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+        float tExit = fminf(tNext[a], t1);
+        if (tExit > t && !visit(idx[0], idx[1], idx[2], t, tExit)) return;
+        if (tExit >= t1) return;
+
+        t = tExit;
+        idx[a] += step[a];
+        if (idx[a] < 0 || idx[a] >= n) return;
+        tNext[a] += tDelta[a];
+    }
+}
+
+template <class Fn>
+void OccupancyGrid::forEachOccupiedSpan(Vec3 ro, Vec3 rd, float tMin, float tMax, Fn&& fn) const {
+    bool open = false, stop = false;
+    float s0 = 0.0f, s1 = 0.0f;
+
+    auto addCell = [&](float tEnter, float tExit) {
+        if (open && tEnter <= s1 + 1e-5f) {
+            s1 = tExit;
+            return true;
+        }
+        if (open && !fn(s0, s1)) return !(stop = true);
+        open = true;
+        s0 = tEnter;
+        s1 = tExit;
+        return true;
+    };
+
+    const float brickSize = cellSize_ * BRICK;
+    dda(ro, rd, tMin, tMax, brickSize, nb_, [&](int bx, int by, int bz, float b0, float b1) {
+        if (!brickOccupied(bx, by, bz)) return true;
+        dda(ro, rd, b0, b1, cellSize_, n_, [&](int cx, int cy, int cz, float c0, float c1) {
+            return cellOccupied(cx, cy, cz) ? addCell(c0, c1) : true;
+        });
+        return !stop;
+    });
+    if (open && !stop) fn(s0, s1);
+}
+
+/* =================== SKIPPING MARCH =================== */
+
+// marchFlame() that only samples density inside occupied spans. Step sizes
+// match the full march; jumps across empty cells cost no samples.
+template <class Q = QualityProduction, class Field>
+FlameSample marchFlameSkipping(const Field& field, const OccupancyGrid& grid, Vec3 ro, Vec3 rd,
+                               float pixelSpread = 0.0f, float jitter = 0.0f) {
+    FlameSample out;
+    Vec2 tRange;
+    float baseStep, radius;
+    Vec3 center;
+    fieldSphere(field, center, radius);
+    if (!marchRange<Q>(ro, rd, tRange, baseStep, center, radius)) return out;
+    out.hit = true;
+    out.exit = RayExit::Left;
+
+    // Each span restarts the stepping, so each span gets the jitter
+    float t = tRange.x;
+    grid.forEachOccupiedSpan(ro, rd, tRange.x, tRange.y, [&](float s0, float s1) {
+        t = fmaxf(t, s0);
+        return marchInterval<Q>(field, ro, rd, t, s1, baseStep, out, pixelSpread, jitter);
+    });
+    return out;
+}
@@ -0,0 +1,226 @@
+#include "particle_system.h"
+
+#include <algorithm>
+#include "noise_simd.h"
+#include "thread_pool.h"
+
+/* =================== CURL NOISE =================== */
+
+// Decorrelating offsets of the three potential components
+static const Vec3 POTENTIAL_OFFSET[3] = {
+    {0.0f, 0.0f, 0.0f},
+    {31.416f, -47.853f, 12.793f},
+    {-23.137f, 17.721f, 59.311f},
+};
+
+constexpr float CURL_EPS = 0.01f;    // finite-difference step in noise space
+constexpr size_t CURL_BATCH = 256;   // points per packet call
+
+void curlNoisePacket(const float* x, const float* y, const float* z, float time,
+                     float* outX, float* outY, float* outZ, size_t n) {
+    // Per point and potential component k: psi_k at p, p + eps*a, p + eps*b
+    // where a, b are the two axes its curl terms differentiate along.
+    //   curl = (dPz/dy - dPy/dz, dPx/dz - dPz/dx, dPy/dx - dPx/dy)
+    // Forward differences: 9 noise3D samples per point.
+    constexpr int SAMPLES = 9;
+    static const Vec3 AXIS[3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    static const int DIFF_AXES[3][2] = {{1, 2}, {0, 2}, {0, 1}};   // Px: y,z  Py: x,z  Pz: x,y
+
+    float sx[SAMPLES * CURL_BATCH], sy[SAMPLES * CURL_BATCH], sz[SAMPLES * CURL_BATCH];
+    float v[SAMPLES * CURL_BATCH];
+
+    for (size_t begin = 0; begin < n; begin += CURL_BATCH) {
+        size_t m = std::min(CURL_BATCH, n - begin);
+
+        // Sample-major layout so each run of m points is contiguous
+        for (int k = 0; k < 3; k++) {
+            Vec3 o = POTENTIAL_OFFSET[k] + Vec3{0.0f, -time, 0.0f};
+            for (int s = 0; s < 3; s++) {
+                Vec3 d = s == 0 ? Vec3{0, 0, 0} : AXIS[DIFF_AXES[k][s - 1]] * CURL_EPS;
+                size_t base = (size_t)(k * 3 + s) * m;
+                for (size_t i = 0; i < m; i++) {
+                    sx[base + i] = x[begin + i] + o.x + d.x;
+                    sy[base + i] = y[begin + i] + o.y + d.y;
+                    sz[base + i] = z[begin + i] + o.z + d.z;
+                }
+            }
+        }
+        noise3DPacket(sx, sy, sz, v, SAMPLES * m);
+
+        const float inv = 1.0f / CURL_EPS;
+        const float* px = v;          // Px, Px(+y), Px(+z)
+        const float* py = v + 3 * m;  // Py, Py(+x), Py(+z)
+        const float* pz = v + 6 * m;  // Pz, Pz(+x), Pz(+y)
+        for (size_t i = 0; i < m; i++) {
+            float dPx_dy = (px[m + i] - px[i]) * inv, dPx_dz = (px[2 * m + i] - px[i]) * inv;
+            float dPy_dx = (py[m + i] - py[i]) * inv, dPy_dz = (py[2 * m + i] - py[i]) * inv;
+            float dPz_dx = (pz[m + i] - pz[i]) * inv, dPz_dy = (pz[2 * m + i] - pz[i]) * inv;
+            outX[begin + i] = dPz_dy - dPy_dz;
+            outY[begin + i] = dPx_dz - dPz_dx;
+            outZ[begin + i] = dPy_dx - dPx_dy;
+        }
+    }
+}
+
+/* =================== POOL =================== */
+
+ParticleSystem::ParticleSystem(const ParticleSettings& settings) : settings_(settings) {
+    rng_ = 0x9E3779B97F4A7C15ull ^ settings_.seed;
+    if (settings_.spawnRate <= 0.0f)
+        settings_.spawnRate = (float)settings_.capacity / (0.5f * (settings_.lifeMin + settings_.lifeMax));
+
+    size_t n = settings_.capacity;
+    for (auto* a : {&px_, &py_, &pz_, &vx_, &vy_, &vz_, &temp_, &age_, &life_}) a->assign(n, 0.0f);
+    aliveMask_.assign(n, 0);
+
+    // Descending, so pops hand out slots 0, 1, 2, ... and a young pool is dense
+    freeList_.resize(n);
+    for (size_t i = 0; i < n; i++) freeList_[i] = (uint32_t)(n - 1 - i);
+    chunkDead_.resize((n + CHUNK - 1) / CHUNK);
+}
+
+float ParticleSystem::random01() {
+    // xorshift64*
+    rng_ ^= rng_ >> 12;
+    rng_ ^= rng_ << 25;
+    rng_ ^= rng_ >> 27;
+    return (float)((rng_ * 0x2545F4914F6CDD1Dull) >> 40) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::spawn(uint32_t slot) {
+    // Uniform over the emitter disc
+    float r = settings_.spawnRadius * sqrtf(random01());
+    float a = 6.2831853f * random01();
+    px_[slot] = r * cosf(a);
+    py_[slot] = settings_.baseY;
+    pz_[slot] = r * sinf(a);
+    vx_[slot] = 0.0f;
+    vy_[slot] = 0.2f + 0.3f * random01();
+    vz_[slot] = 0.0f;
+    temp_[slot] = 1.0f;
+    age_[slot] = 0.0f;
+    life_[slot] = mixf(settings_.lifeMin, settings_.lifeMax, random01());
+    aliveMask_[slot] = 1;
+}
+
+size_t ParticleSystem::emit(size_t count) {
+    count = std::min(count, freeList_.size());
+    for (size_t i = 0; i < count; i++) {
+        spawn(freeList_.back());
+        freeList_.pop_back();
+    }
+    alive_ += count;
+    return count;
+}
+
+void ParticleSystem::prewarm() {
+    size_t first = freeList_.size();
+    emit(first);
+    // Scatter ages and lift each particle to roughly where it would be by
+    // then, so despawns are spread evenly instead of arriving in one wave
+    for (size_t i = 0; i < settings_.capacity; i++) {
+        float f = random01();
+        age_[i] = f * life_[i];
+        temp_[i] = expf(-settings_.coolingRate * age_[i]);
+        py_[i] = settings_.baseY + f * (settings_.maxHeight - settings_.baseY) * 0.9f;
+    }
+}
+
+/* =================== UPDATE =================== */
+
+void ParticleSystem::updateChunk(size_t chunk, float dt) {
+    const ParticleSettings& s = settings_;
+    const size_t begin = chunk * CHUNK;
+    const size_t end = std::min(begin + CHUNK, s.capacity);
+    std::vector<uint32_t>& dead = chunkDead_[chunk];
+    dead.clear();
+
+    const float cool = expf(-s.coolingRate * dt);
+    const float damp = expf(-s.drag * dt);
+    const float noiseTime = time_ * s.noiseSpeed;
+
+    // Live particles are gathered into short batches so the packet curl
+    // noise only runs on them
+    constexpr size_t BATCH = CURL_BATCH;
+    uint32_t idx[BATCH];
+    float nx[BATCH], ny[BATCH], nz[BATCH], cx[BATCH], cy[BATCH], cz[BATCH];
+
+    size_t i = begin;
+    while (i < end) {
+        size_t m = 0;
+        for (; i < end && m < BATCH; i++) {
+            if (!aliveMask_[i]) continue;
+            idx[m] = (uint32_t)i;
+            nx[m] = px_[i] * s.noiseScale;
+            ny[m] = py_[i] * s.noiseScale;
+            nz[m] = pz_[i] * s.noiseScale;
+            m++;
+        }
+        if (m == 0) break;
+        curlNoisePacket(nx, ny, nz, noiseTime, cx, cy, cz, m);
+
+        for (size_t j = 0; j < m; j++) {
+            uint32_t p = idx[j];
+
+            // 1. Cooling
+            float T = temp_[p] * cool;
+
+            // 2. Buoyancy
+            float vx = vx_[p], vy = vy_[p], vz = vz_[p];
+            vy += s.buoyancy * (T - s.ambient) * dt;
+
+            // 3. Turbulence, hotter = more turbulent
+            float turb = (0.5f + T) * s.turbulence * dt;
+            vx += cx[j] * turb;
+            vy += cy[j] * turb;
+            vz += cz[j] * turb;
+
+            // 4. Cone confinement: spring back toward the axis
+            float x = px_[p], y = py_[p], z = pz_[p];
+            float maxRadius = fmaxf(s.spawnRadius * (1.0f - (y - s.baseY) / s.coneTaper), 0.0f);
+            float r = length2D(x, z);
+            if (r > maxRadius && r > 0.0f) {
+                float push = (r - maxRadius) * s.conePush * dt / r;
+                vx -= x * push;
+                vz -= z * push;
+            }
+
+            vx *= damp; vy *= damp; vz *= damp;
+
+            // 5. Integration
+            x += vx * dt; y += vy * dt; z += vz * dt;
+            float age = age_[p] + dt;
+
+            // 6. Despawn into the free list (merged after the parallel pass)
+            if (age >= life_[p] || y > s.maxHeight) {
+                aliveMask_[p] = 0;
+                dead.push_back(p);
+                continue;
+            }
+            px_[p] = x; py_[p] = y; pz_[p] = z;
+            vx_[p] = vx; vy_[p] = vy; vz_[p] = vz;
+            temp_[p] = T;
+            age_[p] = age;
+        }
+    }
+}
+
+void ParticleSystem::step(float dt, ThreadPool& pool) {
+    stats_ = {};
+    pool.parallelFor(chunkDead_.size(), [&](size_t chunk) { updateChunk(chunk, dt); });
+
+    // Chunk order keeps the free list, and so the whole run, independent of
+    // the thread count
+    for (std::vector<uint32_t>& dead : chunkDead_) {
+        freeList_.insert(freeList_.end(), dead.begin(), dead.end());
+        stats_.despawned += dead.size();
+    }
+    alive_ -= stats_.despawned;
+
+    float want = settings_.spawnRate * dt + spawnCarry_;
+    size_t count = (size_t)want;
+    spawnCarry_ = want - (float)count;
+    stats_.spawned = emit(count);
+    stats_.alive = alive_;
+    time_ += dt;
+}
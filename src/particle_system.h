@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "math_utils.h"
+
+class ThreadPool;
+
+/* =================== PARTICLE SYSTEM =================== */
+// The particle physics from docs/ALGO_WORKFLOW_AND_STRUCTURE.md as a
+// data-oriented engine: cooling, thermal buoyancy, curl-noise turbulence,
+// cone confinement and explicit Euler integration.
+//
+// Storage is structure-of-arrays over a fixed capacity. Slots are pooled:
+// a particle that outlives maxLife or leaves the height limit is marked dead
+// and its slot goes onto a free list, and emission pops slots back off it.
+// The update loop never respawns in place.
+//
+// step() updates the pool in fixed-size chunks spread over a ThreadPool.
+// Turbulence is the curl of a vector potential made of three offset
+// noise3D fields (the same noise the flame shader uses). It is taken by
+// forward differences, nine noise samples per particle (each potential at
+// p and one step along the two axes its curl terms use), evaluated with
+// the packet noise kernels.
+
+struct ParticleSettings {
+    size_t capacity = 1 << 20;      // pool size (max live particles)
+    float  spawnRate = 0.0f;        // particles/s; 0 = keep the pool full at steady state
+
+    // Emitter: disc at the flame base
+    float spawnRadius = 0.15f;      // SPAWN_RADIUS
+    float baseY = 0.0f;             // flame base in flame_field coordinates
+    float lifeMin = 0.8f, lifeMax = 1.6f;
+    float maxHeight = 2.2f;         // despawn above this (FLAME_HEIGHT)
+
+    // Physics (PARAMETER_GUIDE.md values)
+    float buoyancy = 15.0f;         // THERMAL_BUOYANCY
+    float ambient = 0.1f;           // temperature with no lift
+    float coolingRate = 0.8f;       // COOLING_RATE: T *= exp(-k dt)
+    float drag = 4.0f;              // v *= exp(-drag dt), keeps buoyancy bounded
+    float turbulence = 2.0f;        // curl velocity scale
+    float noiseScale = 2.0f;        // curlNoise(pos * 2, ...)
+    float noiseSpeed = 1.5f;        // curlNoise(..., time * 1.5)
+    float coneTaper = 3.0f;         // maxRadius = spawnRadius * (1 - h / taper)
+    float conePush = 3.0f;          // spring constant outside the cone
+
+    uint32_t seed = 1;
+};
+
+// Counters for the last step()
+struct ParticleStepStats {
+    size_t alive = 0;
+    size_t spawned = 0;
+    size_t despawned = 0;
+};
+
+class ParticleSystem {
+public:
+    static constexpr size_t CHUNK = 8192;   // particles per parallel task
+
+    explicit ParticleSystem(const ParticleSettings& settings = {});
+
+    // Advance by dt seconds: update live particles, recycle dead slots, then
+    // emit spawnRate * dt new ones
+    void step(float dt, ThreadPool& pool);
+
+    // Emit up to count particles now; returns how many fit in the pool
+    size_t emit(size_t count);
+
+    // Fill the pool and scatter ages, as if the emitter had been running
+    void prewarm();
+
+    const ParticleSettings& settings() const { return settings_; }
+    const ParticleStepStats& lastStep() const { return stats_; }
+    size_t capacity() const { return settings_.capacity; }
+    size_t aliveCount() const { return alive_; }
+    float time() const { return time_; }
+
+    // ---- Pool access (index < capacity(), check alive()) ----
+    bool  alive(size_t i) const { return aliveMask_[i] != 0; }
+    Vec3  position(size_t i) const { return {px_[i], py_[i], pz_[i]}; }
+    Vec3  velocity(size_t i) const { return {vx_[i], vy_[i], vz_[i]}; }
+    float temperature(size_t i) const { return temp_[i]; }
+    float age(size_t i) const { return age_[i]; }
+
+private:
+    void updateChunk(size_t chunk, float dt);
+    void spawn(uint32_t slot);
+    float random01();
+
+    ParticleSettings settings_;
+    float time_ = 0.0f;
+    float spawnCarry_ = 0.0f;       // fractional particles owed to next step
+    uint64_t rng_;
+
+    // SoA pool
+    std::vector<float> px_, py_, pz_;
+    std::vector<float> vx_, vy_, vz_;
+    std::vector<float> temp_, age_, life_;
+    std::vector<uint8_t> aliveMask_;
+
+    std::vector<uint32_t> freeList_;                 // dead slots, popped from the back
+    std::vector<std::vector<uint32_t>> chunkDead_;   // per-chunk despawns of this step
+    size_t alive_ = 0;
+    ParticleStepStats stats_;
+};
+
+// Curl of the noise3D vector potential at n points (SoA). Positions are in
+// noise space; time scrolls the potential. out* receive the curl.
+void curlNoisePacket(const float* x, const float* y, const float* z, float time,
+                     float* outX, float* outY, float* outZ, size_t n);
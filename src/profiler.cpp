@@ -0,0 +1,188 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "bench_report.h"
+
+namespace {
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t start, end;
+};
+
+// One writer; head counts every event ever written, the ring holds the last
+// PROFILER_RING_EVENTS of them
+struct Track {
+    std::string name;
+    int id = 0;
+    std::unique_ptr<ProfileEvent[]> events{new ProfileEvent[PROFILER_RING_EVENTS]};
+    std::atomic<uint64_t> head{0};
+    uint64_t resetAt = 0;   // events before this were dropped by profilerReset()
+
+    void record(const char* n, uint64_t start, uint64_t end) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        events[h & (PROFILER_RING_EVENTS - 1)] = {n, start, end};
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
+struct Registry {
+    std::mutex m;
+    std::vector<std::unique_ptr<Track>> tracks;
+    uint64_t epoch = 0;   // trace time zero: the first profilerEnable(true)
+
+    Track* add(std::string name) {
+        std::lock_guard<std::mutex> lock(m);
+        tracks.push_back(std::make_unique<Track>());
+        Track* t = tracks.back().get();
+        t->id = (int)tracks.size();
+        t->name = name.empty() ? "thread " + std::to_string(t->id) : std::move(name);
+        return t;
+    }
+};
+
+Registry& registry() {
+    static Registry r;
+    return r;
+}
+
+thread_local Track* threadTrack = nullptr;
+thread_local std::string threadName;
+
+// Events of a track still in its ring, oldest first
+std::vector<ProfileEvent> snapshot(const Track& t) {
+    uint64_t head = t.head.load(std::memory_order_acquire);
+    uint64_t first = std::max(t.resetAt, head > PROFILER_RING_EVENTS ? head - PROFILER_RING_EVENTS : 0);
+    std::vector<ProfileEvent> out;
+    out.reserve((size_t)(head - first));
+    for (uint64_t i = first; i < head; i++) out.push_back(t.events[i & (PROFILER_RING_EVENTS - 1)]);
+    return out;
+}
+
+} // namespace
+
+uint64_t profilerNow() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void profilerEnable(bool enabled) {
+    Registry& r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.m);
+        if (enabled && r.epoch == 0) r.epoch = profilerNow();
+    }
+    profilerActive.store(enabled, std::memory_order_relaxed);
+}
+
+void profilerSetThreadName(const char* name) {
+    threadName = name;
+    if (threadTrack) {
+        std::lock_guard<std::mutex> lock(registry().m);
+        threadTrack->name = name;
+    }
+}
+
+void profilerRecord(const char* name, uint64_t start, uint64_t end) {
+    if (!threadTrack) threadTrack = registry().add(threadName);
+    threadTrack->record(name, start, end);
+}
+
+int profilerAddTrack(const char* name) {
+    return registry().add(name)->id;
+}
+
+void profilerRecordOn(int track, const char* name, uint64_t start, uint64_t end) {
+    Registry& r = registry();
+    Track* t;
+    {
+        std::lock_guard<std::mutex> lock(r.m);
+        t = r.tracks[track - 1].get();
+    }
+    t->record(name, start, end);
+}
+
+void profilerReset() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.m);
+    for (auto& t : r.tracks) t->resetAt = t->head.load(std::memory_order_acquire);
+}
+
+bool profilerWriteChromeTrace(const std::string& path) {
+    std::unique_ptr<FILE, int (*)(FILE*)> f(std::fopen(path.c_str(), "w"), &std::fclose);
+    if (!f) return false;
+    FILE* o = f.get();
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.m);
+    std::fprintf(o, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    auto sep = [&] {
+        if (!first) std::fprintf(o, ",\n");
+        first = false;
+    };
+    for (const auto& t : r.tracks) {
+        sep();
+        std::fprintf(o, "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %d, "
+                        "\"args\": {\"name\": \"%s\"}}", t->id, jsonEscape(t->name).c_str());
+        for (const ProfileEvent& e : snapshot(*t)) {
+            if (e.start < r.epoch) continue;
+            sep();
+            // Trace times are microseconds
+            std::fprintf(o, "{\"ph\": \"X\", \"name\": \"%s\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                         jsonEscape(e.name).c_str(), t->id, (e.start - r.epoch) * 1e-3, (e.end - e.start) * 1e-3);
+        }
+    }
+    std::fprintf(o, "\n]}\n");
+    return std::ferror(o) == 0;
+}
+
+void profilerPrintSummary() {
+    struct Totals {
+        std::string track;
+        const char* name;
+        uint64_t count = 0, total = 0, max = 0;
+    };
+    std::vector<Totals> rows;
+    uint64_t dropped = 0;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.m);
+        for (const auto& t : r.tracks) {
+            // Numbered threads of one kind ("pool worker 3") are merged
+            std::string track = t->name;
+            size_t digits = track.find_last_not_of("0123456789");
+            if (digits != std::string::npos && digits + 1 < track.size() && track[digits] == ' ')
+                track.resize(digits);
+            uint64_t head = t->head.load(std::memory_order_acquire);
+            if (head - t->resetAt > PROFILER_RING_EVENTS) dropped += head - t->resetAt - PROFILER_RING_EVENTS;
+            for (const ProfileEvent& e : snapshot(*t)) {
+                auto it = std::find_if(rows.begin(), rows.end(), [&](const Totals& x) {
+                    return x.track == track && std::strcmp(x.name, e.name) == 0;
+                });
+                if (it == rows.end()) {
+                    rows.push_back({track, e.name});
+                    it = rows.end() - 1;
+                }
+                uint64_t d = e.end - e.start;
+                it->count++;
+                it->total += d;
+                it->max = std::max(it->max, d);
+            }
+        }
+    }
+    std::sort(rows.begin(), rows.end(), [](const Totals& a, const Totals& b) { return a.total > b.total; });
+
+    std::printf("%-16s %-24s %9s %11s %10s %10s\n", "track", "marker", "count", "total ms", "mean us", "max us");
+    for (const Totals& t : rows) {
+        std::printf("%-16s %-24s %9llu %11.3f %10.2f %10.2f\n", t.track.c_str(), t.name,
+                    (unsigned long long)t.count, t.total * 1e-6, t.total * 1e-3 / t.count, t.max * 1e-3);
+    }
+    if (dropped) std::printf("(%llu older events were overwritten and are not counted)\n", (unsigned long long)dropped);
+}
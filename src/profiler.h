@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/* =================== FRAME PROFILER =================== */
+// Scoped timing markers. Every thread records into its own ring buffer
+// (single writer, no locks after the thread's first event); the oldest
+// events are overwritten when a ring is full. Exports are meant for quiet
+// moments such as exit: a ring being written while it is read may show a
+// torn event.
+//
+// Markers are compiled in unless FLAME_PROFILER is 0 (CMake option
+// FLAME_PROFILER) and cost one relaxed atomic load while profiling is off.
+// Extra tracks carry events recorded on another thread's behalf, e.g. GPU
+// timer query results.
+
+#ifndef FLAME_PROFILER
+#define FLAME_PROFILER 1
+#endif
+
+constexpr int PROFILER_RING_EVENTS = 1 << 15;   // per thread / track
+
+// Nanoseconds on the steady clock
+uint64_t profilerNow();
+
+void profilerEnable(bool enabled);
+
+inline std::atomic<bool> profilerActive{false};
+inline bool profilerEnabled() { return profilerActive.load(std::memory_order_relaxed); }
+
+// Names the calling thread's track in the trace and summary
+void profilerSetThreadName(const char* name);
+
+// Records [start, end) (profilerNow() values) on the calling thread's track.
+// name must outlive the profiler (string literals).
+void profilerRecord(const char* name, uint64_t start, uint64_t end);
+
+// A track not tied to a thread; only one thread may record on it at a time
+int profilerAddTrack(const char* name);
+void profilerRecordOn(int track, const char* name, uint64_t start, uint64_t end);
+
+// Chrome trace event JSON (chrome://tracing, Perfetto); false on write error
+bool profilerWriteChromeTrace(const std::string& path);
+
+// Per-marker count, total, mean and max, heaviest first, to stdout
+void profilerPrintSummary();
+
+// Drops every recorded event (tracks stay)
+void profilerReset();
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name_(name), start_(profilerEnabled() ? profilerNow() : 0) {}
+    ~ProfileScope() {
+        if (start_) profilerRecord(name_, start_, profilerNow());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
+
+#if FLAME_PROFILER
+#define FLAME_PROFILE_JOIN2(a, b) a##b
+#define FLAME_PROFILE_JOIN(a, b) FLAME_PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(name) ProfileScope FLAME_PROFILE_JOIN(profileScope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
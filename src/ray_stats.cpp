@@ -0,0 +1,186 @@
+#include "ray_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include "bench_report.h"
+#include "image_io.h"
+
+void RayCostMap::resize(int w, int h) {
+    width = w;
+    height = h;
+    size_t n = (size_t)w * h;
+    steps.assign(n, 0);
+    emptySteps.assign(n, 0);
+    exit.assign(n, RayExit::Miss);
+}
+
+void RayCostMap::set(size_t i, int s, int empty, RayExit e) {
+    steps[i] = (uint16_t)std::min(s, 0xffff);
+    emptySteps[i] = (uint16_t)std::min(empty, 0xffff);
+    exit[i] = e;
+}
+
+void unpackRayCost(const uint32_t* packed, int width, int height, RayCostMap& map) {
+    map.resize(width, height);
+    for (int y = 0; y < height; y++) {
+        const uint32_t* row = packed + (size_t)(height - 1 - y) * width;
+        for (int x = 0; x < width; x++) {
+            uint32_t v = row[x];
+            map.set((size_t)y * width + x, (int)(v & RAY_COST_FIELD_MAX), (int)((v >> 12) & RAY_COST_FIELD_MAX),
+                    (RayExit)((v >> 24) & 3));
+        }
+    }
+}
+
+const char* rayExitName(RayExit exit) {
+    static const char* const names[RAY_EXIT_COUNT] = {"miss", "left", "opaque", "budget"};
+    return names[(int)exit & 3];
+}
+
+/* =================== HISTOGRAMS =================== */
+
+RayStatsFrame summarizeRayCost(const RayCostMap& map, int maxSteps, int frame) {
+    RayStatsFrame f;
+    f.frame = frame;
+    f.width = map.width;
+    f.height = map.height;
+    f.maxSteps = std::max(maxSteps, 1);
+    f.bins.assign((size_t)f.maxSteps + 1, RayStatsBin{});
+    auto bin = [&](int v) -> RayStatsBin& { return f.bins[std::min(v, f.maxSteps)]; };
+
+    for (size_t i = 0; i < map.steps.size(); i++) {
+        int steps = map.steps[i], empty = map.emptySteps[i];
+        int exit = (int)map.exit[i];
+        f.steps += (uint64_t)steps;
+        f.emptySteps += (uint64_t)empty;
+        f.exits[exit]++;
+        RayStatsBin& b = bin(steps);
+        b.pixels++;
+        b.exits[exit]++;
+        bin(empty).empty++;
+        bin(steps - empty).inFlame++;
+    }
+
+    // Nearest-rank percentiles of marched rays, as benchStats
+    uint64_t marched = f.marched();
+    auto percentile = [&](double p) {
+        if (!marched) return 0;
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(p / 100.0 * (double)marched));
+        uint64_t seen = 0;
+        for (int s = 0; s <= f.maxSteps; s++) {
+            const RayStatsBin& b = f.bins[s];
+            seen += b.pixels - b.exits[(int)RayExit::Miss];
+            if (seen >= rank) return s;
+        }
+        return f.maxSteps;
+    };
+    f.p50 = percentile(50.0);
+    f.p95 = percentile(95.0);
+    f.p99 = percentile(99.0);
+    return f;
+}
+
+void printRayStats(const RayStatsFrame& f) {
+    uint64_t marched = f.marched();
+    auto pct = [&](RayExit e) { return marched ? 100.0 * f.exits[(int)e] / marched : 0.0; };
+    std::printf("Ray stats: %llu rays marched, %.1f steps/ray (p50 %d, p95 %d, p99 %d of %d), %.1f%% empty; "
+                "ended left %.1f%%, opaque %.1f%%, budget %.1f%%\n",
+                (unsigned long long)marched, f.meanSteps(), f.p50, f.p95, f.p99, f.maxSteps,
+                f.emptyFraction() * 100.0, pct(RayExit::Left), pct(RayExit::Opaque), pct(RayExit::Budget));
+}
+
+/* =================== HEATMAP =================== */
+
+void rayCostHeatmap(const RayCostMap& map, int maxSteps, Image& out) {
+    static const Vec3 ramp[] = {
+        {0.0f, 0.0f, 0.0f}, {0.1f, 0.1f, 0.6f}, {0.8f, 0.1f, 0.3f}, {1.0f, 0.6f, 0.0f}, {1.0f, 1.0f, 0.4f},
+    };
+    constexpr int last = (int)(sizeof(ramp) / sizeof(ramp[0])) - 1;
+    out.resize(map.width, map.height);
+    for (size_t i = 0; i < map.steps.size(); i++) {
+        Vec3 c = {1.0f, 1.0f, 1.0f};
+        if (map.exit[i] != RayExit::Budget) {
+            float v = std::clamp((float)map.steps[i] / (float)std::max(maxSteps, 1), 0.0f, 1.0f) * last;
+            int k = std::min((int)v, last - 1);
+            c = mix(ramp[k], ramp[k + 1], v - (float)k);
+        }
+        out.rgb[i * 3 + 0] = c.x;
+        out.rgb[i * 3 + 1] = c.y;
+        out.rgb[i * 3 + 2] = c.z;
+    }
+}
+
+/* =================== EXPORT =================== */
+
+bool writeRayStatsCsv(const std::string& path, const std::vector<RayStatsFrame>& frames) {
+    std::unique_ptr<FILE, int (*)(FILE*)> f(std::fopen(path.c_str(), "w"), &std::fclose);
+    if (!f) return false;
+    FILE* o = f.get();
+    std::fprintf(o, "frame,steps,pixels,empty,in_flame,miss,left,opaque,budget\n");
+    for (const RayStatsFrame& fr : frames) {
+        for (size_t s = 0; s < fr.bins.size(); s++) {
+            const RayStatsBin& b = fr.bins[s];
+            std::fprintf(o, "%d,%zu,%u,%u,%u,%u,%u,%u,%u\n", fr.frame, s, b.pixels, b.empty, b.inFlame,
+                         b.exits[0], b.exits[1], b.exits[2], b.exits[3]);
+        }
+    }
+    return std::ferror(o) == 0;
+}
+
+static void writeArray(FILE* o, const char* name, const RayStatsFrame& fr, uint32_t (*get)(const RayStatsBin&)) {
+    std::fprintf(o, "\"%s\": [", name);
+    for (size_t s = 0; s < fr.bins.size(); s++) std::fprintf(o, s ? ", %u" : "%u", get(fr.bins[s]));
+    std::fprintf(o, "]");
+}
+
+bool writeRayStatsJson(const std::string& path, const std::string& renderer,
+                       const std::vector<RayStatsFrame>& frames) {
+    std::unique_ptr<FILE, int (*)(FILE*)> f(std::fopen(path.c_str(), "w"), &std::fclose);
+    if (!f) return false;
+    FILE* o = f.get();
+
+    std::fprintf(o, "{\n  \"renderer\": \"%s\",\n  \"frames\": [\n", jsonEscape(renderer).c_str());
+    for (size_t i = 0; i < frames.size(); i++) {
+        const RayStatsFrame& fr = frames[i];
+        std::fprintf(o, "    {\"frame\": %d, \"width\": %d, \"height\": %d, \"max_steps\": %d, "
+                        "\"rays_marched\": %llu, \"steps\": %llu, \"empty_steps\": %llu, "
+                        "\"mean_steps\": %.4f, \"p50_steps\": %d, \"p95_steps\": %d, \"p99_steps\": %d, "
+                        "\"empty_fraction\": %.4f, \"early_out_rate\": %.4f,\n     \"exits\": {",
+                     fr.frame, fr.width, fr.height, fr.maxSteps, (unsigned long long)fr.marched(),
+                     (unsigned long long)fr.steps, (unsigned long long)fr.emptySteps, fr.meanSteps(), fr.p50,
+                     fr.p95, fr.p99, fr.emptyFraction(), fr.earlyOutRate());
+        for (int e = 0; e < RAY_EXIT_COUNT; e++)
+            std::fprintf(o, "%s\"%s\": %llu", e ? ", " : "", rayExitName((RayExit)e),
+                         (unsigned long long)fr.exits[e]);
+        std::fprintf(o, "},\n     ");
+        writeArray(o, "steps_histogram", fr, [](const RayStatsBin& b) { return b.pixels; });
+        std::fprintf(o, ",\n     ");
+        writeArray(o, "empty_histogram", fr, [](const RayStatsBin& b) { return b.empty; });
+        std::fprintf(o, ",\n     ");
+        writeArray(o, "in_flame_histogram", fr, [](const RayStatsBin& b) { return b.inFlame; });
+        std::fprintf(o, ",\n     ");
+        writeArray(o, "opaque_histogram", fr, [](const RayStatsBin& b) { return b.exits[(int)RayExit::Opaque]; });
+        std::fprintf(o, "}");
+        std::fprintf(o, i + 1 < frames.size() ? ",\n" : "\n");
+    }
+    std::fprintf(o, "  ]\n}\n");
+    return std::ferror(o) == 0;
+}
+
+std::string rayHeatmapPath(const std::string& prefix, int frame, bool sequence) {
+    if (!sequence) return prefix + "_heatmap.png";
+    char n[16];
+    std::snprintf(n, sizeof(n), "_%04d", frame);
+    return prefix + "_heatmap" + n + ".png";
+}
+
+bool writeRayStats(const std::string& prefix, const std::string& renderer,
+                   const std::vector<RayStatsFrame>& frames) {
+    bool ok = writeRayStatsCsv(prefix + ".csv", frames);
+    ok = writeRayStatsJson(prefix + ".json", renderer, frames) && ok;
+    if (ok) std::printf("Wrote %s.csv, %s.json\n", prefix.c_str(), prefix.c_str());
+    else std::fprintf(stderr, "Failed to write %s.csv / .json\n", prefix.c_str());
+    return ok;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cpu_renderer.h"
+
+/* =================== RAY STATISTICS =================== */
+// Where the flame march spends its budget. A RayCostMap holds, per pixel,
+// the march's loop iterations (density evaluations), how many of them found
+// empty space, and how the march ended (RayExit: missed the sphere, left
+// it, the accAlpha > 0.97 early-out, or out of steps). FlameCpu fills one
+// through RenderOptions::rayCost; Sandbox --headless has flameFS write the
+// same values packed into a storage buffer (packRayCost) and unpacks them,
+// so both renderers share the heatmap and the histograms below.
+
+// Per-pixel march cost of a frame, rows top to bottom like Image
+struct RayCostMap {
+    int width = 0, height = 0;
+    std::vector<uint16_t> steps;        // loop iterations == density evaluations
+    std::vector<uint16_t> emptySteps;   // of those, samples with no density
+    std::vector<RayExit> exit;
+
+    void resize(int w, int h);
+    void set(size_t i, int steps, int emptySteps, RayExit exit);
+};
+
+// flameFS packing, one uint per pixel: steps in bits 0-11, empty steps in
+// 12-23 (both saturating), the RayExit in 24-25
+constexpr uint32_t RAY_COST_FIELD_MAX = 0xfff;
+
+inline uint32_t packRayCost(int steps, int emptySteps, RayExit exit) {
+    return std::min((uint32_t)steps, RAY_COST_FIELD_MAX) |
+           (std::min((uint32_t)emptySteps, RAY_COST_FIELD_MAX) << 12) | ((uint32_t)exit << 24);
+}
+
+// GL rows are bottom first; flip them into map
+void unpackRayCost(const uint32_t* packed, int width, int height, RayCostMap& map);
+
+constexpr int RAY_EXIT_COUNT = 4;
+const char* rayExitName(RayExit exit);   // "miss", "left", "opaque", "budget"
+
+// Pixels with a given number of steps (the bin), split by what they were
+struct RayStatsBin {
+    uint32_t pixels = 0;                    // steps == bin
+    uint32_t empty = 0;                     // empty steps == bin
+    uint32_t inFlame = 0;                   // in-flame steps == bin
+    uint32_t exits[RAY_EXIT_COUNT] = {};    // steps == bin, by RayExit
+};
+
+// Histograms of one frame, bins 0..maxSteps (higher counts land in the last)
+struct RayStatsFrame {
+    int frame = 0;
+    int width = 0, height = 0;
+    int maxSteps = 0;
+    uint64_t steps = 0, emptySteps = 0;
+    uint64_t exits[RAY_EXIT_COUNT] = {};
+    int p50 = 0, p95 = 0, p99 = 0;          // steps of marched rays, nearest rank
+    std::vector<RayStatsBin> bins;
+
+    uint64_t marched() const { return (uint64_t)width * height - exits[(int)RayExit::Miss]; }
+    double meanSteps() const { return marched() ? (double)steps / marched() : 0.0; }
+    double earlyOutRate() const { return marched() ? (double)exits[(int)RayExit::Opaque] / marched() : 0.0; }
+    double emptyFraction() const { return steps ? (double)emptySteps / steps : 0.0; }
+};
+
+RayStatsFrame summarizeRayCost(const RayCostMap& map, int maxSteps, int frame = 0);
+
+// Steps per pixel through a black - blue - red - yellow - white ramp, white
+// at maxSteps; rays that ran out of steps are drawn white
+void rayCostHeatmap(const RayCostMap& map, int maxSteps, Image& out);
+
+// One line: mean / p95 steps, empty fraction, exits
+void printRayStats(const RayStatsFrame& frame);
+
+// CSV, one row per frame and bin:
+//   frame,steps,pixels,empty,in_flame,miss,left,opaque,budget
+// JSON: per frame the summary and the same histograms as arrays
+bool writeRayStatsCsv(const std::string& path, const std::vector<RayStatsFrame>& frames);
+bool writeRayStatsJson(const std::string& path, const std::string& renderer,
+                       const std::vector<RayStatsFrame>& frames);
+
+// The outputs of a --ray-stats prefix run: prefix.csv, prefix.json and
+// prefix_heatmap.png (prefix_heatmap_NNNN.png per frame when there are several)
+std::string rayHeatmapPath(const std::string& prefix, int frame, bool sequence);
+bool writeRayStats(const std::string& prefix, const std::string& renderer,
+                   const std::vector<RayStatsFrame>& frames);
@@ -0,0 +1,528 @@
+#include "render_farm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <type_traits>
+#include "bounded_queue.h"
+#include "image_io.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/* =================== SOCKETS =================== */
+// Just enough of BSD sockets / Winsock for blocking sends, polled receives
+// and a listener. Sockets travel as intptr_t (SOCKET is pointer-sized).
+
+using Clock = std::chrono::steady_clock;
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+constexpr intptr_t NO_SOCKET = (intptr_t)INVALID_SOCKET;
+#else
+using SocketHandle = int;
+constexpr intptr_t NO_SOCKET = -1;
+#endif
+
+bool netInit() {
+#ifdef _WIN32
+    static const bool ok = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return ok;
+#else
+    return true;
+#endif
+}
+
+void closeSocket(intptr_t s) {
+    if (s == NO_SOCKET) return;
+#ifdef _WIN32
+    closesocket((SocketHandle)s);
+#else
+    ::close((int)s);
+#endif
+}
+
+void setNoDelay(intptr_t s) {
+    int one = 1;
+    setsockopt((SocketHandle)s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+}
+
+bool sendAll(intptr_t s, const void* data, size_t bytes) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;   // a dropped peer is an error, not SIGPIPE
+#else
+    const int flags = 0;
+#endif
+    const char* p = (const char*)data;
+    while (bytes > 0) {
+        int chunk = (int)std::min<size_t>(bytes, 1 << 20);
+        int n = (int)send((SocketHandle)s, p, chunk, flags);
+        if (n <= 0) return false;
+        p += n;
+        bytes -= (size_t)n;
+    }
+    return true;
+}
+
+// Blocking; false on error or if the peer closed first
+bool recvAll(intptr_t s, void* data, size_t bytes) {
+    char* p = (char*)data;
+    while (bytes > 0) {
+        int chunk = (int)std::min<size_t>(bytes, 1 << 20);
+        int n = (int)recv((SocketHandle)s, p, chunk, 0);
+        if (n <= 0) return false;
+        p += n;
+        bytes -= (size_t)n;
+    }
+    return true;
+}
+
+int pollSockets(std::vector<pollfd>& fds, int timeoutMs) {
+#ifdef _WIN32
+    return WSAPoll(fds.data(), (ULONG)fds.size(), timeoutMs);
+#else
+    return poll(fds.data(), (nfds_t)fds.size(), timeoutMs);
+#endif
+}
+
+/* =================== PROTOCOL =================== */
+// Every message is a MessageHeader followed by `bytes` of payload:
+//
+//   worker -> coordinator   Hello, then one Result per Frame, or Error
+//                           (the reason, as text) if it refuses the Setup
+//   coordinator -> worker   Setup once, then Frame ..., then Done
+
+constexpr char FARM_MAGIC[4] = {'F', 'L', 'R', 'F'};
+constexpr uint32_t FARM_VERSION = 2;
+
+enum class MessageType : uint32_t { Hello = 1, Setup, Frame, Result, Done, Error };
+
+struct MessageHeader {
+    uint32_t type;
+    uint32_t bytes;
+};
+
+struct HelloMessage {
+    char magic[4];
+    uint32_t version;
+    uint32_t threads;
+};
+
+// The sequence and the options that travel (see render_farm.h)
+struct SetupMessage {
+    char magic[4];
+    uint32_t version;
+    int32_t width, height;
+    float fps;
+    uint32_t floatPixels;   // results carry float RGB (for PFM output), else 8-bit RGB
+    FlameUniforms base;
+    int32_t quality;
+    int32_t tileSize;
+    uint8_t lod, tables, screenRect, pad;
+    float flameScale;
+};
+static_assert(std::is_trivially_copyable_v<SetupMessage>);
+
+struct FrameMessage {
+    int32_t frame;
+};
+
+struct ResultHeader {   // followed by the pixels, rows top to bottom
+    int32_t frame;
+    float renderMs;
+};
+
+bool sendMessage(intptr_t s, MessageType type, const void* payload, size_t bytes,
+                 const void* extra = nullptr, size_t extraBytes = 0) {
+    MessageHeader h{(uint32_t)type, (uint32_t)(bytes + extraBytes)};
+    return sendAll(s, &h, sizeof(h)) && sendAll(s, payload, bytes) && (!extra || sendAll(s, extra, extraBytes));
+}
+
+size_t pixelBytes(int width, int height, bool floatPixels) {
+    return (size_t)width * height * 3 * (floatPixels ? sizeof(float) : 1);
+}
+
+SetupMessage makeSetup(const SequenceSettings& s, const FlameUniforms& base, const RenderOptions& options) {
+    SetupMessage m{};
+    std::memcpy(m.magic, FARM_MAGIC, 4);
+    m.version = FARM_VERSION;
+    m.width = s.width;
+    m.height = s.height;
+    m.fps = s.fps;
+    m.floatPixels = s.writeFloat ? 1 : 0;
+    m.base = base;
+    m.quality = (int32_t)options.quality;
+    m.tileSize = options.tileSize;
+    m.lod = options.lod;
+    m.tables = options.tables;
+    m.screenRect = options.screenRect;
+    m.flameScale = options.flameScale;
+    return m;
+}
+
+// Why a Setup cannot be rendered, or nullptr; checked by the worker on what
+// arrives and by the coordinator before it hands anything out
+const char* setupError(const SetupMessage& m) {
+    if (std::memcmp(m.magic, FARM_MAGIC, 4) != 0 || m.version != FARM_VERSION) return "protocol version mismatch";
+    if (m.width <= 0 || m.height <= 0) return "width and height must be positive";
+    if (!(m.fps > 0.0f)) return "fps must be positive";
+    if (m.quality < 0 || m.quality >= QUALITY_TIER_COUNT) return "unknown quality tier";
+    if (m.tileSize <= 0) return "tile size must be positive";
+    if (!(m.flameScale > 0.0f && m.flameScale <= 1.0f)) return "flame scale must be in (0, 1]";
+    return nullptr;
+}
+
+/* =================== COORDINATOR STATE =================== */
+
+struct WorkerConnection {
+    intptr_t socket = NO_SOCKET;
+    int id = 0;
+    bool ready = false;          // Hello received, Setup sent
+    int frame = -1;              // frame being rendered, or -1 when idle
+    Clock::time_point assigned;
+    std::vector<uint8_t> buffer; // received, not yet parsed
+};
+
+struct ReceivedFrame {
+    int frame;
+    Image image;
+};
+
+} // namespace
+
+/* =================== COORDINATOR =================== */
+
+FarmCoordinator::~FarmCoordinator() { closeSocket(listener_); }
+
+bool FarmCoordinator::listen(int port) {
+    if (!netInit()) return false;
+    closeSocket(listener_);
+    listener_ = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener_ == NO_SOCKET) return false;
+
+    int one = 1;
+    setsockopt((SocketHandle)listener_, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    socklen_t len = sizeof(addr);
+    if (bind((SocketHandle)listener_, (const sockaddr*)&addr, sizeof(addr)) != 0 ||
+        ::listen((SocketHandle)listener_, 64) != 0 ||
+        getsockname((SocketHandle)listener_, (sockaddr*)&addr, &len) != 0) {
+        closeSocket(listener_);
+        listener_ = NO_SOCKET;
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+    return true;
+}
+
+FarmReport FarmCoordinator::run(const SequenceSettings& s, const FlameUniforms& base, const RenderOptions& options,
+                                const FarmSettings& farm) {
+    auto start = Clock::now();
+    FarmReport report;
+
+    std::deque<int> pending;
+    for (int f = s.firstFrame; f <= s.lastFrame; f++) {
+        if (s.resume && frameOutputsExist(s, f)) report.skipped++;
+        else pending.push_back(f);
+    }
+    const int total = (int)pending.size();
+    int received = 0;
+
+    // Every worker would refuse these, so nothing is handed out
+    const SetupMessage setup = makeSetup(s, base, options);
+    if (const char* error = setupError(setup)) {
+        std::fprintf(stderr, "Cannot start the farm: %s\n", error);
+        report.failed = total;
+        return report;
+    }
+
+    // ---- Encoder stage, as in renderSequence ----
+    int encoders = s.encoders > 0 ? s.encoders : 1;
+    BoundedQueue<ReceivedFrame> queue(s.queueCapacity > 0 ? (size_t)s.queueCapacity : (size_t)encoders * 2);
+    std::atomic<int> written{0}, failed{0};
+    std::vector<std::thread> encoderThreads;
+    for (int e = 0; e < encoders; e++) {
+        encoderThreads.emplace_back([&, e] {
+            profilerSetThreadName(("encoder " + std::to_string(e)).c_str());
+            while (std::optional<ReceivedFrame> job = queue.pop()) {
+                PROFILE_SCOPE("encode frame");
+                if (writeFrameOutputs(s, job->frame, job->image)) {
+                    written++;
+                } else {
+                    failed++;
+                    std::fprintf(stderr, "frame %d: failed to write output\n", job->frame);
+                }
+            }
+        });
+    }
+
+    const size_t resultBytes = sizeof(ResultHeader) + pixelBytes(s.width, s.height, s.writeFloat);
+    std::vector<WorkerConnection> workers;
+
+    auto drop = [&](WorkerConnection& w, const char* why) {
+        closeSocket(w.socket);
+        w.socket = NO_SOCKET;
+        report.workersLost++;
+        if (w.frame >= 0) {
+            pending.push_front(w.frame);
+            report.reissued++;
+            if (farm.log) std::printf("worker %d %s; frame %d re-issued\n", w.id, why, w.frame);
+        } else if (farm.log) {
+            std::printf("worker %d %s\n", w.id, why);
+        }
+        w.frame = -1;
+    };
+
+    auto assign = [&](WorkerConnection& w) {
+        if (!w.ready || w.frame >= 0 || pending.empty()) return;
+        FrameMessage m{pending.front()};
+        pending.pop_front();
+        w.frame = m.frame;
+        w.assigned = Clock::now();
+        if (!sendMessage(w.socket, MessageType::Frame, &m, sizeof(m))) drop(w, "lost");
+    };
+
+    // One complete message from w; false drops the worker for why
+    auto handle = [&](WorkerConnection& w, MessageType type, const uint8_t* payload, size_t bytes,
+                      const char*& why) {
+        if (type == MessageType::Hello && !w.ready && bytes == sizeof(HelloMessage)) {
+            HelloMessage hello;
+            std::memcpy(&hello, payload, sizeof(hello));
+            if (std::memcmp(hello.magic, FARM_MAGIC, 4) != 0 || hello.version != FARM_VERSION) return false;
+            if (!sendMessage(w.socket, MessageType::Setup, &setup, sizeof(setup))) return false;
+            w.ready = true;
+            if (farm.log) std::printf("worker %d joined (%u threads)\n", w.id, hello.threads);
+            return true;
+        }
+        if (type == MessageType::Result && w.ready && bytes == resultBytes) {
+            ResultHeader r;
+            std::memcpy(&r, payload, sizeof(r));
+            if (r.frame != w.frame) return false;
+
+            ReceivedFrame job{r.frame, Image{}};
+            job.image.resize(s.width, s.height);
+            const uint8_t* px = payload + sizeof(r);
+            if (s.writeFloat) {
+                std::memcpy(job.image.rgb.data(), px, job.image.rgb.size() * sizeof(float));
+            } else {
+                for (size_t i = 0; i < job.image.rgb.size(); i++) job.image.rgb[i] = px[i] / 255.0f;
+            }
+            if (farm.log) std::printf("frame %d: worker %d, render %.1f ms\n", r.frame, w.id, r.renderMs);
+            report.framesPerWorker[w.id]++;
+            received++;
+            w.frame = -1;
+            if (farm.onFrame) farm.onFrame(r.frame, w.id);
+            queue.push(std::move(job));
+            return true;
+        }
+        if (type == MessageType::Error && w.ready) {
+            if (farm.log) std::printf("worker %d: %.*s\n", w.id, (int)bytes, (const char*)payload);
+            why = "refused the setup";
+        }
+        return false;
+    };
+
+    std::vector<pollfd> fds;
+    std::vector<uint8_t> chunk(1 << 20);
+    while (received < total) {
+        // Re-issued frames go to whoever is idle
+        for (WorkerConnection& w : workers)
+            if (w.socket != NO_SOCKET) assign(w);
+
+        fds.clear();
+        fds.push_back({(SocketHandle)listener_, POLLIN, 0});
+        for (const WorkerConnection& w : workers) fds.push_back({(SocketHandle)w.socket, POLLIN, 0});
+        if (pollSockets(fds, 100) < 0) {
+#ifndef _WIN32
+            if (errno == EINTR) continue;
+#endif
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            intptr_t c = (intptr_t)accept((SocketHandle)listener_, nullptr, nullptr);
+            if (c != NO_SOCKET) {
+                setNoDelay(c);
+                WorkerConnection w;
+                w.socket = c;
+                w.id = report.workersJoined++;
+                report.framesPerWorker.push_back(0);
+                workers.push_back(std::move(w));
+            }
+        }
+
+        auto now = Clock::now();
+        for (size_t i = 1; i < fds.size(); i++) {
+            WorkerConnection& w = workers[i - 1];
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                int n = (int)recv((SocketHandle)w.socket, (char*)chunk.data(), (int)chunk.size(), 0);
+                if (n <= 0) {
+                    drop(w, "disconnected");
+                    continue;
+                }
+                w.buffer.insert(w.buffer.end(), chunk.begin(), chunk.begin() + n);
+
+                size_t used = 0;
+                bool ok = true;
+                const char* why = "sent an invalid message";
+                while (ok && w.buffer.size() - used >= sizeof(MessageHeader)) {
+                    MessageHeader h;
+                    std::memcpy(&h, w.buffer.data() + used, sizeof(h));
+                    if (h.bytes > resultBytes) { ok = false; break; }
+                    if (w.buffer.size() - used < sizeof(h) + h.bytes) break;
+                    ok = handle(w, (MessageType)h.type, w.buffer.data() + used + sizeof(h), h.bytes, why);
+                    used += sizeof(h) + h.bytes;
+                }
+                if (!ok) {
+                    drop(w, why);
+                    continue;
+                }
+                w.buffer.erase(w.buffer.begin(), w.buffer.begin() + used);
+            }
+            if (w.socket != NO_SOCKET && w.frame >= 0 &&
+                std::chrono::duration<double>(now - w.assigned).count() > farm.workerTimeout)
+                drop(w, "timed out");
+        }
+
+        // Forget closed connections
+        std::erase_if(workers, [](const WorkerConnection& w) { return w.socket == NO_SOCKET; });
+    }
+
+    for (WorkerConnection& w : workers) {
+        sendMessage(w.socket, MessageType::Done, nullptr, 0);
+        closeSocket(w.socket);
+    }
+    queue.close();
+    for (auto& t : encoderThreads) t.join();
+
+    report.rendered = written.load();
+    report.failed = failed.load() + (total - received);
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return report;
+}
+
+/* =================== WORKER =================== */
+
+static intptr_t connectTo(const std::string& host, int port, double seconds) {
+    auto deadline = Clock::now() + std::chrono::duration<double>(seconds);
+    std::string service = std::to_string(port);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    for (;;) {
+        addrinfo* list = nullptr;
+        if (getaddrinfo(host.c_str(), service.c_str(), &hints, &list) == 0) {
+            for (addrinfo* a = list; a; a = a->ai_next) {
+                intptr_t s = (intptr_t)socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+                if (s == NO_SOCKET) continue;
+                if (connect((SocketHandle)s, a->ai_addr, (socklen_t)a->ai_addrlen) == 0) {
+                    freeaddrinfo(list);
+                    setNoDelay(s);
+                    return s;
+                }
+                closeSocket(s);
+            }
+            freeaddrinfo(list);
+        }
+        if (Clock::now() >= deadline) return NO_SOCKET;
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+}
+
+bool runFarmWorker(const std::string& host, int port, unsigned threads, double connectSeconds) {
+    if (!netInit()) return false;
+    intptr_t s = connectTo(host, port, connectSeconds);
+    if (s == NO_SOCKET) {
+        std::fprintf(stderr, "Could not connect to %s:%d\n", host.c_str(), port);
+        return false;
+    }
+
+    ThreadPool pool(threads);
+    HelloMessage hello{};
+    std::memcpy(hello.magic, FARM_MAGIC, 4);
+    hello.version = FARM_VERSION;
+    hello.threads = pool.size();
+    bool ok = sendMessage(s, MessageType::Hello, &hello, sizeof(hello));
+
+    SetupMessage setup{};
+    bool haveSetup = false, done = false, refused = false;
+    Image img;
+    std::vector<uint8_t> result;
+    while (ok && !done) {
+        MessageHeader h;
+        if (!recvAll(s, &h, sizeof(h))) break;
+        switch ((MessageType)h.type) {
+        case MessageType::Setup: {
+            ok = h.bytes == sizeof(setup) && recvAll(s, &setup, sizeof(setup));
+            if (!ok) break;
+            if (const char* error = setupError(setup)) {
+                std::fprintf(stderr, "Refusing the coordinator's setup: %s\n", error);
+                sendMessage(s, MessageType::Error, error, std::strlen(error));
+                ok = false;
+                refused = true;
+            }
+            haveSetup = ok;
+            break;
+        }
+        case MessageType::Frame: {
+            FrameMessage m;
+            ok = haveSetup && h.bytes == sizeof(m) && recvAll(s, &m, sizeof(m));
+            if (!ok) break;
+
+            RenderOptions options;
+            options.quality = (QualityTier)setup.quality;
+            options.tileSize = setup.tileSize;
+            options.lod = setup.lod != 0;
+            options.tables = setup.tables != 0;
+            options.screenRect = setup.screenRect != 0;
+            options.flameScale = setup.flameScale;
+            FlameUniforms u = setup.base;
+            u.time = (float)m.frame / setup.fps;
+            u.aspect = (float)setup.width / (float)setup.height;
+            img.resize(setup.width, setup.height);
+            ResultHeader r{m.frame, (float)(renderImage(u, img, pool, options).seconds * 1000.0)};
+
+            // Pixels go out as the coordinator's outputs need them
+            size_t bytes = pixelBytes(setup.width, setup.height, setup.floatPixels != 0);
+            result.resize(bytes);
+            if (setup.floatPixels) std::memcpy(result.data(), img.rgb.data(), bytes);
+            else result = toRGB8(img);
+            ok = sendMessage(s, MessageType::Result, &r, sizeof(r), result.data(), result.size());
+            std::printf("frame %d: %.1f ms\n", m.frame, r.renderMs);
+            break;
+        }
+        case MessageType::Done:
+            done = true;
+            break;
+        default:
+            ok = false;
+        }
+    }
+    closeSocket(s);
+    if (!done && !refused) std::fprintf(stderr, "Lost the coordinator at %s:%d\n", host.c_str(), port);
+    return done;
+}
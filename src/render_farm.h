@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "sequence_renderer.h"
+
+/* =================== DISTRIBUTED SEQUENCE RENDERING =================== */
+// A coordinator hands the frames of a sequence out over TCP to worker
+// processes, which render them with the CPU renderer and stream the pixels
+// back; the coordinator writes the outputs exactly as renderSequence does.
+//
+//   coordinator: FlameCpu --sequence 0:239 --coordinator 7471 ...
+//   workers:     FlameCpu --worker host:7471 [--threads n]
+//
+// Work is handed out one frame at a time, so faster workers take more
+// frames and each worker spreads its frame over its own cores. A worker
+// that disconnects, or sends nothing for FarmSettings::workerTimeout, is
+// dropped and its frame goes back to the front of the queue. Workers may
+// join at any time.
+//
+// Only the procedural flame is distributed: the options that travel are the
+// tier, LOD, lookup tables, screen rect and flame scale (no baked, fluid,
+// volume or scene sources, which would need their data on every worker).
+// The wire format is the host's byte order; all machines in a farm must
+// share it (every x86-64 and arm64 machine does).
+
+constexpr int FARM_DEFAULT_PORT = 7471;
+
+struct FarmSettings {
+    double workerTimeout = 120.0;   // seconds a frame may take before it is re-issued
+    bool log = true;                // print joins, losses and each frame received
+    // Called on the coordinator thread for every frame received (bench / progress hook)
+    std::function<void(int frame, int worker)> onFrame;
+};
+
+struct FarmReport {
+    int rendered = 0;
+    int skipped = 0;
+    int failed = 0;
+    int reissued = 0;        // frames handed out again after a worker was lost
+    int workersJoined = 0;
+    int workersLost = 0;
+    std::vector<int> framesPerWorker;   // indexed by join order
+    double seconds = 0.0;
+};
+
+class FarmCoordinator {
+public:
+    FarmCoordinator() = default;
+    ~FarmCoordinator();
+    FarmCoordinator(const FarmCoordinator&) = delete;
+    FarmCoordinator& operator=(const FarmCoordinator&) = delete;
+
+    // Bind and listen on all interfaces; port 0 picks a free port
+    bool listen(int port);
+    int port() const { return port_; }
+
+    // Render the sequence on whatever workers connect; returns when every
+    // frame is written (or failed to write). settings.renderWorkers is unused
+    FarmReport run(const SequenceSettings& settings, const FlameUniforms& base, const RenderOptions& options,
+                   const FarmSettings& farm = {});
+
+private:
+    intptr_t listener_ = -1;
+    int port_ = 0;
+};
+
+// Connect to a coordinator (retrying for up to connectSeconds), render the
+// frames it sends on a pool of threads (0 = all cores) until it says done.
+// False if it never connected or the connection broke mid-sequence
+bool runFarmWorker(const std::string& host, int port, unsigned threads, double connectSeconds = 30.0);
@@ -1,12 +1,36 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <cstddef>
+#include <filesystem>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 /* =================== MATH =================== */
 #include "math_utils.h"
+#include "bench_path.h"
+#include "bench_report.h"
+#include "bounded_queue.h"
+#include "blue_noise.h"
+#include "dynamic_resolution.h"
+#include "file_watcher.h"
+#include "flame_params.h"
+#include "flame_quality.h"
+#include "flame_tables.h"
+#include "gl_headless.h"
+#include "image_io.h"
+#include "profiler.h"
+#include "ray_stats.h"
+#include "sequence_renderer.h"
+#include "screen_rect.h"
+#include "sim_thread.h"
+#include "temporal_accumulator.h"
 
 /* =================== CAMERA =================== */
 Vec3 camPos = {0.0f, 0.8f, 3.0f};
@@ -67,7 +91,7 @@ void processMovement(GLFWwindow* w, float dt) {
 
 // Fullscreen triangle vertex shader
 const char* fullscreenVS = R"(
-#version 460 core
+#version 450 core
 const vec2 v[3]=vec2[]( vec2(-1,-1), vec2(3,-1), vec2(-1,3) );
 out vec2 uv;
 void main(){
@@ -80,9 +104,10 @@ void main(){
 // VOLUMETRIC FLAME RAYMARCHING FRAGMENT SHADER
 // ==========================================
 const char* flameFS = R"(
-#version 460 core
+#version 450 core
 in vec2 uv;
-out vec4 fragColor;
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out float fragDepth;   // opacity-weighted flame distance, 0 = none
 
 uniform float iTime;
 uniform vec3  iCamPos;
@@ -91,6 +116,64 @@ uniform vec3  iCamUp;
 uniform float iAspect;
 uniform float iFormation;
 
+// March budget: 96 / 64 / 1 normally, QualityTemporal's in temporal mode
+uniform int   iMaxSteps;
+uniform float iStepDivisor;
+uniform int   iOpacitySubsteps;
+
+// Blue-noise start offsets (blue_noise.h); iJitterOffset < 0 disables them
+uniform sampler2D iBlueNoise;
+uniform float iJitterOffset;
+
+// Flame-only pass of the screen rect (screen_rect.h): the viewport covers
+// iUvRect (uv min.xy, max.xy) and the output is the premultiplied flame,
+// colour + alpha, with no background, glow or tone mapping
+uniform bool  iFlameOnly;
+uniform vec4  iUvRect;
+
+// Shape tables (flame_tables.h) on units 1 and 2: profile = radius,
+// heightTemp, blueHeight over h; ramp = colour band, emission over temp
+uniform bool  iUseTables;
+uniform sampler1D iProfileTable;
+uniform sampler1D iRampTable;
+
+// Ray statistics (ray_stats.h): with iRayStats every pixel stores its march
+// cost, packed as packRayCost(), at rayStats[y * iRayStatsWidth + x]
+uniform bool  iRayStats;
+uniform int   iRayStatsWidth;
+layout(std430, binding = 1) writeonly buffer RayStatsBuffer {
+    uint rayStats[];
+};
+const uint RAY_MISS = 0u, RAY_LEFT = 1u, RAY_OPAQUE = 2u, RAY_BUDGET = 3u;
+
+void writeRayStats(int steps, int emptySteps, uint exitReason) {
+    if(!iRayStats) return;
+    ivec2 px = ivec2(gl_FragCoord.xy);
+    rayStats[px.y * iRayStatsWidth + px.x] =
+        uint(min(steps, 0xfff)) | (uint(min(emptySteps, 0xfff)) << 12) | (exitReason << 24);
+}
+
+// Flame parameters (flame_params.h), uploaded by FlameParamBuffer; the
+// colour stops hold rgb and, in w, the temperature their band starts at
+layout(std140, binding = 0) uniform FlameParamBlock {
+    float height;
+    float baseWidth;
+    float turbulence;
+    float turbulenceTip;
+    float flicker;
+    vec2  sway;
+    vec4  stops[7];
+} params;
+
+// Linear interpolation between entries, entry i at x = i / (size - 1), the
+// same way FlameTables::profileAt / rampAt do it on the CPU
+vec4 tableLookup(sampler1D table, float x) {
+    int n = textureSize(table, 0);
+    float f = clamp(x, 0.0, 1.0) * float(n - 1);
+    int i = min(int(f), n - 2);
+    return mix(texelFetch(table, i, 0), texelFetch(table, i + 1, 0), f - float(i));
+}
+
 // =============================================
 // NOISE — Optimized GPU noise functions
 // =============================================
@@ -143,11 +226,9 @@ float fbm(vec3 p, int octaves) {
 //   - Smooth, slightly elongated taper to tip
 //   - Overall aspect ratio ~3:1 (tall and slender)
 
-const float FLAME_HEIGHT = 2.2;
-const float FLAME_BASE_WIDTH = 0.12;
-
 float flameRadius(float h) {
     // h in [0..1]: 0=base, 1=tip
+    if(iUseTables) return tableLookup(iProfileTable, h).x;
     
     // Fast rise from narrow nozzle point
     float rise = 1.0 - exp(-h * 15.0);
@@ -159,11 +240,11 @@ float flameRadius(float h) {
     // Bell-shaped combustion zone bulge, peaking at h=0.35
     float bulge = 1.0 + 0.35 * exp(-pow((h - 0.35) / 0.18, 2.0));
     
-    return FLAME_BASE_WIDTH * rise * taper * bulge;
+    return params.baseWidth * rise * taper * bulge;
 }
 
 float flameSDF(vec3 p) {
-    float h = p.y / FLAME_HEIGHT;
+    float h = p.y / params.height;
     
     if(h < -0.01 || h > 1.01) {
         return length(p.xz) + abs(p.y) * 0.3 + 0.1;
@@ -181,7 +262,7 @@ float flameSDF(vec3 p) {
 // =============================================
 
 float flameDensity(vec3 p, float time) {
-    float h = p.y / FLAME_HEIGHT;
+    float h = p.y / params.height;
     
     // Quick reject
     if(h < -0.01 || h > 1.05) return 0.0;
@@ -194,18 +275,18 @@ float flameDensity(vec3 p, float time) {
     // This is physically correct: the fuel jet stabilizes the base,
     // while the tip is subject to free convective instability
     float turbHeight = smoothstep(0.05, 0.6, h);
-    float turbAmp = 0.08 + turbHeight * 0.18;
+    float turbAmp = params.turbulence + turbHeight * params.turbulenceTip;
     
     // Gentle whole-flame sway (very low frequency)
-    float swayX = noise3D(vec3(time * 0.3, 0.0, 0.0)) * 0.015;
-    float swayZ = noise3D(vec3(0.0, 0.0, time * 0.25)) * 0.012;
+    float swayX = noise3D(vec3(time * 0.3, 0.0, 0.0)) * params.sway.x;
+    float swayZ = noise3D(vec3(0.0, 0.0, time * 0.25)) * params.sway.y;
     
     // Medium turbulence (flame tongue motion)
     float turbX = fbm(noisePos * 3.5, 3) * turbAmp;
     float turbZ = fbm(noisePos * 3.5 + vec3(43.0, 17.0, 31.0), 3) * turbAmp * 0.8;
     
     // Fine flickering at tip
-    float fineAmp = turbHeight * 0.04;
+    float fineAmp = turbHeight * params.flicker;
     float fineX = fbm(noisePos * 9.0 + vec3(0, time * 1.2, 0), 2) * fineAmp;
     float fineZ = fbm(noisePos * 9.0 + vec3(67.0, time * 1.2, 41.0), 2) * fineAmp * 0.7;
     
@@ -241,13 +322,14 @@ float flameDensity(vec3 p, float time) {
 // =============================================
 
 float getTemperature(vec3 p, float density, float time) {
-    float h = clamp(p.y / FLAME_HEIGHT, 0.0, 1.0);
+    float h = clamp(p.y / params.height, 0.0, 1.0);
     float radial = length(p.xz);
     float maxR = flameRadius(h) + 0.01;
     
     // Convective cooling with height
     // Bottom ~30% stays very hot, then exponential decline
-    float heightTemp = exp(-h * 1.8) * 0.7 + (1.0 - h) * 0.3;
+    float heightTemp = iUseTables ? tableLookup(iProfileTable, h).y
+                                  : exp(-h * 1.8) * 0.7 + (1.0 - h) * 0.3;
     
     // Radial: hottest on center axis, coolest at edges
     float radialFactor = 1.0 - smoothstep(0.0, maxR * 0.85, radial);
@@ -279,33 +361,18 @@ float radialFactor(float radial, float h) {
 
 vec3 flameColor(float temp, float h, float radial) {
     // --- Temperature-based color bands ---
+    // Default stops: dim smoke, dark red and dark orange at the cool outer
+    // edges, deep orange and golden mid flame, bright yellow to a white-hot
+    // core above 0.82
     vec3 color;
-    
-    // White-hot core (T > 0.82)
-    vec3 whiteHot    = vec3(1.0, 0.96, 0.88);
-    vec3 brightYellow = vec3(1.0, 0.9, 0.5);
-    
-    // Mid flame
-    vec3 golden      = vec3(1.0, 0.72, 0.18);
-    vec3 deepOrange  = vec3(1.0, 0.48, 0.02);
-    
-    // Cool outer edges
-    vec3 darkOrange  = vec3(0.88, 0.28, 0.0);
-    vec3 darkRed     = vec3(0.55, 0.1, 0.0);
-    vec3 dimSmoke    = vec3(0.18, 0.04, 0.0);
-    
-    if(temp > 0.82) {
-        color = mix(brightYellow, whiteHot, (temp - 0.82) / 0.18);
-    } else if(temp > 0.62) {
-        color = mix(golden, brightYellow, (temp - 0.62) / 0.2);
-    } else if(temp > 0.42) {
-        color = mix(deepOrange, golden, (temp - 0.42) / 0.2);
-    } else if(temp > 0.24) {
-        color = mix(darkOrange, deepOrange, (temp - 0.24) / 0.18);
-    } else if(temp > 0.1) {
-        color = mix(darkRed, darkOrange, (temp - 0.1) / 0.14);
+    if(iUseTables) {
+        color = tableLookup(iRampTable, temp).rgb;
     } else {
-        color = mix(dimSmoke, darkRed, temp / 0.1);
+        int i = 0;
+        for(int k = 1; k < 6; k++)
+            if(temp > params.stops[k].w) i = k;
+        vec4 a = params.stops[i], b = params.stops[i + 1];
+        color = mix(a.rgb, b.rgb, (temp - a.w) / (b.w - a.w));
     }
     
     // --- Blue base zone ---
@@ -314,7 +381,7 @@ vec3 flameColor(float temp, float h, float radial) {
     // The blue is INDEPENDENT of temperature — it's chemiluminescence
     
     // Blue zone strength: strong at base, fades out by h=0.22
-    float blueHeight = smoothstep(0.22, 0.02, h);
+    float blueHeight = iUseTables ? tableLookup(iProfileTable, h).z : smoothstep(0.22, 0.02, h);
     float blueRadial = 1.0 - smoothstep(0.0, flameRadius(h) * 1.2, radial);
     float blueStrength = blueHeight * blueRadial;
     
@@ -354,19 +421,20 @@ void main() {
     vec3 right = normalize(cross(forward, iCamUp));
     vec3 up = cross(right, forward);
     
-    vec3 rd = normalize(forward + uv.x * iAspect * 0.5 * right + uv.y * 0.5 * up);
+    vec2 suv = iFlameOnly ? mix(iUvRect.xy, iUvRect.zw, uv * 0.5 + 0.5) : uv;
+    vec3 rd = normalize(forward + suv.x * iAspect * 0.5 * right + suv.y * 0.5 * up);
     vec3 ro = iCamPos;
     
     // Pure black background
     vec3 bgColor = vec3(0.003, 0.003, 0.006);
     
     // Bounding sphere
-    vec3 sphereCenter = vec3(0.0, FLAME_HEIGHT * 0.45, 0.0);
-    float sphereRadius = FLAME_HEIGHT * 0.65;
+    vec3 sphereCenter = vec3(0.0, params.height * 0.45, 0.0);
+    float sphereRadius = params.height * 0.65;
     vec2 tRange = intersectSphere(ro, rd, sphereCenter, sphereRadius);
     
     // Glow for ALL pixels (ambient warm light cast by flame)
-    vec3 flameCenter = vec3(0.0, FLAME_HEIGHT * 0.35, 0.0);
+    vec3 flameCenter = vec3(0.0, params.height * 0.35, 0.0);
     vec3 toC = flameCenter - ro;
     float tProj = max(dot(toC, rd), 0.0);
     vec3 closest = ro + rd * tProj;
@@ -378,12 +446,21 @@ void main() {
     glowAmt *= iFormation;
     vec3 warmGlow = vec3(1.0, 0.5, 0.12) * glowAmt;
     
-    if(tRange.x < 0.0) {
+    // Miss only if the sphere is entirely behind the camera; a camera
+    // inside the sphere gets tRange.x < 0 and marches from t = 0
+    if(tRange.y < 0.0 && iFlameOnly) {
+        fragColor = vec4(0.0);
+        fragDepth = 0.0;
+        return;
+    }
+    if(tRange.y < 0.0) {
         // Miss — background + glow only
+        writeRayStats(0, 0, RAY_MISS);
         vec3 c = bgColor + warmGlow;
         c = c / (c + 1.0);
         c = pow(c, vec3(1.0/2.2));
         fragColor = vec4(c, 1.0);
+        fragDepth = 0.0;
         return;
     }
     
@@ -392,45 +469,70 @@ void main() {
     // --- Adaptive-step raymarching ---
     // Fewer steps in empty regions, more steps inside the flame
     float totalDist = tRange.y - tRange.x;
-    float baseStep = totalDist / 64.0;
+    float baseStep = totalDist / iStepDivisor;
     baseStep = max(baseStep, 0.01);
     
     vec3 accColor = vec3(0.0);
     float accAlpha = 0.0;
+    float depthSum = 0.0;
     float t = tRange.x;
-    int steps = 0;
-    const int MAX_STEPS = 96;
+    int steps = 0, emptySteps = 0;
+    uint exitReason = RAY_BUDGET;
+    
+    // Jitter shortens the first step, moving every later sample by up to
+    // one stride without skipping anything before it
+    float stepScale = 1.0;
+    if(iJitterOffset >= 0.0) {
+        float bn = texelFetch(iBlueNoise, ivec2(gl_FragCoord.xy) & (textureSize(iBlueNoise, 0) - 1), 0).r;
+        stepScale = 1.0 - fract(bn + iJitterOffset);
+    }
     
-    for(int i = 0; i < MAX_STEPS; i++) {
-        if(accAlpha > 0.97 || t > tRange.y) break;
+    for(; steps < iMaxSteps; steps++) {
+        if(accAlpha > 0.97) { exitReason = RAY_OPAQUE; break; }
+        if(t > tRange.y) { exitReason = RAY_LEFT; break; }
         
+        float step = baseStep * stepScale;
+        stepScale = 1.0;
         vec3 p = ro + rd * t;
         float density = flameDensity(p, iTime);
         
         if(density > 0.001) {
-            float h = clamp(p.y / FLAME_HEIGHT, 0.0, 1.0);
+            float h = clamp(p.y / params.height, 0.0, 1.0);
             float radial = length(p.xz);
             float temp = getTemperature(p, density, iTime);
             vec3 col = flameColor(temp, h, radial);
             
             // Emission: pow curve makes core dramatically brighter
-            float emission = pow(temp, 1.6) * 3.5;
+            float emission = iUseTables ? tableLookup(iRampTable, temp).a : pow(temp, 1.6) * 3.5;
             col *= emission;
             
-            // Opacity per step (Beer-Lambert)
-            float stepLen = baseStep * 0.6;  // finer steps inside flame
-            float alpha = density * stepLen * 18.0;
-            alpha = min(alpha, 0.2);
+            // Opacity per step (Beer-Lambert); a long step is composited
+            // as iOpacitySubsteps equal steps
+            float stepLen = step * 0.6;  // finer steps inside flame
+            float sub = float(iOpacitySubsteps);
+            float alpha = min(density * (stepLen / sub) * 18.0, 0.2);
+            if(iOpacitySubsteps > 1) alpha = 1.0 - pow(1.0 - alpha, sub);
             
+            float before = accAlpha;
             accColor += col * alpha * (1.0 - accAlpha);
             accAlpha += alpha * (1.0 - accAlpha);
+            depthSum += (accAlpha - before) * t;
             
             t += stepLen;
         } else {
             // Empty space — take a larger step
-            t += baseStep * 1.4;
+            emptySteps++;
+            t += step * 1.4;
         }
     }
+    // Out of steps, unless the last one made the ray opaque
+    if(exitReason == RAY_BUDGET && accAlpha > 0.97) exitReason = RAY_OPAQUE;
+    writeRayStats(steps, emptySteps, exitReason);
+    fragDepth = accAlpha > 0.0 ? depthSum / accAlpha : 0.0;
+    if(iFlameOnly) {
+        fragColor = vec4(accColor, accAlpha);
+        return;
+    }
     
     // Final composite
     vec3 finalColor = bgColor * (1.0 - accAlpha) + accColor + warmGlow;
@@ -446,6 +548,220 @@ void main() {
 )";
 
 
+// ==========================================
+// SCREEN RECT COMPOSITE FRAGMENT SHADER
+// ==========================================
+// Full-resolution half of the screen-rect path: every pixel gets the
+// analytic glow; pixels inside the rect whose ray enters the bounding sphere
+// add the flame buffer (flameFS with iFlameOnly), upsampled like
+// upsampleFlame() in cpu_renderer.cpp.
+const char* rectCompositeFS = R"(
+#version 450 core
+in vec2 uv;
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out float fragDepth;
+
+uniform vec3  iCamPos;
+uniform vec3  iCamFront;
+uniform vec3  iCamUp;
+uniform float iAspect;
+uniform float iFormation;
+
+uniform sampler2D iFlame;        // premultiplied colour + alpha
+uniform sampler2D iFlameDepth;
+uniform ivec4 iRect;             // x0, y0, x1, y1 in window pixels, y up
+uniform ivec2 iBufferSize;       // texels of iFlame in use
+uniform float iDepthTolerance;
+
+// flameFS's parameter block, same binding; only the height is read here
+layout(std140, binding = 0) uniform FlameParamBlock {
+    float height;
+    float baseWidth;
+    float turbulence;
+    float turbulenceTip;
+    float flicker;
+    vec2  sway;
+    vec4  stops[7];
+} params;
+
+bool hitsSphere(vec3 ro, vec3 rd, vec3 center, float radius) {
+    vec3 oc = ro - center;
+    float b = dot(oc, rd);
+    float c = dot(oc, oc) - radius * radius;
+    float disc = b * b - c;
+    return disc >= 0.0 && -b + sqrt(disc) >= 0.0;
+}
+
+void main() {
+    vec3 forward = normalize(iCamFront);
+    vec3 right = normalize(cross(forward, iCamUp));
+    vec3 up = cross(right, forward);
+    vec3 rd = normalize(forward + uv.x * iAspect * 0.5 * right + uv.y * 0.5 * up);
+    vec3 ro = iCamPos;
+    
+    vec3 bgColor = vec3(0.003, 0.003, 0.006);
+    
+    // Glow as in flameFS
+    vec3 flameCenter = vec3(0.0, params.height * 0.35, 0.0);
+    float tProj = max(dot(flameCenter - ro, rd), 0.0);
+    vec3 closest = ro + rd * tProj;
+    float dAxis = length(closest.xz);
+    float dCenter = length(closest - flameCenter);
+    float glowAmt = (exp(-dCenter * dCenter * 1.2) * 0.035 + exp(-dAxis * dAxis * 10.0) * 0.015) * iFormation;
+    vec3 warmGlow = vec3(1.0, 0.5, 0.12) * glowAmt;
+    
+    ivec2 pix = ivec2(gl_FragCoord.xy);
+    bool inside = all(greaterThanEqual(pix, iRect.xy)) && all(lessThan(pix, iRect.zw));
+    if(!inside || !hitsSphere(ro, rd, vec3(0.0, params.height * 0.45, 0.0), params.height * 0.65)) {
+        vec3 c = bgColor + warmGlow;
+        c = c / (c + 1.0);
+        fragColor = vec4(pow(c, vec3(1.0/2.2)), 1.0);
+        fragDepth = 0.0;
+        return;
+    }
+    
+    // Bilinear over premultiplied colour, alpha and depth * alpha; taps at a
+    // different depth than the most visible one are left out
+    vec2 p = (gl_FragCoord.xy - vec2(iRect.xy)) * vec2(iBufferSize) / vec2(iRect.zw - iRect.xy) - 0.5;
+    ivec2 p0 = ivec2(floor(p));
+    vec2 f = p - vec2(p0);
+    vec4 taps[4];
+    float depths[4], bilinear[4];
+    int front = 0;
+    for(int k = 0; k < 4; k++) {
+        ivec2 q = clamp(p0 + ivec2(k & 1, k >> 1), ivec2(0), iBufferSize - 1);
+        taps[k] = texelFetch(iFlame, q, 0);
+        depths[k] = texelFetch(iFlameDepth, q, 0).r;
+        bilinear[k] = ((k & 1) == 1 ? f.x : 1.0 - f.x) * ((k >> 1) == 1 ? f.y : 1.0 - f.y);
+        if(bilinear[k] * taps[k].a > bilinear[front] * taps[front].a) front = k;
+    }
+    float ref = depths[front];
+    vec4 flame = vec4(0.0);
+    float depthSum = 0.0, weight = 0.0;
+    for(int k = 0; k < 4; k++) {
+        if(taps[k].a > 0.0 && ref > 0.0 && abs(depths[k] - ref) > iDepthTolerance * ref) continue;
+        flame += taps[k] * bilinear[k];
+        depthSum += depths[k] * taps[k].a * bilinear[k];
+        weight += bilinear[k];
+    }
+    if(weight > 0.0) {
+        flame /= weight;
+        depthSum /= weight;
+    }
+    fragDepth = flame.a > 0.0 ? depthSum / flame.a : 0.0;
+    
+    // Composite and tone map as flameFS
+    vec3 c = bgColor * (1.0 - flame.a) + flame.rgb + warmGlow;
+    c = c / (c + 0.8) * 1.1;
+    fragColor = vec4(pow(max(c, vec3(0.0)), vec3(1.0/2.2)), 1.0);
+}
+)";
+
+// ==========================================
+// TEMPORAL RESOLVE FRAGMENT SHADER
+// ==========================================
+// GPU side of TemporalAccumulator (temporal_accumulator.h): reprojects the
+// history with the previous camera, keeps only texels whose depth matches,
+// clamps it to the new frame's neighbourhood and blends.
+const char* temporalFS = R"(
+#version 450 core
+in vec2 uv;
+layout(location = 0) out vec4 outColor;   // rgb history
+layout(location = 1) out vec2 outData;    // depth, frames accumulated
+
+uniform sampler2D iFrame;         // flame pass colour
+uniform sampler2D iFrameDepth;    // flame pass depth
+uniform sampler2D iHistory;
+uniform sampler2D iHistoryData;
+uniform bool  iHasHistory;
+
+uniform vec3  iCamPos, iCamFront, iCamUp;
+uniform float iAspect;
+uniform vec3  iPrevCamPos, iPrevCamFront, iPrevCamUp;
+uniform float iPrevAspect;
+
+uniform float iBlend;
+uniform float iDepthTolerance;
+uniform float iDepthSlack;
+uniform float iClipSigma;
+
+void basis(vec3 front, vec3 camUp, out vec3 forward, out vec3 right, out vec3 up) {
+    forward = normalize(front);
+    right = normalize(cross(forward, camUp));
+    up = cross(right, forward);
+}
+
+void main() {
+    ivec2 size = textureSize(iFrame, 0);
+    ivec2 pix = ivec2(gl_FragCoord.xy);
+    vec3 c = texelFetch(iFrame, pix, 0).rgb;
+    float d = texelFetch(iFrameDepth, pix, 0).r;
+    
+    outColor = vec4(c, 1.0);
+    outData = vec2(d, 1.0);
+    if(!iHasHistory) return;
+    
+    // Reproject: flame pixels by world position, the rest by direction
+    vec3 fw, rt, up;
+    basis(iCamFront, iCamUp, fw, rt, up);
+    vec3 rd = normalize(fw + uv.x * iAspect * 0.5 * rt + uv.y * 0.5 * up);
+    vec3 toPrev = d > 0.0 ? iCamPos + rd * d - iPrevCamPos : rd;
+    float expected = d > 0.0 ? length(toPrev) : 0.0;
+    
+    vec3 pfw, prt, pup;
+    basis(iPrevCamFront, iPrevCamUp, pfw, prt, pup);
+    float z = dot(toPrev, pfw);
+    if(z <= 1e-4) return;
+    vec2 prevUv = vec2(dot(toPrev, prt) / z / (iPrevAspect * 0.5), dot(toPrev, pup) / z / 0.5);
+    vec2 p = (prevUv * 0.5 + 0.5) * vec2(size) - 0.5;
+    if(p.x <= -1.0 || p.y <= -1.0 || p.x >= float(size.x) || p.y >= float(size.y)) return;
+    
+    // Bilinear history over the texels whose depth matches
+    ivec2 p0 = ivec2(floor(p));
+    vec2 f = p - vec2(p0);
+    vec3 hist = vec3(0.0);
+    float weight = 0.0, bestWeight = 0.0, samples = 0.0;
+    for(int k = 0; k < 4; k++) {
+        ivec2 o = ivec2(k & 1, k >> 1);
+        ivec2 q = clamp(p0 + o, ivec2(0), size - 1);
+        vec2 hd = texelFetch(iHistoryData, q, 0).rg;
+        bool match = d > 0.0 ? hd.x > 0.0 && abs(hd.x - expected) <= iDepthTolerance * expected + iDepthSlack
+                             : hd.x == 0.0;
+        if(!match) continue;
+        float bw = (o.x == 1 ? f.x : 1.0 - f.x) * (o.y == 1 ? f.y : 1.0 - f.y);
+        hist += texelFetch(iHistory, q, 0).rgb * bw;
+        weight += bw;
+        if(bw > bestWeight) { bestWeight = bw; samples = hd.y; }
+    }
+    if(weight <= 1e-4) return;
+    hist /= weight;
+    
+    // Clamp to the new frame's neighbourhood: mean +- iClipSigma std devs
+    vec3 lo = c, hi = c, sum = vec3(0.0), sumSq = vec3(0.0);
+    float count = 0.0;
+    for(int y = -1; y <= 1; y++) {
+        for(int x = -1; x <= 1; x++) {
+            ivec2 q = pix + ivec2(x, y);
+            if(any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, size))) continue;
+            vec3 n = texelFetch(iFrame, q, 0).rgb;
+            lo = min(lo, n);
+            hi = max(hi, n);
+            sum += n;
+            sumSq += n * n;
+            count += 1.0;
+        }
+    }
+    vec3 mean = sum / count;
+    vec3 sigma = sqrt(max(sumSq / count - mean * mean, 0.0)) * iClipSigma;
+    hist = clamp(hist, max(lo, mean - sigma), min(hi, mean + sigma));
+    
+    // Running mean until the history holds 1 / iBlend frames, then exponential
+    float n = min(samples + 1.0, floor(1.0 / iBlend + 0.5));
+    outColor = vec4(mix(hist, c, 1.0 / n), 1.0);
+    outData = vec2(d, n);
+}
+)";
+
 /* =================== SHADER UTILITIES =================== */
 
 GLuint makeProg(const char* vs, const char* fs) {
@@ -480,112 +796,1194 @@ GLuint makeProg(const char* vs, const char* fs) {
     return p;
 }
 
+/* =================== GPU TIMERS =================== */
+// GL timestamp queries around the passes while the profiler is on. Results
+// are read GPU_TIMER_FRAMES frames later, when they are long done, so the
+// queries never stall the pipeline, and are recorded on the profiler's
+// "GPU" track converted to profilerNow() time.
+
+constexpr int GPU_TIMER_FRAMES = 4;
+constexpr int GPU_TIMER_PASSES = 16;   // per frame; further passes go untimed
+
+struct GpuTimers {
+    int track = 0;                     // 0 until gpuTimersInit()
+    int64_t toCpu = 0;                 // GL_TIMESTAMP + toCpu = profilerNow()
+    GLuint queries[GPU_TIMER_FRAMES][GPU_TIMER_PASSES][2] = {};
+    const char* names[GPU_TIMER_FRAMES][GPU_TIMER_PASSES] = {};
+    int count[GPU_TIMER_FRAMES] = {};
+    int frame = 0;                     // slot being recorded
+};
+
+static GpuTimers gpuTimers;
+
+void gpuTimersInit() {
+    GpuTimers& g = gpuTimers;
+    g.track = profilerAddTrack("GPU");
+    glGenQueries(GPU_TIMER_FRAMES * GPU_TIMER_PASSES * 2, &g.queries[0][0][0]);
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    g.toCpu = (int64_t)profilerNow() - gpuNow;
+}
+
+void gpuTimersRelease() {
+    if (gpuTimers.track) glDeleteQueries(GPU_TIMER_FRAMES * GPU_TIMER_PASSES * 2, &gpuTimers.queries[0][0][0]);
+}
+
+// Call once per frame before its passes: collects the oldest slot and reuses it
+void gpuTimersNextFrame() {
+    GpuTimers& g = gpuTimers;
+    if (!g.track) return;
+    g.frame = (g.frame + 1) % GPU_TIMER_FRAMES;
+    for (int i = 0; i < g.count[g.frame]; i++) {
+        GLuint64 t0 = 0, t1 = 0;
+        glGetQueryObjectui64v(g.queries[g.frame][i][0], GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(g.queries[g.frame][i][1], GL_QUERY_RESULT, &t1);
+        profilerRecordOn(g.track, g.names[g.frame][i], t0 + g.toCpu, t1 + g.toCpu);
+    }
+    g.count[g.frame] = 0;
+}
+
+// Times the GL commands issued during its lifetime
+class GpuScope {
+public:
+    explicit GpuScope(const char* name) {
+        GpuTimers& g = gpuTimers;
+        if (!g.track || !profilerEnabled() || g.count[g.frame] == GPU_TIMER_PASSES) return;
+        slot_ = g.count[g.frame]++;
+        g.names[g.frame][slot_] = name;
+        glQueryCounter(g.queries[g.frame][slot_][0], GL_TIMESTAMP);
+    }
+    ~GpuScope() {
+        if (slot_ >= 0) glQueryCounter(gpuTimers.queries[gpuTimers.frame][slot_][1], GL_TIMESTAMP);
+    }
+
+    GpuScope(const GpuScope&) = delete;
+    GpuScope& operator=(const GpuScope&) = delete;
+
+private:
+    int slot_ = -1;
+};
+
+/* =================== FLAME PROGRAM =================== */
+
+// Blue-noise map for the march jitter, sampled from texture unit 0
+GLuint makeBlueNoiseTexture() {
+    BlueNoise noise = makeBlueNoise();
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, noise.size, noise.size, 0, GL_RED, GL_FLOAT, noise.values.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return tex;
+}
+
+// FlameTables as 1D RGBA32F textures, one entry per texel
+GLuint makeTableTexture(const void* entries, int size) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_1D, tex);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, size, 0, GL_RGBA, GL_FLOAT, entries);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return tex;
+}
+
+struct FlameProgram {
+    GLuint prog = 0;
+    GLuint blueNoise = 0;
+    GLuint profileTable = 0, rampTable = 0;
+    bool useTables = false;   // shape and colour from the tables (--lut, L)
+    FlameParams params;       // in paramBuffer, and what tables was built from
+    GLuint paramBuffer = 0;
+    FlameTables tables;
+    GLint uTime, uCamPos, uCamFront, uCamUp, uAspect, uFormation;
+    GLint uMaxSteps, uStepDivisor, uOpacitySubsteps, uJitterOffset;
+    GLint uFlameOnly, uUvRect, uUseTables;
+    GLint uRayStats, uRayStatsWidth;
+    GLuint rayStatsBuffer = 0;   // RayStatsBuffer while recording (enableRayStats)
+    int rayStatsWidth = 0, rayStatsHeight = 0;
+};
+
+void initFlameParams(FlameProgram& fp, const FlameParams& params);
+
+FlameProgram makeFlameProgram(const FlameParams& params) {
+    FlameProgram fp;
+    fp.prog = makeProg(fullscreenVS, flameFS);
+    fp.uTime = glGetUniformLocation(fp.prog, "iTime");
+    fp.uCamPos = glGetUniformLocation(fp.prog, "iCamPos");
+    fp.uCamFront = glGetUniformLocation(fp.prog, "iCamFront");
+    fp.uCamUp = glGetUniformLocation(fp.prog, "iCamUp");
+    fp.uAspect = glGetUniformLocation(fp.prog, "iAspect");
+    fp.uFormation = glGetUniformLocation(fp.prog, "iFormation");
+    fp.uMaxSteps = glGetUniformLocation(fp.prog, "iMaxSteps");
+    fp.uStepDivisor = glGetUniformLocation(fp.prog, "iStepDivisor");
+    fp.uOpacitySubsteps = glGetUniformLocation(fp.prog, "iOpacitySubsteps");
+    fp.uJitterOffset = glGetUniformLocation(fp.prog, "iJitterOffset");
+    fp.uFlameOnly = glGetUniformLocation(fp.prog, "iFlameOnly");
+    fp.uUvRect = glGetUniformLocation(fp.prog, "iUvRect");
+    fp.uUseTables = glGetUniformLocation(fp.prog, "iUseTables");
+    fp.uRayStats = glGetUniformLocation(fp.prog, "iRayStats");
+    fp.uRayStatsWidth = glGetUniformLocation(fp.prog, "iRayStatsWidth");
+    glUseProgram(fp.prog);
+    glUniform1i(glGetUniformLocation(fp.prog, "iBlueNoise"), 0);
+    glUniform1i(glGetUniformLocation(fp.prog, "iProfileTable"), 1);
+    glUniform1i(glGetUniformLocation(fp.prog, "iRampTable"), 2);
+    fp.blueNoise = makeBlueNoiseTexture();
+    initFlameParams(fp, params);
+    return fp;
+}
+
+/* =================== FLAME PARAMETERS =================== */
+// FlameParamBlock is a uniform buffer on binding 0, read by flameFS and
+// rectCompositeFS. With --params the block comes from a file that is
+// reloaded whenever it is saved: the buffer is rewritten in place and only
+// what the changed groups reach is rebuilt (flameCachesFor), so a retune
+// shows on the next frame with no shader compile or link.
+
+// FlameParamBlock in std140 layout: sway is a vec2, 8-byte aligned
+struct FlameParamBlockStd140 {
+    float height, baseWidth, turbulence, turbulenceTip, flicker, pad;
+    float sway[2];
+    float stops[FLAME_COLOR_STOPS][4];
+};
+static_assert(sizeof(FlameParamBlockStd140) == 144, "FlameParamBlock std140 layout");
+
+void writeFlameParamBlock(const FlameProgram& fp) {
+    const FlameParams& p = fp.params;
+    FlameParamBlockStd140 b = {p.height, p.baseWidth, p.turbulence, p.turbulenceTip, p.flicker, 0.0f,
+                               {p.swayX, p.swayZ}, {}};
+    for (int i = 0; i < FLAME_COLOR_STOPS; i++) {
+        const FlameColorStop& s = p.stops[i];
+        b.stops[i][0] = s.color.x;
+        b.stops[i][1] = s.color.y;
+        b.stops[i][2] = s.color.z;
+        b.stops[i][3] = s.temp;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, fp.paramBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(b), &b);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Parameter buffer and tables for a new program
+void initFlameParams(FlameProgram& fp, const FlameParams& params) {
+    fp.params = params;
+    glGenBuffers(1, &fp.paramBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, fp.paramBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FlameParamBlockStd140), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, fp.paramBuffer);
+    writeFlameParamBlock(fp);
+    buildFlameProfileTable(fp.tables, params);
+    buildFlameRampTable(fp.tables, params);
+    fp.profileTable = makeTableTexture(fp.tables.profile.data(), FLAME_PROFILE_TABLE_SIZE);
+    fp.rampTable = makeTableTexture(fp.tables.ramp.data(), FLAME_RAMP_TABLE_SIZE);
+}
+
+// Switch fp to params, rebuilding only what differs from the current
+// block; returns what was invalidated (FlameParamCache bits). Bounds need
+// nothing here, the rect pass reads the sphere from fp.params each frame;
+// the caller clears temporal history on CACHE_HISTORY
+unsigned applyFlameParams(FlameProgram& fp, const FlameParams& params) {
+    unsigned caches = flameCachesFor(flameParamsChanged(fp.params, params));
+    fp.params = params;
+    if (caches & CACHE_UNIFORMS) writeFlameParamBlock(fp);
+    if (caches & CACHE_PROFILE_TABLE) {
+        buildFlameProfileTable(fp.tables, params);
+        glBindTexture(GL_TEXTURE_1D, fp.profileTable);
+        glTexSubImage1D(GL_TEXTURE_1D, 0, 0, FLAME_PROFILE_TABLE_SIZE, GL_RGBA, GL_FLOAT, fp.tables.profile.data());
+    }
+    if (caches & CACHE_RAMP_TABLE) {
+        buildFlameRampTable(fp.tables, params);
+        glBindTexture(GL_TEXTURE_1D, fp.rampTable);
+        glTexSubImage1D(GL_TEXTURE_1D, 0, 0, FLAME_RAMP_TABLE_SIZE, GL_RGBA, GL_FLOAT, fp.tables.ramp.data());
+    }
+    glBindTexture(GL_TEXTURE_1D, 0);
+    return caches;
+}
+
+// Reload a --params file that was saved; a file that does not parse leaves
+// the flame as it was. Returns the invalidated caches
+unsigned reloadFlameParams(FlameProgram& fp, const std::string& path) {
+    auto t0 = std::chrono::steady_clock::now();
+    FlameParams params;
+    if (!loadFlameParams(path, params)) {
+        std::cerr << "[Params] Keeping the previous parameters" << std::endl;
+        return 0;
+    }
+    unsigned groups = flameParamsChanged(fp.params, params);
+    unsigned caches = applyFlameParams(fp, params);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (groups)
+        std::printf("[Params] %s: %s changed, rebuilt %s in %.2f ms\n", path.c_str(),
+                    flameParamGroupNames(groups).c_str(), flameParamCacheNames(caches).c_str(), ms);
+    else
+        std::printf("[Params] %s: no changes\n", path.c_str());
+    std::fflush(stdout);
+    return caches;
+}
+
+// Step budget and jitter of the flame march; the defaults are the shader's own
+struct FlameMarch {
+    int   maxSteps = QualityProduction::maxSteps;
+    float stepDivisor = QualityProduction::stepDivisor;
+    int   opacitySubsteps = QualityProduction::opacitySubsteps;
+    float jitterOffset = -1.0f;   // blueNoiseOffset(frame); < 0 = no jitter
+};
+
+// Upload uniforms and draw the fullscreen flame triangle. flameOnlyUvRect
+// (uv min x, y, max x, y) draws just the premultiplied flame of that part of
+// the screen into the bound target; null draws the composited frame.
+void drawFlame(const FlameProgram& fp, GLuint vao, float time, Vec3 pos, Vec3 front,
+               float aspect, float formation, const FlameMarch& march = {},
+               const float* flameOnlyUvRect = nullptr) {
+    GpuScope gpu("flame march");
+    {
+        PROFILE_SCOPE("upload uniforms");
+        glUseProgram(fp.prog);
+        glUniform1f(fp.uTime, time);
+        glUniform3f(fp.uCamPos, pos.x, pos.y, pos.z);
+        glUniform3f(fp.uCamFront, front.x, front.y, front.z);
+        glUniform3f(fp.uCamUp, camUp.x, camUp.y, camUp.z);
+        glUniform1f(fp.uAspect, aspect);
+        glUniform1f(fp.uFormation, formation);
+        glUniform1i(fp.uMaxSteps, march.maxSteps);
+        glUniform1f(fp.uStepDivisor, march.stepDivisor);
+        glUniform1i(fp.uOpacitySubsteps, march.opacitySubsteps);
+        glUniform1f(fp.uJitterOffset, march.jitterOffset);
+        glUniform1i(fp.uFlameOnly, flameOnlyUvRect != nullptr);
+        if (flameOnlyUvRect) glUniform4fv(fp.uUvRect, 1, flameOnlyUvRect);
+        glUniform1i(fp.uUseTables, fp.useTables);
+        glUniform1i(fp.uRayStats, fp.rayStatsBuffer != 0 && !flameOnlyUvRect);
+        glUniform1i(fp.uRayStatsWidth, fp.rayStatsWidth);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, fp.blueNoise);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, fp.profileTable);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_1D, fp.rampTable);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    PROFILE_SCOPE("draw flame");
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+/* =================== RAY STATISTICS =================== */
+// --ray-stats: full-screen flame draws also store each pixel's march cost
+// in RayStatsBuffer, a storage buffer on binding 1 with one uint per pixel.
+// Every pixel writes its own slot, so the buffer needs no clearing between
+// frames. Reading it back stalls on the draw; this is a debug mode.
+
+void enableRayStats(FlameProgram& fp, int width, int height) {
+    fp.rayStatsWidth = width;
+    fp.rayStatsHeight = height;
+    glGenBuffers(1, &fp.rayStatsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, fp.rayStatsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)width * height * sizeof(uint32_t), nullptr, GL_STREAM_READ);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, fp.rayStatsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// The last full-screen draw's costs
+void readRayStats(const FlameProgram& fp, RayCostMap& map) {
+    PROFILE_SCOPE("read ray stats");
+    std::vector<uint32_t> packed((size_t)fp.rayStatsWidth * fp.rayStatsHeight);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, fp.rayStatsBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)(packed.size() * sizeof(uint32_t)), packed.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    unpackRayCost(packed.data(), fp.rayStatsWidth, fp.rayStatsHeight, map);
+}
+
+/* =================== RENDER TARGETS =================== */
+
+// Framebuffer finished frames end up in: the window's, or the output target
+// of a --headless run
+static GLuint presentFbo = 0;
+
+static GLuint makeTargetTexture(GLenum format, int w, int h) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexStorage2D(GL_TEXTURE_2D, 1, format, w, h);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return tex;
+}
+
+static GLuint makeTargetFbo(GLuint color, GLuint data) {
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, data, 0);
+    const GLenum buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, buffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "[FBO] Incomplete framebuffer" << std::endl;
+    return fbo;
+}
+
+// Single colour attachment, like the window's framebuffer
+static GLuint makeColorFbo(GLuint color) {
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "[FBO] Incomplete framebuffer" << std::endl;
+    return fbo;
+}
+
+/* =================== MARCH TIMER =================== */
+// GL timestamp queries around the rect pass's flame march for the dynamic
+// resolution controller, as in GpuTimers but always on. Results are read once the GPU reports them
+// available, normally a couple of frames later, so reading never stalls; a
+// frame is left untimed if every query is still in flight.
+
+constexpr int MARCH_TIMER_QUERIES = 8;
+
+struct MarchTimer {
+    GLuint queries[MARCH_TIMER_QUERIES][2] = {};
+    long long pixels[MARCH_TIMER_QUERIES] = {};   // marched by each timed pass
+    int next = 0, pending = 0;                    // oldest in flight: next - pending
+};
+
+// Start timing a march of pixels; false (nothing started) if no query is free
+bool beginMarchTimer(MarchTimer& t, long long pixels) {
+    if (!t.queries[0][0]) glGenQueries(MARCH_TIMER_QUERIES * 2, &t.queries[0][0]);
+    if (t.pending == MARCH_TIMER_QUERIES) return false;
+    t.pixels[t.next] = pixels;
+    glQueryCounter(t.queries[t.next][0], GL_TIMESTAMP);
+    return true;
+}
+
+void endMarchTimer(MarchTimer& t) {
+    glQueryCounter(t.queries[t.next][1], GL_TIMESTAMP);
+    t.next = (t.next + 1) % MARCH_TIMER_QUERIES;
+    t.pending++;
+}
+
+// Hand every finished march time, oldest first, to the controller
+void readMarchTimes(MarchTimer& t, DynamicResolution& dyn) {
+    while (t.pending > 0) {
+        int i = (t.next - t.pending + MARCH_TIMER_QUERIES) % MARCH_TIMER_QUERIES;
+        GLint available = 0;
+        glGetQueryObjectiv(t.queries[i][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint64 t0 = 0, t1 = 0;
+        glGetQueryObjectui64v(t.queries[i][0], GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(t.queries[i][1], GL_QUERY_RESULT, &t1);
+        dyn.addSample((double)(t1 - t0) * 1e-6, t.pixels[i]);
+        t.pending--;
+    }
+}
+
+void releaseMarchTimer(MarchTimer& t) {
+    if (t.queries[0][0]) glDeleteQueries(MARCH_TIMER_QUERIES * 2, &t.queries[0][0]);
+    t = MarchTimer{};
+}
+
+void logScaleChange(const ScaleChange& c, const DynamicResolutionSettings& s) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "[DynRes] frame %d: flame scale %.3f -> %.3f (march %.2f ms, %.2f ms "
+                  "predicted at %.3f, budget %.2f ms)", c.frame, c.from, c.to, c.sampleMs, c.predictedMs,
+                  c.from, s.budgetMs);
+    std::cout << line << std::endl;
+}
+
+/* =================== SCREEN RECT =================== */
+// With --screen-rect / --flame-scale (toggle: R) flameFS marches only the
+// flame's projected bounding rect (screen_rect.h), at flame scale x the
+// window resolution, into an offscreen buffer; rectCompositeFS then draws
+// every window pixel, upsampling the buffer inside the rect and giving the
+// rest the glow alone. With --dynamic-res (toggle: G) the flame scale is
+// picked every frame to keep the march under a GPU time budget
+// (dynamic_resolution.h), up to --flame-scale.
+
+struct FlameRectPass {
+    GLuint prog = 0;
+    GLint uCamPos, uCamFront, uCamUp, uAspect, uFormation, uRect, uBufferSize;
+    float scale = 1.0f;
+    float maxScale = 1.0f;              // the buffer is sized for this scale
+    DynamicResolution* dynamic = nullptr;   // picks scale each frame when set
+    MarchTimer timer;                   // times the march for dynamic
+
+    int width = 0, height = 0;          // window size the buffer is for
+    GLuint fbo = 0, tex[2] = {};        // premultiplied flame RGBA16F, depth R32F
+    ScreenRect rect;                    // last frame's, rows top to bottom
+    int bufferW = 0, bufferH = 0;       // texels of the buffer it used
+
+    long long shadedPixels() const { return (long long)bufferW * bufferH; }
+    long long skippedPixels() const { return (long long)width * height - rect.area(); }
+};
+
+FlameRectPass makeFlameRectPass(float scale) {
+    FlameRectPass rp;
+    rp.scale = rp.maxScale = scale;
+    rp.prog = makeProg(fullscreenVS, rectCompositeFS);
+    rp.uCamPos = glGetUniformLocation(rp.prog, "iCamPos");
+    rp.uCamFront = glGetUniformLocation(rp.prog, "iCamFront");
+    rp.uCamUp = glGetUniformLocation(rp.prog, "iCamUp");
+    rp.uAspect = glGetUniformLocation(rp.prog, "iAspect");
+    rp.uFormation = glGetUniformLocation(rp.prog, "iFormation");
+    rp.uRect = glGetUniformLocation(rp.prog, "iRect");
+    rp.uBufferSize = glGetUniformLocation(rp.prog, "iBufferSize");
+    glUseProgram(rp.prog);
+    glUniform1i(glGetUniformLocation(rp.prog, "iFlame"), 0);
+    glUniform1i(glGetUniformLocation(rp.prog, "iFlameDepth"), 1);
+    glUniform1f(glGetUniformLocation(rp.prog, "iDepthTolerance"), UPSAMPLE_DEPTH_TOLERANCE);
+    return rp;
+}
+
+void releaseFlameRectTargets(FlameRectPass& rp) {
+    if (!rp.fbo) return;
+    glDeleteFramebuffers(1, &rp.fbo);
+    glDeleteTextures(2, rp.tex);
+    rp.fbo = 0;
+    rp.width = rp.height = 0;
+}
+
+// Buffer for the whole window at the largest flame scale; a frame uses its corner
+void resizeFlameRectTargets(FlameRectPass& rp, int w, int h) {
+    if (rp.width == w && rp.height == h) return;
+    releaseFlameRectTargets(rp);
+    rp.width = w;
+    rp.height = h;
+    int bw, bh;
+    flameBufferSize(ScreenRect{0, 0, w, h}, rp.maxScale, bw, bh);
+    rp.tex[0] = makeTargetTexture(GL_RGBA16F, bw, bh);
+    rp.tex[1] = makeTargetTexture(GL_R32F, bw, bh);
+    rp.fbo = makeTargetFbo(rp.tex[0], rp.tex[1]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Flame pass over the rect, then the full-resolution composite into target
+void drawFlameRect(FlameRectPass& rp, const FlameProgram& fp, GLuint vao, float time, Vec3 pos,
+                   Vec3 front, int w, int h, float formation, const FlameMarch& march, GLuint target) {
+    resizeFlameRectTargets(rp, w, h);
+    float aspect = (float)w / (float)h;
+
+    FlameUniforms u;
+    u.camPos = pos;
+    u.camFront = front;
+    u.camUp = camUp;
+    u.aspect = aspect;
+    const ScreenRect& r = rp.rect = flameScreenRect(u, w, h, fp.params.sphereCenter(), fp.params.sphereRadius());
+    if (rp.dynamic) {
+        readMarchTimes(rp.timer, *rp.dynamic);
+        ScaleChange c;
+        if (rp.dynamic->update(r.area(), &c)) logScaleChange(c, rp.dynamic->settings());
+        rp.scale = rp.dynamic->scale();
+    }
+    flameBufferSize(r, rp.scale, rp.bufferW, rp.bufferH);
+
+    if (!r.empty()) {
+        const float uvRect[4] = {2.0f * r.x0 / w - 1.0f, 1.0f - 2.0f * r.y1 / h,
+                                 2.0f * r.x1 / w - 1.0f, 1.0f - 2.0f * r.y0 / h};
+        glBindFramebuffer(GL_FRAMEBUFFER, rp.fbo);
+        glViewport(0, 0, rp.bufferW, rp.bufferH);
+        bool timed = rp.dynamic && beginMarchTimer(rp.timer, rp.shadedPixels());
+        drawFlame(fp, vao, time, pos, front, aspect, formation, march, uvRect);
+        if (timed) endMarchTimer(rp.timer);
+    }
+
+    GpuScope gpu("rect composite");
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, w, h);
+    glUseProgram(rp.prog);
+    glUniform3f(rp.uCamPos, pos.x, pos.y, pos.z);
+    glUniform3f(rp.uCamFront, front.x, front.y, front.z);
+    glUniform3f(rp.uCamUp, camUp.x, camUp.y, camUp.z);
+    glUniform1f(rp.uAspect, aspect);
+    glUniform1f(rp.uFormation, formation);
+    glUniform4i(rp.uRect, r.x0, h - r.y1, r.x1, h - r.y0);
+    glUniform2i(rp.uBufferSize, rp.bufferW, rp.bufferH);
+    for (int i = 0; i < 2; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, rp.tex[i]);
+    }
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    for (int i = 1; i >= 0; i--) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+/* =================== TEMPORAL ACCUMULATION =================== */
+// With --temporal (toggle: T) the flame is drawn with QualityTemporal's step
+// budget and blue-noise jitter into an offscreen target, temporalFS blends it
+// into a ping-pong history, and the history is blitted to the window.
+
+struct TemporalPass {
+    GLuint prog = 0;
+    GLint uHasHistory, uCamPos, uCamFront, uCamUp, uAspect;
+    GLint uPrevCamPos, uPrevCamFront, uPrevCamUp, uPrevAspect;
+
+    int width = 0, height = 0;
+    GLuint frameFbo = 0, frameTex[2] = {};              // colour RGBA8, depth R32F
+    GLuint historyFbo[2] = {}, historyTex[2][2] = {};   // colour RGBA16F, depth + count RG32F
+    int current = 0;          // history written last
+    bool hasHistory = false;
+    Vec3 prevPos = {0, 0, 0}, prevFront = {0, 0, -1};
+    float prevAspect = 1.0f;
+    int frame = 0;
+};
+
+TemporalPass makeTemporalPass() {
+    TemporalPass tp;
+    tp.prog = makeProg(fullscreenVS, temporalFS);
+    tp.uHasHistory = glGetUniformLocation(tp.prog, "iHasHistory");
+    tp.uCamPos = glGetUniformLocation(tp.prog, "iCamPos");
+    tp.uCamFront = glGetUniformLocation(tp.prog, "iCamFront");
+    tp.uCamUp = glGetUniformLocation(tp.prog, "iCamUp");
+    tp.uAspect = glGetUniformLocation(tp.prog, "iAspect");
+    tp.uPrevCamPos = glGetUniformLocation(tp.prog, "iPrevCamPos");
+    tp.uPrevCamFront = glGetUniformLocation(tp.prog, "iPrevCamFront");
+    tp.uPrevCamUp = glGetUniformLocation(tp.prog, "iPrevCamUp");
+    tp.uPrevAspect = glGetUniformLocation(tp.prog, "iPrevAspect");
+
+    TemporalSettings settings;
+    glUseProgram(tp.prog);
+    glUniform1i(glGetUniformLocation(tp.prog, "iFrame"), 0);
+    glUniform1i(glGetUniformLocation(tp.prog, "iFrameDepth"), 1);
+    glUniform1i(glGetUniformLocation(tp.prog, "iHistory"), 2);
+    glUniform1i(glGetUniformLocation(tp.prog, "iHistoryData"), 3);
+    glUniform1f(glGetUniformLocation(tp.prog, "iBlend"), settings.blend);
+    glUniform1f(glGetUniformLocation(tp.prog, "iDepthTolerance"), settings.depthTolerance);
+    glUniform1f(glGetUniformLocation(tp.prog, "iDepthSlack"), settings.depthSlack);
+    glUniform1f(glGetUniformLocation(tp.prog, "iClipSigma"), settings.clipSigma);
+    return tp;
+}
+
+void releaseTemporalTargets(TemporalPass& tp) {
+    if (!tp.frameFbo) return;
+    glDeleteFramebuffers(1, &tp.frameFbo);
+    glDeleteFramebuffers(2, tp.historyFbo);
+    glDeleteTextures(2, tp.frameTex);
+    glDeleteTextures(4, &tp.historyTex[0][0]);
+    tp.frameFbo = 0;
+    tp.width = tp.height = 0;
+}
+
+// (Re)create the targets for a framebuffer size; drops the history
+void resizeTemporalTargets(TemporalPass& tp, int w, int h) {
+    if (tp.width == w && tp.height == h) return;
+    releaseTemporalTargets(tp);
+    tp.width = w;
+    tp.height = h;
+    tp.frameTex[0] = makeTargetTexture(GL_RGBA8, w, h);
+    tp.frameTex[1] = makeTargetTexture(GL_R32F, w, h);
+    tp.frameFbo = makeTargetFbo(tp.frameTex[0], tp.frameTex[1]);
+    for (int i = 0; i < 2; i++) {
+        tp.historyTex[i][0] = makeTargetTexture(GL_RGBA16F, w, h);
+        tp.historyTex[i][1] = makeTargetTexture(GL_RG32F, w, h);
+        tp.historyFbo[i] = makeTargetFbo(tp.historyTex[i][0], tp.historyTex[i][1]);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    tp.hasHistory = false;
+}
+
+// Jittered flame pass (through the screen rect pass if given), resolve into
+// the next history, blit it to the window
+void drawFlameTemporal(TemporalPass& tp, const FlameProgram& fp, FlameRectPass* rect, GLuint vao,
+                       float time, Vec3 pos, Vec3 front, int w, int h, float formation) {
+    resizeTemporalTargets(tp, w, h);
+    float aspect = (float)w / (float)h;
+
+    FlameMarch march;
+    march.maxSteps = QualityTemporal::maxSteps;
+    march.stepDivisor = QualityTemporal::stepDivisor;
+    march.opacitySubsteps = QualityTemporal::opacitySubsteps;
+    march.jitterOffset = blueNoiseOffset(tp.frame++);
+
+    if (rect) {
+        drawFlameRect(*rect, fp, vao, time, pos, front, w, h, formation, march, tp.frameFbo);
+    } else {
+        glViewport(0, 0, w, h);
+        glBindFramebuffer(GL_FRAMEBUFFER, tp.frameFbo);
+        drawFlame(fp, vao, time, pos, front, aspect, formation, march);
+    }
+
+    GpuScope gpu("temporal resolve");
+    int src = tp.current, dst = 1 - tp.current;
+    glBindFramebuffer(GL_FRAMEBUFFER, tp.historyFbo[dst]);
+    glUseProgram(tp.prog);
+    glUniform1i(tp.uHasHistory, tp.hasHistory);
+    glUniform3f(tp.uCamPos, pos.x, pos.y, pos.z);
+    glUniform3f(tp.uCamFront, front.x, front.y, front.z);
+    glUniform3f(tp.uCamUp, camUp.x, camUp.y, camUp.z);
+    glUniform1f(tp.uAspect, aspect);
+    glUniform3f(tp.uPrevCamPos, tp.prevPos.x, tp.prevPos.y, tp.prevPos.z);
+    glUniform3f(tp.uPrevCamFront, tp.prevFront.x, tp.prevFront.y, tp.prevFront.z);
+    glUniform3f(tp.uPrevCamUp, camUp.x, camUp.y, camUp.z);
+    glUniform1f(tp.uPrevAspect, tp.prevAspect);
+    const GLuint inputs[4] = {tp.frameTex[0], tp.frameTex[1], tp.historyTex[src][0], tp.historyTex[src][1]};
+    for (int i = 0; i < 4; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, inputs[i]);
+    }
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    for (int i = 3; i >= 0; i--) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, tp.historyFbo[dst]);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, presentFbo);
+    glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, presentFbo);
+
+    tp.current = dst;
+    tp.hasHistory = true;
+    tp.prevPos = pos;
+    tp.prevFront = front;
+    tp.prevAspect = aspect;
+}
+
+/* =================== BENCHMARK =================== */
+
+struct BenchOptions {
+    bool enabled = false;
+    int frames = 240;
+    int warmup = 10;
+    float dt = BENCH_DEFAULT_DT;
+    std::string out = "bench_gpu.json";
+};
+
+// Scripted, input-free run with vsync off. Each frame is timed from the
+// first GL call to glFinish after the swap, so GPU work is included.
+// temporal and rect are null for the plain shader; w is null for a
+// --headless run, drawn width x height into presentFbo.
+int runGpuBench(GLFWwindow* w, int width, int height, const FlameProgram& fp, TemporalPass* temporal,
+                FlameRectPass* rect, GLuint vao, const BenchOptions& opt) {
+    if (w) glfwSwapInterval(0);
+
+    BenchRun run;
+    run.mode = "gpu";
+    run.renderer = (const char*)glGetString(GL_RENDERER);
+    if (fp.useTables) run.renderer += " + lut";
+    if (temporal) run.renderer += " + temporal";
+    if (rect) {
+        char scale[64];
+        if (rect->dynamic)
+            std::snprintf(scale, sizeof(scale), " + rect dynamic x%.2f-%.2f, %.2f ms",
+                          rect->dynamic->settings().minScale, rect->maxScale, rect->dynamic->settings().budgetMs);
+        else
+            std::snprintf(scale, sizeof(scale), " + rect x%.2f", rect->scale);
+        run.renderer += scale;
+    }
+    run.dt = opt.dt;
+
+    std::cout << "Benchmark: " << opt.frames << " frames (+" << opt.warmup << " warmup), dt = "
+              << opt.dt << " s" << std::endl;
+
+    for (int i = -opt.warmup; i < opt.frames && !(w && glfwWindowShouldClose(w)); i++) {
+        PROFILE_SCOPE("frame");
+        gpuTimersNextFrame();
+        int frame = i < 0 ? 0 : i;
+        BenchPose pose = benchPose(frame, opt.frames);
+        float simTime = frame * opt.dt;
+
+        int winW = width, winH = height;
+        if (w) glfwGetFramebufferSize(w, &winW, &winH);
+        run.width = winW;
+        run.height = winH;
+
+        auto t0 = std::chrono::steady_clock::now();
+        if (temporal) {
+            drawFlameTemporal(*temporal, fp, rect, vao, simTime, pose.camPos, pose.camFront, winW, winH, 1.0f);
+        } else if (rect) {
+            drawFlameRect(*rect, fp, vao, simTime, pose.camPos, pose.camFront, winW, winH, 1.0f, {}, presentFbo);
+        } else {
+            glBindFramebuffer(GL_FRAMEBUFFER, presentFbo);
+            glViewport(0, 0, winW, winH);
+            drawFlame(fp, vao, simTime, pose.camPos, pose.camFront, (float)winW / (float)winH, 1.0f);
+        }
+        if (w) glfwSwapBuffers(w);
+        glFinish();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        if (w) glfwPollEvents();
+        if (i < 0) continue;
+
+        BenchFrame f;
+        f.frame = frame;
+        f.segment = pose.segment;
+        f.simTime = simTime;
+        f.ms = ms;
+        if (rect) {
+            f.shadedPixels = rect->shadedPixels();
+            f.skippedPixels = rect->skippedPixels();
+        }
+        run.frames.push_back(f);
+    }
+
+    printBenchSummary(run);
+    if (!writeBenchJson(opt.out, run)) {
+        std::cerr << "Failed to write " << opt.out << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << opt.out << std::endl;
+    return 0;
+}
+
+/* =================== HEADLESS =================== */
+// --headless: no window (an EGL surfaceless context where built with EGL,
+// else a hidden GLFW window). Frames are drawn into an RGBA8 target and
+// read back through FrameReadback; --out-pattern writes them as a
+// sequence through the same encoder stage as FlameCpu, so a GPU run gives
+// the shader's exact pixels on a node without a display.
+
+struct HeadlessOptions {
+    bool enabled = false;
+    std::string outPattern;   // empty = render and read back only (throughput)
+    float fps = 24.0f;        // iTime = frame / fps
+    int readbackDepth = 3;    // pixel buffers in flight; 0 = synchronous glReadPixels
+    std::string rayStats;     // --ray-stats output prefix; empty = off
+};
+
+struct ReadbackFrame {
+    int frame;
+    Image image;
+};
+
+// Frames 0..frames-1 at the default camera, flame formed, drawn into presentFbo
+int runHeadlessSequence(int width, int height, int frames, const FlameProgram& fp, TemporalPass* temporal,
+                        FlameRectPass* rect, GLuint vao, const HeadlessOptions& opt) {
+    SequenceSettings s;
+    s.lastFrame = frames - 1;
+    s.width = width;
+    s.height = height;
+    s.fps = opt.fps;
+    s.outPattern = opt.outPattern;
+    const bool write = !opt.outPattern.empty();
+
+    // Encoder stage, as in renderSequence
+    int encoders = write ? 2 : 0;
+    BoundedQueue<ReadbackFrame> queue((size_t)encoders * 2);
+    std::atomic<int> failed{0};
+    std::vector<std::thread> encoderThreads;
+    for (int e = 0; e < encoders; e++) {
+        encoderThreads.emplace_back([&, e] {
+            profilerSetThreadName(("encoder " + std::to_string(e)).c_str());
+            while (std::optional<ReadbackFrame> job = queue.pop()) {
+                PROFILE_SCOPE("encode frame");
+                if (!writeFrameOutputs(s, job->frame, job->image)) {
+                    failed++;
+                    std::cerr << "Frame " << job->frame << ": failed to write output" << std::endl;
+                }
+            }
+        });
+    }
+
+    // GL rows are bottom first, Image rows top first
+    auto deliver = [&](int frame, const uint8_t* rgba) {
+        if (!write) return;
+        PROFILE_SCOPE("convert frame");
+        ReadbackFrame job{frame, Image{}};
+        job.image.resize(width, height);
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = rgba + (size_t)(height - 1 - y) * width * 4;
+            for (int x = 0; x < width; x++) {
+                float* px = job.image.pixel(x, y);
+                for (int c = 0; c < 3; c++) px[c] = row[x * 4 + c] / 255.0f;
+            }
+        }
+        queue.push(std::move(job));
+    };
+
+    // The march budget drawFlame and drawFlameTemporal use
+    const int maxSteps = temporal ? QualityTemporal::maxSteps : QualityProduction::maxSteps;
+    RayCostMap cost;
+    std::vector<RayStatsFrame> rayFrames;
+
+    const GLuint target = presentFbo;
+    auto t0 = std::chrono::steady_clock::now();
+    double readbackWaitMs = 0.0;
+    {
+        FrameReadback readback(width, height, opt.readbackDepth);
+        for (int f = 0; f < frames; f++) {
+            PROFILE_SCOPE("frame");
+            gpuTimersNextFrame();
+            float time = (float)f / opt.fps;
+            if (temporal) {
+                drawFlameTemporal(*temporal, fp, rect, vao, time, camPos, camFront, width, height, 1.0f);
+            } else if (rect) {
+                drawFlameRect(*rect, fp, vao, time, camPos, camFront, width, height, 1.0f, {}, target);
+            } else {
+                glBindFramebuffer(GL_FRAMEBUFFER, target);
+                glViewport(0, 0, width, height);
+                drawFlame(fp, vao, time, camPos, camFront, (float)width / (float)height, 1.0f);
+            }
+            if (fp.rayStatsBuffer) {
+                readRayStats(fp, cost);
+                Image heatmap;
+                rayCostHeatmap(cost, maxSteps, heatmap);
+                std::string path = rayHeatmapPath(opt.rayStats, f, frames > 1);
+                if (!writeImage(path, heatmap)) std::cerr << "Failed to write " << path << std::endl;
+                rayFrames.push_back(summarizeRayCost(cost, maxSteps, f));
+            }
+            PROFILE_SCOPE("readback");
+            readback.read(target, f, deliver);
+        }
+        readback.finish(deliver);
+        readbackWaitMs = readback.waitMs();
+    }
+    double gpuSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    queue.close();
+    for (std::thread& t : encoderThreads) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%d frames %dx%d: %.2f s, %.1f frames/s rendered and read back "
+                  "(%.2f ms/frame blocked in readback, %s)", frames, width, height, gpuSeconds,
+                  frames / gpuSeconds, readbackWaitMs / frames,
+                  opt.readbackDepth > 0 ? (std::to_string(opt.readbackDepth) + " pixel buffers").c_str()
+                                        : "synchronous glReadPixels");
+    std::cout << line << std::endl;
+    if (write) std::cout << "Wrote " << frames - failed << " frames in " << seconds << " s" << std::endl;
+    if (fp.rayStatsBuffer) {
+        if (frames == 1) printRayStats(rayFrames[0]);
+        std::string renderer = std::string((const char*)glGetString(GL_RENDERER)) + (temporal ? " + temporal" : "");
+        if (!writeRayStats(opt.rayStats, renderer, rayFrames)) return 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
+
 /* =================== MAIN =================== */
-int main() {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWwindow* w = glfwCreateWindow(1280, 720, "Flame Simulation", 0, 0);
-    if (!w) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+int main(int argc, char** argv) {
+    BenchOptions bench;
+    HeadlessOptions headless;
+    int width = 1280, height = 720;
+    bool temporal = false;
+    bool screenRect = false;
+    bool tables = false;
+    float flameScale = 1.0f;
+    double dynamicResMs = 0.0;   // flame march budget; 0 = fixed flame scale
+    std::string paramsPath;      // flame parameter file, reloaded when saved
+    std::string profilePath;
+    int simHz = DEFAULT_SIM_HZ;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--bench") bench.enabled = true;
+        else if (a == "--frames" && hasValue) bench.frames = std::atoi(argv[++i]);
+        else if (a == "--warmup" && hasValue) bench.warmup = std::atoi(argv[++i]);
+        else if (a == "--dt" && hasValue) bench.dt = (float)std::atof(argv[++i]);
+        else if (a == "--bench-out" && hasValue) bench.out = argv[++i];
+        else if (a == "--width" && hasValue) width = std::atoi(argv[++i]);
+        else if (a == "--height" && hasValue) height = std::atoi(argv[++i]);
+        else if (a == "--temporal") temporal = true;
+        else if (a == "--screen-rect") screenRect = true;
+        else if (a == "--lut") tables = true;
+        else if (a == "--params" && hasValue) paramsPath = argv[++i];
+        else if (a == "--flame-scale" && hasValue) flameScale = (float)std::atof(argv[++i]);
+        else if (a == "--dynamic-res" && hasValue) dynamicResMs = std::atof(argv[++i]);
+        else if (a == "--profile" && hasValue) profilePath = argv[++i];
+        else if (a == "--sim-hz" && hasValue) simHz = std::atoi(argv[++i]);
+        else if (a == "--headless") headless.enabled = true;
+        else if (a == "--out-pattern" && hasValue) headless.outPattern = argv[++i];
+        else if (a == "--fps" && hasValue) headless.fps = (float)std::atof(argv[++i]);
+        else if (a == "--readback-depth" && hasValue) headless.readbackDepth = std::atoi(argv[++i]);
+        else if (a == "--ray-stats" && hasValue) headless.rayStats = argv[++i];
+        else {
+            std::cerr << "Unknown option: " << a << "\n"
+                      << "Usage: Sandbox [--width px] [--height px] [--temporal] [--lut]\n"
+                      << "               [--params file (flame look, reloaded when saved; written if missing)]\n"
+                      << "               [--screen-rect] [--flame-scale s (0..1], implies --screen-rect)]\n"
+                      << "               [--dynamic-res ms (flame march budget, implies --screen-rect)]\n"
+                      << "               [--profile trace.json] [--sim-hz n]\n"
+                      << "               [--bench [--frames n] [--warmup n] [--dt s] [--bench-out file]]\n"
+                      << "               [--headless [--frames n] [--out-pattern p] [--fps f] [--readback-depth n]\n"
+                      << "                           [--ray-stats prefix (steps per pixel heatmaps, CSV / JSON)]]"
+                      << std::endl;
+            return 1;
+        }
     }
 
-    glfwMakeContextCurrent(w);
-    glfwSwapInterval(1);  // VSync for smooth rendering
+    if (!(flameScale > 0.0f && flameScale <= 1.0f)) {
+        std::cerr << "--flame-scale must be in (0, 1]" << std::endl;
+        return 1;
+    }
+    if (dynamicResMs < 0.0) {
+        std::cerr << "--dynamic-res must be a positive budget in ms" << std::endl;
+        return 1;
+    }
+    if (headless.enabled && (bench.frames <= 0 || headless.fps <= 0.0f || headless.readbackDepth < 0 ||
+                             width <= 0 || height <= 0)) {
+        std::cerr << "--headless needs positive --frames, --fps, --width and --height and --readback-depth >= 0"
+                  << std::endl;
+        return 1;
+    }
+    if (!headless.outPattern.empty() && !validFramePattern(headless.outPattern)) {
+        std::cerr << "--out-pattern needs exactly one %d conversion, e.g. out/gpu_%04d" << std::endl;
+        return 1;
+    }
+    if (!headless.rayStats.empty() &&
+        (!headless.enabled || bench.enabled || screenRect || flameScale < 1.0f || dynamicResMs > 0.0)) {
+        std::cerr << "--ray-stats records full-screen --headless frames; it cannot be combined with --bench, "
+                     "--screen-rect, --flame-scale or --dynamic-res" << std::endl;
+        return 1;
+    }
+    if (simHz <= 0) {
+        std::cerr << "--sim-hz must be positive" << std::endl;
+        return 1;
+    }
+    screenRect = screenRect || flameScale < 1.0f || dynamicResMs > 0.0;
+
+    // --params: a missing file starts out as the defaults, to be edited
+    FlameParams params;
+    if (!paramsPath.empty()) {
+        if (!std::filesystem::exists(paramsPath)) {
+            if (!saveFlameParams(paramsPath, params)) {
+                std::cerr << "Cannot write " << paramsPath << std::endl;
+                return 1;
+            }
+            std::cout << "[Params] Wrote the defaults to " << paramsPath << std::endl;
+        } else if (!loadFlameParams(paramsPath, params)) {
+            return 1;
+        }
+    }
+
+    // --headless: a surfaceless EGL context where available, else a hidden window
+    GLFWwindow* w = nullptr;
+#ifdef FLAME_HAVE_EGL
+    EglContext egl;
+    if (headless.enabled) {
+        if (!createEglContext(egl, 4, 5)) return -1;
+    } else
+#endif
+    {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        if (headless.enabled) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        w = glfwCreateWindow(width, height, "Flame Simulation", 0, 0);
+        if (!w) {
+            std::cerr << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+
+        glfwMakeContextCurrent(w);
+        glfwSwapInterval(1);  // VSync for smooth rendering
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            std::cerr << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
     }
 
     std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
     std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
     std::cout << "Starting volumetric flame simulation..." << std::endl;
 
-    glfwSetCursorPosCallback(w, mouse);
-
     // Empty VAO for fullscreen triangle
     GLuint emptyVAO;
     glGenVertexArrays(1, &emptyVAO);
 
-    // Build shader program
-    GLuint flameProg = makeProg(fullscreenVS, flameFS);
+    // Build shader programs
+    FlameProgram flame = makeFlameProgram(params);
+    flame.useTables = tables;
+    TemporalPass temporalPass = makeTemporalPass();
+    FlameRectPass rectPass = makeFlameRectPass(flameScale);
+    DynamicResolutionSettings dynSettings;
+    dynSettings.budgetMs = dynamicResMs > 0.0 ? dynamicResMs : dynSettings.budgetMs;
+    dynSettings.maxScale = flameScale;
+    dynSettings.minScale = std::fmin(dynSettings.minScale, flameScale);
+    DynamicResolution dynRes(dynSettings);
+    if (dynamicResMs > 0.0) rectPass.dynamic = &dynRes;
+
+    // --profile: CPU markers plus GPU timer queries, exported at exit
+    if (!profilePath.empty()) {
+        profilerSetThreadName("main");
+        gpuTimersInit();
+        profilerEnable(true);
+    }
+
+    auto release = [&] {
+        if (!profilePath.empty()) {
+            for (int i = 0; i < GPU_TIMER_FRAMES; i++) gpuTimersNextFrame();   // collect the last frames
+            profilerEnable(false);
+            std::cout << "\nProfile:" << std::endl;
+            profilerPrintSummary();
+            if (profilerWriteChromeTrace(profilePath)) std::cout << "Wrote " << profilePath << std::endl;
+            else std::cerr << "Failed to write " << profilePath << std::endl;
+        }
+        gpuTimersRelease();
+        releaseMarchTimer(rectPass.timer);
+        releaseFlameRectTargets(rectPass);
+        glDeleteProgram(rectPass.prog);
+        releaseTemporalTargets(temporalPass);
+        glDeleteProgram(temporalPass.prog);
+        glDeleteTextures(1, &flame.blueNoise);
+        glDeleteTextures(1, &flame.profileTable);
+        glDeleteTextures(1, &flame.rampTable);
+        glDeleteBuffers(1, &flame.paramBuffer);
+        if (flame.rayStatsBuffer) glDeleteBuffers(1, &flame.rayStatsBuffer);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(flame.prog);
+#ifdef FLAME_HAVE_EGL
+        destroyEglContext(egl);
+#endif
+        glfwTerminate();
+    };
+
+    if (bench.enabled || headless.enabled) {
+        // Headless frames go to an offscreen target instead of the window
+        GLuint color = 0;
+        if (headless.enabled) {
+            color = makeTargetTexture(GL_RGBA8, width, height);
+            presentFbo = makeColorFbo(color);
+            if (!headless.rayStats.empty()) enableRayStats(flame, width, height);
+        }
+        int rc = bench.enabled
+                     ? runGpuBench(headless.enabled ? nullptr : w, width, height, flame,
+                                   temporal ? &temporalPass : nullptr, screenRect ? &rectPass : nullptr, emptyVAO,
+                                   bench)
+                     : runHeadlessSequence(width, height, bench.frames, flame, temporal ? &temporalPass : nullptr,
+                                           screenRect ? &rectPass : nullptr, emptyVAO, headless);
+        if (headless.enabled) {
+            glDeleteFramebuffers(1, &presentFbo);
+            glDeleteTextures(1, &color);
+            presentFbo = 0;
+        }
+        release();
+        return rc;
+    }
 
-    // Get uniform locations
-    GLint uTime = glGetUniformLocation(flameProg, "iTime");
-    GLint uCamPos = glGetUniformLocation(flameProg, "iCamPos");
-    GLint uCamFront = glGetUniformLocation(flameProg, "iCamFront");
-    GLint uCamUp = glGetUniformLocation(flameProg, "iCamUp");
-    GLint uAspect = glGetUniformLocation(flameProg, "iAspect");
-    GLint uFormation = glGetUniformLocation(flameProg, "iFormation");
+    glfwSetCursorPosCallback(w, mouse);
 
-    // Formation state
-    float formationProgress = 0.0f;
-    const float FORMATION_DURATION = 2.5f;
+    // Animation state (time, formation) steps on its own thread
+    SimThread sim(simHz);
+    sim.start();
     bool formed = false;
 
     double last = glfwGetTime();
-    float simTime = 0.0f;
 
     // FPS tracking
     double fpsTimer = 0.0;
     int frameCount = 0;
 
+    bool tWasDown = false;   // T toggles temporal accumulation on press
+    bool rWasDown = false;   // R toggles the screen rect pass
+    bool lWasDown = false;   // L toggles the shape tables
+    bool gWasDown = false;   // G toggles dynamic resolution
+
+    std::optional<FileWatcher> paramsWatcher;
+    if (!paramsPath.empty()) {
+        paramsWatcher.emplace(paramsPath);
+        std::cout << "[Params] Watching " << paramsPath << (paramsWatcher->native() ? " (inotify)" : " (polling)")
+                  << std::endl;
+    }
+
     std::cout << "\n--- Controls ---" << std::endl;
     std::cout << "Hold RMB + Mouse:    Look around" << std::endl;
     std::cout << "Hold RMB + W/A/S/D:  Move forward/left/back/right" << std::endl;
     std::cout << "Hold RMB + Q/E:      Move down/up" << std::endl;
     std::cout << "Hold RMB + Shift:    Move faster" << std::endl;
+    std::cout << "T:                   Toggle temporal accumulation" << std::endl;
+    std::cout << "R:                   Toggle screen rect culling (flame scale " << flameScale << ")" << std::endl;
+    std::cout << "L:                   Toggle shape / colour lookup tables" << std::endl;
+    std::cout << "G:                   Toggle dynamic resolution (flame march budget " << dynSettings.budgetMs
+              << " ms)" << std::endl;
     std::cout << "ESC:                 Quit" << std::endl;
     std::cout << "----------------\n" << std::endl;
     std::cout << "Flame forming..." << std::endl;
 
     while (!glfwWindowShouldClose(w)) {
+        PROFILE_SCOPE("frame");
+        gpuTimersNextFrame();
         double now = glfwGetTime();
         float dt = (float)(now - last);
         last = now;
-        dt = fminf(dt, 0.05f);  // Cap delta time to prevent physics explosion on lag spike
-        simTime += dt;
+        dt = fminf(dt, 0.05f);  // camera speed only; the simulation keeps real time
 
         // FPS counter
         fpsTimer += dt;
         frameCount++;
         if (fpsTimer >= 2.0) {
             float fps = frameCount / (float)fpsTimer;
-            char title[64];
-            snprintf(title, sizeof(title), "Flame Simulation | %.1f FPS", fps);
+            char title[128];
+            int n = snprintf(title, sizeof(title), "Flame Simulation | %.1f FPS", fps);
+            if (screenRect && rectPass.width > 0) {
+                double pixels = (double)rectPass.width * rectPass.height;
+                n += snprintf(title + n, sizeof(title) - n, " | shaded %.1f%%, skipped %.1f%%",
+                              100.0 * rectPass.shadedPixels() / pixels, 100.0 * rectPass.skippedPixels() / pixels);
+                if (rectPass.dynamic) snprintf(title + n, sizeof(title) - n, " | flame scale %.2f", rectPass.scale);
+            }
             glfwSetWindowTitle(w, title);
             fpsTimer = 0.0;
             frameCount = 0;
         }
 
         // Input
-        rmb = glfwGetMouseButton(w, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
-        glfwSetInputMode(w, GLFW_CURSOR, rmb ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
-
-        if (glfwGetKey(w, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-            glfwSetWindowShouldClose(w, true);
-
-        // Camera movement (only when RMB held)
-        processMovement(w, dt);
-
-        // Formation
-        if (!formed) {
-            formationProgress += dt / FORMATION_DURATION;
-            if (formationProgress >= 1.0f) {
-                formationProgress = 1.0f;
-                formed = true;
-                std::cout << "\n========================================" << std::endl;
-                std::cout << "Flame formation complete!" << std::endl;
-                std::cout << "========================================\n" << std::endl;
+        {
+            PROFILE_SCOPE("input");
+            rmb = glfwGetMouseButton(w, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+            glfwSetInputMode(w, GLFW_CURSOR, rmb ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+
+            if (glfwGetKey(w, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+                glfwSetWindowShouldClose(w, true);
+
+            bool tDown = glfwGetKey(w, GLFW_KEY_T) == GLFW_PRESS;
+            if (tDown && !tWasDown) {
+                temporal = !temporal;
+                temporalPass.hasHistory = false;
+                std::cout << "Temporal accumulation " << (temporal ? "on" : "off") << std::endl;
             }
+            tWasDown = tDown;
+
+            bool rDown = glfwGetKey(w, GLFW_KEY_R) == GLFW_PRESS;
+            if (rDown && !rWasDown) {
+                screenRect = !screenRect;
+                temporalPass.hasHistory = false;
+                std::cout << "Screen rect " << (screenRect ? "on" : "off") << std::endl;
+            }
+            rWasDown = rDown;
+
+            bool lDown = glfwGetKey(w, GLFW_KEY_L) == GLFW_PRESS;
+            if (lDown && !lWasDown) {
+                flame.useTables = !flame.useTables;
+                std::cout << "Lookup tables " << (flame.useTables ? "on" : "off") << std::endl;
+            }
+            lWasDown = lDown;
+
+            bool gDown = glfwGetKey(w, GLFW_KEY_G) == GLFW_PRESS;
+            if (gDown && !gWasDown) {
+                rectPass.dynamic = rectPass.dynamic ? nullptr : &dynRes;
+                dynRes.reset();
+                rectPass.scale = rectPass.maxScale;
+                if (rectPass.dynamic) screenRect = true;
+                std::cout << "Dynamic resolution " << (rectPass.dynamic ? "on" : "off") << std::endl;
+            }
+            gWasDown = gDown;
+
+            // Camera movement (only when RMB held)
+            processMovement(w, dt);
+        }
+
+        if (paramsWatcher && paramsWatcher->changed()) {
+            PROFILE_SCOPE("reload params");
+            if (reloadFlameParams(flame, paramsPath) & CACHE_HISTORY) temporalPass.hasHistory = false;
         }
 
-        float easedFormation = 1.0f - powf(1.0f - formationProgress, 3.0f);
+        // Simulation state at this frame's time
+        SimState state = sim.sample();
+        float simTime = (float)state.time;
+        float formation = easedFormation(state.formationProgress);
+        if (state.formed && !formed) {
+            formed = true;
+            std::cout << "\n========================================" << std::endl;
+            std::cout << "Flame formation complete!" << std::endl;
+            std::cout << "========================================\n" << std::endl;
+        }
 
         // Viewport
         int winW, winH;
@@ -597,23 +1995,29 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT);
 
         // Render
-        glUseProgram(flameProg);
-        glUniform1f(uTime, simTime);
-        glUniform3f(uCamPos, camPos.x, camPos.y, camPos.z);
-        glUniform3f(uCamFront, camFront.x, camFront.y, camFront.z);
-        glUniform3f(uCamUp, camUp.x, camUp.y, camUp.z);
-        glUniform1f(uAspect, aspect);
-        glUniform1f(uFormation, easedFormation);
-
-        glBindVertexArray(emptyVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-
-        glfwSwapBuffers(w);
-        glfwPollEvents();
+        {
+            PROFILE_SCOPE("render");
+            FlameRectPass* rect = screenRect ? &rectPass : nullptr;
+            if (temporal)
+                drawFlameTemporal(temporalPass, flame, rect, emptyVAO, simTime, camPos, camFront, winW, winH,
+                                  formation);
+            else if (rect)
+                drawFlameRect(rectPass, flame, emptyVAO, simTime, camPos, camFront, winW, winH, formation,
+                              {}, 0);
+            else
+                drawFlame(flame, emptyVAO, simTime, camPos, camFront, aspect, formation);
+        }
+        {
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(w);
+        }
+        {
+            PROFILE_SCOPE("poll events");
+            glfwPollEvents();
+        }
     }
 
-    glDeleteVertexArrays(1, &emptyVAO);
-    glDeleteProgram(flameProg);
-    glfwTerminate();
+    sim.stop();
+    release();
     return 0;
 }
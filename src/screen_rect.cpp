@@ -0,0 +1,59 @@
+#include "screen_rect.h"
+
+#include <algorithm>
+#include <cmath>
+#include "flame_field.h"
+
+// Slopes a / z of the two lines through the origin tangent to a circle at
+// (a, z) of radius r, z > r (one axis of the view-space sphere)
+static void tangentSlopes(float a, float z, float r, float& lo, float& hi) {
+    float root = r * sqrtf(fmaxf(a * a + z * z - r * r, 0.0f));
+    float denom = z * z - r * r;
+    lo = (a * z - root) / denom;
+    hi = (a * z + root) / denom;
+}
+
+ScreenRect flameScreenRect(const FlameUniforms& u, int width, int height) {
+    return flameScreenRect(u, width, height, FLAME_SPHERE_CENTER, FLAME_SPHERE_RADIUS);
+}
+
+ScreenRect flameScreenRect(const FlameUniforms& u, int width, int height, Vec3 center, float radius) {
+    ScreenRect full{0, 0, width, height};
+
+    // View space of cameraRay(): x along right, y along up, z along forward
+    Vec3 forward = normalize(u.camFront);
+    Vec3 right = normalize(cross(forward, u.camUp));
+    Vec3 up = cross(right, forward);
+    Vec3 c = center - u.camPos;
+    float cx = dot(c, right), cy = dot(c, up), cz = dot(c, forward);
+    float r = radius;
+
+    if (cz <= -r) return {};        // behind the camera: every ray misses
+    if (cz <= r * 1.001f) return full;  // inside, or crossing the camera plane
+
+    // Tangent slopes to uv (cameraRay: x / z = uvx * aspect / 2, y / z = uvy / 2),
+    // then to pixel edges; rows run top to bottom
+    float sx0, sx1, sy0, sy1;
+    tangentSlopes(cx, cz, r, sx0, sx1);
+    tangentSlopes(cy, cz, r, sy0, sy1);
+    float px0 = (sx0 / (u.aspect * 0.5f) + 1.0f) * 0.5f * (float)width;
+    float px1 = (sx1 / (u.aspect * 0.5f) + 1.0f) * 0.5f * (float)width;
+    float py0 = (1.0f - sy1 / 0.5f) * 0.5f * (float)height;
+    float py1 = (1.0f - sy0 / 0.5f) * 0.5f * (float)height;
+
+    // Clamp in float first: slopes of a sphere near the camera plane are huge
+    auto edge = [](float v, int n) { return (int)std::floor(std::clamp(v, -1.0f, (float)n + 1.0f)); };
+    ScreenRect rect;
+    rect.x0 = std::max(edge(px0, width) - 1, 0);
+    rect.x1 = std::min(edge(px1, width) + 2, width);
+    rect.y0 = std::max(edge(py0, height) - 1, 0);
+    rect.y1 = std::min(edge(py1, height) + 2, height);
+    if (rect.empty()) return {};
+    return rect;
+}
+
+void flameBufferSize(const ScreenRect& rect, float scale, int& w, int& h) {
+    if (rect.empty()) { w = h = 0; return; }
+    w = std::clamp((int)std::ceil((float)rect.width() * scale), 1, rect.width());
+    h = std::clamp((int)std::ceil((float)rect.height() * scale), 1, rect.height());
+}
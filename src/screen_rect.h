@@ -0,0 +1,33 @@
+#pragma once
+#include "cpu_renderer.h"
+
+/* =================== SCREEN-SPACE FLAME BOUNDS =================== */
+// The flame's bounding sphere (FLAME_SPHERE_CENTER / RADIUS) projected to a
+// pixel rectangle. Rays outside it cannot enter the sphere, so both
+// renderers march only the rectangle (optionally at reduced resolution) and
+// give every other pixel the analytic glow over the background.
+
+// Pixels [x0, x1) x [y0, y1), rows top to bottom like Image
+struct ScreenRect {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+    long long area() const { return empty() ? 0 : (long long)width() * height(); }
+};
+
+// Conservative bounds (one pixel of margin) of the bounding sphere for a
+// width x height image: the whole image when the camera is inside the sphere
+// or it crosses the camera plane, empty when it is entirely behind
+ScreenRect flameScreenRect(const FlameUniforms& u, int width, int height);
+
+// The same for another bounding sphere (FlameParams::sphereCenter / Radius)
+ScreenRect flameScreenRect(const FlameUniforms& u, int width, int height, Vec3 center, float radius);
+
+// Flame buffer size for a rect marched at scale (0, 1]; 0 x 0 for an empty rect
+void flameBufferSize(const ScreenRect& rect, float scale, int& w, int& h);
+
+// Relative depth difference beyond which the upsampling filter keeps two
+// flame taps apart instead of blending them
+constexpr float UPSAMPLE_DEPTH_TOLERANCE = 0.15f;
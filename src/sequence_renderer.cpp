@@ -0,0 +1,154 @@
+#include "sequence_renderer.h"
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+#include "image_io.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+namespace fs = std::filesystem;
+
+bool validFramePattern(const std::string& pattern) {
+    int conversions = 0;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern[i] != '%') continue;
+        size_t j = i + 1;
+        if (j < pattern.size() && pattern[j] == '%') { i = j; continue; }  // literal %%
+        while (j < pattern.size() && std::isdigit((unsigned char)pattern[j])) j++;
+        if (j >= pattern.size() || pattern[j] != 'd') return false;
+        conversions++;
+        i = j;
+    }
+    return conversions == 1;
+}
+
+std::string framePath(const std::string& pattern, int frame, const char* extension) {
+    char buf[1024];
+    std::snprintf(buf, sizeof(buf), pattern.c_str(), frame);
+    return std::string(buf) + extension;
+}
+
+// Write through a temporary file so a visible output is always complete
+template <class Write>
+static bool writeAtomically(const std::string& path, Write write) {
+    std::error_code ec;
+    fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) fs::create_directories(parent, ec);
+
+    std::string tmp = path + ".tmp";
+    if (!write(tmp)) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+bool frameOutputsExist(const SequenceSettings& s, int frame) {
+    std::error_code ec;
+    if (s.writePng && !fs::exists(framePath(s.outPattern, frame, ".png"), ec)) return false;
+    if (s.writeFloat && !fs::exists(framePath(s.outPattern, frame, ".pfm"), ec)) return false;
+    return true;
+}
+
+bool writeFrameOutputs(const SequenceSettings& s, int frame, const Image& image) {
+    bool ok = true;
+    if (s.writePng) {
+        ok &= writeAtomically(framePath(s.outPattern, frame, ".png"),
+                              [&](const std::string& p) { return writeImage(p, image); });
+    }
+    if (s.writeFloat) {
+        ok &= writeAtomically(framePath(s.outPattern, frame, ".pfm"),
+                              [&](const std::string& p) { return writePFM(p, image); });
+    }
+    return ok;
+}
+
+struct RenderedFrame {
+    int frame;
+    Image image;
+    double renderMs;
+};
+
+SequenceReport renderSequence(const SequenceSettings& s, const FlameUniforms& base,
+                              const RenderOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+
+    int workers = s.renderWorkers > 0 ? s.renderWorkers : (int)std::thread::hardware_concurrency();
+    workers = workers > 0 ? workers : 1;
+    int encoders = s.encoders > 0 ? s.encoders : 1;
+    size_t capacity = s.queueCapacity > 0 ? (size_t)s.queueCapacity : (size_t)encoders * 2;
+
+    BoundedQueue<RenderedFrame> queue(capacity);
+    std::atomic<int> nextFrame{s.firstFrame};
+    std::atomic<int> rendered{0}, skipped{0}, failed{0};
+    std::mutex logMutex;
+
+    // ---- Encoder stage ----
+    std::vector<std::thread> encoderThreads;
+    for (int e = 0; e < encoders; e++) {
+        encoderThreads.emplace_back([&, e] {
+            profilerSetThreadName(("encoder " + std::to_string(e)).c_str());
+            while (std::optional<RenderedFrame> job = queue.pop()) {
+                PROFILE_SCOPE("encode frame");
+                auto t0 = std::chrono::steady_clock::now();
+                bool ok = writeFrameOutputs(s, job->frame, job->image);
+                double encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+                (ok ? rendered : failed)++;
+                std::lock_guard<std::mutex> lock(logMutex);
+                if (ok) {
+                    std::printf("frame %d: render %.1f ms, encode %.1f ms\n", job->frame, job->renderMs, encodeMs);
+                } else {
+                    std::fprintf(stderr, "frame %d: failed to write output\n", job->frame);
+                }
+            }
+        });
+    }
+
+    // ---- Render stage: whole frames per worker ----
+    std::vector<std::thread> renderThreads;
+    for (int w = 0; w < workers; w++) {
+        renderThreads.emplace_back([&, w] {
+            profilerSetThreadName(("render worker " + std::to_string(w)).c_str());
+            ThreadPool single(1);
+            for (;;) {
+                int frame = nextFrame.fetch_add(1);
+                if (frame > s.lastFrame) break;
+                if (s.resume && frameOutputsExist(s, frame)) {
+                    skipped++;
+                    continue;
+                }
+
+                FlameUniforms u = base;
+                u.time = (float)frame / s.fps;
+                u.aspect = (float)s.width / (float)s.height;
+
+                RenderedFrame job{frame, Image{}, 0.0};
+                job.image.resize(s.width, s.height);
+                job.renderMs = renderImage(u, job.image, single, options).seconds * 1000.0;
+                if (!queue.push(std::move(job))) break;
+            }
+        });
+    }
+
+    for (auto& t : renderThreads) t.join();
+    queue.close();
+    for (auto& t : encoderThreads) t.join();
+
+    SequenceReport report;
+    report.rendered = rendered.load();
+    report.skipped = skipped.load();
+    report.failed = failed.load();
+    report.peakQueued = queue.peak();
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include "cpu_renderer.h"
+
+/* =================== OFFLINE SEQUENCE RENDERER =================== */
+// Renders a frame range to disk as a two-stage pipeline:
+//
+//   render workers --(bounded queue)--> encoder threads --> PNG / PFM files
+//
+// Each render worker draws whole frames on its own thread, so frames are
+// rendered in parallel with no per-tile synchronization. Encoders compress
+// and write while the next frames render. At most
+//   renderWorkers + queueCapacity + encoders
+// frames are alive at once, however long the range is.
+//
+// Files are written under a temporary name and renamed when complete, so
+// a frame that exists on disk is whole. With resume set, frames whose
+// outputs all exist are skipped, which continues an interrupted range.
+
+struct SequenceSettings {
+    int firstFrame = 0;
+    int lastFrame = 0;                 // inclusive
+    int width = 1280, height = 720;
+    float fps = 24.0f;                 // iTime = frame / fps
+    std::string outPattern = "flame_%04d";  // printf pattern, extension added
+    bool writePng = true;
+    bool writeFloat = false;           // PFM float dump of the same pixels
+    int renderWorkers = 0;             // 0 = one per hardware thread
+    int encoders = 1;
+    int queueCapacity = 0;             // 0 = 2 per encoder
+    bool resume = false;
+};
+
+struct SequenceReport {
+    int rendered = 0;
+    int skipped = 0;
+    int failed = 0;
+    size_t peakQueued = 0;
+    double seconds = 0.0;
+};
+
+// True if outPattern has exactly one integer conversion (%d, %04d, ...)
+bool validFramePattern(const std::string& pattern);
+
+// Output path for a frame, with the extension appended
+std::string framePath(const std::string& pattern, int frame, const char* extension);
+
+// True if every output the settings ask for already exists for frame
+bool frameOutputsExist(const SequenceSettings& settings, int frame);
+
+// Writes the frame's PNG and / or PFM through temporary files
+bool writeFrameOutputs(const SequenceSettings& settings, int frame, const Image& image);
+
+// base provides the camera and formation; its time is set per frame
+SequenceReport renderSequence(const SequenceSettings& settings, const FlameUniforms& base,
+                              const RenderOptions& options);
@@ -0,0 +1,105 @@
+#include "sim_thread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "profiler.h"
+
+static int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void stepSim(SimState& s, float dt) {
+    s.tick++;
+    s.time += dt;
+    if (!s.formed) {
+        s.formationProgress += dt / FORMATION_DURATION;
+        if (s.formationProgress >= 1.0f) {
+            s.formationProgress = 1.0f;
+            s.formed = true;
+        }
+    }
+}
+
+float easedFormation(float progress) {
+    return 1.0f - powf(1.0f - progress, 3.0f);
+}
+
+SimState interpolateSim(const SimState& a, const SimState& b, float alpha) {
+    SimState s = b;
+    s.time = a.time + (b.time - a.time) * alpha;
+    s.formationProgress = a.formationProgress + (b.formationProgress - a.formationProgress) * alpha;
+    return s;
+}
+
+SimThread::SimThread(int hz) : hz_(std::max(hz, 1)), stepNs_(1000000000LL / std::max(hz, 1)) {}
+
+SimThread::~SimThread() {
+    stop();
+}
+
+void SimThread::start() {
+    if (thread_.joinable()) return;
+    stop_ = false;
+    thread_ = std::thread([this] { run(); });
+}
+
+void SimThread::stop() {
+    if (!thread_.joinable()) return;
+    stop_ = true;
+    thread_.join();
+}
+
+// Ticks are due every stepNs_ from the start. A late wake runs the missed
+// ticks, up to SIM_MAX_CATCH_UP; beyond that the backlog is dropped, so a
+// simulation slower than real time runs slow instead of spiralling.
+void SimThread::run() {
+    profilerSetThreadName("simulation");
+    const float dt = 1.0f / (float)hz_;
+
+    Snapshot snap = snapshots_.write();
+    snap.prev = snap.curr;
+    snap.currNs = steadyNs();
+    snapshots_.write() = snap;
+    snapshots_.publish();
+
+    int64_t next = snap.currNs + stepNs_;
+    while (!stop_.load(std::memory_order_relaxed)) {
+        int64_t now = steadyNs();
+        if (now < next) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(next - now));
+            continue;
+        }
+
+        for (int n = 0; n < SIM_MAX_CATCH_UP && next <= now; n++) {
+            PROFILE_SCOPE("sim step");
+            snap.prev = snap.curr;
+            stepSim(snap.curr, dt);
+            double extraMs = extraStepMs_.load(std::memory_order_relaxed);
+            if (extraMs > 0.0) std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(extraMs));
+            snap.currNs = next;
+            next += stepNs_;
+        }
+        if (next <= now) {
+            int64_t behind = (now - next) / stepNs_ + 1;
+            dropped_.fetch_add((uint64_t)behind, std::memory_order_relaxed);
+            next += behind * stepNs_;
+        }
+
+        snapshots_.write() = snap;
+        snapshots_.publish();
+    }
+}
+
+SimState SimThread::sample(int64_t nowNs) {
+    snapshots_.fetch();
+    const Snapshot& s = snapshots_.read();
+    if (s.currNs == 0) return s.curr;   // not started yet
+    float alpha = std::clamp((float)(nowNs - s.currNs) / (float)stepNs_, 0.0f, 1.0f);
+    return interpolateSim(s.prev, s.curr, alpha);
+}
+
+SimState SimThread::sample() {
+    return sample(steadyNs());
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "triple_buffer.h"
+
+/* =================== SIMULATION THREAD =================== */
+// The flame's animation state stepped at a fixed rate on its own thread,
+// so render hitches do not slow the simulation and heavy steps do not
+// stall rendering. Each tick publishes the last two states through a
+// triple buffer; the render thread shows the state at its own wall-clock
+// time, interpolated between them, one tick behind real time.
+
+constexpr float FORMATION_DURATION = 2.5f;   // seconds for the flame to form
+constexpr int   DEFAULT_SIM_HZ = 120;
+constexpr int   SIM_MAX_CATCH_UP = 8;        // steps per wake before dropping time
+
+struct SimState {
+    uint64_t tick = 0;
+    double time = 0.0;               // simulated seconds (iTime)
+    float formationProgress = 0.0f;  // 0..1 over FORMATION_DURATION
+    bool formed = false;
+};
+
+// One fixed step of dt seconds
+void stepSim(SimState& s, float dt);
+
+// iFormation for a formation progress (cubic ease-out)
+float easedFormation(float progress);
+
+// a at alpha 0, b at alpha 1; discrete fields come from b
+SimState interpolateSim(const SimState& a, const SimState& b, float alpha);
+
+class SimThread {
+public:
+    explicit SimThread(int hz = DEFAULT_SIM_HZ);
+    ~SimThread();
+
+    SimThread(const SimThread&) = delete;
+    SimThread& operator=(const SimThread&) = delete;
+
+    void start();
+    void stop();
+
+    // Render thread only: the state at wall time nowNs (steady clock)
+    SimState sample(int64_t nowNs);
+    SimState sample();
+
+    int hz() const { return hz_; }
+    uint64_t droppedSteps() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Heavy-step stand-in for testing: each step also sleeps this long
+    void setExtraStepCost(double ms) { extraStepMs_.store(ms, std::memory_order_relaxed); }
+
+private:
+    struct Snapshot {
+        SimState prev, curr;
+        int64_t currNs = 0;   // wall time curr belongs to
+    };
+
+    void run();
+
+    const int hz_;
+    const int64_t stepNs_;
+    TripleBuffer<Snapshot> snapshots_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<double> extraStepMs_{0.0};
+};
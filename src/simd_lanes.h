@@ -0,0 +1,196 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/* =================== SIMD LANE WRAPPERS =================== */
+// One struct per instruction set giving the packet kernels (noise, math) a
+// common vocabulary: F (float lanes), I (32-bit int lanes), M (comparison
+// mask) and W (lane count). Each wrapper only exists in translation units
+// compiled for its ISA, so include this from the per-ISA .cpp files (and
+// the scalar fallbacks) only. MSVC has no SSE4.1 switch and accepts the
+// intrinsics anywhere, so it always gets LanesSSE41.
+//
+// Everything is in an anonymous namespace: the same inline functions built
+// with -mavx2 in one TU and without in another must never be merged by the
+// linker.
+//
+// Only correctly rounded IEEE operations are exposed (no estimates such as
+// rsqrtps / vrsqrte, whose results differ between CPUs), so a kernel
+// written against these gives the same bits on every ISA.
+
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#define FLAME_LANES_SSE41 1
+#endif
+#if defined(FLAME_LANES_SSE41) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// One lane, plain C++; the reference the packet kernels are checked against
+struct LanesScalar {
+    static constexpr int W = 1;
+    using F = float;
+    using I = uint32_t;
+    using M = bool;
+
+    static F load(const float* p) { return *p; }
+    static void store(float* p, F v) { *p = v; }
+    static F set1(float v) { return v; }
+    static I set1u(uint32_t v) { return v; }
+    static F add(F a, F b) { return a + b; }
+    static F sub(F a, F b) { return a - b; }
+    static F mul(F a, F b) { return a * b; }
+    static F div(F a, F b) { return a / b; }
+    static F sqrt(F a) { return sqrtf(a); }
+    static F min(F a, F b) { return a < b ? a : b; }   // minps semantics
+    static F max(F a, F b) { return a > b ? a : b; }
+    static F floor(F a) { return floorf(a); }
+    static I toInt(F a) { return (uint32_t)(int32_t)a; }
+    static F toFloat(I a) { return (float)(int32_t)a; }
+    static I asInt(F a) { I i; std::memcpy(&i, &a, 4); return i; }
+    static F asFloat(I a) { F f; std::memcpy(&f, &a, 4); return f; }
+    static I iadd(I a, I b) { return a + b; }
+    static I isub(I a, I b) { return a - b; }
+    static I band(I a, I b) { return a & b; }
+    static I bor(I a, I b) { return a | b; }
+    static I bxor(I a, I b) { return a ^ b; }
+    template <int N> static I shl(I a) { return a << N; }
+    template <int N> static I shr(I a) { return a >> N; }
+    static I mullo(I a, I b) { return a * b; }
+    static F u32ToFloat(I q) { return (float)q; }
+    static M lt(F a, F b) { return a < b; }
+    static F select(M m, F a, F b) { return m ? a : b; }
+};
+
+#if defined(FLAME_LANES_SSE41)
+struct LanesSSE41 {
+    static constexpr int W = 4;
+    using F = __m128;
+    using I = __m128i;
+    using M = __m128;
+
+    static F load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, F v) { _mm_storeu_ps(p, v); }
+    static F set1(float v) { return _mm_set1_ps(v); }
+    static I set1u(uint32_t v) { return _mm_set1_epi32((int)v); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm_div_ps(a, b); }
+    static F sqrt(F a) { return _mm_sqrt_ps(a); }
+    static F min(F a, F b) { return _mm_min_ps(a, b); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); }
+    static F floor(F a) { return _mm_floor_ps(a); }
+    static I toInt(F a) { return _mm_cvttps_epi32(a); }
+    static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+    static I asInt(F a) { return _mm_castps_si128(a); }
+    static F asFloat(I a) { return _mm_castsi128_ps(a); }
+    static I iadd(I a, I b) { return _mm_add_epi32(a, b); }
+    static I isub(I a, I b) { return _mm_sub_epi32(a, b); }
+    static I band(I a, I b) { return _mm_and_si128(a, b); }
+    static I bor(I a, I b) { return _mm_or_si128(a, b); }
+    static I bxor(I a, I b) { return _mm_xor_si128(a, b); }
+    template <int N> static I shl(I a) { return _mm_slli_epi32(a, N); }
+    template <int N> static I shr(I a) { return _mm_srli_epi32(a, N); }
+    static I mullo(I a, I b) { return _mm_mullo_epi32(a, b); }
+
+    // Exact uint32 -> float (see LanesAVX2)
+    static F u32ToFloat(I q) {
+        F hi = _mm_cvtepi32_ps(_mm_srli_epi32(q, 16));
+        F lo = _mm_cvtepi32_ps(_mm_and_si128(q, _mm_set1_epi32(0xffff)));
+        return _mm_add_ps(_mm_mul_ps(hi, _mm_set1_ps(65536.0f)), lo);
+    }
+
+    static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static F select(M m, F a, F b) { return _mm_blendv_ps(b, a, m); }
+};
+#endif
+
+#if defined(__AVX2__)
+struct LanesAVX2 {
+    static constexpr int W = 8;
+    using F = __m256;
+    using I = __m256i;
+    using M = __m256;
+
+    static F load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, F v) { _mm256_storeu_ps(p, v); }
+    static F set1(float v) { return _mm256_set1_ps(v); }
+    static I set1u(uint32_t v) { return _mm256_set1_epi32((int)v); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+    static F min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F floor(F a) { return _mm256_floor_ps(a); }
+    static I toInt(F a) { return _mm256_cvttps_epi32(a); }
+    static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+    static I asInt(F a) { return _mm256_castps_si256(a); }
+    static F asFloat(I a) { return _mm256_castsi256_ps(a); }
+    static I iadd(I a, I b) { return _mm256_add_epi32(a, b); }
+    static I isub(I a, I b) { return _mm256_sub_epi32(a, b); }
+    static I band(I a, I b) { return _mm256_and_si256(a, b); }
+    static I bor(I a, I b) { return _mm256_or_si256(a, b); }
+    static I bxor(I a, I b) { return _mm256_xor_si256(a, b); }
+    template <int N> static I shl(I a) { return _mm256_slli_epi32(a, N); }
+    template <int N> static I shr(I a) { return _mm256_srli_epi32(a, N); }
+    static I mullo(I a, I b) { return _mm256_mullo_epi32(a, b); }
+
+    // Exact uint32 -> float: both 16-bit halves convert exactly, the single
+    // add rounds to nearest like a native unsigned conversion
+    static F u32ToFloat(I q) {
+        F hi = _mm256_cvtepi32_ps(_mm256_srli_epi32(q, 16));
+        F lo = _mm256_cvtepi32_ps(_mm256_and_si256(q, _mm256_set1_epi32(0xffff)));
+        return _mm256_add_ps(_mm256_mul_ps(hi, _mm256_set1_ps(65536.0f)), lo);
+    }
+
+    static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+};
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+struct LanesNEON {
+    static constexpr int W = 4;
+    using F = float32x4_t;
+    using I = uint32x4_t;
+    using M = uint32x4_t;
+
+    static F load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, F v) { vst1q_f32(p, v); }
+    static F set1(float v) { return vdupq_n_f32(v); }
+    static I set1u(uint32_t v) { return vdupq_n_u32(v); }
+    static F add(F a, F b) { return vaddq_f32(a, b); }
+    static F sub(F a, F b) { return vsubq_f32(a, b); }
+    static F mul(F a, F b) { return vmulq_f32(a, b); }
+    static F div(F a, F b) { return vdivq_f32(a, b); }
+    static F sqrt(F a) { return vsqrtq_f32(a); }
+    static F min(F a, F b) { return vbslq_f32(vcltq_f32(a, b), a, b); }   // minps semantics
+    static F max(F a, F b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+    static F floor(F a) { return vrndmq_f32(a); }
+    static I toInt(F a) { return vreinterpretq_u32_s32(vcvtq_s32_f32(a)); }
+    static F toFloat(I a) { return vcvtq_f32_s32(vreinterpretq_s32_u32(a)); }
+    static I asInt(F a) { return vreinterpretq_u32_f32(a); }
+    static F asFloat(I a) { return vreinterpretq_f32_u32(a); }
+    static I iadd(I a, I b) { return vaddq_u32(a, b); }
+    static I isub(I a, I b) { return vsubq_u32(a, b); }
+    static I band(I a, I b) { return vandq_u32(a, b); }
+    static I bor(I a, I b) { return vorrq_u32(a, b); }
+    static I bxor(I a, I b) { return veorq_u32(a, b); }
+    template <int N> static I shl(I a) { return vshlq_n_u32(a, N); }
+    template <int N> static I shr(I a) { return vshrq_n_u32(a, N); }
+    static I mullo(I a, I b) { return vmulq_u32(a, b); }
+    static F u32ToFloat(I q) { return vcvtq_f32_u32(q); }
+    static M lt(F a, F b) { return vcltq_f32(a, b); }
+    static F select(M m, F a, F b) { return vbslq_f32(m, a, b); }
+};
+#endif
+
+} // namespace
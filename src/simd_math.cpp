@@ -0,0 +1,50 @@
+#include "simd_math.h"
+
+#include "simd_lanes.h"
+#include "simd_math_impl.h"
+
+// Defined in the per-ISA translation units that CMake adds for this target
+#if defined(FLAME_SIMD_X86)
+const MathKernels* mathKernelsSSE41();
+const MathKernels* mathKernelsAVX2();
+#endif
+#if defined(FLAME_SIMD_NEON)
+const MathKernels* mathKernelsNEON();
+#endif
+
+/* =================== SCALAR =================== */
+
+using ScalarMath = MathPacket<LanesScalar>;
+
+float fastExp(float x) { return ScalarMath::exp(x); }
+float fastLog(float x) { return ScalarMath::log(x); }
+float fastPow(float x, float y) { return ScalarMath::pow(x, y); }
+float fastSqrt(float x) { return ScalarMath::sqrt(x); }
+float fastInverseSqrt(float x) { return ScalarMath::inversesqrt(x); }
+
+static const MathKernels scalarKernels = ScalarMath::kernels(SimdIsa::Scalar, "scalar");
+
+/* =================== DISPATCH =================== */
+
+const MathKernels* mathKernelsFor(SimdIsa isa) {
+    if (!simdIsaSupported(isa)) return nullptr;
+    switch (isa) {
+    case SimdIsa::Scalar: return &scalarKernels;
+#if defined(FLAME_SIMD_X86)
+    case SimdIsa::SSE41: return mathKernelsSSE41();
+    case SimdIsa::AVX2:  return mathKernelsAVX2();
+#endif
+#if defined(FLAME_SIMD_NEON)
+    case SimdIsa::NEON:  return mathKernelsNEON();
+#endif
+    default: return nullptr;
+    }
+}
+
+const MathKernels& mathKernels() {
+    static const MathKernels& k = [] () -> const MathKernels& {
+        const MathKernels* m = mathKernelsFor(noiseKernels().isa);
+        return m ? *m : scalarKernels;
+    }();
+    return k;
+}
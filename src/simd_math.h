@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include "noise_simd.h"
+
+/* =================== FAST MATH =================== */
+// Bounded-error exp / log / pow (Cephes-style polynomials) plus sqrt and
+// inversesqrt, for porting shader code to the CPU. Scalar functions and
+// packet kernels over arrays (8 lanes with AVX2, 4 with SSE4.1 / NEON, same
+// runtime choice and FLAME_SIMD override as the packet noise); every ISA
+// returns the same bits as the scalar functions. The packet types
+// themselves (Vec3Packet, Vec4Packet, the GLSL helpers) are templates in
+// simd_math_impl.h.
+//
+// These are not drop-in replacements for libm in the existing renderers:
+// the production image is pinned to the libm results. Use them for new
+// paths where the error bounds below are acceptable.
+//
+// Max relative errors against double-precision libm, checked by
+// FlameMathBench over the stated domains (float ulp is ~1.19e-7 relative).
+
+// exp(x): x clamped to [FAST_EXP_MIN, FAST_EXP_MAX]
+constexpr float  FAST_EXP_MIN = -87.6f;
+constexpr float  FAST_EXP_MAX = 88.0f;
+constexpr double FAST_EXP_MAX_REL_ERROR = 1.5e-7;
+
+// log(x): positive normal x
+constexpr double FAST_LOG_MAX_REL_ERROR = 1.5e-7;
+
+// pow(x, y) = exp(y log x) for x > 0 (x <= 0 gives 0). Rounding y log x to
+// a float grows the error with |y log x|, as in any float-only pow
+constexpr double FAST_POW_MAX_REL_ERROR = 1.5e-7;       // plus ...
+constexpr double FAST_POW_REL_ERROR_PER_LOG = 1.0e-7;   // ... this per unit of |y log x|
+
+// sqrt(x) is the correctly rounded hardware instruction; inversesqrt(x) is
+// 1 / sqrt(x). x >= 0
+constexpr double FAST_SQRT_MAX_REL_ERROR = 6.0e-8;
+constexpr double FAST_INVERSESQRT_MAX_REL_ERROR = 1.5e-7;
+
+float fastExp(float x);
+float fastLog(float x);
+float fastPow(float x, float y);
+float fastSqrt(float x);
+float fastInverseSqrt(float x);
+
+// Function table for one instruction set; n may be any count (tails are padded)
+struct MathKernels {
+    SimdIsa isa;
+    const char* name;
+    int width;   // lanes per packet
+
+    void (*exp)(const float* x, float* out, size_t n);
+    void (*log)(const float* x, float* out, size_t n);
+    void (*pow)(const float* x, float y, float* out, size_t n);
+    void (*sqrt)(const float* x, float* out, size_t n);
+    void (*inversesqrt)(const float* x, float* out, size_t n);
+    void (*normalize)(float* x, float* y, float* z, size_t n);   // in place, zero stays zero
+    void (*flameRadius)(const float* h, float* out, size_t n);   // flameRadius() on the fast math
+};
+
+// Kernels for the ISA noiseKernels() picked (so FLAME_SIMD applies to both)
+const MathKernels& mathKernels();
+
+// Kernels for a specific ISA, or nullptr if not compiled in / not supported
+const MathKernels* mathKernelsFor(SimdIsa isa);
@@ -0,0 +1,8 @@
+// Compiled with -mavx2 (see CMakeLists.txt); only called after a CPU check.
+#include "simd_lanes.h"
+#include "simd_math_impl.h"
+
+const MathKernels* mathKernelsAVX2() {
+    static const MathKernels k = MathPacket<LanesAVX2>::kernels(SimdIsa::AVX2, "avx2");
+    return &k;
+}
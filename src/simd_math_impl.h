@@ -0,0 +1,316 @@
+#pragma once
+#include <cstring>
+#include "flame_field.h"
+#include "math_utils.h"
+#include "simd_math.h"
+
+/* =================== PACKET MATH =================== */
+// Shared bodies for the fast math layer, instantiated once per instruction
+// set with one of the lane wrappers in simd_lanes.h (LanesScalar gives the
+// one-lane reference). Only include this from the per-ISA translation units
+// and simd_math.cpp; code that wants packet math in its own hot loop adds a
+// per-ISA TU of its own the same way.
+//
+// Only correctly rounded IEEE operations are used, in a fixed order, so
+// every ISA returns the same bits as the scalar fastExp() etc. Error bounds are in
+// simd_math.h. The GLSL helpers (clamp, mix, smoothstep) evaluate the same
+// expressions as the scalar ones in math_utils.h and match them exactly.
+
+template <class L>
+struct MathPacket {
+    using F = typename L::F;
+    using I = typename L::I;
+    using M = typename L::M;
+
+    // ---- GLSL helpers ----
+
+    static inline F clamp(F x, F lo, F hi) { return L::min(L::max(x, lo), hi); }
+
+    static inline F mix(F x, F y, F a) {
+        return L::add(L::mul(x, L::sub(L::set1(1.0f), a)), L::mul(y, a));
+    }
+
+    static inline F smoothstep(F e0, F e1, F x) {
+        F t = clamp(L::div(L::sub(x, e0), L::sub(e1, e0)), L::set1(0.0f), L::set1(1.0f));
+        return L::mul(L::mul(t, t), L::sub(L::set1(3.0f), L::mul(L::set1(2.0f), t)));
+    }
+
+    static inline F step(F edge, F x) { return L::select(L::lt(x, edge), L::set1(0.0f), L::set1(1.0f)); }
+    static inline F fract(F x) { return L::sub(x, L::floor(x)); }
+    static inline F abs(F x) { return L::asFloat(L::band(L::asInt(x), L::set1u(0x7fffffffu))); }
+
+    // ---- Transcendentals ----
+
+    // 2^n for integral n in [-126, 127], built in the exponent field
+    static inline F pow2i(F n) {
+        return L::asFloat(L::template shl<23>(L::iadd(L::toInt(n), L::set1u(127))));
+    }
+
+    // e^x = 2^n * e^r, n = round(x / ln 2), |r| <= ln 2 / 2. ln 2 is split in
+    // two (Cody-Waite) so r is exact; e^r is Cephes' degree-6 expf polynomial
+    static inline F exp(F x) {
+        x = clamp(x, L::set1(FAST_EXP_MIN), L::set1(FAST_EXP_MAX));
+        F n = L::floor(L::add(L::mul(x, L::set1(1.44269504088896341f)), L::set1(0.5f)));
+        F r = L::sub(L::sub(x, L::mul(n, L::set1(0.693359375f))), L::mul(n, L::set1(-2.12194440e-4f)));
+
+        F p = L::set1(1.9875691500e-4f);
+        p = L::add(L::mul(p, r), L::set1(1.3981999507e-3f));
+        p = L::add(L::mul(p, r), L::set1(8.3334519073e-3f));
+        p = L::add(L::mul(p, r), L::set1(4.1665795894e-2f));
+        p = L::add(L::mul(p, r), L::set1(1.6666665459e-1f));
+        p = L::add(L::mul(p, r), L::set1(5.0000001201e-1f));
+        F er = L::add(L::add(L::mul(p, L::mul(r, r)), r), L::set1(1.0f));
+        return L::mul(er, pow2i(n));
+    }
+
+    // ln x = e ln 2 + ln m with m in [sqrt(1/2), sqrt(2)), Cephes' logf
+    // polynomial in m - 1. x must be a positive normal float
+    static inline F log(F x) {
+        const F one = L::set1(1.0f);
+        I bits = L::asInt(x);
+        F e = L::toFloat(L::isub(L::template shr<23>(bits), L::set1u(126)));
+        F m = L::asFloat(L::bor(L::band(bits, L::set1u(0x007fffffu)), L::set1u(0x3f000000u)));   // [0.5, 1)
+        M small = L::lt(m, L::set1(0.707106781186547524f));
+        e = L::select(small, L::sub(e, one), e);
+        F t = L::sub(L::select(small, L::add(m, m), m), one);
+        F z = L::mul(t, t);
+
+        F p = L::set1(7.0376836292e-2f);
+        p = L::add(L::mul(p, t), L::set1(-1.1514610310e-1f));
+        p = L::add(L::mul(p, t), L::set1(1.1676998740e-1f));
+        p = L::add(L::mul(p, t), L::set1(-1.2420140846e-1f));
+        p = L::add(L::mul(p, t), L::set1(1.4249322787e-1f));
+        p = L::add(L::mul(p, t), L::set1(-1.6668057665e-1f));
+        p = L::add(L::mul(p, t), L::set1(2.0000714765e-1f));
+        p = L::add(L::mul(p, t), L::set1(-2.4999993993e-1f));
+        p = L::add(L::mul(p, t), L::set1(3.3333331174e-1f));
+        F y = L::mul(L::mul(p, t), z);
+        y = L::add(y, L::mul(e, L::set1(-2.12194440e-4f)));
+        y = L::sub(y, L::mul(z, L::set1(0.5f)));
+        return L::add(L::add(t, y), L::mul(e, L::set1(0.693359375f)));
+    }
+
+    // e^(y ln x); x <= 0 gives 0 (GLSL leaves x < 0 undefined)
+    static inline F pow(F x, F y) {
+        F r = exp(L::mul(y, log(x)));
+        return L::select(L::lt(L::set1(0.0f), x), r, L::set1(0.0f));
+    }
+
+    // The hardware square root is correctly rounded on every ISA here and
+    // measured faster than a bit-trick estimate plus the three Newton steps
+    // it needs for float accuracy; inversesqrt adds one divide's rounding
+    static inline F sqrt(F x) { return L::sqrt(x); }
+    static inline F inversesqrt(F x) { return L::div(L::set1(1.0f), L::sqrt(x)); }
+
+    // ---- Flame shape ----
+
+    // flameRadius (flame_field.cpp) on the fast transcendentals; the
+    // bulge's pow(d, 2.0) is d * d, as pow is undefined for d < 0
+    static inline F flameRadius(F h) {
+        const F one = L::set1(1.0f);
+        F rise = L::sub(one, exp(L::mul(L::sub(L::set1(0.0f), h), L::set1(15.0f))));
+        F taper = pow(L::max(L::sub(one, h), L::set1(0.0f)), L::set1(1.2f));
+        F d = L::div(L::sub(h, L::set1(0.35f)), L::set1(0.18f));
+        F bulge = L::add(one, L::mul(L::set1(0.35f), exp(L::sub(L::set1(0.0f), L::mul(d, d)))));
+        return L::mul(L::mul(L::mul(L::set1(FLAME_BASE_WIDTH), rise), taper), bulge);
+    }
+
+    // ---- Array drivers: full packets, then one zero-padded tail packet ----
+
+    template <class Fn>
+    static inline void map1(const float* x, float* out, size_t n, Fn fn) {
+        size_t i = 0;
+        for (; i + L::W <= n; i += L::W) L::store(out + i, fn(L::load(x + i)));
+        if (i < n) {
+            alignas(32) float t[L::W] = {};
+            std::memcpy(t, x + i, (n - i) * sizeof(float));
+            L::store(t, fn(L::load(t)));
+            std::memcpy(out + i, t, (n - i) * sizeof(float));
+        }
+    }
+
+    static void expN(const float* x, float* out, size_t n) { map1(x, out, n, [](F v) { return exp(v); }); }
+    static void logN(const float* x, float* out, size_t n) { map1(x, out, n, [](F v) { return log(v); }); }
+    static void sqrtN(const float* x, float* out, size_t n) { map1(x, out, n, [](F v) { return sqrt(v); }); }
+
+    static void inversesqrtN(const float* x, float* out, size_t n) {
+        map1(x, out, n, [](F v) { return inversesqrt(v); });
+    }
+
+    static void powN(const float* x, float y, float* out, size_t n) {
+        const F py = L::set1(y);
+        map1(x, out, n, [&](F v) { return pow(v, py); });
+    }
+
+    static void flameRadiusN(const float* h, float* out, size_t n) {
+        map1(h, out, n, [](F v) { return flameRadius(v); });
+    }
+
+    static void normalizeN(float* x, float* y, float* z, size_t n);
+
+    static MathKernels kernels(SimdIsa isa, const char* name) {
+        return {isa, name, L::W, &expN, &logN, &powN, &sqrtN, &inversesqrtN, &normalizeN, &flameRadiusN};
+    }
+};
+
+/* =================== VECTOR PACKETS =================== */
+// GLSL vec3 / vec4 over W lanes in structure-of-arrays form: x holds the x
+// of W vectors, and so on.
+
+template <class L>
+struct Vec3Packet {
+    using F = typename L::F;
+    F x, y, z;
+
+    static Vec3Packet load(const float* px, const float* py, const float* pz) {
+        return {L::load(px), L::load(py), L::load(pz)};
+    }
+    static Vec3Packet splat(Vec3 v) { return {L::set1(v.x), L::set1(v.y), L::set1(v.z)}; }
+
+    void store(float* px, float* py, float* pz) const {
+        L::store(px, x);
+        L::store(py, y);
+        L::store(pz, z);
+    }
+};
+
+template <class L>
+struct Vec4Packet {
+    using F = typename L::F;
+    F x, y, z, w;
+
+    static Vec4Packet load(const float* px, const float* py, const float* pz, const float* pw) {
+        return {L::load(px), L::load(py), L::load(pz), L::load(pw)};
+    }
+    static Vec4Packet splat(float vx, float vy, float vz, float vw) {
+        return {L::set1(vx), L::set1(vy), L::set1(vz), L::set1(vw)};
+    }
+
+    Vec3Packet<L> xyz() const { return {x, y, z}; }
+
+    void store(float* px, float* py, float* pz, float* pw) const {
+        L::store(px, x);
+        L::store(py, y);
+        L::store(pz, z);
+        L::store(pw, w);
+    }
+};
+
+// ---- vec3 ----
+
+template <class L>
+inline Vec3Packet<L> operator+(Vec3Packet<L> a, Vec3Packet<L> b) {
+    return {L::add(a.x, b.x), L::add(a.y, b.y), L::add(a.z, b.z)};
+}
+
+template <class L>
+inline Vec3Packet<L> operator-(Vec3Packet<L> a, Vec3Packet<L> b) {
+    return {L::sub(a.x, b.x), L::sub(a.y, b.y), L::sub(a.z, b.z)};
+}
+
+template <class L>
+inline Vec3Packet<L> operator*(Vec3Packet<L> a, Vec3Packet<L> b) {
+    return {L::mul(a.x, b.x), L::mul(a.y, b.y), L::mul(a.z, b.z)};
+}
+
+template <class L>
+inline Vec3Packet<L> operator*(Vec3Packet<L> a, typename L::F s) {
+    return {L::mul(a.x, s), L::mul(a.y, s), L::mul(a.z, s)};
+}
+
+template <class L>
+inline typename L::F dot(Vec3Packet<L> a, Vec3Packet<L> b) {
+    return L::add(L::add(L::mul(a.x, b.x), L::mul(a.y, b.y)), L::mul(a.z, b.z));
+}
+
+template <class L>
+inline Vec3Packet<L> cross(Vec3Packet<L> a, Vec3Packet<L> b) {
+    return {L::sub(L::mul(a.y, b.z), L::mul(a.z, b.y)),
+            L::sub(L::mul(a.z, b.x), L::mul(a.x, b.z)),
+            L::sub(L::mul(a.x, b.y), L::mul(a.y, b.x))};
+}
+
+template <class L>
+inline typename L::F length(Vec3Packet<L> v) { return MathPacket<L>::sqrt(dot(v, v)); }
+
+template <class L>
+inline typename L::F distance(Vec3Packet<L> a, Vec3Packet<L> b) { return length(a - b); }
+
+// Zero vectors stay zero (GLSL leaves them undefined): inversesqrt(0) is
+// inf and 0 * inf NaN, so those lanes are selected out
+template <class L>
+inline Vec3Packet<L> normalize(Vec3Packet<L> v) {
+    typename L::F d = dot(v, v), zero = L::set1(0.0f);
+    typename L::M nonzero = L::lt(zero, d);
+    Vec3Packet<L> n = v * MathPacket<L>::inversesqrt(d);
+    return {L::select(nonzero, n.x, zero), L::select(nonzero, n.y, zero), L::select(nonzero, n.z, zero)};
+}
+
+template <class L>
+inline Vec3Packet<L> mix(Vec3Packet<L> a, Vec3Packet<L> b, typename L::F t) {
+    using P = MathPacket<L>;
+    return {P::mix(a.x, b.x, t), P::mix(a.y, b.y, t), P::mix(a.z, b.z, t)};
+}
+
+template <class L>
+inline Vec3Packet<L> clamp(Vec3Packet<L> v, typename L::F lo, typename L::F hi) {
+    using P = MathPacket<L>;
+    return {P::clamp(v.x, lo, hi), P::clamp(v.y, lo, hi), P::clamp(v.z, lo, hi)};
+}
+
+// ---- vec4 ----
+
+template <class L>
+inline Vec4Packet<L> operator+(Vec4Packet<L> a, Vec4Packet<L> b) {
+    return {L::add(a.x, b.x), L::add(a.y, b.y), L::add(a.z, b.z), L::add(a.w, b.w)};
+}
+
+template <class L>
+inline Vec4Packet<L> operator-(Vec4Packet<L> a, Vec4Packet<L> b) {
+    return {L::sub(a.x, b.x), L::sub(a.y, b.y), L::sub(a.z, b.z), L::sub(a.w, b.w)};
+}
+
+template <class L>
+inline Vec4Packet<L> operator*(Vec4Packet<L> a, Vec4Packet<L> b) {
+    return {L::mul(a.x, b.x), L::mul(a.y, b.y), L::mul(a.z, b.z), L::mul(a.w, b.w)};
+}
+
+template <class L>
+inline Vec4Packet<L> operator*(Vec4Packet<L> a, typename L::F s) {
+    return {L::mul(a.x, s), L::mul(a.y, s), L::mul(a.z, s), L::mul(a.w, s)};
+}
+
+template <class L>
+inline typename L::F dot(Vec4Packet<L> a, Vec4Packet<L> b) {
+    return L::add(L::add(L::add(L::mul(a.x, b.x), L::mul(a.y, b.y)), L::mul(a.z, b.z)), L::mul(a.w, b.w));
+}
+
+template <class L>
+inline Vec4Packet<L> mix(Vec4Packet<L> a, Vec4Packet<L> b, typename L::F t) {
+    using P = MathPacket<L>;
+    return {P::mix(a.x, b.x, t), P::mix(a.y, b.y, t), P::mix(a.z, b.z, t), P::mix(a.w, b.w, t)};
+}
+
+template <class L>
+inline Vec4Packet<L> clamp(Vec4Packet<L> v, typename L::F lo, typename L::F hi) {
+    using P = MathPacket<L>;
+    return {P::clamp(v.x, lo, hi), P::clamp(v.y, lo, hi), P::clamp(v.z, lo, hi), P::clamp(v.w, lo, hi)};
+}
+
+// Normalizes n vectors stored as separate x / y / z arrays, in place
+template <class L>
+void MathPacket<L>::normalizeN(float* x, float* y, float* z, size_t n) {
+    size_t i = 0;
+    for (; i + L::W <= n; i += L::W) normalize(Vec3Packet<L>::load(x + i, y + i, z + i)).store(x + i, y + i, z + i);
+    if (i < n) {
+        alignas(32) float tx[L::W] = {}, ty[L::W] = {}, tz[L::W] = {};
+        size_t rest = (n - i) * sizeof(float);
+        std::memcpy(tx, x + i, rest);
+        std::memcpy(ty, y + i, rest);
+        std::memcpy(tz, z + i, rest);
+        normalize(Vec3Packet<L>::load(tx, ty, tz)).store(tx, ty, tz);
+        std::memcpy(x + i, tx, rest);
+        std::memcpy(y + i, ty, rest);
+        std::memcpy(z + i, tz, rest);
+    }
+}
@@ -0,0 +1,8 @@
+// AArch64 only: NEON is part of the base ISA, so no runtime check is needed.
+#include "simd_lanes.h"
+#include "simd_math_impl.h"
+
+const MathKernels* mathKernelsNEON() {
+    static const MathKernels k = MathPacket<LanesNEON>::kernels(SimdIsa::NEON, "neon");
+    return &k;
+}
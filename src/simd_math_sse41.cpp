@@ -0,0 +1,8 @@
+// Compiled with -msse4.1 (see CMakeLists.txt); only called after a CPU check.
+#include "simd_lanes.h"
+#include "simd_math_impl.h"
+
+const MathKernels* mathKernelsSSE41() {
+    static const MathKernels k = MathPacket<LanesSSE41>::kernels(SimdIsa::SSE41, "sse4.1");
+    return &k;
+}
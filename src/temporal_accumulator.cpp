@@ -0,0 +1,155 @@
+#include "temporal_accumulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include "profiler.h"
+#include "thread_pool.h"
+
+// The camera of cameraRay(), for projecting points back to pixels
+struct CameraBasis {
+    Vec3 pos, forward, right, up;
+    float aspect;
+
+    explicit CameraBasis(const FlameUniforms& u) {
+        pos = u.camPos;
+        forward = normalize(u.camFront);
+        right = normalize(cross(forward, u.camUp));
+        up = cross(right, forward);
+        aspect = u.aspect;
+    }
+
+    // Continuous pixel coordinates (pixel centres at .5 - 0.5 = integers)
+    // of a view direction d; false if it points behind the camera
+    bool project(Vec3 d, int width, int height, float& px, float& py) const {
+        float z = dot(d, forward);
+        if (z <= 1e-4f) return false;
+        float uvx = dot(d, right) / z / (aspect * 0.5f);
+        float uvy = dot(d, up) / z / 0.5f;
+        px = (uvx + 1.0f) * 0.5f * (float)width - 0.5f;
+        py = (1.0f - uvy) * 0.5f * (float)height - 0.5f;
+        return true;
+    }
+};
+
+const Image& TemporalAccumulator::accumulate(const Image& frame, const std::vector<float>& depth,
+                                             const FlameUniforms& u, ThreadPool& pool) {
+    PROFILE_SCOPE("temporal accumulate");
+    const int w = frame.width, h = frame.height;
+    const size_t pixels = (size_t)w * h;
+
+    if (!valid_ || history_.width != w || history_.height != h) {
+        history_ = frame;
+        historyDepth_ = depth;
+        samples_.assign(pixels, 1);
+        next_.resize(w, h);
+        nextDepth_.assign(pixels, 0.0f);
+        nextSamples_.assign(pixels, 0);
+        prev_ = u;
+        valid_ = true;
+        rejectedFraction_ = 1.0;
+        return history_;
+    }
+
+    const CameraBasis cur(u), prev(prev_);
+    const uint16_t maxSamples = (uint16_t)std::clamp((int)std::lround(1.0f / settings_.blend), 1, 65535);
+    const float tol = settings_.depthTolerance, slack = settings_.depthSlack;
+    std::atomic<size_t> rejected{0};
+
+    pool.parallelFor((size_t)h, [&](size_t row) {
+        const int y = (int)row;
+        const float uvy = 1.0f - 2.0f * ((float)y + 0.5f) / (float)h;
+        size_t rowRejected = 0;
+
+        for (int x = 0; x < w; x++) {
+            const size_t i = (size_t)y * w + x;
+            const float d = depth[i];
+            const float* c = frame.pixel(x, y);
+
+            // Reproject: flame pixels by their world position, the rest by direction
+            float uvx = 2.0f * ((float)x + 0.5f) / (float)w - 1.0f;
+            Vec3 ro, rd;
+            cameraRay(u, uvx, uvy, ro, rd);
+            Vec3 world = ro + rd * d;
+            Vec3 toPrev = d > 0.0f ? world - prev.pos : rd;
+            float expected = d > 0.0f ? length(toPrev) : 0.0f;
+
+            float px, py;
+            bool onScreen = prev.project(toPrev, w, h, px, py) &&
+                            px > -1.0f && px < (float)w && py > -1.0f && py < (float)h;
+
+            // Bilinear history over the texels whose depth matches
+            Vec3 hist = {0.0f, 0.0f, 0.0f};
+            float weight = 0.0f, bestWeight = 0.0f;
+            uint16_t histSamples = 0;
+            if (onScreen) {
+                int x0 = (int)std::floor(px), y0 = (int)std::floor(py);
+                float fx = px - (float)x0, fy = py - (float)y0;
+                for (int k = 0; k < 4; k++) {
+                    int tx = std::clamp(x0 + (k & 1), 0, w - 1);
+                    int ty = std::clamp(y0 + (k >> 1), 0, h - 1);
+                    size_t j = (size_t)ty * w + tx;
+                    float hd = historyDepth_[j];
+                    bool match = d > 0.0f ? hd > 0.0f && fabsf(hd - expected) <= tol * expected + slack
+                                          : hd == 0.0f;
+                    if (!match) continue;
+                    float bw = ((k & 1) ? fx : 1.0f - fx) * ((k >> 1) ? fy : 1.0f - fy);
+                    const float* hc = history_.pixel(tx, ty);
+                    hist += Vec3{hc[0], hc[1], hc[2]} * bw;
+                    weight += bw;
+                    if (bw > bestWeight) { bestWeight = bw; histSamples = samples_[j]; }
+                }
+            }
+
+            float* out = next_.pixel(x, y);
+            nextDepth_[i] = d;
+            if (weight <= 1e-4f) {
+                out[0] = c[0]; out[1] = c[1]; out[2] = c[2];
+                nextSamples_[i] = 1;
+                rowRejected++;
+                continue;
+            }
+            hist = hist * (1.0f / weight);
+
+            // Clamp to the new frame's neighbourhood: mean +- clipSigma
+            // standard deviations, within its min / max
+            Vec3 lo = {c[0], c[1], c[2]}, hi = lo;
+            Vec3 sum = {0.0f, 0.0f, 0.0f}, sumSq = {0.0f, 0.0f, 0.0f};
+            float count = 0.0f;
+            for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, h - 1); ny++) {
+                for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, w - 1); nx++) {
+                    const float* n = frame.pixel(nx, ny);
+                    Vec3 v = {n[0], n[1], n[2]};
+                    lo = {fminf(lo.x, v.x), fminf(lo.y, v.y), fminf(lo.z, v.z)};
+                    hi = {fmaxf(hi.x, v.x), fmaxf(hi.y, v.y), fmaxf(hi.z, v.z)};
+                    sum += v;
+                    sumSq += Vec3{v.x * v.x, v.y * v.y, v.z * v.z};
+                    count += 1.0f;
+                }
+            }
+            Vec3 mean = sum * (1.0f / count);
+            Vec3 var = sumSq * (1.0f / count) - Vec3{mean.x * mean.x, mean.y * mean.y, mean.z * mean.z};
+            Vec3 sigma = Vec3{sqrtf(fmaxf(var.x, 0.0f)), sqrtf(fmaxf(var.y, 0.0f)), sqrtf(fmaxf(var.z, 0.0f))}
+                       * settings_.clipSigma;
+            lo = {fmaxf(lo.x, mean.x - sigma.x), fmaxf(lo.y, mean.y - sigma.y), fmaxf(lo.z, mean.z - sigma.z)};
+            hi = {fminf(hi.x, mean.x + sigma.x), fminf(hi.y, mean.y + sigma.y), fminf(hi.z, mean.z + sigma.z)};
+            hist = {clampf(hist.x, lo.x, hi.x), clampf(hist.y, lo.y, hi.y), clampf(hist.z, lo.z, hi.z)};
+
+            // Running mean until the history holds 1 / blend frames, then exponential
+            uint16_t n = std::min<uint16_t>((uint16_t)(histSamples + 1), maxSamples);
+            float a = 1.0f / (float)n;
+            out[0] = hist.x + (c[0] - hist.x) * a;
+            out[1] = hist.y + (c[1] - hist.y) * a;
+            out[2] = hist.z + (c[2] - hist.z) * a;
+            nextSamples_[i] = n;
+        }
+        rejected.fetch_add(rowRejected, std::memory_order_relaxed);
+    });
+
+    std::swap(history_, next_);
+    std::swap(historyDepth_, nextDepth_);
+    std::swap(samples_, nextSamples_);
+    prev_ = u;
+    rejectedFraction_ = (double)rejected.load() / (double)pixels;
+    return history_;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "cpu_renderer.h"
+
+class ThreadPool;
+
+/* =================== TEMPORAL ACCUMULATION =================== */
+// Exponential history for jittered frames. Each frame is rendered with
+// blue-noise start offsets (RenderOptions::jitter), so a coarse march gives
+// noise instead of bands; blending it into the history averages the noise
+// over frames:
+//
+//   history = mix(reprojected history, frame, max(1 / samples, blend))
+//
+// The history is reprojected with the known cameras: a pixel's flame depth
+// (FlameSample::depth()) gives its world position, which is projected into
+// the previous camera. Pixels without flame reproject by direction only.
+// History is dropped (the pixel restarts from the new frame) when:
+//   - the point was off screen or behind the previous camera
+//   - no history texel around it has a matching depth (disocclusion:
+//     flame revealed, covered, or moved away)
+// and it is clamped to the range of the new frame's 3x3 neighbourhood,
+// which bounds ghosting from the flame's own motion.
+//
+// Colours are blended after tone mapping, as the images come out of
+// renderImage().
+
+struct TemporalSettings {
+    float blend = 0.25f;           // weight of a new frame once converged
+    float depthTolerance = 0.1f;   // relative depth mismatch counted as disocclusion,
+    float depthSlack = 0.3f;       // plus this in world units: jittered depths wander by a step
+    float clipSigma = 1.0f;        // history clamp: neighbourhood mean +- this many std devs
+};
+
+class TemporalAccumulator {
+public:
+    explicit TemporalAccumulator(const TemporalSettings& settings = {}) : settings_(settings) {}
+
+    // Forget the history; the next frame is taken as is
+    void reset() { valid_ = false; }
+
+    // Blend a frame (rendered with u, depth per pixel as in RenderOptions::depth)
+    // into the history and return the result
+    const Image& accumulate(const Image& frame, const std::vector<float>& depth,
+                            const FlameUniforms& u, ThreadPool& pool);
+
+    const Image& result() const { return history_; }
+
+    // Fraction of pixels whose history was dropped by the last accumulate()
+    double rejectedFraction() const { return rejectedFraction_; }
+
+private:
+    TemporalSettings settings_;
+    bool valid_ = false;
+    FlameUniforms prev_;
+    Image history_, next_;
+    std::vector<float> historyDepth_, nextDepth_;
+    std::vector<uint16_t> samples_, nextSamples_;   // frames in each pixel's history
+    double rejectedFraction_ = 0.0;
+};
@@ -0,0 +1,125 @@
+#include "thread_pool.h"
+
+#include <exception>
+#include <string>
+#include "profiler.h"
+
+struct ThreadPool::Batch {
+    const std::function<void(size_t)>* body = nullptr;
+    std::atomic<size_t> remaining{0};
+    std::mutex m;
+    std::condition_variable done;
+    std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+
+    for (unsigned i = 0; i < threadCount; i++)
+        queues_.push_back(std::make_unique<Queue>());
+    for (unsigned i = 1; i < threadCount; i++)
+        workers_.emplace_back([this, i] { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+// Own queue first (front), then steal from the back of the others
+bool ThreadPool::tryPop(unsigned self, Task& out) {
+    {
+        Queue& q = *queues_[self];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (!q.tasks.empty()) {
+            out = q.tasks.front();
+            q.tasks.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    unsigned n = size();
+    for (unsigned k = 1; k < n; k++) {
+        Queue& q = *queues_[(self + k) % n];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (!q.tasks.empty()) {
+            out = q.tasks.back();
+            q.tasks.pop_back();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(const Task& task) {
+    Batch& b = *task.batch;
+    try {
+        (*b.body)(task.index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(b.m);
+        if (!b.error) b.error = std::current_exception();
+    }
+    // Decrement under the lock: the caller owns the batch on its stack and
+    // may return as soon as it observes zero
+    std::lock_guard<std::mutex> lock(b.m);
+    if (b.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        b.done.notify_all();
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+    profilerSetThreadName(("pool worker " + std::to_string(self)).c_str());
+    for (;;) {
+        Task task;
+        if (tryPop(self, task)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_.load() > 0; });
+        if (stop_) return;
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+
+    Batch batch;
+    batch.body = &body;
+    batch.remaining = count;
+
+    // Hand each thread a contiguous block so neighbouring tiles stay on one
+    // core; stealing evens out the load when blocks differ in cost.
+    unsigned n = size();
+    for (unsigned w = 0; w < n; w++) {
+        size_t begin = count * w / n, end = count * (w + 1) / n;
+        if (begin == end) continue;
+        Queue& q = *queues_[w];
+        std::lock_guard<std::mutex> lock(q.m);
+        for (size_t i = begin; i < end; i++) q.tasks.push_back({&batch, i});
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        queued_.fetch_add(count);
+    }
+    wake_.notify_all();
+
+    // The caller works too, then sleeps until stragglers finish
+    Task task;
+    while (batch.remaining.load(std::memory_order_acquire) > 0) {
+        if (tryPop(0, task)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(batch.m);
+        batch.done.wait(lock, [&] { return batch.remaining.load() == 0; });
+    }
+    std::lock_guard<std::mutex> lock(batch.m);  // last worker has let go
+
+    if (batch.error) std::rethrow_exception(batch.error);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* =================== THREAD POOL =================== */
+// Work-stealing pool used by the CPU renderer. Every thread owns a deque:
+// it pops its own work from the front and, when empty, steals from the back
+// of another thread's deque. The thread calling parallelFor() takes part in
+// the work, so a pool of N threads spawns N-1 workers.
+
+class ThreadPool {
+public:
+    // threadCount = 0 uses every hardware thread
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Total number of threads doing work (workers + calling thread)
+    unsigned size() const { return (unsigned)queues_.size(); }
+
+    // Run body(i) for i in [0, count) and wait for all of them.
+    // Rethrows the first exception thrown by a task.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    struct Batch;
+    struct Task { Batch* batch; size_t index; };
+    struct Queue {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    bool tryPop(unsigned self, Task& out);
+    void run(const Task& task);
+    void workerLoop(unsigned self);
+
+    std::vector<std::unique_ptr<Queue>> queues_;   // [0] belongs to the caller
+    std::vector<std::thread> workers_;
+
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> queued_{0};
+    bool stop_ = false;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+
+/* =================== TRIPLE BUFFER =================== */
+// Lock-free hand-off of the latest value from one writer thread to one
+// reader thread. The writer fills its back slot and publishes it; the
+// reader picks up the newest published slot. Neither ever waits, and the
+// reader skips values it was too slow to see.
+
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial) : slots_{initial, initial, initial} {}
+
+    // Writer side: fill write(), then publish() it
+    T& write() { return slots_[back_]; }
+    void publish() { back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+    // Reader side: fetch() takes the newest published value if there is
+    // one (returns whether there was), read() is the one taken last
+    bool fetch() {
+        if (!(middle_.load(std::memory_order_acquire) & FRESH)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& read() const { return slots_[front_]; }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;   // middle slot not yet fetched
+
+    T slots_[3] = {};
+    std::atomic<int> middle_{1};
+    int back_ = 0;    // writer only
+    int front_ = 2;   // reader only
+};
@@ -0,0 +1,234 @@
+#include "volume_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "flame_quality.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+// Stored temperatureFactor range; the factor stays within [-0.25, 1.15]
+constexpr float TEMP_MIN = -0.5f;
+constexpr float TEMP_MAX = 1.5f;
+
+constexpr char     CACHE_MAGIC[4] = {'F', 'L', 'V', 'C'};
+constexpr uint32_t CACHE_VERSION = 2;   // 2: shape of the baked flame
+
+static uint16_t quantize(float v, float lo, float hi) {
+    float n = clampf((v - lo) / (hi - lo), 0.0f, 1.0f);
+    return (uint16_t)(n * 65535.0f + 0.5f);
+}
+
+static float dequantize(float q, float lo, float hi) {
+    return lo + q * ((hi - lo) / 65535.0f);
+}
+
+/* =================== BAKING =================== */
+
+BakeGrid bakeGrid(const BakeSettings& settings, const FlameParams& params) {
+    // Density support: 0 < h < 1 and within flameSupportRadius of the axis,
+    // clipped to the bounding sphere's box
+    BakeGrid g;
+    const Vec3 center = params.sphereCenter();
+    const float radius = params.sphereRadius();
+    float r = fminf(flameSupportRadius(0.0f, 1.0f, params), radius);
+    float yLo = fmaxf(0.0f, center.y - radius);
+    float yHi = fminf(params.height, center.y + radius);
+    g.boundsMin = {-r, yLo, -r};
+    g.boundsMax = {r, yHi, r};
+
+    Vec3 size = g.boundsMax - g.boundsMin;
+    g.invCell = {(settings.nx - 1) / size.x, (settings.ny - 1) / size.y, (settings.nz - 1) / size.z};
+    g.cell = {1.0f / g.invCell.x, 1.0f / g.invCell.y, 1.0f / g.invCell.z};
+    return g;
+}
+
+// The production field on the block; with the defaults this is
+// flameDensity / temperatureFactor exactly
+void bakeNode(const BakeSettings& settings, const BakeGrid& grid, int x, int y, int z, int slice,
+              uint16_t& density, uint16_t& temperature, const FlameParams& params) {
+    const float period = settings.period;
+    float t = period * (float)slice / (float)settings.slices;
+    float w = t / period;
+    Vec3 p = {grid.boundsMin.x + x * grid.cell.x, grid.boundsMin.y + y * grid.cell.y,
+              grid.boundsMin.z + z * grid.cell.z};
+
+    auto densityAt = [&](float time) { return flameDensityT<QualityProduction>(p, time, 1.0f, 0.0f, params); };
+    auto factorAt = [&](float time) { return temperatureFactorT<QualityProduction>(p, time, 0.0f, params); };
+    float d = mixf(densityAt(t), densityAt(t - period), w);
+    float tf = mixf(factorAt(t), factorAt(t - period), w);
+    density = quantize(d, 0.0f, 1.0f);
+    temperature = quantize(tf, TEMP_MIN, TEMP_MAX);
+}
+
+float bakedDensity(float q) {
+    return dequantize(q, 0.0f, 1.0f);
+}
+
+float bakedTemperatureFactor(float q) {
+    return dequantize(q, TEMP_MIN, TEMP_MAX);
+}
+
+void VolumeCache::computeBounds() {
+    BakeGrid g = bakeGrid(settings_, params_);
+    boundsMin_ = g.boundsMin;
+    boundsMax_ = g.boundsMax;
+    invCell_ = g.invCell;
+}
+
+void VolumeCache::bake(const BakeSettings& settings, ThreadPool& pool, const FlameParams& params) {
+    PROFILE_SCOPE("bake");
+    settings_ = settings;
+    params_ = params;
+    settings_.nx = std::max(settings_.nx, 2);
+    settings_.ny = std::max(settings_.ny, 2);
+    settings_.nz = std::max(settings_.nz, 2);
+    settings_.slices = std::max(settings_.slices, 1);
+    computeBounds();
+
+    const int nx = settings_.nx, ny = settings_.ny, nz = settings_.nz;
+    const size_t sliceSize = (size_t)nx * ny * nz;
+    density_.assign(sliceSize * settings_.slices, 0);
+    temperature_.assign(sliceSize * settings_.slices, 0);
+    const BakeGrid grid = bakeGrid(settings_, params_);
+
+    // One task per (slice, z-plane) keeps every core busy even when there
+    // are fewer slices than threads
+    pool.parallelFor((size_t)settings_.slices * nz, [&](size_t job) {
+        int slice = (int)(job / nz);
+        int z = (int)(job % nz);
+        for (int y = 0; y < ny; y++) {
+            for (int x = 0; x < nx; x++) {
+                size_t idx = slice * sliceSize + ((size_t)z * ny + y) * nx + x;
+                bakeNode(settings_, grid, x, y, z, slice, density_[idx], temperature_[idx], params_);
+            }
+        }
+    });
+}
+
+/* =================== FILE I/O =================== */
+
+// The FlameParams members the bake depends on (colour is applied when shading)
+constexpr int SHAPE_VALUES = 7;
+
+static void shapeValues(const FlameParams& p, float out[SHAPE_VALUES]) {
+    const float v[SHAPE_VALUES] = {p.height, p.baseWidth, p.turbulence, p.turbulenceTip, p.flicker, p.swayX, p.swayZ};
+    std::memcpy(out, v, sizeof(v));
+}
+
+bool VolumeCache::save(const std::string& path) const {
+    std::unique_ptr<FILE, int (*)(FILE*)> f(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if (!f) return false;
+
+    int32_t dims[4] = {settings_.nx, settings_.ny, settings_.nz, settings_.slices};
+    float bounds[6] = {boundsMin_.x, boundsMin_.y, boundsMin_.z, boundsMax_.x, boundsMax_.y, boundsMax_.z};
+    float shape[SHAPE_VALUES];
+    shapeValues(params_, shape);
+    bool ok = std::fwrite(CACHE_MAGIC, 4, 1, f.get()) == 1
+           && std::fwrite(&CACHE_VERSION, sizeof(CACHE_VERSION), 1, f.get()) == 1
+           && std::fwrite(dims, sizeof(dims), 1, f.get()) == 1
+           && std::fwrite(&settings_.period, sizeof(float), 1, f.get()) == 1
+           && std::fwrite(bounds, sizeof(bounds), 1, f.get()) == 1
+           && std::fwrite(shape, sizeof(shape), 1, f.get()) == 1
+           && std::fwrite(density_.data(), sizeof(uint16_t), density_.size(), f.get()) == density_.size()
+           && std::fwrite(temperature_.data(), sizeof(uint16_t), temperature_.size(), f.get()) == temperature_.size();
+    return ok;
+}
+
+bool VolumeCache::load(const std::string& path, const BakeSettings& expected, const FlameParams& params) {
+    std::unique_ptr<FILE, int (*)(FILE*)> f(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!f) return false;
+
+    char magic[4];
+    uint32_t version = 0;
+    int32_t dims[4];
+    float period, bounds[6], shape[SHAPE_VALUES], expectedShape[SHAPE_VALUES];
+    if (std::fread(magic, 4, 1, f.get()) != 1 || std::memcmp(magic, CACHE_MAGIC, 4) != 0) return false;
+    if (std::fread(&version, sizeof(version), 1, f.get()) != 1 || version != CACHE_VERSION) return false;
+    if (std::fread(dims, sizeof(dims), 1, f.get()) != 1) return false;
+    if (std::fread(&period, sizeof(float), 1, f.get()) != 1) return false;
+    if (std::fread(bounds, sizeof(bounds), 1, f.get()) != 1) return false;
+    if (std::fread(shape, sizeof(shape), 1, f.get()) != 1) return false;
+
+    if (dims[0] != expected.nx || dims[1] != expected.ny || dims[2] != expected.nz ||
+        dims[3] != expected.slices || period != expected.period)
+        return false;
+    shapeValues(params, expectedShape);
+    if (std::memcmp(shape, expectedShape, sizeof(shape)) != 0) return false;
+
+    settings_ = expected;
+    params_ = params;
+    computeBounds();
+    // Same shape, different bounds: the bound functions of flame_field.cpp
+    // changed since the bake, so it is stale
+    if (bounds[0] != boundsMin_.x || bounds[1] != boundsMin_.y || bounds[2] != boundsMin_.z ||
+        bounds[3] != boundsMax_.x || bounds[4] != boundsMax_.y || bounds[5] != boundsMax_.z)
+        return false;
+
+    size_t count = (size_t)dims[0] * dims[1] * dims[2] * dims[3];
+    density_.resize(count);
+    temperature_.resize(count);
+    if (std::fread(density_.data(), sizeof(uint16_t), count, f.get()) != count ||
+        std::fread(temperature_.data(), sizeof(uint16_t), count, f.get()) != count) {
+        density_.clear();
+        temperature_.clear();
+        return false;
+    }
+    return true;
+}
+
+/* =================== SAMPLING =================== */
+
+VolumeCache::Lookup VolumeCache::locate(Vec3 p, float time) const {
+    Lookup l{};
+    const int nx = settings_.nx, ny = settings_.ny, nz = settings_.nz;
+    float gx = (p.x - boundsMin_.x) * invCell_.x;
+    float gy = (p.y - boundsMin_.y) * invCell_.y;
+    float gz = (p.z - boundsMin_.z) * invCell_.z;
+    if (!(gx >= 0.0f && gy >= 0.0f && gz >= 0.0f && gx <= nx - 1 && gy <= ny - 1 && gz <= nz - 1))
+        return l;  // outside the support: density is zero
+
+    int ix = std::min((int)gx, nx - 2), iy = std::min((int)gy, ny - 2), iz = std::min((int)gz, nz - 2);
+    l.fx = gx - ix; l.fy = gy - iy; l.fz = gz - iz;
+
+    float tm = fmodf(time, settings_.period);
+    if (tm < 0.0f) tm += settings_.period;
+    float ts = tm / settings_.period * settings_.slices;
+    int s0 = std::min((int)ts, settings_.slices - 1);
+    int s1 = (s0 + 1) % settings_.slices;
+    l.ft = ts - (float)s0;
+
+    size_t sliceSize = (size_t)nx * ny * nz;
+    size_t cellBase = ((size_t)iz * ny + iy) * nx + ix;
+    l.base0 = s0 * sliceSize + cellBase;
+    l.base1 = s1 * sliceSize + cellBase;
+    l.inside = true;
+    return l;
+}
+
+float VolumeCache::sampleChannel(const std::vector<uint16_t>& ch, const Lookup& l) const {
+    const size_t sx = 1, sy = settings_.nx, sz = (size_t)settings_.nx * settings_.ny;
+
+    auto trilinear = [&](size_t b) {
+        const uint16_t* c = &ch[b];
+        float x00 = mixf(c[0],           c[sx],           l.fx);
+        float x10 = mixf(c[sy],          c[sy + sx],      l.fx);
+        float x01 = mixf(c[sz],          c[sz + sx],      l.fx);
+        float x11 = mixf(c[sz + sy],     c[sz + sy + sx], l.fx);
+        return mixf(mixf(x00, x10, l.fy), mixf(x01, x11, l.fy), l.fz);
+    };
+    return mixf(trilinear(l.base0), trilinear(l.base1), l.ft);
+}
+
+float VolumeCache::density(Vec3 p, float time, float formation) const {
+    Lookup l = locate(p, time);
+    if (!l.inside) return 0.0f;
+    return bakedDensity(sampleChannel(density_, l)) * formation;
+}
+
+float VolumeCache::temperatureFactor(Vec3 p, float time) const {
+    Lookup l = locate(p, time);
+    if (!l.inside) return 0.0f;
+    return bakedTemperatureFactor(sampleChannel(temperature_, l));
+}
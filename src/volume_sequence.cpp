@@ -0,0 +1,367 @@
+#include "volume_sequence.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "flame_field.h"
+#include "profiler.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr char     SEQ_MAGIC[4] = {'F', 'L', 'V', 'S'};
+constexpr uint32_t SEQ_VERSION = 1;
+constexpr uint64_t SEQ_ALIGN = 64;
+
+static_assert(sizeof(VolumeFileHeader) == 64, "header layout");
+static_assert(sizeof(VolumeBrickRecord) == 40, "brick record layout");
+
+static uint64_t alignUp(uint64_t v) { return (v + SEQ_ALIGN - 1) & ~(SEQ_ALIGN - 1); }
+
+VolumeLayout flameVolumeLayout(int cellsPerAxis) {
+    VolumeLayout l;
+    l.cellsPerAxis = std::max(1, (cellsPerAxis + VOLUME_BRICK - 1) / VOLUME_BRICK) * VOLUME_BRICK;
+    l.min = FLAME_SPHERE_CENTER - Vec3{FLAME_SPHERE_RADIUS, FLAME_SPHERE_RADIUS, FLAME_SPHERE_RADIUS};
+    l.cellSize = 2.0f * FLAME_SPHERE_RADIUS / l.cellsPerAxis;
+    return l;
+}
+
+/* =================== WRITER =================== */
+
+VolumeSequenceWriter::~VolumeSequenceWriter() {
+    if (file_) std::fclose(file_);
+}
+
+bool VolumeSequenceWriter::write(const void* data, size_t bytes) {
+    if (bytes && std::fwrite(data, 1, bytes, file_) != bytes) return false;
+    offset_ += bytes;
+    return true;
+}
+
+bool VolumeSequenceWriter::pad() {
+    static const uint8_t zeros[SEQ_ALIGN] = {};
+    return write(zeros, (size_t)(alignUp(offset_) - offset_));
+}
+
+bool VolumeSequenceWriter::open(const std::string& path, const VolumeLayout& layout, int bits, float fps) {
+    if ((bits != 8 && bits != 16) || fps <= 0.0f || layout.cellsPerAxis <= 0 ||
+        layout.cellsPerAxis % VOLUME_BRICK != 0)
+        return false;
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) return false;
+
+    std::memcpy(header_.magic, SEQ_MAGIC, 4);
+    header_.version = SEQ_VERSION;
+    header_.cellsPerAxis = (uint32_t)layout.cellsPerAxis;
+    header_.brickSize = VOLUME_BRICK;
+    header_.bits = (uint32_t)bits;
+    header_.fps = fps;
+    header_.min[0] = layout.min.x; header_.min[1] = layout.min.y; header_.min[2] = layout.min.z;
+    header_.cellSize = layout.cellSize;
+
+    // Placeholder; finish() rewrites it with the frame count and index
+    offset_ = 0;
+    index_.clear();
+    return write(&header_, sizeof(header_));
+}
+
+bool VolumeSequenceWriter::addFrame(const VolumeBrickFill& fill, ThreadPool& pool) {
+    if (!file_) return false;
+    const int nb = (int)header_.cellsPerAxis / VOLUME_BRICK;
+    const int bits = (int)header_.bits;
+    const float maxQ = bits == 8 ? 255.0f : 65535.0f;
+    const size_t payloadBytes = (size_t)VOLUME_BRICK_CELLS * (bits / 8);
+
+    struct Encoded {
+        bool present = false;
+        VolumeBrickRecord rec{};
+        std::vector<uint8_t> payload[2];
+    };
+    std::vector<Encoded> bricks((size_t)nb * nb * nb);
+
+    pool.parallelFor(bricks.size(), [&](size_t id) {
+        float values[2][VOLUME_BRICK_CELLS];
+        if (!fill((int)id, values[0], values[1])) return;
+
+        Encoded& e = bricks[id];
+        e.rec.id = (uint32_t)id;
+        bool empty = true;
+        for (int c = 0; c < 2; c++) {
+            const float* v = values[c];
+            auto [lo, hi] = std::minmax_element(v, v + VOLUME_BRICK_CELLS);
+            if (*lo != 0.0f || *hi != 0.0f) empty = false;
+
+            if (*hi - *lo <= 1e-6f) {
+                e.rec.encoding[c] = 0;
+                e.rec.offset[c] = *lo;
+                continue;
+            }
+            e.rec.encoding[c] = 1;
+            e.rec.offset[c] = *lo;
+            e.rec.scale[c] = (*hi - *lo) / maxQ;
+            float inv = 1.0f / e.rec.scale[c];
+            e.payload[c].resize(payloadBytes);
+            for (int i = 0; i < VOLUME_BRICK_CELLS; i++) {
+                float q = clampf((v[i] - *lo) * inv + 0.5f, 0.0f, maxQ);
+                if (bits == 8) {
+                    e.payload[c][i] = (uint8_t)q;
+                } else {
+                    uint16_t q16 = (uint16_t)q;
+                    std::memcpy(&e.payload[c][i * 2], &q16, 2);
+                }
+            }
+        }
+        e.present = !empty;
+    });
+
+    // Lay the frame out: counts, records, then 64-byte aligned payloads
+    std::vector<VolumeBrickRecord> records;
+    for (const Encoded& e : bricks)
+        if (e.present) records.push_back(e.rec);
+
+    if (!pad()) return false;
+    VolumeFrameEntry entry{offset_, 0};
+    uint64_t payloadAt = alignUp(offset_ + 8 + records.size() * sizeof(VolumeBrickRecord));
+    size_t r = 0;
+    for (const Encoded& e : bricks) {
+        if (!e.present) continue;
+        for (int c = 0; c < 2; c++) {
+            if (e.rec.encoding[c] == 0) continue;
+            records[r].payload[c] = payloadAt;
+            payloadAt += payloadBytes;
+        }
+        r++;
+    }
+
+    uint32_t counts[2] = {(uint32_t)records.size(), 0};
+    if (!write(counts, sizeof(counts)) ||
+        !write(records.data(), records.size() * sizeof(VolumeBrickRecord)) || !pad())
+        return false;
+    for (const Encoded& e : bricks)
+        for (int c = 0; c < 2; c++)
+            if (e.present && e.rec.encoding[c] == 1 && !write(e.payload[c].data(), payloadBytes)) return false;
+
+    entry.bytes = offset_ - entry.offset;
+    index_.push_back(entry);
+    return true;
+}
+
+bool VolumeSequenceWriter::finish() {
+    if (!file_) return false;
+    bool ok = pad();
+    header_.indexOffset = offset_;
+    header_.frameCount = (uint32_t)index_.size();
+    ok = ok && write(index_.data(), index_.size() * sizeof(VolumeFrameEntry));
+    ok = ok && std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+    ok = std::fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    return ok;
+}
+
+/* =================== READER =================== */
+
+VolumeSequence::~VolumeSequence() { close(); }
+
+bool VolumeSequence::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return false;
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+    data_ = (const uint8_t*)view;
+    size_ = (uint64_t)size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    data_ = (const uint8_t*)view;
+    size_ = (uint64_t)st.st_size;
+#endif
+
+    // Header and index must be self-consistent and inside the file
+    bool ok = size_ >= sizeof(VolumeFileHeader);
+    if (ok) std::memcpy(&header_, data_, sizeof(header_));
+    ok = ok && std::memcmp(header_.magic, SEQ_MAGIC, 4) == 0 && header_.version == SEQ_VERSION &&
+         header_.brickSize == VOLUME_BRICK && (header_.bits == 8 || header_.bits == 16) &&
+         header_.cellsPerAxis > 0 && header_.cellsPerAxis % VOLUME_BRICK == 0 && header_.fps > 0.0f &&
+         header_.cellSize > 0.0f && header_.frameCount > 0 && header_.indexOffset % SEQ_ALIGN == 0 &&
+         header_.indexOffset <= size_ &&
+         (size_ - header_.indexOffset) / sizeof(VolumeFrameEntry) >= header_.frameCount;
+    if (ok) {
+        index_ = (const VolumeFrameEntry*)(data_ + header_.indexOffset);
+        for (uint32_t i = 0; i < header_.frameCount && ok; i++)
+            ok = index_[i].offset <= size_ && index_[i].bytes >= 8 && index_[i].bytes <= size_ - index_[i].offset;
+    }
+    if (!ok) {
+        close();
+        return false;
+    }
+
+    stop_ = false;
+    requested_ = resident_ = -1;
+    prefetcher_ = std::thread([this] { prefetchLoop(); });
+    return true;
+}
+
+void VolumeSequence::close() {
+    if (prefetcher_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        prefetcher_.join();
+    }
+    if (data_) {
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+        CloseHandle((HANDLE)mapping_);
+#else
+        munmap((void*)data_, (size_t)size_);
+#endif
+    }
+    data_ = nullptr;
+    mapping_ = nullptr;
+    index_ = nullptr;
+    size_ = 0;
+}
+
+int VolumeSequence::frameAt(float time) const {
+    int count = frameCount();
+    int f = (int)floorf(time * header_.fps) % count;
+    return f < 0 ? f + count : f;
+}
+
+VolumeFrame VolumeSequence::frame(int index) const {
+    VolumeFrame f;
+    f.n_ = (int)header_.cellsPerAxis;
+    f.nb_ = f.n_ / VOLUME_BRICK;
+    f.bits_ = (int)header_.bits;
+    f.min_ = {header_.min[0], header_.min[1], header_.min[2]};
+    f.invCell_ = 1.0f / header_.cellSize;
+    f.base_ = data_;
+    f.lookup_.assign((size_t)f.nb_ * f.nb_ * f.nb_, nullptr);
+    if (index < 0 || index >= frameCount()) return f;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requested_ = (index + 1) % frameCount();
+    }
+    wake_.notify_one();
+
+    const VolumeFrameEntry& e = index_[index];
+    uint32_t count;
+    std::memcpy(&count, data_ + e.offset, sizeof(count));
+    if (count > (e.bytes - 8) / sizeof(VolumeBrickRecord)) return f;   // corrupt frame: empty
+
+    const uint64_t payloadBytes = (uint64_t)VOLUME_BRICK_CELLS * (header_.bits / 8);
+    const VolumeBrickRecord* records = (const VolumeBrickRecord*)(data_ + e.offset + 8);
+    for (uint32_t i = 0; i < count; i++) {
+        const VolumeBrickRecord* r = &records[i];
+        bool valid = r->id < f.lookup_.size();
+        for (int c = 0; c < 2 && valid; c++)
+            valid = r->encoding[c] == 0 ||
+                    (r->encoding[c] == 1 && r->payload[c] % 2 == 0 && size_ >= payloadBytes &&
+                     r->payload[c] <= size_ - payloadBytes);
+        if (!valid) continue;
+        f.lookup_[r->id] = r;
+        f.brickCount_++;
+    }
+    return f;
+}
+
+void VolumeSequence::prefetchLoop() {
+#ifndef _WIN32
+    const uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    auto advise = [&](int frame, int advice) {
+        uint64_t begin = index_[frame].offset & ~(page - 1);
+        uint64_t end = index_[frame].offset + index_[frame].bytes;
+        madvise((void*)(data_ + begin), (size_t)(end - begin), advice);
+    };
+#endif
+
+    profilerSetThreadName("volume prefetch");
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [&] { return stop_ || (requested_ >= 0 && requested_ != resident_); });
+        if (stop_) return;
+        int frame = requested_;
+        lock.unlock();
+        PROFILE_SCOPE("prefetch frame");
+
+        // Fault the frame in ahead of the renderer
+        const VolumeFrameEntry& e = index_[frame];
+#ifndef _WIN32
+        advise(frame, MADV_WILLNEED);
+#endif
+        volatile uint8_t sink = 0;
+        for (uint64_t o = e.offset; o < e.offset + e.bytes; o += 4096) sink = sink + data_[o];
+
+#ifndef _WIN32
+        // Release frames behind the playhead; clean file pages refault if needed
+        int count = frameCount();
+        if (count > 4) advise((frame - 3 + count) % count, MADV_DONTNEED);
+#endif
+
+        lock.lock();
+        resident_ = frame;
+    }
+}
+
+/* =================== SAMPLING =================== */
+
+float VolumeFrame::at(int ch, int x, int y, int z) const {
+    if ((unsigned)x >= (unsigned)n_ || (unsigned)y >= (unsigned)n_ || (unsigned)z >= (unsigned)n_) return 0.0f;
+    const VolumeBrickRecord* r =
+        lookup_[((size_t)(z / VOLUME_BRICK) * nb_ + y / VOLUME_BRICK) * nb_ + x / VOLUME_BRICK];
+    if (!r) return 0.0f;
+    if (r->encoding[ch] == 0) return r->offset[ch];
+
+    constexpr int M = VOLUME_BRICK - 1;
+    int l = ((z & M) * VOLUME_BRICK + (y & M)) * VOLUME_BRICK + (x & M);
+    const uint8_t* p = base_ + r->payload[ch];
+    float q = bits_ == 8 ? (float)p[l] : (float)((const uint16_t*)p)[l];
+    return r->offset[ch] + r->scale[ch] * q;
+}
+
+float VolumeFrame::sample(int ch, Vec3 p) const {
+    float gx = (p.x - min_.x) * invCell_ - 0.5f;
+    float gy = (p.y - min_.y) * invCell_ - 0.5f;
+    float gz = (p.z - min_.z) * invCell_ - 0.5f;
+    float fx = floorf(gx), fy = floorf(gy), fz = floorf(gz);
+    int x = (int)fx, y = (int)fy, z = (int)fz;
+    float tx = gx - fx, ty = gy - fy, tz = gz - fz;
+
+    float x00 = mixf(at(ch, x, y, z),         at(ch, x + 1, y, z),         tx);
+    float x10 = mixf(at(ch, x, y + 1, z),     at(ch, x + 1, y + 1, z),     tx);
+    float x01 = mixf(at(ch, x, y, z + 1),     at(ch, x + 1, y, z + 1),     tx);
+    float x11 = mixf(at(ch, x, y + 1, z + 1), at(ch, x + 1, y + 1, z + 1), tx);
+    return mixf(mixf(x00, x10, ty), mixf(x01, x11, ty), tz);
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "math_utils.h"
+
+class ThreadPool;
+
+/* =================== VOLUME SEQUENCE FILES =================== */
+// On-disk density/temperature sequences ("FLVS") for playback without
+// holding the sequence in RAM. Frames come from baking flameDensity or from
+// the fluid solver; playback memory-maps the file and reads bricks in place.
+//
+// Layout (little endian, every block 64-byte aligned):
+//   header      VolumeFileHeader
+//   frame i     u32 brickCount, u32 0, VolumeBrickRecord[brickCount],
+//               then the quantized payloads of the frame's bricks
+//   index       VolumeFrameEntry[frameCount] (offset and size of each frame)
+//
+// Each frame stores only the bricks that hold gas. A brick channel is either
+// constant (no payload, value in offset) or BRICK^3 8- or 16-bit samples
+// with a per-brick scale and offset: v = offset + scale * q. Dropping empty
+// bricks and constant channels is the compression. Payloads stay in their
+// final form, so a sample is a load from the mapping with no decode pass.
+//
+// The reader hands out VolumeFrame views. Asking for frame i prefetches
+// frame i+1 on a background thread (madvise + page touch) and drops frames
+// behind the playhead from the process, so resident memory stays a few
+// frames deep whatever the file size; the page cache does the rest.
+
+constexpr int VOLUME_BRICK = 8;
+constexpr int VOLUME_BRICK_CELLS = VOLUME_BRICK * VOLUME_BRICK * VOLUME_BRICK;
+
+// Cell-centred grid the frames are stored on
+struct VolumeLayout {
+    int   cellsPerAxis = 64;   // multiple of VOLUME_BRICK
+    Vec3  min = {0, 0, 0};
+    float cellSize = 0.0f;
+};
+
+// The bounding-sphere cube used by the occupancy grid and the fluid solver
+VolumeLayout flameVolumeLayout(int cellsPerAxis);
+
+#pragma pack(push, 1)
+struct VolumeFileHeader {
+    char     magic[4];         // "FLVS"
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t cellsPerAxis;
+    uint32_t brickSize;
+    uint32_t bits;             // 8 or 16
+    float    fps;
+    float    min[3];
+    float    cellSize;
+    uint64_t indexOffset;
+    uint8_t  reserved[12];
+};
+
+struct VolumeBrickRecord {
+    uint32_t id;               // (bz * nb + by) * nb + bx
+    uint8_t  encoding[2];      // per channel: 0 = constant, 1 = quantized
+    uint16_t reserved;
+    float    scale[2];
+    float    offset[2];
+    uint64_t payload[2];       // file offsets of quantized channels
+};
+
+struct VolumeFrameEntry {
+    uint64_t offset;
+    uint64_t bytes;
+};
+#pragma pack(pop)
+
+// ---- Writing ----
+
+// Fills one brick's cell-centred density and temperature (BRICK^3 each,
+// [z][y][x]); returns false if the brick holds nothing
+using VolumeBrickFill = std::function<bool(int brickId, float* density, float* temperature)>;
+
+class VolumeSequenceWriter {
+public:
+    ~VolumeSequenceWriter();
+
+    bool open(const std::string& path, const VolumeLayout& layout, int bits, float fps);
+
+    // Encode a frame; bricks are filled and quantized in parallel
+    bool addFrame(const VolumeBrickFill& fill, ThreadPool& pool);
+
+    // Write the frame index and final header; the file is unusable without it
+    bool finish();
+
+    uint64_t bytesWritten() const { return offset_; }
+    int frameCount() const { return (int)index_.size(); }
+
+private:
+    bool write(const void* data, size_t bytes);
+    bool pad();
+
+    FILE* file_ = nullptr;
+    VolumeFileHeader header_{};
+    uint64_t offset_ = 0;
+    std::vector<VolumeFrameEntry> index_;
+};
+
+// ---- Playback ----
+
+class VolumeSequence;
+
+// Zero-copy view of one frame; valid while its VolumeSequence is open
+class VolumeFrame {
+public:
+    float density(Vec3 p) const { return sample(0, p); }
+    float temperature(Vec3 p) const { return sample(1, p); }
+    size_t brickCount() const { return brickCount_; }
+
+private:
+    friend class VolumeSequence;
+    float at(int ch, int x, int y, int z) const;
+    float sample(int ch, Vec3 p) const;
+
+    const uint8_t* base_ = nullptr;                    // start of the mapping
+    std::vector<const VolumeBrickRecord*> lookup_;     // brick id -> record or null
+    size_t brickCount_ = 0;
+    int n_ = 0, nb_ = 0, bits_ = 8;
+    Vec3 min_ = {0, 0, 0};
+    float invCell_ = 0.0f;
+};
+
+class VolumeSequence {
+public:
+    VolumeSequence() = default;
+    ~VolumeSequence();
+    VolumeSequence(const VolumeSequence&) = delete;
+    VolumeSequence& operator=(const VolumeSequence&) = delete;
+
+    // Map the file and check the header and index; false on any mismatch
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return data_ != nullptr; }
+    int frameCount() const { return (int)header_.frameCount; }
+    float fps() const { return header_.fps; }
+    int bits() const { return (int)header_.bits; }
+    uint64_t fileBytes() const { return size_; }
+
+    // Frame shown at a time; the sequence loops
+    int frameAt(float time) const;
+
+    // View of a frame. Thread-safe; queues a prefetch of the next frame.
+    VolumeFrame frame(int index) const;
+
+private:
+    void prefetchLoop();
+
+    const uint8_t* data_ = nullptr;
+    uint64_t size_ = 0;
+    void* mapping_ = nullptr;          // platform handle (Windows file mapping)
+    VolumeFileHeader header_{};
+    const VolumeFrameEntry* index_ = nullptr;
+
+    // Prefetcher: latest requested frame wins
+    std::thread prefetcher_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable wake_;
+    mutable int requested_ = -1;
+    int resident_ = -1;                // last frame brought in by the prefetcher
+    bool stop_ = false;
+};
+
+// Field policy for marchFlame() that reads one frame
+struct VolumeFrameField {
+    const VolumeFrame* frame;
+    float formation;
+
+    float density(Vec3 p) const { return frame->density(p) * formation; }
+    float temperature(Vec3 p, float) const { return clampf(frame->temperature(p), 0.0f, 1.0f); }
+};
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_path.h"
+#include "cpu_renderer.h"
+#include "flame_scene.h"
+#include "image_io.h"
+#include "thread_pool.h"
+
+/* =================== GOLDEN IMAGE / PERF BUDGET TEST =================== */
+// Renders a fixed set of camera / time / option configurations through the
+// CPU renderer and checks each one against tests/golden:
+//
+//   images   <name>.png, compared with a perceptual tolerance: SSIM of the
+//            luma over 8x8 windows, plus the share of pixels with a visible
+//            (> VISIBLE_STEP 8-bit steps) difference in any channel
+//   --perf   single-thread render time against budgets.txt, in units of a
+//            fixed calibration loop timed next to each render (median over
+//            the runs) so the budgets carry over between machines and ride
+//            out load changes; fails above budget * (1 + margin)
+//
+// Configurations that stand in for another (the lookup tables, say) name
+// that configuration's golden, so an optimization has to reproduce the
+// exact picture. --update re-renders the goldens (or, with --perf, the
+// budgets) after an intended change; review the new images before
+// committing them.
+//
+// Usage: FlameGoldenTest <golden dir> [--perf] [--update] [--margin m] [--only name]
+
+constexpr int WIDTH = 160;
+constexpr int HEIGHT = 90;
+
+constexpr double MIN_SSIM = 0.999;
+constexpr int VISIBLE_STEP = 2;
+constexpr double MAX_VISIBLE_SHARE = 0.001;
+
+constexpr int PERF_REPEATS = 5;             // at least, and ...
+constexpr double PERF_MIN_TOTAL_MS = 250.0; // ... until this much time is spent
+constexpr double DEFAULT_PERF_MARGIN = 0.3;
+
+struct Config {
+    const char* name;
+    const char* golden;   // golden image to compare against; null = its own
+    FlameUniforms u;
+    RenderOptions options;
+    int candles = 0;      // render a candle field of this many flames
+};
+
+static Config makeConfig(const char* name, Vec3 camPos, Vec3 camFront, float time) {
+    Config c;
+    c.name = name;
+    c.golden = nullptr;
+    c.u.camPos = camPos;
+    c.u.camFront = normalize(camFront);
+    c.u.aspect = (float)WIDTH / (float)HEIGHT;
+    c.u.time = time;
+    return c;
+}
+
+static std::vector<Config> makeConfigs() {
+    std::vector<Config> configs;
+    configs.push_back(makeConfig("default_t0", {0.0f, 0.8f, 3.0f}, {0.0f, 0.0f, -1.0f}, 0.0f));
+    configs.push_back(makeConfig("default_t1.5", {0.0f, 0.8f, 3.0f}, {0.0f, 0.0f, -1.0f}, 1.5f));
+
+    Config forming = makeConfig("forming", {0.0f, 0.8f, 3.0f}, {0.0f, 0.0f, -1.0f}, 0.7f);
+    forming.u.formation = 0.4f;
+    configs.push_back(forming);
+
+    // Middle of each bench path segment
+    const int pathFrames = 4 * BENCH_SEGMENT_COUNT;
+    static std::string segmentNames[BENCH_SEGMENT_COUNT];
+    for (int seg = 0; seg < BENCH_SEGMENT_COUNT; seg++) {
+        BenchPose pose = benchPose(seg * 4 + 2, pathFrames);
+        segmentNames[seg] = std::string("path_") + pose.segment;
+        configs.push_back(makeConfig(segmentNames[seg].c_str(), pose.camPos, pose.camFront, 1.0f));
+    }
+
+    Config preview = makeConfig("preview", {0.0f, 0.8f, 3.0f}, {0.0f, 0.0f, -1.0f}, 1.5f);
+    preview.options.quality = QualityTier::Preview;
+    configs.push_back(preview);
+
+    Config lod = makeConfig("lod_distant", {0.0f, 1.0f, 25.0f}, {0.0f, 0.0f, -1.0f}, 1.0f);
+    lod.options.lod = true;
+    configs.push_back(lod);
+
+    // Must not change the picture: compared with the exact render
+    Config rect = makeConfig("screen_rect", {0.0f, 0.8f, 3.0f}, {0.0f, 0.0f, -1.0f}, 1.5f);
+    rect.golden = "default_t1.5";
+    rect.options.screenRect = true;
+    configs.push_back(rect);
+
+    Config lut = makeConfig("lut", {0.0f, 0.8f, 3.0f}, {0.0f, 0.0f, -1.0f}, 1.5f);
+    lut.golden = "default_t1.5";
+    lut.options.tables = true;
+    configs.push_back(lut);
+
+    Config candles = makeConfig("candles", {0.0f, 5.0f, 7.0f}, {0.0f, -0.57f, -0.82f}, 1.0f);
+    candles.candles = 25;
+    configs.push_back(candles);
+    return configs;
+}
+
+/* =================== IMAGE COMPARISON =================== */
+
+struct ImageDiff {
+    double ssim = 1.0;
+    double visibleShare = 0.0;   // pixels differing by > VISIBLE_STEP in a channel
+    int maxStep = 0;
+};
+
+// Rec. 709 luma of 8-bit values, as the eye weighs the channels
+static std::vector<double> luma(const std::vector<uint8_t>& rgb) {
+    std::vector<double> y(rgb.size() / 3);
+    for (size_t i = 0; i < y.size(); i++)
+        y[i] = 0.2126 * rgb[i * 3] + 0.7152 * rgb[i * 3 + 1] + 0.0722 * rgb[i * 3 + 2];
+    return y;
+}
+
+// Mean SSIM over 8x8 windows at a stride of 4, standard constants for 8-bit
+static double ssim(const std::vector<double>& a, const std::vector<double>& b, int w, int h) {
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+    const int win = 8, stride = 4;
+    double sum = 0.0;
+    int windows = 0;
+    for (int y0 = 0; y0 + win <= h; y0 += stride) {
+        for (int x0 = 0; x0 + win <= w; x0 += stride) {
+            double ma = 0, mb = 0, va = 0, vb = 0, cov = 0;
+            for (int y = y0; y < y0 + win; y++)
+                for (int x = x0; x < x0 + win; x++) {
+                    ma += a[(size_t)y * w + x];
+                    mb += b[(size_t)y * w + x];
+                }
+            const double n = win * win;
+            ma /= n;
+            mb /= n;
+            for (int y = y0; y < y0 + win; y++)
+                for (int x = x0; x < x0 + win; x++) {
+                    double da = a[(size_t)y * w + x] - ma, db = b[(size_t)y * w + x] - mb;
+                    va += da * da;
+                    vb += db * db;
+                    cov += da * db;
+                }
+            va /= n - 1;
+            vb /= n - 1;
+            cov /= n - 1;
+            sum += (2 * ma * mb + c1) * (2 * cov + c2) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+            windows++;
+        }
+    }
+    return windows ? sum / windows : 1.0;
+}
+
+static ImageDiff compare(const Image& img, const Image& golden) {
+    std::vector<uint8_t> a = toRGB8(img), b = toRGB8(golden);
+    ImageDiff d;
+    size_t visible = 0;
+    for (size_t i = 0; i < a.size(); i += 3) {
+        int m = 0;
+        for (int c = 0; c < 3; c++) m = std::max(m, std::abs((int)a[i + c] - (int)b[i + c]));
+        d.maxStep = std::max(d.maxStep, m);
+        if (m > VISIBLE_STEP) visible++;
+    }
+    d.visibleShare = (double)visible / (double)(a.size() / 3);
+    d.ssim = ssim(luma(a), luma(b), img.width, img.height);
+    return d;
+}
+
+/* =================== RENDERING =================== */
+
+static RenderStats render(const Config& c, ThreadPool& pool, Image& img) {
+    FlameScene scene;
+    RenderOptions options = c.options;
+    if (c.candles > 0) {
+        scene = makeCandleField(c.candles);
+        options.scene = &scene;
+    }
+    img.resize(WIDTH, HEIGHT);
+    return renderImage(c.u, img, pool, options);
+}
+
+// Fixed scalar workload, independent of the renderer. It runs next to every
+// timed render so both see the same clock speed and machine load
+static double calibrationMs() {
+    volatile float sink = 0.0f;
+    auto t0 = std::chrono::steady_clock::now();
+    float x = 0.5f, acc = 0.0f;
+    for (int i = 0; i < 1000000; i++) {
+        x = x * 0.999f + 0.001f;
+        acc += expf(-x) * sqrtf(x + (float)(i & 7));
+    }
+    sink = sink + acc;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+/* =================== BUDGETS FILE =================== */
+// One "<config> <cost>" per line, cost = render ms / calibration ms; '#'
+// starts a comment
+
+static std::map<std::string, double> readBudgets(const std::string& path) {
+    std::map<std::string, double> budgets;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        std::string name;
+        double cost;
+        if (ss >> name >> cost) budgets[name] = cost;
+    }
+    return budgets;
+}
+
+static bool writeBudgets(const std::string& path, const std::map<std::string, double>& budgets) {
+    std::ofstream out(path);
+    out << "# Single-thread render time of each FlameGoldenTest configuration, in units\n"
+           "# of its calibration loop. Regenerate with FlameGoldenTest <dir> --perf --update\n";
+    char line[128];
+    for (const auto& [name, cost] : budgets) {
+        std::snprintf(line, sizeof(line), "%-16s %.3f\n", name.c_str(), cost);
+        out << line;
+    }
+    return (bool)out;
+}
+
+/* =================== CHECKS =================== */
+
+static bool checkImages(const std::vector<Config>& configs, const std::string& dir, bool update) {
+    ThreadPool pool;
+    std::printf("%-16s %-16s %8s %10s %8s  %s\n", "config", "golden", "SSIM", "visible %", "max", "result");
+    bool ok = true;
+    for (const Config& c : configs) {
+        if (update && c.golden) continue;   // renders someone else's golden
+        Image img;
+        render(c, pool, img);
+        std::string golden = dir + "/" + (c.golden ? c.golden : c.name) + ".png";
+        if (update) {
+            if (!writeImage(golden, img)) {
+                std::fprintf(stderr, "Failed to write %s\n", golden.c_str());
+                return false;
+            }
+            std::printf("%-16s wrote %s\n", c.name, golden.c_str());
+            continue;
+        }
+
+        Image ref;
+        if (!readImage(golden, ref) || ref.width != img.width || ref.height != img.height) {
+            std::printf("%-16s missing or mismatched golden %s  FAIL\n", c.name, golden.c_str());
+            ok = false;
+            continue;
+        }
+        ImageDiff d = compare(img, ref);
+        bool pass = d.ssim >= MIN_SSIM && d.visibleShare <= MAX_VISIBLE_SHARE;
+        std::printf("%-16s %-16s %8.5f %10.3f %8d  %s\n", c.name, c.golden ? c.golden : "-", d.ssim,
+                    d.visibleShare * 100.0, d.maxStep, pass ? "ok" : "FAIL");
+        ok = ok && pass;
+    }
+    if (!update)
+        std::printf("\npass: SSIM >= %.3f and <= %.1f%% of pixels off by more than %d 8-bit steps\n", MIN_SSIM,
+                    MAX_VISIBLE_SHARE * 100.0, VISIBLE_STEP);
+    return ok;
+}
+
+static double median(std::vector<double> v) {
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+static bool checkPerf(const std::vector<Config>& configs, const std::string& dir, bool update, double margin) {
+    ThreadPool pool(1);
+    std::string path = dir + "/budgets.txt";
+    std::map<std::string, double> budgets = readBudgets(path);
+    std::printf("median of %d+ runs, 1 thread, margin %.0f%%\n\n", PERF_REPEATS, margin * 100.0);
+    std::printf("%-16s %10s %10s %10s %8s  %s\n", "config", "ms", "cost", "budget", "ratio", "result");
+
+    bool ok = true;
+    for (const Config& c : configs) {
+        Image img;
+        std::vector<double> times, costs;
+        double total = 0.0;
+        for (int r = 0; r < PERF_REPEATS || total < PERF_MIN_TOTAL_MS; r++) {
+            double unit = calibrationMs();
+            double t = render(c, pool, img).seconds * 1000.0;
+            times.push_back(t);
+            costs.push_back(t / unit);
+            total += t + unit;
+        }
+        double ms = median(times), cost = median(costs);
+        if (update) {
+            budgets[c.name] = cost;   // --only updates just that entry
+            std::printf("%-16s %10.2f %10.3f\n", c.name, ms, cost);
+            continue;
+        }
+
+        auto it = budgets.find(c.name);
+        if (it == budgets.end()) {
+            std::printf("%-16s %10.2f %10.3f %10s %8s  FAIL (no budget)\n", c.name, ms, cost, "-", "-");
+            ok = false;
+            continue;
+        }
+        double ratio = cost / it->second;
+        const char* result = ratio > 1.0 + margin ? "FAIL" : ratio < 1.0 - margin ? "ok (faster: update budget)" : "ok";
+        std::printf("%-16s %10.2f %10.3f %10.3f %8.2f  %s\n", c.name, ms, cost, it->second, ratio, result);
+        ok = ok && ratio <= 1.0 + margin;
+    }
+    if (update) {
+        if (!writeBudgets(path, budgets)) {
+            std::fprintf(stderr, "Failed to write %s\n", path.c_str());
+            return false;
+        }
+        std::printf("\nWrote %s\n", path.c_str());
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    std::string dir;
+    bool perf = false, update = false;
+    double margin = DEFAULT_PERF_MARGIN;
+    std::string only;
+    bool usage = false;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--perf") perf = true;
+        else if (a == "--update") update = true;
+        else if (a == "--margin" && hasValue) margin = std::atof(argv[++i]);
+        else if (a == "--only" && hasValue) only = argv[++i];
+        else if (dir.empty() && a[0] != '-') dir = a;
+        else usage = true;
+    }
+    if (usage || dir.empty() || margin < 0.0) {
+        std::fprintf(stderr, "Usage: FlameGoldenTest <golden dir> [--perf] [--update] [--margin m] [--only name]\n");
+        return 1;
+    }
+
+    std::vector<Config> configs;
+    for (const Config& c : makeConfigs())
+        if (only.empty() || only == c.name) configs.push_back(c);
+    if (configs.empty()) {
+        std::fprintf(stderr, "No configuration named %s\n", only.c_str());
+        return 1;
+    }
+
+    bool ok = perf ? checkPerf(configs, dir, update, margin) : checkImages(configs, dir, update);
+    return ok ? 0 : 1;
+}